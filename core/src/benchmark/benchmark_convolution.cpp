@@ -22,6 +22,7 @@
 //#define SMPL_FRAME_TIME 0.6667f
 #include <profiler.h>
 #include <containers.h>
+#include <non_uniform_convolution_effect.h>
 using namespace ipl;
 
 #include <phonon.h>
@@ -335,3 +336,99 @@ BENCHMARK(convolution)
 #endif
 
 }
+
+void BenchmarkNonUniformConvolutionForSettings(const float duration,
+                                               const int order,
+                                               shared_ptr<BackgroundJobQueue> jobQueue)
+{
+    const auto kNumRuns = 200;
+    const auto numChannels = (order + 1) * (order + 1);
+    const auto irSize = static_cast<int>(ceilf(duration * gSamplingRate));
+
+    ImpulseResponse ir(duration, order, gSamplingRate);
+    for (auto i = 0; i < ir.numChannels(); ++i)
+    {
+        FillRandomData(ir[i], ir.numSamples());
+    }
+
+    TripleBuffer<OverlapSaveFIR> fftIR;
+    fftIR.initBuffers(numChannels, irSize, gFrameSize);
+
+    OverlapSavePartitioner partitioner(gFrameSize);
+    partitioner.partition(ir, numChannels, irSize, *fftIR.writeBuffer);
+    fftIR.commitWriteBuffer();
+
+    AudioSettings audioSettings{gSamplingRate, gFrameSize};
+
+    AudioBuffer in(1, gFrameSize);
+    AudioBuffer out(numChannels, gFrameSize);
+    FillRandomData(in[0], gFrameSize);
+
+    OverlapSaveConvolutionEffectParams params{};
+    params.fftIR = &fftIR;
+    params.numChannels = numChannels;
+    params.numSamples = irSize;
+
+    OverlapSaveConvolutionEffect uniformEffect(audioSettings, OverlapSaveConvolutionEffectSettings{numChannels, irSize});
+
+    NonUniformConvolutionEffectSettings nonUniformSettings{};
+    nonUniformSettings.numChannels = numChannels;
+    nonUniformSettings.irSize = irSize;
+    nonUniformSettings.jobQueue = jobQueue;
+
+    NonUniformConvolutionEffect nonUniformEffect(audioSettings, nonUniformSettings);
+
+    // Warm up, so the tail partitions are built from the IR before timing starts.
+    for (auto i = 0; i < kNumRuns; ++i)
+    {
+        uniformEffect.apply(params, in, out);
+        nonUniformEffect.apply(params, in, out);
+    }
+
+    Timer timer;
+
+    timer.start();
+    for (auto i = 0; i < kNumRuns; ++i)
+    {
+        uniformEffect.apply(params, in, out);
+    }
+    auto uniformTime = timer.elapsedMilliseconds() / kNumRuns;
+
+    // The worst-case time is the one that determines whether the audio thread misses its deadline.
+    auto nonUniformTime = 0.0;
+    auto nonUniformMaxTime = 0.0;
+    for (auto i = 0; i < kNumRuns; ++i)
+    {
+        timer.start();
+        nonUniformEffect.apply(params, in, out);
+        auto elapsedTime = timer.elapsedMilliseconds();
+
+        nonUniformTime += elapsedTime;
+        nonUniformMaxTime = std::max(nonUniformMaxTime, elapsedTime);
+    }
+    nonUniformTime /= kNumRuns;
+
+    PrintOutput("%8.1f s %10d %10s %10.3f ms %10.3f ms %10.3f ms\n", duration, order, jobQueue ? "yes" : "no",
+                uniformTime, nonUniformTime, nonUniformMaxTime);
+}
+
+BENCHMARK(nonuniformconvolution)
+{
+    PrintOutput("Buffer Size = %d\n", gFrameSize);
+
+    PrintOutput("Running benchmark: Non-Uniform Convolution...\n");
+    PrintOutput("%10s %10s %10s %13s %13s %13s\n", "Duration", "Order", "Background", "Uniform", "Non-Uniform", "Worst");
+
+    auto jobQueue = ipl::make_shared<BackgroundJobQueue>();
+
+    for (auto duration = 0.5f; duration <= 4.0f; duration *= 2.0f)
+    {
+        for (auto order = 0; order <= 1; ++order)
+        {
+            BenchmarkNonUniformConvolutionForSettings(duration, order, nullptr);
+            BenchmarkNonUniformConvolutionForSettings(duration, order, jobQueue);
+        }
+    }
+
+    PrintOutput("\n");
+}
@@ -0,0 +1,190 @@
+//
+// Copyright 2017-2023 Valve Corporation.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <profiler.h>
+#include <compressed_energy_field.h>
+#include <reflection_simulator_factory.h>
+#include <scene_factory.h>
+#include <thread_pool.h>
+using namespace ipl;
+
+#include <phonon.h>
+
+#include "phonon_perf.h"
+
+void BenchmarkEnergyFieldCompressionForSettings(const vector<unique_ptr<EnergyField>>& energyFields,
+                                                float duration,
+                                                int order,
+                                                EnergyFieldCompression compression,
+                                                const char* name)
+{
+    const auto kNumRuns = 100;
+    const auto kErrorFloor = 1e-6f; // Only measure errors for bins within 60 dB of the peak of their channel and band.
+
+    vector<unique_ptr<CompressedEnergyField>> compressedEnergyFields;
+    auto size = 0.0;
+    for (const auto& energyField : energyFields)
+    {
+        if (compression == EnergyFieldCompression::None)
+        {
+            size += energyField->serializedSize();
+        }
+        else
+        {
+            compressedEnergyFields.push_back(ipl::make_unique<CompressedEnergyField>(*energyField, compression));
+            size += compressedEnergyFields.back()->serializedSize();
+        }
+    }
+
+    auto maxError = 0.0;
+    auto sumError = 0.0;
+    auto numErrorSamples = 0;
+
+    EnergyField decoded(duration, order);
+    for (auto i = 0u; i < energyFields.size(); ++i)
+    {
+        const auto& energyField = *energyFields[i];
+
+        if (compression == EnergyFieldCompression::None)
+        {
+            decoded.copyFrom(energyField);
+        }
+        else
+        {
+            compressedEnergyFields[i]->decode(decoded);
+        }
+
+        for (auto j = 0; j < energyField.numChannels(); ++j)
+        {
+            for (auto k = 0; k < Bands::kNumBands; ++k)
+            {
+                auto peak = 0.0f;
+                for (auto l = 0; l < energyField.numBins(); ++l)
+                {
+                    peak = std::max(peak, fabsf(energyField[j][k][l]));
+                }
+
+                for (auto l = 0; l < energyField.numBins(); ++l)
+                {
+                    auto value = fabsf(energyField[j][k][l]);
+                    if (value <= peak * kErrorFloor)
+                        continue;
+
+                    auto error = fabs(10.0 * log10(std::max(fabsf(decoded[j][k][l]), std::numeric_limits<float>::min()) / value));
+                    maxError = std::max(maxError, error);
+                    sumError += error;
+                    ++numErrorSamples;
+                }
+            }
+        }
+    }
+
+    // Time the operation performed for each probe when looking up baked data: a weighted accumulation into the output.
+    EnergyField accumulated(duration, order);
+    accumulated.reset();
+
+    Timer timer;
+    timer.start();
+
+    for (auto run = 0; run < kNumRuns; ++run)
+    {
+        for (auto i = 0u; i < energyFields.size(); ++i)
+        {
+            if (compression == EnergyFieldCompression::None)
+            {
+                EnergyField::scaleAccumulate(*energyFields[i], 0.5f, accumulated);
+            }
+            else
+            {
+                compressedEnergyFields[i]->scaleAccumulate(0.5f, accumulated);
+            }
+        }
+    }
+
+    auto elapsedTime = (timer.elapsedMicroseconds() / kNumRuns) / energyFields.size();
+
+    PrintOutput("%-16s %10d %10.1f %10.3f %10.3f %10.1f us\n", name, order, (size / 1024.0) / energyFields.size(),
+                maxError, (numErrorSamples > 0) ? sumError / numErrorSamples : 0.0, elapsedTime);
+}
+
+void BenchmarkEnergyFieldCompressionForScene(const std::string& fileName)
+{
+    const auto kNumRays = 8192;
+    const auto kNumBounces = 16;
+    const auto kDuration = 2.0f;
+    const auto kNumPositions = 8;
+
+    std::vector<float>   vertices;
+    std::vector<int32_t> triangleIndices;
+    std::vector<int>     materialIndices;
+
+    LoadObj(fileName, vertices, triangleIndices, materialIndices);
+
+    Material material;
+    material.absorption[0] = 0.1f;
+    material.absorption[1] = 0.1f;
+    material.absorption[2] = 0.1f;
+    material.scattering = 0.5f;
+    material.transmission[0] = 1.0f;
+    material.transmission[1] = 1.0f;
+    material.transmission[2] = 1.0f;
+
+    auto scene = shared_ptr<IScene>(SceneFactory::create(SceneType::Default, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr));
+
+    auto staticMesh = scene->createStaticMesh(static_cast<int>(vertices.size()) / 3, static_cast<int>(triangleIndices.size()) / 3, 1,
+                                              reinterpret_cast<Vector3f*>(vertices.data()), (Triangle*) triangleIndices.data(),
+                                              materialIndices.data(), &material);
+
+    scene->addStaticMesh(staticMesh);
+    scene->commit();
+
+    PrintOutput("%-16s %10s %10s %10s %10s %13s\n", "Compression", "Order", "KB/Probe", "Max (dB)", "Mean (dB)", "Accumulate");
+
+    for (auto order : {1, 2})
+    {
+        auto simulator = ReflectionSimulatorFactory::create(SceneType::Default, kNumRays, 512, kDuration, order, 1, 1, 1, 1, nullptr);
+
+        // Simulate reverb at a handful of positions, as would be done when baking a row of probes.
+        vector<unique_ptr<EnergyField>> energyFields;
+        for (auto i = 0; i < kNumPositions; ++i)
+        {
+            CoordinateSpace3f listener(-Vector3f::kZAxis, Vector3f::kYAxis, Vector3f(-8.0f + 2.0f * i, 1.5f, 0.0f));
+            Directivity directivity{};
+
+            energyFields.push_back(ipl::make_unique<EnergyField>(kDuration, order));
+            auto energyFieldPtr = energyFields.back().get();
+
+            JobGraph jobGraph;
+            simulator->simulate(*scene, 1, &listener, 1, &listener, &directivity, kNumRays, kNumBounces, kDuration, order, 1.0f, &energyFieldPtr, jobGraph);
+
+            ThreadPool threadPool(1);
+            threadPool.process(jobGraph);
+        }
+
+        BenchmarkEnergyFieldCompressionForSettings(energyFields, kDuration, order, EnergyFieldCompression::None, "None");
+        BenchmarkEnergyFieldCompressionForSettings(energyFields, kDuration, order, EnergyFieldCompression::LogQuantized16, "LogQuantized16");
+        BenchmarkEnergyFieldCompressionForSettings(energyFields, kDuration, order, EnergyFieldCompression::LogQuantized8, "LogQuantized8");
+    }
+}
+
+BENCHMARK(energyfieldcompression)
+{
+    SetCoreAffinityForBenchmarking();
+
+    PrintOutput("Running benchmark: Energy Field Compression...\n");
+    BenchmarkEnergyFieldCompressionForScene("../../data/meshes/sponza.obj");
+    PrintOutput("\n");
+}
@@ -19,6 +19,8 @@
 #include <path_simulator.h>
 #include <path_effect.h>
 #include <sh.h>
+#include <simulation_data.h>
+#include <simulation_manager.h>
 
 using namespace ipl;
 
@@ -112,7 +114,7 @@ void benchmarkPathFindingForSettings(IScene const& scene,
             {
                 timer.start();
                 probePath = pathFinder.findShortestPath(scene, probes, visGraph, visTester, i, j,
-                                                        radius, threshold, range, true, true);
+                                                        radius, threshold, range, INFINITY, true, true);
                 usElapsed = timer.elapsedMicroseconds();
             }
 
@@ -254,6 +256,112 @@ void benchmarkPathingForSettings(shared_ptr<Context> context, shared_ptr<IScene>
         spacing, numProbes, ambisonicsOrder, visSamples, totalTime / totalProbesBenchmarked );
 }
 
+void benchmarkPathingSimulationForSettings(shared_ptr<IScene> scene,
+                                           shared_ptr<ProbeBatch> probeBatch,
+                                           const ProbeArray& probes,
+                                           int numSources,
+                                           int numThreads)
+{
+    const auto kNumRuns = 10;
+    const auto kOrder = 1;
+
+    SimulationManager simulationManager(false, false, true, SceneType::Default, IndirectEffectType::Convolution, 1, 0, 0,
+                                        0.0f, kOrder, numSources, 1, numThreads, 1, 1, true, -Vector3f::kYAxis, 48000, 1024,
+                                        nullptr, nullptr, nullptr);
+
+    simulationManager.scene() = scene;
+    simulationManager.addProbeBatch(probeBatch);
+
+    std::vector<shared_ptr<SimulationData>> sources;
+    for (auto i = 0; i < numSources; ++i)
+    {
+        auto source = make_shared<SimulationData>(false, true, SceneType::Default, IndirectEffectType::Convolution, 1,
+                                                  0.0f, kOrder, 48000, 1024, nullptr, nullptr);
+
+        source->pathingInputs.enabled = true;
+        source->pathingInputs.source = CoordinateSpace3f(probes[(i * 7) % probes.numProbes()].influence.center);
+        source->pathingInputs.probes = probeBatch;
+        source->pathingInputs.visRadius = 0.0f;
+        source->pathingInputs.visThreshold = 0.99f;
+        source->pathingInputs.visRange = INFINITY;
+        source->pathingInputs.order = kOrder;
+        source->pathingInputs.enableValidation = true;
+        source->pathingInputs.findAlternatePaths = true;
+        source->pathingInputs.simplifyPaths = true;
+        source->pathingInputs.realTimeVis = false;
+
+        simulationManager.addSource(source);
+        sources.push_back(source);
+    }
+
+    simulationManager.commit();
+
+    SharedPathingSimulationInputs sharedInputs{};
+    sharedInputs.listener = CoordinateSpace3f(probes[0].influence.center);
+    simulationManager.setSharedPathingInputs(sharedInputs);
+
+    PathingSimulationTimings timings{};
+    auto maxSourceTime = 0.0;
+
+    for (auto i = 0; i < kNumRuns; ++i)
+    {
+        simulationManager.simulatePathing();
+
+        const auto& runTimings = simulationManager.pathingTimings();
+        timings.listenerProbes += runTimings.listenerProbes / kNumRuns;
+        timings.sourceProbes += runTimings.sourceProbes / kNumRuns;
+        timings.findPaths += runTimings.findPaths / kNumRuns;
+        timings.total += runTimings.total / kNumRuns;
+
+        for (const auto& source : sources)
+        {
+            maxSourceTime = std::max(maxSourceTime, source->pathingState.timings.total);
+        }
+    }
+
+    PrintOutput("%-8d  %-8d  %-10.2f  %-10.2f  %-10.2f  %-10.2f  %-10.2f\n", numSources, numThreads, timings.listenerProbes,
+                timings.sourceProbes, timings.findPaths, timings.total, maxSourceTime);
+}
+
+void benchmarkPathingSimulation(shared_ptr<IScene> scene)
+{
+    Matrix4x4f localToWorldTransform{};
+    localToWorldTransform.identity();
+    localToWorldTransform *= 80;
+
+    auto spacing = 1.5f;
+    auto height = 1.5f;
+    ProbeArray probes;
+    ProbeGenerator::generateProbes(*scene, localToWorldTransform, ProbeGenerationType::UniformFloor, spacing, height, probes);
+
+    auto probeBatch = make_shared<ProbeBatch>();
+    probeBatch->addProbeArray(probes);
+    probeBatch->commit();
+
+    BakedDataIdentifier identifier;
+    identifier.variation = BakedDataVariation::Dynamic;
+    identifier.type = BakedDataType::Pathing;
+
+    PathBaker::bake(const_cast<const IScene&>(*scene), identifier, 1, 0.0f, 0.99f, INFINITY, INFINITY, 5000.0f,
+                    true, -Vector3f::kYAxis, true, 8, *probeBatch, nullptr);
+
+    PrintOutput("Running benchmark: Pathing Simulation (%d probes)...\n", probes.numProbes());
+    PrintOutput("%-8s  %-8s  %-10s  %-10s  %-10s  %-10s  %-10s\n", "#Sources", "#Threads", "Listener", "Sources",
+                "FindPaths", "Total (ms)", "Max Source");
+
+    int numSourcesValues[] = {1, 16, 64, 128};
+    int numThreadsValues[] = {1, 2, 4};
+    for (auto numSources : numSourcesValues)
+    {
+        for (auto numThreads : numThreadsValues)
+        {
+            benchmarkPathingSimulationForSettings(scene, probeBatch, probes, numSources, numThreads);
+        }
+    }
+
+    PrintOutput("\n");
+}
+
 BENCHMARK(pathing)
 {
     auto context = std::make_shared<Context>(nullptr, nullptr, nullptr, SIMDLevel::AVX2, STEAMAUDIO_VERSION);
@@ -286,6 +394,7 @@ BENCHMARK(pathing)
 
     benchmarkVisGraph(context, scene);
     benchmarkPathFinding(context, scene);
+    benchmarkPathingSimulation(scene);
 
     PrintOutput("Running benchmark: Pathing Runtime...\n");
     PrintOutput("%-8s  %-8s  %-10s  %-8s %6s\n", "Spacing", "#Probes", "Ambisonics", "Samples", "(us) Time");
@@ -75,7 +75,8 @@ void benchmarkPathingBakeForSettings(shared_ptr<Context> context, shared_ptr<ISc
     auto elapsedSeconds = timer.elapsedSeconds();
 
     printf("\r");
-    PrintOutput("%-8.2f  %-10d  %-12d  %-10d  %-12.2f\n", spacing, numProbes, visSamples, numThreads, elapsedSeconds);
+    PrintOutput("%-8.2f  %-10d  %-12d  %-10d  %-12.2f  %-12d  %-12.2f\n", spacing, numProbes, visSamples, numThreads,
+                elapsedSeconds, bakedPathData->numValidPaths(), bakedPathData->serializedSize() / 1024.0f);
 }
 
 BENCHMARK(pathingbake)
@@ -109,7 +110,8 @@ BENCHMARK(pathingbake)
     scene->commit();
 
     PrintOutput("Running benchmark: Pathing Bake...\n");
-    PrintOutput("%-8s  %-10s  %-12s  %-10s  %-12s\n", "Spacing", "#Probes", "Vis Samples", "Threads", "Time (sec)");
+    PrintOutput("%-8s  %-10s  %-12s  %-10s  %-12s  %-12s  %-12s\n", "Spacing", "#Probes", "Vis Samples", "Threads", "Time (sec)",
+                "#Paths", "Size (KB)");
 
     benchmarkPathingBakeForSettings(context, scene, 1, 1);
     benchmarkPathingBakeForSettings(context, scene, 1, 2);
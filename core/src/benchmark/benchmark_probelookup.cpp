@@ -14,6 +14,8 @@
 // limitations under the License.
 //
 
+#include <random>
+
 #include <profiler.h>
 #include <scene_factory.h>
 #include <path_simulator.h>
@@ -83,6 +85,91 @@ void benchmarkProbeLookupForSettings(shared_ptr<Context> context, shared_ptr<ISc
     PrintOutput("%-10s %-8.2f %-10d %-10.2f\n", mode == NEAREST ? "Nearest" : "All", spacing, numProbes, elapsedTime);
 }
 
+// Compares the throughput of looking up, checking occlusion, and weighting the probes that influence many points, one
+// point at a time and with a single batched query.
+void benchmarkBatchedProbeLookupForSettings(shared_ptr<IScene> scene, float spacing, int numQueries)
+{
+    Matrix4x4f localToWorldTransform{};
+    localToWorldTransform.identity();
+    localToWorldTransform *= 8000;
+
+    auto height = 1.5f;
+    ProbeArray probes;
+    ProbeGenerator::generateProbes(*scene, localToWorldTransform, ProbeGenerationType::UniformFloor, spacing, height, probes);
+    auto numProbes = probes.numProbes();
+
+    auto probeBatch = make_shared<ProbeBatch>();
+    probeBatch->addProbeArray(probes);
+    probeBatch->commit();
+
+    ProbeManager probeManager;
+    probeManager.addProbeBatch(probeBatch);
+    probeManager.commit();
+
+    // Query points are scattered around randomly chosen probes within a region around the center of the scene, much
+    // like a listener surrounded by nearby sources.
+    const auto kRegionRadius = 10.0f;
+
+    const auto& regionCenter = probes[numProbes / 2].influence.center;
+    vector<int> regionProbes;
+    for (auto i = 0; i < numProbes; ++i)
+    {
+        if ((probes[i].influence.center - regionCenter).length() <= kRegionRadius)
+        {
+            regionProbes.push_back(i);
+        }
+    }
+
+    std::default_random_engine rng(42);
+    std::uniform_int_distribution<int> probeDistribution(0, static_cast<int>(regionProbes.size()) - 1);
+    std::uniform_real_distribution<float> offsetDistribution(-0.5f * spacing, 0.5f * spacing);
+
+    vector<Vector3f> points(numQueries);
+    for (auto i = 0; i < numQueries; ++i)
+    {
+        points[i] = probes[regionProbes[probeDistribution(rng)]].influence.center +
+                    Vector3f(offsetDistribution(rng), 0.0f, offsetDistribution(rng));
+    }
+
+    int kNumRuns = 100;
+
+    Timer timer;
+    timer.start();
+    {
+        ProbeNeighborhood neighborhood;
+
+        for (int i = 0; i < kNumRuns; ++i)
+        {
+            for (int j = 0; j < numQueries; ++j)
+            {
+                probeManager.getInfluencingProbes(points[j], neighborhood);
+                neighborhood.checkOcclusion(*scene, points[j]);
+                neighborhood.calcWeights(points[j]);
+            }
+        }
+    }
+    auto singleTime = timer.elapsedSeconds();
+
+    timer.start();
+    {
+        ProbeNeighborhoodBatch neighborhoods;
+
+        for (int i = 0; i < kNumRuns; ++i)
+        {
+            probeManager.getInfluencingProbes(numQueries, points.data(), neighborhoods);
+            neighborhoods.checkOcclusion(*scene, points.data());
+            neighborhoods.calcWeights(points.data());
+        }
+    }
+    auto batchedTime = timer.elapsedSeconds();
+
+    auto numTotalQueries = static_cast<double>(kNumRuns) * numQueries;
+
+    printf("\r");
+    PrintOutput("%-8.2f %-10d %-10d %-16.0f %-16.0f\n", spacing, numProbes, numQueries, numTotalQueries / singleTime,
+                numTotalQueries / batchedTime);
+}
+
 BENCHMARK(probelookup)
 {
     auto context = std::make_shared<Context>(nullptr, nullptr, nullptr, SIMDLevel::AVX2, STEAMAUDIO_VERSION);
@@ -126,4 +213,15 @@ BENCHMARK(probelookup)
     benchmarkProbeLookupForSettings(context, scene, 2.0f, LookUpMode::ALL);
     benchmarkProbeLookupForSettings(context, scene, 1.5f, LookUpMode::ALL);
     benchmarkProbeLookupForSettings(context, scene, 1.0f, LookUpMode::ALL);
-}
\ No newline at end of file
+
+    PrintOutput("\nRunning benchmark: Batched Probe Lookup...\n");
+    PrintOutput("%-8s %-10s %-10s %-16s %-16s\n", "Spacing", "#Probes", "#Queries", "Single (q/s)", "Batched (q/s)");
+
+    for (auto spacing : {2.5f, 2.0f, 1.5f, 1.0f})
+    {
+        for (auto numQueries : {8, 64, 256})
+        {
+            benchmarkBatchedProbeLookupForSettings(scene, spacing, numQueries);
+        }
+    }
+}
@@ -72,6 +72,354 @@ void BenchmarkReflectionsForSettings(shared_ptr<IScene> scene, const SceneType t
     PrintOutput("%-10d %10d %10d %10d %8.1f s %10d %8.1f ms\n", rays, bounces, sources, threads, duration, order, elapsedTime);
 }
 
+double TimeEnergyFieldReduction(shared_ptr<IScene> scene, const int rays, const int bounces, const int sources,
+    const float duration, const int order, const int threads, const EnergyFieldReduction reduction)
+{
+    const int kNumRuns = 4;
+
+    ReflectionSimulator simulator(rays, 512, duration, order, sources, 1, threads, reduction);
+
+    CoordinateSpace3f listeners[1];
+    listeners[0] = CoordinateSpace3f(-Vector3f::kZAxis, Vector3f::kYAxis, Vector3f::kZero);
+
+    Array<CoordinateSpace3f> _sources(sources);
+    Array<Directivity> directivities(sources);
+    Array<unique_ptr<EnergyField>> energyFields(sources);
+    Array<EnergyField*> energyFieldPtrs(sources);
+    for (auto i = 0; i < sources; ++i)
+    {
+        _sources[i] = listeners[0];
+        directivities[i] = Directivity{};
+
+        energyFields[i] = make_unique<EnergyField>(duration, order);
+        energyFieldPtrs[i] = energyFields[i].get();
+    }
+
+    ThreadPool threadPool(threads);
+
+    Timer timer;
+    timer.start();
+
+    for (auto run = 0; run < kNumRuns; ++run)
+    {
+        JobGraph jobGraph;
+        simulator.simulate(*scene, sources, _sources.data(), 1, listeners, directivities.data(), rays, bounces, duration, order, 1.0f, energyFieldPtrs.data(), jobGraph);
+        threadPool.process(jobGraph);
+    }
+
+    return timer.elapsedMilliseconds() / kNumRuns;
+}
+
+// Compares summing per-thread energy fields on the last ray tracing job against summing them with parallel jobs. Uses
+// few rays and bounces and many sources, so the reduction is a significant fraction of the total time.
+void BenchmarkEnergyFieldReductionForSettings(shared_ptr<IScene> scene, const int rays, const int bounces,
+    const int sources, const float duration, const int order, const int threads)
+{
+    auto serialTime = TimeEnergyFieldReduction(scene, rays, bounces, sources, duration, order, threads, EnergyFieldReduction::Serial);
+    auto parallelTime = TimeEnergyFieldReduction(scene, rays, bounces, sources, duration, order, threads, EnergyFieldReduction::Parallel);
+
+    PrintOutput("%-10d %10d %10d %10d %10d %8.1f ms %8.1f ms %9.2fx\n", rays, bounces, sources, threads, order,
+        serialTime, parallelTime, serialTime / parallelTime);
+}
+
+// Compares shading every source individually against shading clusters of sources, for crowds of sources spread out
+// over a grid around the listener.
+void BenchmarkSourceClusteringForSettings(shared_ptr<IScene> scene, const int rays, const int bounces, const int sources,
+    const float duration, const int order, const int threads, const float maxClusteringError)
+{
+    const int kNumRuns = 1;
+
+    ReflectionSimulator simulator(rays, 512, duration, order, sources, 1, threads);
+
+    CoordinateSpace3f listeners[1];
+    listeners[0] = CoordinateSpace3f(-Vector3f::kZAxis, Vector3f::kYAxis, Vector3f::kZero);
+
+    Array<CoordinateSpace3f> _sources(sources);
+    Array<Directivity> directivities(sources);
+    Array<unique_ptr<EnergyField>> energyFields(sources);
+    Array<EnergyField*> energyFieldPtrs(sources);
+    for (auto i = 0; i < sources; ++i)
+    {
+        _sources[i] = CoordinateSpace3f(-Vector3f::kZAxis, Vector3f::kYAxis, Vector3f((i % 16 - 8) * 0.5f, 0.0f, (i / 16 - 8) * 0.5f));
+        directivities[i] = Directivity{};
+
+        energyFields[i] = make_unique<EnergyField>(duration, order);
+        energyFieldPtrs[i] = energyFields[i].get();
+    }
+
+    ThreadPool threadPool(threads);
+
+    double times[2];
+    for (auto i = 0; i < 2; ++i)
+    {
+        simulator.setSourceClustering(i == 1, maxClusteringError);
+
+        Timer timer;
+        timer.start();
+
+        for (auto run = 0; run < kNumRuns; ++run)
+        {
+            JobGraph jobGraph;
+            simulator.simulate(*scene, sources, _sources.data(), 1, listeners, directivities.data(), rays, bounces, duration, order, 1.0f, energyFieldPtrs.data(), jobGraph);
+            threadPool.process(jobGraph);
+        }
+
+        times[i] = timer.elapsedMilliseconds() / kNumRuns;
+    }
+
+    PrintOutput("%-10d %10d %10d %10d %10.2f %8.1f ms %8.1f ms %9.2fx\n", rays, bounces, sources, threads, maxClusteringError,
+        times[0], times[1], times[0] / times[1]);
+}
+
+// Simulates reflections with the given number of rays, and returns the time taken. The energy fields from the last
+// run are left in energyFields.
+double TimeRussianRoulette(ReflectionSimulator& simulator, shared_ptr<IScene> scene, const int rays, const int bounces,
+    const int sources, const CoordinateSpace3f* _sources, const float duration, const int order, ThreadPool& threadPool,
+    EnergyField** energyFields)
+{
+    const int kNumRuns = 4;
+
+    CoordinateSpace3f listeners[1];
+    listeners[0] = CoordinateSpace3f(-Vector3f::kZAxis, Vector3f::kYAxis, Vector3f::kZero);
+
+    Array<Directivity> directivities(sources);
+    for (auto i = 0; i < sources; ++i)
+    {
+        directivities[i] = Directivity{};
+    }
+
+    Timer timer;
+    timer.start();
+
+    for (auto run = 0; run < kNumRuns; ++run)
+    {
+        JobGraph jobGraph;
+        simulator.simulate(*scene, sources, _sources, 1, listeners, directivities.data(), rays, bounces, duration, order, 1.0f, energyFields, jobGraph);
+        threadPool.process(jobGraph);
+    }
+
+    return timer.elapsedMilliseconds() / kNumRuns;
+}
+
+// Returns the RMS difference between two sets of energy fields, relative to the RMS value of the reference.
+float EnergyFieldError(const int sources, EnergyField* const* energyFields, EnergyField* const* referenceEnergyFields)
+{
+    auto error = 0.0;
+    auto reference = 0.0;
+
+    for (auto i = 0; i < sources; ++i)
+    {
+        const auto* data = energyFields[i]->flatData();
+        const auto* referenceData = referenceEnergyFields[i]->flatData();
+        auto size = energyFields[i]->numChannels() * Bands::kNumBands * energyFields[i]->numBins();
+
+        for (auto j = 0; j < size; ++j)
+        {
+            error += (data[j] - referenceData[j]) * (data[j] - referenceData[j]);
+            reference += referenceData[j] * referenceData[j];
+        }
+    }
+
+    return (reference > 0.0) ? static_cast<float>(sqrt(error / reference)) : 0.0f;
+}
+
+// Measures how quickly energy fields converge with and without Russian roulette termination, by comparing them against
+// a reference simulated with many more rays. At equal error, the time per ray and the number of rays needed can be
+// read off the table.
+void BenchmarkRussianRouletteForScene(shared_ptr<IScene> scene, const int bounces, const int sources,
+    const float duration, const int order, const int threads, const float survivalThreshold)
+{
+    const int kReferenceRays = 262144;
+
+    auto rayCounts = { 1024, 2048, 4096, 8192, 16384, 32768 };
+
+    ThreadPool threadPool(threads);
+
+    Array<CoordinateSpace3f> _sources(sources);
+    Array<unique_ptr<EnergyField>> energyFields(sources);
+    Array<unique_ptr<EnergyField>> referenceEnergyFields(sources);
+    Array<EnergyField*> energyFieldPtrs(sources);
+    Array<EnergyField*> referenceEnergyFieldPtrs(sources);
+    for (auto i = 0; i < sources; ++i)
+    {
+        _sources[i] = CoordinateSpace3f(-Vector3f::kZAxis, Vector3f::kYAxis, Vector3f((i % 4 - 2) * 2.0f, 1.0f, (i / 4 - 2) * 2.0f));
+
+        energyFields[i] = make_unique<EnergyField>(duration, order);
+        referenceEnergyFields[i] = make_unique<EnergyField>(duration, order);
+        energyFieldPtrs[i] = energyFields[i].get();
+        referenceEnergyFieldPtrs[i] = referenceEnergyFields[i].get();
+    }
+
+    ReflectionSimulator referenceSimulator(kReferenceRays, 512, duration, order, sources, 1, threads);
+    TimeRussianRoulette(referenceSimulator, scene, kReferenceRays, bounces, sources, _sources.data(), duration, order, threadPool, referenceEnergyFieldPtrs.data());
+
+    for (auto ray : rayCounts)
+    {
+        // Listener ray directions are only well distributed if all of the simulator's directions are used.
+        ReflectionSimulator simulator(ray, 512, duration, order, sources, 1, threads);
+
+        float errors[2];
+        double times[2];
+        for (auto i = 0; i < 2; ++i)
+        {
+            simulator.setRussianRoulette(i == 1, survivalThreshold);
+            times[i] = TimeRussianRoulette(simulator, scene, ray, bounces, sources, _sources.data(), duration, order, threadPool, energyFieldPtrs.data());
+            errors[i] = EnergyFieldError(sources, energyFieldPtrs.data(), referenceEnergyFieldPtrs.data());
+        }
+
+        PrintOutput("%-10d %10d %10d %10.2f %8.1f ms %10.4f %8.1f ms %10.4f\n", ray, bounces, sources, survivalThreshold,
+            times[0], errors[0], times[1], errors[1]);
+    }
+}
+
+// Simulates reflections for a listener walking along a straight line, one simulation per step, and returns the average
+// time per step. The energy fields from the last step are left in energyFields.
+double TimePathCaching(ReflectionSimulator& simulator, shared_ptr<IScene> scene, const int rays, const int bounces,
+    const int sources, const CoordinateSpace3f* _sources, const float duration, const int order, ThreadPool& threadPool,
+    const int steps, const Vector3f& start, const Vector3f& step, EnergyField** energyFields)
+{
+    Array<Directivity> directivities(sources);
+    for (auto i = 0; i < sources; ++i)
+    {
+        directivities[i] = Directivity{};
+    }
+
+    Timer timer;
+    timer.start();
+
+    for (auto i = 0; i < steps; ++i)
+    {
+        CoordinateSpace3f listeners[1];
+        listeners[0] = CoordinateSpace3f(-Vector3f::kZAxis, Vector3f::kYAxis, start + (step * static_cast<float>(i)));
+
+        JobGraph jobGraph;
+        simulator.simulate(*scene, sources, _sources, 1, listeners, directivities.data(), rays, bounces, duration, order, 1.0f, energyFields, jobGraph);
+        threadPool.process(jobGraph);
+    }
+
+    return timer.elapsedMilliseconds() / steps;
+}
+
+// Measures the time per frame and the error of energy fields simulated for a moving listener, with and without path
+// caching. The error is measured at the end of the walk, against a reference simulated with many more rays.
+void BenchmarkPathCachingForScene(shared_ptr<IScene> scene, const int bounces, const int sources, const float duration,
+    const int order, const int threads, const int historyLength)
+{
+    const int kReferenceRays = 262144;
+    const int kNumSteps = 32;
+    const auto kStart = Vector3f(-0.8f, 0.0f, 0.0f);
+    const auto kStep = Vector3f(0.05f, 0.0f, 0.0f); // About 3 m/s at 60 frames per second.
+
+    auto rayCounts = { 1024, 4096, 16384 };
+
+    ThreadPool threadPool(threads);
+
+    Array<CoordinateSpace3f> _sources(sources);
+    Array<unique_ptr<EnergyField>> energyFields(sources);
+    Array<unique_ptr<EnergyField>> referenceEnergyFields(sources);
+    Array<EnergyField*> energyFieldPtrs(sources);
+    Array<EnergyField*> referenceEnergyFieldPtrs(sources);
+    for (auto i = 0; i < sources; ++i)
+    {
+        _sources[i] = CoordinateSpace3f(-Vector3f::kZAxis, Vector3f::kYAxis, Vector3f((i % 4 - 2) * 2.0f, 1.0f, (i / 4 - 2) * 2.0f));
+
+        energyFields[i] = make_unique<EnergyField>(duration, order);
+        referenceEnergyFields[i] = make_unique<EnergyField>(duration, order);
+        energyFieldPtrs[i] = energyFields[i].get();
+        referenceEnergyFieldPtrs[i] = referenceEnergyFields[i].get();
+    }
+
+    auto end = kStart + (kStep * static_cast<float>(kNumSteps - 1));
+
+    ReflectionSimulator referenceSimulator(kReferenceRays, 512, duration, order, sources, 1, threads);
+    TimePathCaching(referenceSimulator, scene, kReferenceRays, bounces, sources, _sources.data(), duration, order, threadPool, 1, end, kStep, referenceEnergyFieldPtrs.data());
+
+    for (auto ray : rayCounts)
+    {
+        // Listener ray directions are only well distributed if all of the simulator's directions are used.
+        ReflectionSimulator simulator(ray, 512, duration, order, sources, 1, threads);
+
+        float errors[2];
+        double times[2];
+        for (auto i = 0; i < 2; ++i)
+        {
+            simulator.setPathCaching(i == 1, historyLength);
+            times[i] = TimePathCaching(simulator, scene, ray, bounces, sources, _sources.data(), duration, order, threadPool, kNumSteps, kStart, kStep, energyFieldPtrs.data());
+            errors[i] = EnergyFieldError(sources, energyFieldPtrs.data(), referenceEnergyFieldPtrs.data());
+        }
+
+        PrintOutput("%-10d %10d %10d %10d %8.1f ms %10.4f %8.1f ms %10.4f\n", ray, bounces, sources, historyLength,
+            times[0], errors[0], times[1], errors[1]);
+    }
+}
+
+// Compares simulating reflections for several listeners with one call per listener, against a single call for all
+// listeners, with and without sharing paths between listeners. Listeners are spaced out along a line.
+void BenchmarkMultipleListenersForSettings(shared_ptr<IScene> scene, const int rays, const int bounces,
+    const int sources, const float duration, const int order, const int threads, const int listeners,
+    const float spacing)
+{
+    const int kNumRuns = 4;
+
+    ReflectionSimulator simulator(rays, 512, duration, order, sources, listeners, threads);
+
+    Array<CoordinateSpace3f> _listeners(listeners);
+    for (auto i = 0; i < listeners; ++i)
+    {
+        _listeners[i] = CoordinateSpace3f(-Vector3f::kZAxis, Vector3f::kYAxis, Vector3f(i * spacing, 0.0f, 0.0f));
+    }
+
+    Array<CoordinateSpace3f> _sources(sources);
+    Array<Directivity> directivities(sources);
+    Array<unique_ptr<EnergyField>> energyFields(listeners * sources);
+    Array<EnergyField*> energyFieldPtrs(listeners * sources);
+    for (auto i = 0; i < sources; ++i)
+    {
+        _sources[i] = CoordinateSpace3f(-Vector3f::kZAxis, Vector3f::kYAxis, Vector3f((i % 4 - 2) * 2.0f, 1.0f, (i / 4 - 2) * 2.0f));
+        directivities[i] = Directivity{};
+    }
+    for (auto i = 0; i < listeners * sources; ++i)
+    {
+        energyFields[i] = make_unique<EnergyField>(duration, order);
+        energyFieldPtrs[i] = energyFields[i].get();
+    }
+
+    ThreadPool threadPool(threads);
+
+    double times[3];
+    for (auto i = 0; i < 3; ++i)
+    {
+        simulator.setListenerPathSharing(i == 2);
+
+        Timer timer;
+        timer.start();
+
+        for (auto run = 0; run < kNumRuns; ++run)
+        {
+            if (i == 0)
+            {
+                for (auto j = 0; j < listeners; ++j)
+                {
+                    JobGraph jobGraph;
+                    simulator.simulate(*scene, sources, _sources.data(), 1, &_listeners[j], directivities.data(), rays, bounces, duration, order, 1.0f, &energyFieldPtrs[j * sources], jobGraph);
+                    threadPool.process(jobGraph);
+                }
+            }
+            else
+            {
+                JobGraph jobGraph;
+                simulator.simulate(*scene, sources, _sources.data(), listeners, _listeners.data(), directivities.data(), rays, bounces, duration, order, 1.0f, energyFieldPtrs.data(), jobGraph);
+                threadPool.process(jobGraph);
+            }
+        }
+
+        times[i] = timer.elapsedMilliseconds() / kNumRuns;
+    }
+
+    PrintOutput("%-10d %10d %10d %10d %10.2f %8.1f ms %8.1f ms %8.1f ms\n", rays, bounces, sources, listeners, spacing,
+        times[0], times[1], times[2]);
+}
+
 void BenchmarkReflectionsForScene(const std::string& fileName, const SceneType type, const int maxReservedCUs = 0, const float fractionCUIRUpdate = .0f)
 {
     auto context = std::make_shared<Context>(nullptr, nullptr, nullptr, SIMDLevel::AVX2, STEAMAUDIO_VERSION);
@@ -146,6 +494,80 @@ void BenchmarkReflectionsForScene(const std::string& fileName, const SceneType t
 
         PrintOutput("\n");
     }
+
+    // Energy field reduction benchmarking.
+    if (type == SceneType::Default)
+    {
+        PrintOutput("%-10s %10s %10s %10s %10s %11s %11s %10s\n", "Rays", "Bounces", "Sources", "Threads", "Order", "Serial", "Parallel", "Speedup");
+
+        auto sources = { 32, 128 };
+        auto orders = { 1, 2 };
+        auto threads = { 1, 2, 4, 8, 16, 32 };
+
+        for (auto source : sources)
+            for (auto order : orders)
+                for (auto thread : threads)
+                    if (thread == 1 || thread * 2 <= static_cast<int>(std::thread::hardware_concurrency()))    // Assumes hyperthreading is turned ON
+                        BenchmarkEnergyFieldReductionForSettings(scene, 4096, 2, source, 2.0f, order, thread);
+
+        PrintOutput("\n");
+    }
+
+    // Source clustering benchmarking.
+    if (type == SceneType::Default)
+    {
+        PrintOutput("%-10s %10s %10s %10s %10s %11s %11s %10s\n", "Rays", "Bounces", "Sources", "Threads", "MaxError", "Individual", "Clustered", "Speedup");
+
+        auto sources = { 16, 64, 128, 256 };
+        auto errors = { 0.01f, 0.05f, 0.2f };
+
+        for (auto source : sources)
+            for (auto error : errors)
+                BenchmarkSourceClusteringForSettings(scene, 8192, 8, source, 2.0f, 1, 1, error);
+
+        PrintOutput("\n");
+    }
+
+    // Convergence of energy fields with and without Russian roulette.
+    if (type == SceneType::Default)
+    {
+        PrintOutput("%-10s %10s %10s %10s %11s %10s %11s %10s\n", "Rays", "Bounces", "Sources", "Threshold", "Fixed", "Error", "Roulette", "Error");
+
+        auto thresholds = { 0.05f, 0.2f };
+
+        for (auto threshold : thresholds)
+            BenchmarkRussianRouletteForScene(scene, 64, 4, 2.0f, 1, 1, threshold);
+
+        PrintOutput("\n");
+    }
+
+    // Time per frame and error of energy fields for a moving listener, with and without path caching.
+    if (type == SceneType::Default)
+    {
+        PrintOutput("%-10s %10s %10s %10s %11s %10s %11s %10s\n", "Rays", "Bounces", "Sources", "History", "Uncached", "Error", "Cached", "Error");
+
+        auto historyLengths = { 2, 4, 8 };
+
+        for (auto historyLength : historyLengths)
+            BenchmarkPathCachingForScene(scene, 16, 4, 2.0f, 1, 1, historyLength);
+
+        PrintOutput("\n");
+    }
+
+    // Cost of simulating several listeners, separately, in one call, and in one call with shared paths.
+    if (type == SceneType::Default)
+    {
+        PrintOutput("%-10s %10s %10s %10s %10s %11s %11s %11s\n", "Rays", "Bounces", "Sources", "Listeners", "Spacing", "Separate", "Combined", "Shared");
+
+        auto listeners = { 2, 4, 8 };
+        auto spacings = { 0.1f, 0.5f, 2.0f };
+
+        for (auto listener : listeners)
+            for (auto spacing : spacings)
+                BenchmarkMultipleListenersForSettings(scene, 8192, 16, 4, 2.0f, 1, 1, listener, spacing);
+
+        PrintOutput("\n");
+    }
 }
 
 BENCHMARK(reflections)
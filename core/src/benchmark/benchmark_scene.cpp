@@ -15,6 +15,8 @@
 //
 
 #include <profiler.h>
+#include <bvh.h>
+#include <job_scheduler.h>
 #include <containers.h>
 #include <vector.h>
 using namespace ipl;
@@ -119,3 +121,70 @@ BENCHMARK(scene)
 #endif
     PrintOutput("\n");
 }
+
+void BenchmarkBVHBuildForSettings(const std::vector<float>& vertices,
+                                  const std::vector<int32_t>& triangleIndices,
+                                  int numCopies,
+                                  int numThreads)
+{
+    // Larger meshes are created by placing copies of the input mesh side by side.
+    auto numVertices = static_cast<int>(vertices.size() / 3);
+    auto numTriangles = static_cast<int>(triangleIndices.size() / 3);
+
+    std::vector<Vector3f> copiedVertices;
+    std::vector<Triangle> copiedTriangles;
+
+    for (auto i = 0; i < numCopies; ++i)
+    {
+        for (auto j = 0; j < numVertices; ++j)
+        {
+            copiedVertices.push_back(Vector3f(vertices[3 * j + 0] + 100.0f * i, vertices[3 * j + 1], vertices[3 * j + 2]));
+        }
+
+        for (auto j = 0; j < numTriangles; ++j)
+        {
+            copiedTriangles.push_back(Triangle{ { triangleIndices[3 * j + 0] + i * numVertices,
+                                                  triangleIndices[3 * j + 1] + i * numVertices,
+                                                  triangleIndices[3 * j + 2] + i * numVertices } });
+        }
+    }
+
+    Mesh mesh(static_cast<int>(copiedVertices.size()), static_cast<int>(copiedTriangles.size()), copiedVertices.data(), copiedTriangles.data());
+
+    shared_ptr<JobScheduler> scheduler;
+    if (numThreads > 1)
+    {
+        scheduler = ipl::make_shared<JobScheduler>(numThreads);
+    }
+
+    Timer timer;
+    timer.start();
+
+    BVH bvh(mesh, nullptr, nullptr, scheduler.get());
+
+    auto timeElapsed = timer.elapsedMilliseconds();
+    PrintOutput("%10d %10d %10.1f ms\n", mesh.numTriangles(), numThreads, timeElapsed);
+}
+
+BENCHMARK(bvhbuild)
+{
+    PrintOutput("Running benchmark: BVH Construction...\n");
+
+    std::vector<float>   vertices;
+    std::vector<int32_t> triangleIndices;
+    std::vector<int>     materialIndices;
+
+    LoadObj("../../data/meshes/sponza.obj", vertices, triangleIndices, materialIndices);
+
+    PrintOutput("%10s %10s %13s\n", "Triangles", "Threads", "Time");
+
+    auto copies = { 1, 2, 4, 8 };
+    auto threads = { 1, 2, 4, 8, 16 };
+
+    for (auto numCopies : copies)
+        for (auto numThreads : threads)
+            if (numThreads == 1 || numThreads <= static_cast<int>(std::thread::hardware_concurrency()))
+                BenchmarkBVHBuildForSettings(vertices, triangleIndices, numCopies, numThreads);
+
+    PrintOutput("\n");
+}
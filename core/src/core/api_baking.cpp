@@ -51,6 +51,7 @@ void CContext::bakeReflections(IPLReflectionsBakeParams* params,
     auto _identifier = *reinterpret_cast<BakedDataIdentifier*>(&params->identifier);
     auto _bakeConvolution = (params->bakeFlags & IPL_REFLECTIONSBAKEFLAGS_BAKECONVOLUTION);
     auto _bakeParametric = (params->bakeFlags & IPL_REFLECTIONSBAKEFLAGS_BAKEPARAMETRIC);
+    auto _energyFieldCompression = (params->bakeFlags & IPL_REFLECTIONSBAKEFLAGS_COMPRESSCONVOLUTION) ? EnergyFieldCompression::LogQuantized8 : EnergyFieldCompression::None;
 
     auto _bakeBatchSize = params->bakeBatchSize;
     if (params->sceneType != IPL_SCENETYPE_RADEONRAYS && params->identifier.variation != IPL_BAKEDDATAVARIATION_STATICLISTENER)
@@ -86,7 +87,7 @@ void CContext::bakeReflections(IPLReflectionsBakeParams* params,
     ReflectionBaker::bake(*_scene, *simulator, _identifier, _bakeConvolution, _bakeParametric, params->numRays,
                           params->numBounces, params->simulatedDuration, params->savedDuration, params->order,
                           params->irradianceMinDistance, params->numThreads, params->bakeBatchSize, _sceneType, _openCL,
-                          *_probeBatch, progressCallback, userData);
+                          *_probeBatch, progressCallback, userData, _energyFieldCompression);
 }
 
 void CContext::cancelBakeReflections()
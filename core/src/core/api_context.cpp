@@ -71,6 +71,18 @@ void CContext::setProfilerContext(void* profilerContext)
     Profiler::setProfilerContext(profilerContext);
 }
 
+shared_ptr<BackgroundJobQueue> CContext::backgroundJobQueue()
+{
+    std::lock_guard<std::mutex> lock(mBackgroundJobQueueMutex);
+
+    if (!mBackgroundJobQueue)
+    {
+        mBackgroundJobQueue = ipl::make_shared<BackgroundJobQueue>();
+    }
+
+    return mBackgroundJobQueue;
+}
+
 }
 
 
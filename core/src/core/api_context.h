@@ -19,6 +19,7 @@
 #include "error.h"
 #include "containers.h"
 #include "context.h"
+#include "background_job_queue.h"
 #include "profiler.h"
 using namespace ipl;
 
@@ -60,6 +61,9 @@ public:
     virtual IPLerror createSerializedObject(IPLSerializedObjectSettings* settings,
                                             ISerializedObject** serializedObject) override;
 
+    virtual IPLerror createSerializedObjectFromFile(IPLstring fileName,
+                                                    ISerializedObject** serializedObject) override;
+
     virtual IPLerror createEmbreeDevice(IPLEmbreeDeviceSettings* settings,
                                         IEmbreeDevice** device) override;
 
@@ -192,6 +196,14 @@ public:
     virtual IPLfloat32 calculateDirectivity(IPLCoordinateSpace3 source,
                                             IPLVector3 listener,
                                             IPLDirectivity* model) override;
+
+    // Returns the job queue used by audio effects created from this context to process work in the background,
+    // creating it if needed.
+    shared_ptr<BackgroundJobQueue> backgroundJobQueue();
+
+private:
+    shared_ptr<BackgroundJobQueue> mBackgroundJobQueue;
+    std::mutex mBackgroundJobQueueMutex;
 };
 
 }
@@ -49,6 +49,16 @@ CReflectionEffect::CReflectionEffect(CContext* context,
     _effectSettings.numChannels = effectSettings->numChannels;
     _effectSettings.irSize = effectSettings->irSize;
 
+    if (Context::isCallerAPIVersionAtLeast(4, 7))
+    {
+        _effectSettings.nonUniformPartitioning = (effectSettings->nonUniformPartitioning == IPL_TRUE);
+    }
+
+    if (_effectSettings.type == IndirectEffectType::Convolution && _effectSettings.nonUniformPartitioning)
+    {
+        _effectSettings.jobQueue = context->backgroundJobQueue();
+    }
+
     new (&mHandle) Handle<IndirectEffect>(ipl::make_shared<IndirectEffect>(_audioSettings, _effectSettings), _context);
 }
 
@@ -56,7 +56,13 @@ CScene::CScene(CContext* context,
     auto _embree = (settings->type == IPL_SCENETYPE_EMBREE && settings->embreeDevice) ? reinterpret_cast<CEmbreeDevice*>(settings->embreeDevice)->mHandle.get() : nullptr;
     auto _radeonRays = (settings->type == IPL_SCENETYPE_RADEONRAYS && settings->radeonRaysDevice) ? reinterpret_cast<CRadeonRaysDevice*>(settings->radeonRaysDevice)->mHandle.get() : nullptr;
 
-    new (&mHandle) Handle<ipl::IScene>(shared_ptr<ipl::IScene>(SceneFactory::create(_sceneType, _closestHitCallback, _anyHitCallback, _batchedClosestHitCallback, _batchedAnyHitCallback, settings->userData, _embree, _radeonRays)), _context);
+    shared_ptr<JobScheduler> _scheduler = nullptr;
+    if (Context::isCallerAPIVersionAtLeast(4, 7) && settings->type == IPL_SCENETYPE_DEFAULT && settings->numBuildThreads > 1)
+    {
+        _scheduler = ipl::make_shared<JobScheduler>(settings->numBuildThreads);
+    }
+
+    new (&mHandle) Handle<ipl::IScene>(shared_ptr<ipl::IScene>(SceneFactory::create(_sceneType, _closestHitCallback, _anyHitCallback, _batchedClosestHitCallback, _batchedAnyHitCallback, settings->userData, _embree, _radeonRays, _scheduler)), _context);
 }
 
 CScene::CScene(CContext* context,
@@ -75,7 +81,13 @@ CScene::CScene(CContext* context,
     if (!_serializedObject)
         throw Exception(Status::Failure);
 
-    new (&mHandle) Handle<ipl::IScene>(shared_ptr<ipl::IScene>(SceneFactory::create(_sceneType, _embree, _radeonRays, *_serializedObject)), _context);
+    shared_ptr<JobScheduler> _scheduler = nullptr;
+    if (Context::isCallerAPIVersionAtLeast(4, 7) && settings->type == IPL_SCENETYPE_DEFAULT && settings->numBuildThreads > 1)
+    {
+        _scheduler = ipl::make_shared<JobScheduler>(settings->numBuildThreads);
+    }
+
+    new (&mHandle) Handle<ipl::IScene>(shared_ptr<ipl::IScene>(SceneFactory::create(_sceneType, _embree, _radeonRays, *_serializedObject, _scheduler)), _context);
 }
 
 IScene* CScene::retain()
@@ -192,6 +204,15 @@ IPLerror CScene::createInstancedMesh(IPLInstancedMeshSettings* settings,
     return IPL_STATUS_SUCCESS;
 }
 
+void CScene::commitWithFlags(IPLSceneCommitFlags flags)
+{
+    auto _scene = mHandle.get();
+    if (!_scene)
+        return;
+
+    _scene->commit(static_cast<SceneCommitFlags>(flags));
+}
+
 
 // --------------------------------------------------------------------------------------------------------------------
 // CStaticMesh
@@ -290,6 +311,24 @@ void CStaticMesh::remove(IScene* scene)
     _scene->removeStaticMesh(_staticMesh);
 }
 
+void CStaticMesh::updateVertices(IScene* scene,
+                                 IPLint32 numVertices,
+                                 IPLVector3* vertices)
+{
+    if (!scene || !vertices)
+        return;
+
+    auto _scene = static_cast<CScene*>(scene)->mHandle.get();
+    auto _staticMesh = mHandle.get();
+    if (!_scene || !_staticMesh)
+        return;
+
+    if (numVertices != _staticMesh->numVertices())
+        return;
+
+    _staticMesh->updateVertices(reinterpret_cast<const Vector3f*>(vertices));
+}
+
 
 // --------------------------------------------------------------------------------------------------------------------
 // CInstancedMesh
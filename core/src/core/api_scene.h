@@ -74,6 +74,8 @@ public:
 
     virtual IPLerror createInstancedMesh(IPLInstancedMeshSettings* settings,
                                          IInstancedMesh** instancedMesh) override;
+
+    virtual void commitWithFlags(IPLSceneCommitFlags flags) override;
 };
 
 
@@ -101,6 +103,10 @@ public:
     virtual void add(IScene* scene) override;
 
     virtual void remove(IScene* scene) override;
+
+    virtual void updateVertices(IScene* scene,
+                                IPLint32 numVertices,
+                                IPLVector3* vertices) override;
 };
 
 
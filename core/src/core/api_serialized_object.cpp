@@ -48,6 +48,18 @@ CSerializedObject::CSerializedObject(CContext* context,
     }
 }
 
+CSerializedObject::CSerializedObject(CContext* context,
+                                     IPLstring fileName)
+{
+    auto _context = context->mHandle.get();
+    if (!_context)
+        throw Exception(Status::Failure);
+
+    auto mappedFile = ipl::make_shared<MappedFile>(fileName);
+
+    new (&mHandle) Handle<SerializedObject>(ipl::make_shared<SerializedObject>(mappedFile), _context);
+}
+
 ISerializedObject* CSerializedObject::retain()
 {
     mHandle.retain();
@@ -106,4 +118,24 @@ IPLerror CContext::createSerializedObject(IPLSerializedObjectSettings* settings,
     return IPL_STATUS_SUCCESS;
 }
 
+IPLerror CContext::createSerializedObjectFromFile(IPLstring fileName,
+                                                  ISerializedObject** serializedObject)
+{
+    if (!fileName || !serializedObject)
+        return IPL_STATUS_FAILURE;
+
+    try
+    {
+        auto _serializedObject = reinterpret_cast<CSerializedObject*>(gMemory().allocate(sizeof(CSerializedObject), Memory::kDefaultAlignment));
+        new (_serializedObject) CSerializedObject(this, fileName);
+        *serializedObject = _serializedObject;
+    }
+    catch (Exception exception)
+    {
+        return static_cast<IPLerror>(exception.status());
+    }
+
+    return IPL_STATUS_SUCCESS;
+}
+
 }
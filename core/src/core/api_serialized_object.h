@@ -40,6 +40,9 @@ public:
     CSerializedObject(CContext* context,
                       IPLSerializedObjectSettings* settings);
 
+    CSerializedObject(CContext* context,
+                      IPLstring fileName);
+
     virtual ISerializedObject* retain() override;
 
     virtual void release() override;
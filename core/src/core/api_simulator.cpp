@@ -48,7 +48,7 @@ CSimulator::CSimulator(CContext* context,
     auto _enablePathing = (settings->flags & IPL_SIMULATIONFLAGS_PATHING);
     auto _sceneType = static_cast<SceneType>(settings->sceneType);
     auto _indirectType = static_cast<IndirectEffectType>(settings->reflectionType);
-    auto _maxNumListeners = 1;
+    auto _maxNumListeners = (Context::isCallerAPIVersionAtLeast(4, 7)) ? std::max(settings->maxNumListeners, 1) : 1;
     auto _asymmetricVisRange = true;
     auto _down = Vector3f(0.0f, -1.0f, 0.0f);
     auto _openCL = (settings->openCLDevice) ? reinterpret_cast<COpenCLDevice*>(settings->openCLDevice)->mHandle.get() : nullptr;
@@ -117,6 +117,55 @@ void CSimulator::removeProbeBatch(IProbeBatch* probeBatch)
     _simulator->removeProbeBatch(_probeBatch);
 }
 
+void CSimulator::addStreamedProbeBatch(IProbeBatch* probeBatch,
+                                       IPLfloat32 tileSize)
+{
+    if (!probeBatch)
+        return;
+
+    auto _probeBatch = reinterpret_cast<CProbeBatch*>(probeBatch)->mHandle.get();
+    auto _simulator = mHandle.get();
+    if (!_probeBatch || !_simulator)
+        return;
+
+    _simulator->addStreamedProbeBatch(_probeBatch, tileSize);
+}
+
+void CSimulator::setProbeStreamingSettings(IPLProbeStreamingSettings* settings)
+{
+    if (!settings)
+        return;
+
+    auto _simulator = mHandle.get();
+    if (!_simulator)
+        return;
+
+    ProbeStreamingSettings _settings{};
+    _settings.memoryBudget = settings->memoryBudget;
+    _settings.prefetchRadius = settings->prefetchRadius;
+
+    _simulator->setProbeStreamingSettings(_settings);
+}
+
+void CSimulator::getProbeStreamingStats(IPLProbeStreamingStats* stats)
+{
+    if (!stats)
+        return;
+
+    auto _simulator = mHandle.get();
+    if (!_simulator)
+        return;
+
+    auto _stats = _simulator->probeStreamingStats();
+
+    stats->numTiles = _stats.numTiles;
+    stats->numResidentTiles = _stats.numResidentTiles;
+    stats->numLoadingTiles = _stats.numLoadingTiles;
+    stats->residentBytes = static_cast<IPLsize>(_stats.residentBytes);
+    stats->numLoads = _stats.numLoads;
+    stats->numEvictions = _stats.numEvictions;
+}
+
 void CSimulator::setSharedInputs(IPLSimulationFlags flags,
                                  IPLSimulationSharedInputs* sharedData)
 {
@@ -145,6 +194,23 @@ void CSimulator::setSharedInputs(IPLSimulationFlags flags,
         sharedReflectionInputs.irradianceMinDistance = sharedData->irradianceMinDistance;
         sharedReflectionInputs.reconstructionType = ReconstructionType::Linear;
 
+        if (Context::isCallerAPIVersionAtLeast(4, 7))
+        {
+            sharedReflectionInputs.clusterSources = (sharedData->clusterSources == IPL_TRUE);
+            sharedReflectionInputs.maxClusteringError = sharedData->maxClusteringError;
+            sharedReflectionInputs.russianRoulette = (sharedData->russianRoulette == IPL_TRUE);
+            sharedReflectionInputs.survivalThreshold = sharedData->survivalThreshold;
+            sharedReflectionInputs.rotateDiffuseSamples = (sharedData->rotateDiffuseSamples == IPL_TRUE);
+            sharedReflectionInputs.cachePaths = (sharedData->cachePaths == IPL_TRUE);
+            sharedReflectionInputs.pathHistoryLength = sharedData->pathHistoryLength;
+            sharedReflectionInputs.shareListenerPaths = (sharedData->shareListenerPaths == IPL_TRUE);
+
+            for (auto i = 0; i < sharedData->numAdditionalListeners; ++i)
+            {
+                sharedReflectionInputs.additionalListeners.push_back(*reinterpret_cast<CoordinateSpace3f*>(&sharedData->additionalListeners[i]));
+            }
+        }
+
         _simulator->setSharedReflectionInputs(sharedReflectionInputs);
     }
     if (flags & IPL_SIMULATIONFLAGS_PATHING)
@@ -249,10 +315,11 @@ CSource::CSource(CSimulator* simulator,
     auto _frameSize = _simulator->frameSize();
     auto _openCL = _simulator->openCLDevice();
     auto _tan = _simulator->tanDevice();
+    auto _maxNumListeners = _simulator->maxNumListeners();
 
     new (&mHandle) Handle<SimulationData>(ipl::make_shared<SimulationData>(_enableIndirect, _enablePathing, _sceneType, _indirectType,
                                           _maxNumOcclusionSamples, _maxDuration, _maxOrder,
-                                          _samplingRate, _frameSize, _openCL, _tan), _context);
+                                          _samplingRate, _frameSize, _openCL, _tan, _maxNumListeners), _context);
 }
 
 ISource* CSource::retain()
@@ -346,6 +413,11 @@ void CSource::setInputs(IPLSimulationFlags flags,
         {
             _source->directInputs.numTransmissionRays = inputs->numTransmissionRays;
         }
+
+        if (Context::isCallerAPIVersionAtLeast(4, 7))
+        {
+            _source->directInputs.temporalOcclusion = (inputs->temporalOcclusion == IPL_TRUE);
+        }
     }
 
     if (flags & IPL_SIMULATIONFLAGS_REFLECTIONS)
@@ -430,17 +502,7 @@ void CSource::getOutputs(IPLSimulationFlags flags,
 
     if (flags & IPL_SIMULATIONFLAGS_REFLECTIONS)
     {
-        outputs->reflections.ir = reinterpret_cast<IPLReflectionEffectIR>(&_source->reflectionOutputs.overlapSaveFIR);
-        outputs->reflections.numChannels = _source->reflectionOutputs.numChannels;
-        outputs->reflections.irSize = _source->reflectionOutputs.numSamples;
-        outputs->reflections.reverbTimes[0] = _source->reflectionOutputs.reverb.reverbTimes[0];
-        outputs->reflections.reverbTimes[1] = _source->reflectionOutputs.reverb.reverbTimes[1];
-        outputs->reflections.reverbTimes[2] = _source->reflectionOutputs.reverb.reverbTimes[2];
-        outputs->reflections.eq[0] = _source->reflectionOutputs.hybridEQ[0];
-        outputs->reflections.eq[1] = _source->reflectionOutputs.hybridEQ[1];
-        outputs->reflections.eq[2] = _source->reflectionOutputs.hybridEQ[2];
-        outputs->reflections.delay = _source->reflectionOutputs.hybridDelay;
-        outputs->reflections.tanSlot = _source->reflectionOutputs.tanSlot;
+        getReflectionOutputs(_source->reflectionOutputs, &outputs->reflections);
     }
 
     if (flags & IPL_SIMULATIONFLAGS_PATHING)
@@ -450,6 +512,38 @@ void CSource::getOutputs(IPLSimulationFlags flags,
     }
 }
 
+void CSource::getListenerReflectionOutputs(IPLint32 listenerIndex,
+                                           IPLReflectionEffectParams* params)
+{
+    if (!params)
+        return;
+
+    auto _source = mHandle.get();
+    if (!_source)
+        return;
+
+    if (listenerIndex < 0 || _source->numListeners() <= listenerIndex)
+        return;
+
+    getReflectionOutputs(_source->listenerData(listenerIndex).reflectionOutputs, params);
+}
+
+void CSource::getReflectionOutputs(ReflectionSimulationOutputs& reflectionOutputs,
+                                   IPLReflectionEffectParams* params)
+{
+    params->ir = reinterpret_cast<IPLReflectionEffectIR>(&reflectionOutputs.overlapSaveFIR);
+    params->numChannels = reflectionOutputs.numChannels;
+    params->irSize = reflectionOutputs.numSamples;
+    params->reverbTimes[0] = reflectionOutputs.reverb.reverbTimes[0];
+    params->reverbTimes[1] = reflectionOutputs.reverb.reverbTimes[1];
+    params->reverbTimes[2] = reflectionOutputs.reverb.reverbTimes[2];
+    params->eq[0] = reflectionOutputs.hybridEQ[0];
+    params->eq[1] = reflectionOutputs.hybridEQ[1];
+    params->eq[2] = reflectionOutputs.hybridEQ[2];
+    params->delay = reflectionOutputs.hybridDelay;
+    params->tanSlot = reflectionOutputs.tanSlot;
+}
+
 
 // --------------------------------------------------------------------------------------------------------------------
 // CContext
@@ -68,6 +68,13 @@ public:
 
     virtual IPLerror createSource(IPLSourceSettings* settings,
                                   ISource** source) override;
+
+    virtual void addStreamedProbeBatch(IProbeBatch* probeBatch,
+                                       IPLfloat32 tileSize) override;
+
+    virtual void setProbeStreamingSettings(IPLProbeStreamingSettings* settings) override;
+
+    virtual void getProbeStreamingStats(IPLProbeStreamingStats* stats) override;
 };
 
 
@@ -96,6 +103,13 @@ public:
 
     virtual void getOutputs(IPLSimulationFlags flags,
                             IPLSimulationOutputs* outputs) override;
+
+    virtual void getListenerReflectionOutputs(IPLint32 listenerIndex,
+                                              IPLReflectionEffectParams* params) override;
+
+private:
+    static void getReflectionOutputs(ReflectionSimulationOutputs& reflectionOutputs,
+                                     IPLReflectionEffectParams* params);
 };
 
 }
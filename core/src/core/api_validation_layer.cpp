@@ -207,6 +207,10 @@ std::string to_string(T* value)
     VALIDATE(IPLSimulationFlags, value, ((value & ~(IPL_SIMULATIONFLAGS_DIRECT | IPL_SIMULATIONFLAGS_REFLECTIONS | IPL_SIMULATIONFLAGS_PATHING)) == 0)); \
 }
 
+#define VALIDATE_IPLSceneCommitFlags(value) { \
+    VALIDATE(IPLSceneCommitFlags, value, ((value & ~(IPL_SCENECOMMITFLAGS_REFITONLY | IPL_SCENECOMMITFLAGS_FORCEREBUILD)) == 0)); \
+}
+
 #define VALIDATE_IPLDirectSimulationFlags(value) { \
     VALIDATE(IPLDirectSimulationFlags, value, ((value & ~(IPL_DIRECTSIMULATIONFLAGS_DISTANCEATTENUATION | IPL_DIRECTSIMULATIONFLAGS_AIRABSORPTION | IPL_DIRECTSIMULATIONFLAGS_DIRECTIVITY | IPL_DIRECTSIMULATIONFLAGS_OCCLUSION | IPL_DIRECTSIMULATIONFLAGS_TRANSMISSION)) == 0)); \
 }
@@ -312,6 +316,9 @@ std::string to_string(T* value)
         else if (value->type == IPL_SCENETYPE_RADEONRAYS) { \
             VALIDATE_POINTER(value->radeonRaysDevice); \
         } \
+        if (Context::isCallerAPIVersionAtLeast(4, 7)) { \
+            VALIDATE(IPLint32, value->numBuildThreads, (value->numBuildThreads >= 0)); \
+        } \
     } \
 }
 
@@ -696,6 +703,9 @@ std::string to_string(T* value)
                 VALIDATE_POINTER(value->tanDevice); \
             } \
         } \
+        if (Context::isCallerAPIVersionAtLeast(4, 7)) { \
+            VALIDATE(IPLint32, value->maxNumListeners, (value->maxNumListeners > 0)); \
+        } \
     } \
 }
 
@@ -716,6 +726,26 @@ std::string to_string(T* value)
             VALIDATE(IPLfloat32, value->duration, (value->duration > 0.0f)); \
             VALIDATE(IPLint32, value->order, (value->order >= 0)); \
             VALIDATE(IPLfloat32, value->irradianceMinDistance, (value->irradianceMinDistance > 0.0f)); \
+            if (Context::isCallerAPIVersionAtLeast(4, 7) && value->clusterSources) { \
+                VALIDATE(IPLfloat32, value->maxClusteringError, (value->maxClusteringError >= 0.0f)); \
+            } \
+            if (Context::isCallerAPIVersionAtLeast(4, 7) && value->russianRoulette) { \
+                VALIDATE(IPLfloat32, value->survivalThreshold, (value->survivalThreshold > 0.0f)); \
+            } \
+            if (Context::isCallerAPIVersionAtLeast(4, 7) && value->cachePaths) { \
+                VALIDATE(IPLint32, value->pathHistoryLength, (value->pathHistoryLength > 0)); \
+            } \
+            if (Context::isCallerAPIVersionAtLeast(4, 7)) { \
+                VALIDATE(IPLint32, value->numAdditionalListeners, (value->numAdditionalListeners >= 0)); \
+                if (value->numAdditionalListeners > 0) { \
+                    VALIDATE_POINTER(value->additionalListeners); \
+                    if (value->additionalListeners) { \
+                        for (auto iListener = 0; iListener < value->numAdditionalListeners; ++iListener) { \
+                            VALIDATE_IPLCoordinateSpace3(value->additionalListeners[iListener]); \
+                        } \
+                    } \
+                } \
+            } \
         } \
     } \
 }
@@ -879,6 +909,14 @@ public:
         return apiObjectAllocate<CValidatedSerializedObject, CContext, ISerializedObject>(serializedObject, this, settings);
     }
 
+    virtual IPLerror createSerializedObjectFromFile(IPLstring fileName, ISerializedObject** serializedObject) override
+    {
+        VALIDATE_POINTER(fileName);
+        VALIDATE_POINTER(serializedObject);
+
+        return apiObjectAllocate<CValidatedSerializedObject, CContext, ISerializedObject>(serializedObject, this, fileName);
+    }
+
     virtual IPLerror createEmbreeDevice(IPLEmbreeDeviceSettings* settings, IEmbreeDevice** device) override
     {
         VALIDATE_IPLEmbreeDeviceSettings(settings);
@@ -1269,6 +1307,10 @@ public:
     CValidatedSerializedObject(CContext* context, IPLSerializedObjectSettings* settings)
         : CSerializedObject(context, settings)
     {}
+
+    CValidatedSerializedObject(CContext* context, IPLstring fileName)
+        : CSerializedObject(context, fileName)
+    {}
 };
 
 
@@ -1426,6 +1468,13 @@ public:
 
         return apiObjectAllocate<CValidatedInstancedMesh, CScene, IInstancedMesh>(instancedMesh, this, settings);
     }
+
+    virtual void commitWithFlags(IPLSceneCommitFlags flags) override
+    {
+        VALIDATE_IPLSceneCommitFlags(flags);
+
+        CScene::commitWithFlags(flags);
+    }
 };
 
 
@@ -1464,6 +1513,28 @@ public:
 
         CStaticMesh::remove(scene);
     }
+
+    virtual void updateVertices(IScene* scene, IPLint32 numVertices, IPLVector3* vertices) override
+    {
+        VALIDATE_POINTER(scene);
+        VALIDATE_POINTER(vertices);
+
+        auto _staticMesh = mHandle.get();
+        if (_staticMesh)
+        {
+            VALIDATE(IPLint32, numVertices, (numVertices == _staticMesh->numVertices()));
+        }
+
+        if (vertices)
+        {
+            for (auto iVertex = 0; iVertex < numVertices; ++iVertex)
+            {
+                VALIDATE_IPLVector3(vertices[iVertex]);
+            }
+        }
+
+        CStaticMesh::updateVertices(scene, numVertices, vertices);
+    }
 };
 
 
@@ -1997,6 +2068,32 @@ public:
         CSimulator::removeProbeBatch(probeBatch);
     }
 
+    virtual void addStreamedProbeBatch(IProbeBatch* probeBatch, IPLfloat32 tileSize) override
+    {
+        VALIDATE_POINTER(probeBatch);
+        VALIDATE(IPLfloat32, tileSize, (Math::isFinite(tileSize) && tileSize > 0.0f));
+
+        CSimulator::addStreamedProbeBatch(probeBatch, tileSize);
+    }
+
+    virtual void setProbeStreamingSettings(IPLProbeStreamingSettings* settings) override
+    {
+        VALIDATE_POINTER(settings);
+        if (settings)
+        {
+            VALIDATE(IPLfloat32, settings->prefetchRadius, (Math::isFinite(settings->prefetchRadius) && settings->prefetchRadius >= 0.0f));
+        }
+
+        CSimulator::setProbeStreamingSettings(settings);
+    }
+
+    virtual void getProbeStreamingStats(IPLProbeStreamingStats* stats) override
+    {
+        VALIDATE_POINTER(stats);
+
+        CSimulator::getProbeStreamingStats(stats);
+    }
+
     virtual void setSharedInputs(IPLSimulationFlags flags, IPLSimulationSharedInputs* sharedInputs) override
     {
         VALIDATE_IPLSimulationFlags(flags);
@@ -2057,6 +2154,16 @@ public:
 
         VALIDATE_IPLSimulationOutputs(outputs, flags);
     }
+
+    virtual void getListenerReflectionOutputs(IPLint32 listenerIndex, IPLReflectionEffectParams* params) override
+    {
+        VALIDATE(IPLint32, listenerIndex, (listenerIndex >= 0));
+        VALIDATE_POINTER(params);
+
+        CSource::getListenerReflectionOutputs(listenerIndex, params);
+
+        VALIDATE_IPLReflectionEffectParams(params);
+    }
 };
 
 }
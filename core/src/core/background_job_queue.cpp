@@ -0,0 +1,187 @@
+//
+// Copyright 2017-2023 Valve Corporation.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "background_job_queue.h"
+
+namespace ipl {
+
+// --------------------------------------------------------------------------------------------------------------------
+// BackgroundJob
+// --------------------------------------------------------------------------------------------------------------------
+
+BackgroundJob::BackgroundJob(std::function<void()> callback)
+    : mCallback(callback)
+    , mState(kIdle)
+{}
+
+bool BackgroundJob::claimOrWait()
+{
+    auto expected = kQueued;
+    if (mState.compare_exchange_strong(expected, kCancelled, std::memory_order_acq_rel))
+        return true;
+
+    waitUntilIdle();
+    return false;
+}
+
+void BackgroundJob::waitUntilIdle() const
+{
+    while (!isIdle())
+    {
+        std::this_thread::yield();
+    }
+}
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// BackgroundJobQueue
+// --------------------------------------------------------------------------------------------------------------------
+
+const int BackgroundJobQueue::kDefaultCapacity = 256;
+const std::chrono::microseconds BackgroundJobQueue::kMaxSleepTime(1000);
+
+BackgroundJobQueue::BackgroundJobQueue(int capacity)
+    : mWritePosition(0)
+    , mReadPosition(0)
+    , mQuit(false)
+{
+    assert(capacity > 0);
+
+    // Round up to a power of 2, so positions can be mapped to slots with a mask.
+    auto numSlots = 1;
+    while (numSlots < capacity)
+    {
+        numSlots *= 2;
+    }
+
+    mSlots.resize(numSlots);
+    mMask = numSlots - 1;
+
+    for (auto i = 0; i < numSlots; ++i)
+    {
+        mSlots[i].sequence = i;
+        mSlots[i].job = nullptr;
+    }
+
+    mThread = std::thread(&BackgroundJobQueue::threadFunc, this);
+}
+
+BackgroundJobQueue::~BackgroundJobQueue()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mQuit = true;
+    mCondVar.notify_one();
+    lock.unlock();
+
+    mThread.join();
+}
+
+bool BackgroundJobQueue::submit(BackgroundJob& job)
+{
+    auto expected = BackgroundJob::kIdle;
+    if (!job.mState.compare_exchange_strong(expected, BackgroundJob::kQueued, std::memory_order_acq_rel))
+        return false;
+
+    if (!push(job))
+    {
+        job.mState.store(BackgroundJob::kIdle, std::memory_order_release);
+        return false;
+    }
+
+    // Notifying without holding the mutex may cause the wakeup to be missed, in which case the worker will pick up
+    // the job after at most kMaxSleepTime.
+    mCondVar.notify_one();
+    return true;
+}
+
+bool BackgroundJobQueue::push(BackgroundJob& job)
+{
+    // A slot can be written to at position p when its sequence number is p, and read from when it is p + 1. Once it
+    // has been read, the worker sets it to p + capacity, i.e., the position at which the slot will next be written.
+    auto position = mWritePosition.load(std::memory_order_relaxed);
+    while (true)
+    {
+        auto& slot = mSlots[static_cast<int>(position & mMask)];
+        auto sequence = slot.sequence.load(std::memory_order_acquire);
+        auto difference = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(position);
+
+        if (difference == 0)
+        {
+            if (mWritePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                slot.job = &job;
+                slot.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (difference < 0)
+        {
+            // The worker hasn't read this slot since the last time around, so the queue is full.
+            return false;
+        }
+        else
+        {
+            // Another thread has claimed this position.
+            position = mWritePosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool BackgroundJobQueue::pop(BackgroundJob*& job)
+{
+    auto& slot = mSlots[static_cast<int>(mReadPosition & mMask)];
+    if (slot.sequence.load(std::memory_order_acquire) != mReadPosition + 1)
+        return false;
+
+    job = slot.job;
+    slot.sequence.store(mReadPosition + mSlots.size(0), std::memory_order_release);
+    ++mReadPosition;
+    return true;
+}
+
+bool BackgroundJobQueue::isEmpty() const
+{
+    const auto& slot = mSlots[static_cast<int>(mReadPosition & mMask)];
+    return (slot.sequence.load(std::memory_order_acquire) != mReadPosition + 1);
+}
+
+void BackgroundJobQueue::threadFunc()
+{
+    while (true)
+    {
+        BackgroundJob* job = nullptr;
+        if (pop(job))
+        {
+            // Jobs that were claimed back by the submitting thread are discarded, which makes them idle again.
+            auto expected = BackgroundJob::kQueued;
+            if (job->mState.compare_exchange_strong(expected, BackgroundJob::kRunning, std::memory_order_acq_rel))
+            {
+                job->mCallback();
+            }
+
+            job->mState.store(BackgroundJob::kIdle, std::memory_order_release);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondVar.wait_for(lock, kMaxSleepTime, [this]() { return (mQuit || !isEmpty()); });
+
+        if (mQuit)
+            break;
+    }
+}
+
+}
@@ -0,0 +1,124 @@
+//
+// Copyright 2017-2023 Valve Corporation.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "array.h"
+
+namespace ipl {
+
+// --------------------------------------------------------------------------------------------------------------------
+// BackgroundJob
+// --------------------------------------------------------------------------------------------------------------------
+
+// A job that can be handed off to a BackgroundJobQueue from an audio thread. A job is idle, queued, running on the
+// queue's worker thread, or cancelled. A cancelled job was claimed back by the thread that submitted it before the
+// worker got to it, and stays in the queue until the worker discards it. A job can only be submitted when it is idle,
+// and must not be destroyed until it is idle.
+class BackgroundJob
+{
+public:
+    BackgroundJob(std::function<void()> callback);
+
+    bool isIdle() const
+    {
+        return (mState.load(std::memory_order_acquire) == kIdle);
+    }
+
+    // If the worker has not yet started running this job, prevents it from doing so and returns true; the caller is
+    // then responsible for doing the job's work. Otherwise, waits until the worker has finished running the job, and
+    // returns false. Never locks.
+    bool claimOrWait();
+
+    // Waits until this job is idle. Never locks.
+    void waitUntilIdle() const;
+
+private:
+    static const int kIdle = 0;
+    static const int kQueued = 1;
+    static const int kRunning = 2;
+    static const int kCancelled = 3;
+
+    std::function<void()> mCallback;
+    std::atomic<int> mState;
+
+    friend class BackgroundJobQueue;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// BackgroundJobQueue
+// --------------------------------------------------------------------------------------------------------------------
+
+// Runs jobs submitted from one or more audio threads on a single worker thread. Jobs are handed to the worker through a
+// fixed-size, lock-free ring buffer, so submitting a job never locks or allocates. The worker sleeps when the queue is
+// empty. Since submitting doesn't lock, a wakeup may be missed if a job is submitted just as the worker goes to sleep,
+// so the worker also checks the queue every kMaxSleepTime.
+class BackgroundJobQueue
+{
+public:
+    static const int kDefaultCapacity;
+    static const std::chrono::microseconds kMaxSleepTime;
+
+    BackgroundJobQueue(int capacity = kDefaultCapacity);
+
+    ~BackgroundJobQueue();
+
+    // Returns the maximum number of jobs that can be in the queue at the same time. Cancelled jobs count until the
+    // worker discards them.
+    int capacity() const
+    {
+        return static_cast<int>(mSlots.size(0));
+    }
+
+    // Queues an idle job for the worker to run. Returns false, without queueing the job, if the job is not idle or
+    // if the queue is full. Never locks or allocates, so it can be called from an audio thread.
+    bool submit(BackgroundJob& job);
+
+private:
+    // An entry in the ring buffer. The sequence number says whether the slot is ready to be written to or read from
+    // for a given position in the queue.
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        BackgroundJob* job;
+    };
+
+    Array<Slot> mSlots;
+    size_t mMask;
+    std::atomic<size_t> mWritePosition; // Shared by all submitting threads.
+    size_t mReadPosition; // Only used by the worker thread.
+    std::atomic<bool> mQuit;
+    std::mutex mMutex;
+    std::condition_variable mCondVar;
+    std::thread mThread;
+
+    bool push(BackgroundJob& job);
+
+    bool pop(BackgroundJob*& job);
+
+    bool isEmpty() const;
+
+    void threadFunc();
+};
+
+}
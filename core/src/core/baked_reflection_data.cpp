@@ -31,11 +31,12 @@ BakedReflectionsData::BakedReflectionsData(const BakedDataIdentifier& identifier
     : mIdentifier(identifier)
     , mHasConvolution(hasConvolution)
     , mHasParametric(hasParametric)
+    , mEnergyFieldCompression(EnergyFieldCompression::None)
     , mNeedsUpdate(numProbes)
 {
     if (hasConvolution)
     {
-        mEnergyFields.resize(numProbes);
+        resizeEnergyFields(numProbes);
     }
 
     if (hasParametric)
@@ -51,33 +52,54 @@ BakedReflectionsData::BakedReflectionsData(const BakedDataIdentifier& identifier
 
 BakedReflectionsData::BakedReflectionsData(const BakedDataIdentifier& identifier,
                                            int numProbes,
-                                           const Serialized::BakedReflectionsData* serializedObject)
+                                           const Serialized::BakedReflectionsData* serializedObject,
+                                           shared_ptr<const MappedFile> mappedFile)
     : mIdentifier(identifier)
+    , mEnergyFieldCompression(EnergyFieldCompression::None)
     , mNeedsUpdate(numProbes)
+    , mMappedFile(mappedFile)
 {
     assert(serializedObject);
     assert(serializedObject->needs_update() && serializedObject->needs_update()->Length() > 0);
 
     memcpy(mNeedsUpdate.data(), serializedObject->needs_update()->data(), serializedObject->needs_update()->size() * sizeof(uint8_t));
 
-    mHasConvolution = (serializedObject->energy_fields() != nullptr);
+    const auto* energyFields = serializedObject->energy_fields();
+    const auto* compressedEnergyFields = serializedObject->compressed_energy_fields();
+
+    mHasConvolution = (energyFields != nullptr || compressedEnergyFields != nullptr);
     mHasParametric = (serializedObject->reverbs() != nullptr);
 
     if (mHasConvolution)
     {
-        mEnergyFields.resize(numProbes);
+        resizeEnergyFields(numProbes);
 
         for (auto i = 0; i < numProbes; ++i)
         {
             if (!mNeedsUpdate[i])
             {
-                if (serializedObject->energy_fields()->Length() > i && serializedObject->energy_fields()->Get(i) != nullptr)
+                // Compressed energy fields are kept compressed, and only decoded when looked up.
+                if (compressedEnergyFields && compressedEnergyFields->Length() > i && compressedEnergyFields->Get(i) != nullptr)
                 {
-                    mEnergyFields[i] = ipl::make_unique<EnergyField>(serializedObject->energy_fields()->Get(i));
+                    if (mMappedFile)
+                    {
+                        mMappedCompressedEnergyFields[i] = compressedEnergyFields->Get(i);
+                    }
+                    else
+                    {
+                        mCompressedEnergyFields[i] = ipl::make_unique<CompressedEnergyField>(compressedEnergyFields->Get(i));
+                    }
                 }
-                else
+                else if (energyFields && energyFields->Length() > i && energyFields->Get(i) != nullptr)
                 {
-                    mEnergyFields[i] = nullptr;
+                    if (mMappedFile)
+                    {
+                        mMappedEnergyFields[i] = energyFields->Get(i);
+                    }
+                    else
+                    {
+                        mEnergyFields[i] = ipl::make_unique<EnergyField>(energyFields->Get(i));
+                    }
                 }
             }
         }
@@ -90,6 +112,45 @@ BakedReflectionsData::BakedReflectionsData(const BakedDataIdentifier& identifier
     }
 }
 
+BakedReflectionsData::BakedReflectionsData(const BakedReflectionsData& other,
+                                           const vector<int>& probeIndices)
+    : BakedReflectionsData(other.mIdentifier, static_cast<int>(probeIndices.size()), other.mHasConvolution, other.mHasParametric)
+{
+    mEnergyFieldCompression = other.mEnergyFieldCompression;
+
+    for (auto i = 0u; i < probeIndices.size(); ++i)
+    {
+        auto index = probeIndices[i];
+
+        mNeedsUpdate[i] = other.mNeedsUpdate[index];
+
+        if (mHasConvolution)
+        {
+            if (other.mEnergyFields[index])
+            {
+                mEnergyFields[i] = ipl::make_unique<EnergyField>(*other.mEnergyFields[index]);
+            }
+            else if (other.mCompressedEnergyFields[index])
+            {
+                mCompressedEnergyFields[i] = ipl::make_unique<CompressedEnergyField>(*other.mCompressedEnergyFields[index]);
+            }
+            else if (other.mMappedEnergyFields[index])
+            {
+                mEnergyFields[i] = ipl::make_unique<EnergyField>(other.mMappedEnergyFields[index]);
+            }
+            else if (other.mMappedCompressedEnergyFields[index])
+            {
+                mCompressedEnergyFields[i] = ipl::make_unique<CompressedEnergyField>(other.mMappedCompressedEnergyFields[index]);
+            }
+        }
+
+        if (mHasParametric)
+        {
+            mReverbs[i] = other.mReverbs[index];
+        }
+    }
+}
+
 void BakedReflectionsData::updateProbePosition(int index,
                                                const Vector3f& position)
 {
@@ -103,6 +164,9 @@ void BakedReflectionsData::addProbe(const Sphere& influence)
     if (mHasConvolution)
     {
         mEnergyFields.push_back(nullptr);
+        mCompressedEnergyFields.push_back(nullptr);
+        mMappedEnergyFields.push_back(nullptr);
+        mMappedCompressedEnergyFields.push_back(nullptr);
     }
 
     if (mHasParametric)
@@ -118,6 +182,9 @@ void BakedReflectionsData::removeProbe(int index)
     if (mHasConvolution)
     {
         mEnergyFields.erase(mEnergyFields.begin() + index);
+        mCompressedEnergyFields.erase(mCompressedEnergyFields.begin() + index);
+        mMappedEnergyFields.erase(mMappedEnergyFields.begin() + index);
+        mMappedCompressedEnergyFields.erase(mMappedCompressedEnergyFields.begin() + index);
     }
 
     if (mHasParametric)
@@ -156,6 +223,9 @@ void BakedReflectionsData::updateEndpoint(const BakedDataIdentifier& identifier,
                 if (mHasConvolution)
                 {
                     mEnergyFields[i] = nullptr;
+                    mCompressedEnergyFields[i] = nullptr;
+                    mMappedEnergyFields[i] = nullptr;
+                    mMappedCompressedEnergyFields[i] = nullptr;
                 }
 
                 if (mHasParametric)
@@ -184,6 +254,30 @@ uint64_t BakedReflectionsData::serializedSize() const
                 {
                     size += mEnergyFields[i]->serializedSize();
                 }
+                else if (mCompressedEnergyFields[i])
+                {
+                    size += mCompressedEnergyFields[i]->serializedSize();
+                }
+                else if (mMappedEnergyFields[i])
+                {
+                    size += 2 * sizeof(int32_t) + mMappedEnergyFields[i]->data()->size() * sizeof(float);
+                }
+                else if (mMappedCompressedEnergyFields[i])
+                {
+                    const auto* compressedEnergyField = mMappedCompressedEnergyFields[i];
+
+                    size += 2 * sizeof(int32_t) + compressedEnergyField->scales()->size() * sizeof(float);
+
+                    if (compressedEnergyField->codes_8bit())
+                    {
+                        size += compressedEnergyField->codes_8bit()->size() * sizeof(uint8_t);
+                    }
+
+                    if (compressedEnergyField->codes_16bit())
+                    {
+                        size += compressedEnergyField->codes_16bit()->size() * sizeof(uint16_t);
+                    }
+                }
             }
         }
     }
@@ -212,11 +306,28 @@ void BakedReflectionsData::evaluateEnergyField(const ProbeNeighborhood& neighbor
         if (neighborhood.batches[i]->hasData(mIdentifier) && &(*neighborhood.batches[i])[mIdentifier] != this)
             continue;
 
-        auto* probeEnergyField = lookupEnergyField(neighborhood.probeIndices[i]);
-        if (!probeEnergyField)
+        if (!mHasConvolution)
             continue;
 
-        EnergyField::scaleAccumulate(*probeEnergyField, neighborhood.weights[i], energyField);
+        auto index = neighborhood.probeIndices[i];
+        auto weight = neighborhood.weights[i];
+
+        if (mEnergyFields[index])
+        {
+            EnergyField::scaleAccumulate(*mEnergyFields[index], weight, energyField);
+        }
+        else if (mCompressedEnergyFields[index])
+        {
+            mCompressedEnergyFields[index]->scaleAccumulate(weight, energyField);
+        }
+        else if (mMappedEnergyFields[index])
+        {
+            EnergyField::scaleAccumulate(mMappedEnergyFields[index], weight, energyField);
+        }
+        else if (mMappedCompressedEnergyFields[index])
+        {
+            CompressedEnergyField::scaleAccumulate(mMappedCompressedEnergyFields[index], weight, energyField);
+        }
     }
 }
 
@@ -249,16 +360,45 @@ flatbuffers::Offset<Serialized::BakedReflectionsData> BakedReflectionsData::seri
     needsUpdateOffset = fbb.CreateVector(mNeedsUpdate.data(), mNeedsUpdate.size());
 
     flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Serialized::EnergyField>>> energyFieldsOffset = 0;
+    flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Serialized::CompressedEnergyField>>> compressedEnergyFieldsOffset = 0;
     if (mHasConvolution)
     {
         vector<flatbuffers::Offset<Serialized::EnergyField>> energyFieldOffsets(mEnergyFields.size());
+        vector<flatbuffers::Offset<Serialized::CompressedEnergyField>> compressedEnergyFieldOffsets(mCompressedEnergyFields.size());
+        auto hasCompressedEnergyFields = false;
 
         for (auto i = 0u; i < mEnergyFields.size(); ++i)
         {
-            energyFieldOffsets[i] = (!mNeedsUpdate[i] && mEnergyFields[i]) ? mEnergyFields[i]->serialize(serializedObject) : 0;
+            if (mNeedsUpdate[i])
+                continue;
+
+            if (mEnergyFields[i])
+            {
+                energyFieldOffsets[i] = mEnergyFields[i]->serialize(serializedObject);
+            }
+            else if (mMappedEnergyFields[i])
+            {
+                energyFieldOffsets[i] = EnergyField(mMappedEnergyFields[i]).serialize(serializedObject);
+            }
+
+            if (mCompressedEnergyFields[i])
+            {
+                compressedEnergyFieldOffsets[i] = mCompressedEnergyFields[i]->serialize(serializedObject);
+                hasCompressedEnergyFields = true;
+            }
+            else if (mMappedCompressedEnergyFields[i])
+            {
+                compressedEnergyFieldOffsets[i] = CompressedEnergyField(mMappedCompressedEnergyFields[i]).serialize(serializedObject);
+                hasCompressedEnergyFields = true;
+            }
         }
 
         energyFieldsOffset = fbb.CreateVector(energyFieldOffsets.data(), energyFieldOffsets.size());
+
+        if (hasCompressedEnergyFields)
+        {
+            compressedEnergyFieldsOffset = fbb.CreateVector(compressedEnergyFieldOffsets.data(), compressedEnergyFieldOffsets.size());
+        }
     }
 
     flatbuffers::Offset<flatbuffers::Vector<const Serialized::Reverb*>> reverbsOffset = 0;
@@ -267,7 +407,8 @@ flatbuffers::Offset<Serialized::BakedReflectionsData> BakedReflectionsData::seri
         reverbsOffset = fbb.CreateVectorOfStructs(reinterpret_cast<const Serialized::Reverb*>(mReverbs.data()), mReverbs.size());
     }
 
-    return Serialized::CreateBakedReflectionsData(fbb, energyFieldsOffset, reverbsOffset, needsUpdateOffset);
+    return Serialized::CreateBakedReflectionsData(fbb, energyFieldsOffset, reverbsOffset, needsUpdateOffset,
+                                                  compressedEnergyFieldsOffset);
 }
 
 int BakedReflectionsData::numProbes() const
@@ -279,7 +420,7 @@ void BakedReflectionsData::setHasConvolution(bool hasConvolution)
 {
     if (!mHasConvolution && hasConvolution)
     {
-        mEnergyFields.resize(mNeedsUpdate.size());
+        resizeEnergyFields(numProbes());
 
         for (auto i = 0u; i < mNeedsUpdate.size(); ++i)
         {
@@ -301,6 +442,25 @@ void BakedReflectionsData::setHasParametric(bool hasParametric)
     }
 }
 
+void BakedReflectionsData::setEnergyFieldCompression(EnergyFieldCompression compression)
+{
+    mEnergyFieldCompression = compression;
+
+    if (compression == EnergyFieldCompression::None)
+        return;
+
+    for (auto i = 0u; i < mEnergyFields.size(); ++i)
+    {
+        unmapEnergyField(i);
+
+        if (mEnergyFields[i])
+        {
+            mCompressedEnergyFields[i] = ipl::make_unique<CompressedEnergyField>(*mEnergyFields[i], compression);
+            mEnergyFields[i] = nullptr;
+        }
+    }
+}
+
 bool BakedReflectionsData::needsUpdate(int index) const
 {
     return (mNeedsUpdate[index] != 0);
@@ -309,7 +469,20 @@ bool BakedReflectionsData::needsUpdate(int index) const
 void BakedReflectionsData::set(int index,
                                unique_ptr<EnergyField> value)
 {
-    mEnergyFields[index] = std::move(value);
+    if (value && mEnergyFieldCompression != EnergyFieldCompression::None)
+    {
+        mCompressedEnergyFields[index] = ipl::make_unique<CompressedEnergyField>(*value, mEnergyFieldCompression);
+        mEnergyFields[index] = nullptr;
+    }
+    else
+    {
+        mEnergyFields[index] = std::move(value);
+        mCompressedEnergyFields[index] = nullptr;
+    }
+
+    mMappedEnergyFields[index] = nullptr;
+    mMappedCompressedEnergyFields[index] = nullptr;
+
     mNeedsUpdate[index] = false;
 }
 
@@ -322,7 +495,20 @@ void BakedReflectionsData::set(int index,
 
 EnergyField* BakedReflectionsData::lookupEnergyField(int index)
 {
-    return (mHasConvolution) ? mEnergyFields[index].get() : nullptr;
+    if (!mHasConvolution)
+        return nullptr;
+
+    unmapEnergyField(index);
+    return mEnergyFields[index].get();
+}
+
+CompressedEnergyField* BakedReflectionsData::lookupCompressedEnergyField(int index)
+{
+    if (!mHasConvolution)
+        return nullptr;
+
+    unmapEnergyField(index);
+    return mCompressedEnergyFields[index].get();
 }
 
 Reverb* BakedReflectionsData::lookupReverb(int index)
@@ -330,4 +516,27 @@ Reverb* BakedReflectionsData::lookupReverb(int index)
     return (mHasParametric) ? &mReverbs[index] : nullptr;
 }
 
+void BakedReflectionsData::resizeEnergyFields(int numProbes)
+{
+    mEnergyFields.resize(numProbes);
+    mCompressedEnergyFields.resize(numProbes);
+    mMappedEnergyFields.resize(numProbes);
+    mMappedCompressedEnergyFields.resize(numProbes);
+}
+
+void BakedReflectionsData::unmapEnergyField(int index)
+{
+    if (mMappedEnergyFields[index])
+    {
+        mEnergyFields[index] = ipl::make_unique<EnergyField>(mMappedEnergyFields[index]);
+        mMappedEnergyFields[index] = nullptr;
+    }
+
+    if (mMappedCompressedEnergyFields[index])
+    {
+        mCompressedEnergyFields[index] = ipl::make_unique<CompressedEnergyField>(mMappedCompressedEnergyFields[index]);
+        mMappedCompressedEnergyFields[index] = nullptr;
+    }
+}
+
 }
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include "compressed_energy_field.h"
 #include "energy_field.h"
 #include "probe_batch.h"
 #include "probe_data.h"
@@ -53,7 +54,13 @@ public:
 
     BakedReflectionsData(const BakedDataIdentifier& identifier,
                          int numProbes,
-                         const Serialized::BakedReflectionsData* serializedObject);
+                         const Serialized::BakedReflectionsData* serializedObject,
+                         shared_ptr<const MappedFile> mappedFile = nullptr);
+
+    // Creates baked data containing copies of the data for the given subset of probes in another set of baked data.
+    // Energy fields that the other data reads from a memory-mapped file are copied into memory.
+    BakedReflectionsData(const BakedReflectionsData& other,
+                         const vector<int>& probeIndices);
 
     virtual void updateProbePosition(int index,
                                      const Vector3f& position) override;
@@ -80,6 +87,10 @@ public:
 
     void setHasParametric(bool hasParametric);
 
+    // Energy fields set after calling this are stored using the given compression. Energy fields that have already
+    // been set are compressed if they are currently uncompressed.
+    void setEnergyFieldCompression(EnergyFieldCompression compression);
+
     bool needsUpdate(int index) const;
 
     void set(int index,
@@ -90,6 +101,8 @@ public:
 
     EnergyField* lookupEnergyField(int index);
 
+    CompressedEnergyField* lookupCompressedEnergyField(int index);
+
     Reverb* lookupReverb(int index);
 
     vector<unique_ptr<EnergyField>>& getEnergyFields() { return mEnergyFields; }
@@ -99,9 +112,24 @@ private:
     BakedDataIdentifier mIdentifier;
     bool mHasConvolution;
     bool mHasParametric;
+    EnergyFieldCompression mEnergyFieldCompression;
     vector<unique_ptr<EnergyField>> mEnergyFields;
+    vector<unique_ptr<CompressedEnergyField>> mCompressedEnergyFields; // Each probe has at most one of these, or an
+                                                                       // energy field.
     vector<Reverb> mReverbs;
     vector<uint8_t> mNeedsUpdate;
+
+    // When loaded from a memory-mapped file, energy fields are read directly from the mapping until they are either
+    // replaced, or looked up for modification (at which point they are copied into mEnergyFields or
+    // mCompressedEnergyFields).
+    shared_ptr<const MappedFile> mMappedFile;
+    vector<const Serialized::EnergyField*> mMappedEnergyFields;
+    vector<const Serialized::CompressedEnergyField*> mMappedCompressedEnergyFields;
+
+    void resizeEnergyFields(int numProbes);
+
+    // Copies the energy field for the given probe out of the mapped file, if it has not already been copied.
+    void unmapEnergyField(int index);
 };
 
 }
@@ -17,6 +17,7 @@
 #include "bvh.h"
 
 #include "stack.h"
+#include "job_scheduler.h"
 
 namespace ipl {
 
@@ -38,30 +39,357 @@ struct ConstructionTask
 // TraversalTask
 // --------------------------------------------------------------------------------------------------------------------
 
-// Represents a unit of work during BVH traversal.
+// Represents a unit of work during BVH traversal: a node to visit, and the distance at which the ray enters it.
 struct TraversalTask
 {
     int32_t nodeIndex;
     float tMin;
-    float tMax;
 };
 
 
+// --------------------------------------------------------------------------------------------------------------------
+// RayPacket
+// --------------------------------------------------------------------------------------------------------------------
+
+// A packet of up to BVH::kPacketSize rays, stored in SoA form so that a single node or triangle can be tested against
+// all rays in the packet using SIMD instructions. Unused lanes are given an empty extent, so they never hit anything.
+struct RayPacket
+{
+    float4_t origin[3];
+    float4_t direction[3];
+    float4_t reciprocalDirection[3];
+    float4_t minDistance;
+    float4_t maxDistance;
+    int directionSigns[BVH::kPacketSize][3];
+    int validMask;
+
+    RayPacket(int numRays,
+              const Ray* rays,
+              const float* minDistances,
+              const float* maxDistances)
+    {
+        assert(0 < numRays && numRays <= BVH::kPacketSize);
+
+        alignas(Memory::kDefaultAlignment) float values[9][BVH::kPacketSize];
+        alignas(Memory::kDefaultAlignment) float tMin[BVH::kPacketSize];
+        alignas(Memory::kDefaultAlignment) float tMax[BVH::kPacketSize];
+
+        validMask = 0;
+
+        for (auto i = 0; i < BVH::kPacketSize; ++i)
+        {
+            const auto& ray = rays[std::min(i, numRays - 1)];
+
+            for (auto j = 0; j < 3; ++j)
+            {
+                values[j][i] = ray.origin.elements[j];
+                values[3 + j][i] = ray.direction.elements[j];
+                values[6 + j][i] = (ray.direction.elements[j] == -0.0f) ? std::numeric_limits<float>::infinity() : 1.0f / ray.direction.elements[j];
+                directionSigns[i][j] = (ray.direction.elements[j] >= 0) ? 1 : 0;
+            }
+
+            if (i < numRays)
+            {
+                tMin[i] = minDistances[i];
+                tMax[i] = maxDistances[i];
+                validMask |= (1 << i);
+            }
+            else
+            {
+                tMin[i] = 1.0f;
+                tMax[i] = 0.0f;
+            }
+        }
+
+        for (auto j = 0; j < 3; ++j)
+        {
+            origin[j] = float4::load(values[j]);
+            direction[j] = float4::load(values[3 + j]);
+            reciprocalDirection[j] = float4::load(values[6 + j]);
+        }
+
+        minDistance = float4::load(tMin);
+        maxDistance = float4::load(tMax);
+    }
+
+    // Returns a bitmask indicating which rays pass through the given box within the extent [minDistance, tMax], and
+    // the distance at which each ray enters the box. Both slab distances are computed for every axis, so rays in the
+    // packet are not required to have the same direction signs. NaNs (which occur when a ray lies in a slab plane)
+    // leave the running extent unchanged.
+    int intersect(const float* minCoordinates,
+                  const float* maxCoordinates,
+                  float4_t tMax,
+                  float4_t& tNear) const
+    {
+        tNear = minDistance;
+        auto tFar = tMax;
+
+        for (auto i = 0; i < 3; ++i)
+        {
+            auto t1 = float4::mul(float4::sub(float4::set1(minCoordinates[i]), origin[i]), reciprocalDirection[i]);
+            auto t2 = float4::mul(float4::sub(float4::set1(maxCoordinates[i]), origin[i]), reciprocalDirection[i]);
+            tNear = float4::max(float4::min(t1, t2), tNear);
+            tFar = float4::min(float4::max(t1, t2), tFar);
+        }
+
+        return float4::movemask(float4::cmple(tNear, tFar));
+    }
+
+    // Returns the distance along each ray at which it intersects the given triangle, or infinity for rays that miss
+    // the triangle. This is the Moller-Trumbore test used by Ray::intersect, applied to all rays at once.
+    float4_t intersect(const Mesh& mesh,
+                       int32_t triangleIndex) const
+    {
+        const auto& v0 = mesh.triangleVertex(triangleIndex, 0);
+        const auto& v1 = mesh.triangleVertex(triangleIndex, 1);
+        const auto& v2 = mesh.triangleVertex(triangleIndex, 2);
+
+        auto e1 = v1 - v0;
+        auto e2 = v2 - v0;
+
+        float4_t edge1[3] = { float4::set1(e1.elements[0]), float4::set1(e1.elements[1]), float4::set1(e1.elements[2]) };
+        float4_t edge2[3] = { float4::set1(e2.elements[0]), float4::set1(e2.elements[1]), float4::set1(e2.elements[2]) };
+
+        float4_t p[3];
+        cross(direction, edge2, p);
+
+        auto determinant = dot(edge1, p);
+        auto reciprocalDeterminant = float4::div(float4::set1(1.0f), determinant);
+
+        float4_t s[3] = {
+            float4::sub(origin[0], float4::set1(v0.x())),
+            float4::sub(origin[1], float4::set1(v0.y())),
+            float4::sub(origin[2], float4::set1(v0.z()))
+        };
+
+        auto u = float4::mul(dot(s, p), reciprocalDeterminant);
+
+        float4_t q[3];
+        cross(s, edge1, q);
+
+        auto v = float4::mul(dot(direction, q), reciprocalDeterminant);
+        auto t = float4::mul(dot(edge2, q), reciprocalDeterminant);
+
+        auto zero = float4::zero();
+        auto one = float4::set1(1.0f);
+
+        auto valid = float4::cmpneq(determinant, zero);
+        valid = float4::andbits(valid, float4::cmpge(u, zero));
+        valid = float4::andbits(valid, float4::cmple(u, one));
+        valid = float4::andbits(valid, float4::cmpge(v, zero));
+        valid = float4::andbits(valid, float4::cmple(v, float4::sub(one, u)));
+
+        auto infinity = float4::set1(std::numeric_limits<float>::infinity());
+        return float4::orbits(float4::andbits(valid, t), float4::andnotbits(valid, infinity));
+    }
+
+    static float4_t dot(const float4_t* a,
+                        const float4_t* b)
+    {
+        return float4::add(float4::mul(a[0], b[0]), float4::add(float4::mul(a[1], b[1]), float4::mul(a[2], b[2])));
+    }
+
+    static void cross(const float4_t* a,
+                      const float4_t* b,
+                      float4_t* c)
+    {
+        c[0] = float4::sub(float4::mul(a[1], b[2]), float4::mul(a[2], b[1]));
+        c[1] = float4::sub(float4::mul(a[2], b[0]), float4::mul(a[0], b[2]));
+        c[2] = float4::sub(float4::mul(a[0], b[1]), float4::mul(a[1], b[0]));
+    }
+
+    // Converts a bitmask of lanes into a SIMD mask with all bits set in the selected lanes.
+    static float4_t laneMask(int mask)
+    {
+        auto lanes = float4::set((mask & 1) ? 1.0f : 0.0f, (mask & 2) ? 1.0f : 0.0f, (mask & 4) ? 1.0f : 0.0f, (mask & 8) ? 1.0f : 0.0f);
+        return float4::cmpneq(lanes, float4::zero());
+    }
+};
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// WideBVHNode
+// --------------------------------------------------------------------------------------------------------------------
+
+const int WideBVHNode::kWidth;
+const int32_t WideBVHNode::kEmptyChild;
+
+Box WideBVHNode::childBoundingBox(int childIndex) const
+{
+    Box box;
+
+    for (auto i = 0; i < 3; ++i)
+    {
+        box.minCoordinates.elements[i] = mOrigin[i] + mQuantizedMin[i][childIndex] * mScale[i];
+        box.maxCoordinates.elements[i] = mOrigin[i] + mQuantizedMax[i][childIndex] * mScale[i];
+    }
+
+    return box;
+}
+
+void WideBVHNode::setBoundingBox(const Box& box)
+{
+    for (auto i = 0; i < 3; ++i)
+    {
+        // The scale is padded, so that the largest quantized value decodes
+        // to a coordinate no smaller than the maximum coordinate of the box,
+        // in spite of rounding errors.
+        auto extent = box.maxCoordinates.elements[i] - box.minCoordinates.elements[i];
+        auto padding = 1e-5f;
+        mOrigin[i] = box.minCoordinates.elements[i];
+        do
+        {
+            mScale[i] = (extent / 255.0f) * (1.0f + padding) + std::numeric_limits<float>::min();
+            padding *= 2.0f;
+        }
+        while (mOrigin[i] + 255.0f * mScale[i] < box.maxCoordinates.elements[i]);
+
+        for (auto j = 0; j < kWidth; ++j)
+        {
+            mQuantizedMin[i][j] = 255;
+            mQuantizedMax[i][j] = 0;
+        }
+    }
+
+    for (auto j = 0; j < kWidth; ++j)
+    {
+        mChildren[j] = kEmptyChild;
+    }
+}
+
+void WideBVHNode::setChild(int childIndex,
+                           int32_t child,
+                           const Box& box)
+{
+    mChildren[childIndex] = child;
+
+    for (auto i = 0; i < 3; ++i)
+    {
+        auto qMin = static_cast<int>(floorf((box.minCoordinates.elements[i] - mOrigin[i]) / mScale[i]));
+        auto qMax = static_cast<int>(ceilf((box.maxCoordinates.elements[i] - mOrigin[i]) / mScale[i]));
+
+        qMin = std::max(0, std::min(qMin, 255));
+        qMax = std::max(0, std::min(qMax, 255));
+
+        // Guard against rounding errors in the division, so the decoded
+        // box always contains the original box.
+        while (qMin > 0 && mOrigin[i] + qMin * mScale[i] > box.minCoordinates.elements[i])
+            --qMin;
+        while (qMax < 255 && mOrigin[i] + qMax * mScale[i] < box.maxCoordinates.elements[i])
+            ++qMax;
+
+        mQuantizedMin[i][childIndex] = static_cast<uint8_t>(qMin);
+        mQuantizedMax[i][childIndex] = static_cast<uint8_t>(qMax);
+    }
+}
+
+
 // --------------------------------------------------------------------------------------------------------------------
 // BVH
 // --------------------------------------------------------------------------------------------------------------------
 
+const int BVH::kPacketSize;
+
 BVH::BVH(const Mesh& mesh,
          ProgressCallback progressCallback,
-         void* userData)
+         void* userData,
+         JobScheduler* scheduler)
     : mNodes(2 * mesh.numTriangles() - 1)
 {
-    build(mesh, progressCallback, userData);
+    build(mesh, progressCallback, userData, scheduler);
+    collapse();
+
+    mBuildCost = traversalCost();
+}
+
+float BVH::refit(const Mesh& mesh)
+{
+    // Children are always stored after their parents, so visiting nodes in
+    // reverse order refits all children before their parent. The node data
+    // shares storage with the bounding box, so it is saved and restored.
+    for (auto i = numNodes() - 1; i >= 0; --i)
+    {
+        auto& node = mNodes[i];
+        auto offset = node.getTriangleIndex();
+        auto axis = node.getSplitAxis();
+
+        GrowableBox box;
+        if (node.isLeaf())
+        {
+            box.growToContain(mesh, offset);
+        }
+        else
+        {
+            GrowableBox childBox;
+            childBox.load(mNodes[i + offset].boundingBox());
+            box.growToContain(childBox);
+            childBox.load(mNodes[i + offset + 1].boundingBox());
+            box.growToContain(childBox);
+        }
+
+        box.store(node.boundingBox());
+        node.setInternalNodeData(offset, axis);
+    }
+
+    // The same holds for the wide nodes. Child boxes are re-quantized from
+    // exact boxes, so quantization errors do not accumulate up the tree.
+    Array<Box> wideNodeBoxes(numWideNodes());
+    for (auto i = numWideNodes() - 1; i >= 0; --i)
+    {
+        auto& wideNode = mWideNodes[i];
+
+        int32_t children[WideBVHNode::kWidth];
+        Box childBoxes[WideBVHNode::kWidth];
+        auto numChildren = 0;
+
+        GrowableBox box;
+        for (; numChildren < WideBVHNode::kWidth && !wideNode.isEmpty(numChildren); ++numChildren)
+        {
+            auto& childBox = childBoxes[numChildren];
+            if (wideNode.isLeaf(numChildren))
+            {
+                children[numChildren] = ~wideNode.triangleIndex(numChildren);
+
+                GrowableBox triangleBox;
+                triangleBox.growToContain(mesh, wideNode.triangleIndex(numChildren));
+                triangleBox.store(childBox);
+            }
+            else
+            {
+                children[numChildren] = wideNode.childNodeIndex(numChildren);
+                childBox = wideNodeBoxes[children[numChildren]];
+            }
+
+            GrowableBox growableChildBox;
+            growableChildBox.load(childBox);
+            box.growToContain(growableChildBox);
+        }
+
+        box.store(wideNodeBoxes[i]);
+
+        wideNode.setBoundingBox(wideNodeBoxes[i]);
+        for (auto j = 0; j < numChildren; ++j)
+        {
+            wideNode.setChild(j, children[j], childBoxes[j]);
+        }
+    }
+
+    return (mBuildCost > 0.0f) ? traversalCost() / mBuildCost : 1.0f;
+}
+
+void BVH::rebuild(const Mesh& mesh,
+                  JobScheduler* scheduler)
+{
+    build(mesh, nullptr, nullptr, scheduler);
+    collapse();
+
+    mBuildCost = traversalCost();
 }
 
 void BVH::build(const Mesh& mesh,
                 ProgressCallback progressCallback,
-                void* userData)
+                void* userData,
+                JobScheduler* scheduler)
 {
     // The leafIndices array stores the indices of the mesh's triangles, in
     // left-to-right order as they appear in the final constructed BVH. When
@@ -100,68 +428,158 @@ void BVH::build(const Mesh& mesh,
     // areas of internal nodes.
     Array<float> surfaceAreas(mesh.numTriangles());
 
-    // We begin by building the root node at index 0. It contains all the triangles in
-    // the entire leafIndices array.
+    // The root node is at index 0. It contains all the triangles in the
+    // entire leafIndices array.
+    auto rootTask = ConstructionTask{ 0, 0, static_cast<int32_t>(leafNodes.size(0)) - 1, 1 };
+
+    auto numThreads = (scheduler) ? scheduler->numThreads() : 1;
+
+    if (numThreads <= 1 || mesh.numTriangles() < kMinParallelBuildSize)
+    {
+        buildSubtree(rootTask, leafNodes.data(), leafBoxCenters.data(), leafIndices.data(), centroids.data(), surfaceAreas.data());
+    }
+    else
+    {
+        // Build the top levels of the BVH serially, always splitting the
+        // largest remaining subtree, until there are enough subtrees to keep
+        // all threads busy.
+        vector<ConstructionTask> subtrees;
+        subtrees.push_back(rootTask);
+
+        while (static_cast<int>(subtrees.size()) < kSubtreesPerThread * numThreads)
+        {
+            auto largest = std::max_element(subtrees.begin(), subtrees.end(), [](const ConstructionTask& a, const ConstructionTask& b)
+            {
+                return (a.endIndex - a.startIndex) < (b.endIndex - b.startIndex);
+            });
+
+            if (largest->endIndex - largest->startIndex + 1 < kMinParallelSubtreeSize)
+                break;
+
+            ConstructionTask leftChildTask;
+            ConstructionTask rightChildTask;
+            buildNode(*largest, leafNodes.data(), leafBoxCenters.data(), leafIndices.data(), centroids.data(), surfaceAreas.data(), leftChildTask, rightChildTask);
+
+            *largest = leftChildTask;
+            subtrees.push_back(rightChildTask);
+        }
+
+        // Build the remaining subtrees in parallel.
+        JobGraph jobGraph;
+        for (const auto& subtree : subtrees)
+        {
+            jobGraph.addJob([this, subtree, &leafNodes, &leafBoxCenters, &leafIndices, &centroids, &surfaceAreas](int threadId, std::atomic<bool>& cancel)
+            {
+                buildSubtree(subtree, leafNodes.data(), leafBoxCenters.data(), leafIndices.data(), centroids.data(), surfaceAreas.data());
+            });
+        }
+
+        scheduler->submit(jobGraph);
+        scheduler->wait(jobGraph);
+    }
+
+    if (progressCallback)
+    {
+        progressCallback(1.0f, userData);
+    }
+}
+
+void BVH::buildSubtree(const ConstructionTask& rootTask,
+                       GrowableBox* leafNodes,
+                       const Vector3f* leafBoxCenters,
+                       int32_t* leafIndices,
+                       CentroidCoordinate* const* centroids,
+                       float* surfaceAreas)
+{
     Stack<ConstructionTask, kConstructionStackDepth> stack;
-    ConstructionTask task = ConstructionTask{ 0, 0, static_cast<int32_t>(leafNodes.size(0)) - 1, 1 };
+    auto task = rootTask;
 
     // At each step of construction, we're processing a node containing
     // all the triangles in leafIndices[startIndex] to leafIndices[endIndex],
     // inclusive.
     while (true)
     {
-        auto oneLeafLeft = (task.startIndex == task.endIndex);
+        ConstructionTask leftChildTask;
+        ConstructionTask rightChildTask;
 
-        if (oneLeafLeft)
+        if (buildNode(task, leafNodes, leafBoxCenters, leafIndices, centroids, surfaceAreas, leftChildTask, rightChildTask))
+        {
+            // Push the right child onto the stack. Set the current task to the
+            // left child, and continue.
+            stack.push(rightChildTask);
+            task = leftChildTask;
+        }
+        else
         {
-            leafNodes[leafIndices[task.startIndex]].store(mNodes[task.outputNodeIndex].boundingBox());
-            mNodes[task.outputNodeIndex].setTriangleIndex(leafIndices[task.startIndex]);
-
             if (stack.isEmpty())
                 break;
 
             task = stack.pop();
         }
-        else
-        {
-            // For internal nodes, we first construct a bounding box that
-            // encloses all its triangles.
-            GrowableBox boundingBox;
-            for (auto i = task.startIndex; i <= task.endIndex; ++i)
-            {
-                boundingBox.growToContain(leafNodes[leafIndices[i]]);
-            }
+    }
+}
 
-            boundingBox.store(mNodes[task.outputNodeIndex].boundingBox());
+bool BVH::buildNode(const ConstructionTask& task,
+                    GrowableBox* leafNodes,
+                    const Vector3f* leafBoxCenters,
+                    int32_t* leafIndices,
+                    CentroidCoordinate* const* centroids,
+                    float* surfaceAreas,
+                    ConstructionTask& leftChildTask,
+                    ConstructionTask& rightChildTask)
+{
+    auto oneLeafLeft = (task.startIndex == task.endIndex);
 
-            // For each axis, centroids[axis][i] contains the coordinate of
-            // the centroid of leaf node leafIndices[i].
-            for (auto i = task.startIndex; i <= task.endIndex; ++i)
-            {
-                centroids[0][i].coordinate = leafBoxCenters[leafIndices[i]].x();
-                centroids[1][i].coordinate = leafBoxCenters[leafIndices[i]].y();
-                centroids[2][i].coordinate = leafBoxCenters[leafIndices[i]].z();
-                centroids[0][i].leafIndex = leafIndices[i];
-                centroids[1][i].leafIndex = leafIndices[i];
-                centroids[2][i].leafIndex = leafIndices[i];
-            }
+    if (oneLeafLeft)
+    {
+        leafNodes[leafIndices[task.startIndex]].store(mNodes[task.outputNodeIndex].boundingBox());
+        mNodes[task.outputNodeIndex].setTriangleIndex(leafIndices[task.startIndex]);
+        return false;
+    }
 
-            // Split the node into left and right children.
-            auto split = bestSplit(leafNodes.data(), leafIndices.data(), centroids.data(), surfaceAreas.data(), mNodes[task.outputNodeIndex].boundingBox(), task.startIndex, task.endIndex);
-            mNodes[task.outputNodeIndex].setInternalNodeData(task.leftChildIndex - task.outputNodeIndex, split.axis);
+    // For internal nodes, we first construct a bounding box that
+    // encloses all its triangles.
+    GrowableBox boundingBox;
+    for (auto i = task.startIndex; i <= task.endIndex; ++i)
+    {
+        boundingBox.growToContain(leafNodes[leafIndices[i]]);
+    }
 
-            // Push the right child onto the stack. Set the current task to the
-            // left child, and continue.
-            stack.push(ConstructionTask{ task.leftChildIndex + 1, task.startIndex + split.index, task.endIndex, task.leftChildIndex + 2 * split.index });
-            task = ConstructionTask{ task.leftChildIndex, task.startIndex, task.startIndex + split.index - 1, task.leftChildIndex + 2 };
-            continue;
-        }
+    boundingBox.store(mNodes[task.outputNodeIndex].boundingBox());
+
+    // Large nodes are split using binned SAH. If that fails, or if the node
+    // is small, we fall back to the full SAH split (and, failing that, the
+    // median split).
+    auto split = Split{ -1, -1 };
+    if (task.endIndex - task.startIndex + 1 >= kMinBinnedSplitSize)
+    {
+        split = binnedSahSplit(leafNodes, leafBoxCenters, leafIndices, mNodes[task.outputNodeIndex].boundingBox(), task.startIndex, task.endIndex);
     }
 
-    if (progressCallback)
+    if (split.axis == -1)
     {
-        progressCallback(1.0f, userData);
+        // For each axis, centroids[axis][i] contains the coordinate of
+        // the centroid of leaf node leafIndices[i].
+        for (auto i = task.startIndex; i <= task.endIndex; ++i)
+        {
+            centroids[0][i].coordinate = leafBoxCenters[leafIndices[i]].x();
+            centroids[1][i].coordinate = leafBoxCenters[leafIndices[i]].y();
+            centroids[2][i].coordinate = leafBoxCenters[leafIndices[i]].z();
+            centroids[0][i].leafIndex = leafIndices[i];
+            centroids[1][i].leafIndex = leafIndices[i];
+            centroids[2][i].leafIndex = leafIndices[i];
+        }
+
+        split = bestSplit(leafNodes, leafIndices, centroids, surfaceAreas, mNodes[task.outputNodeIndex].boundingBox(), task.startIndex, task.endIndex);
     }
+
+    mNodes[task.outputNodeIndex].setInternalNodeData(task.leftChildIndex - task.outputNodeIndex, split.axis);
+
+    // The left child's subtree is stored immediately after both children,
+    // followed by the right child's subtree.
+    leftChildTask = ConstructionTask{ task.leftChildIndex, task.startIndex, task.startIndex + split.index - 1, task.leftChildIndex + 2 };
+    rightChildTask = ConstructionTask{ task.leftChildIndex + 1, task.startIndex + split.index, task.endIndex, task.leftChildIndex + 2 * split.index };
+    return true;
 }
 
 Split BVH::bestSplit(GrowableBox* leafNodes,
@@ -276,6 +694,101 @@ Split BVH::sahSplit(GrowableBox* leafNodes,
     return split;
 }
 
+Split BVH::binnedSahSplit(GrowableBox* leafNodes,
+                          const Vector3f* leafBoxCenters,
+                          int32_t* leafIndices,
+                          const Box& boundingBox,
+                          int32_t startIndex,
+                          int32_t endIndex)
+{
+    alignas(Memory::kDefaultAlignment) GrowableBox parentBox;
+    parentBox.load(boundingBox);
+    auto parentSurfaceArea = parentBox.getSurfaceArea();
+
+    // Bins are distributed uniformly over the bounding box of the centroids,
+    // rather than the bounding box of the node.
+    Box centroidBox;
+    for (auto i = startIndex; i <= endIndex; ++i)
+    {
+        centroidBox.minCoordinates = Vector3f::min(centroidBox.minCoordinates, leafBoxCenters[leafIndices[i]]);
+        centroidBox.maxCoordinates = Vector3f::max(centroidBox.maxCoordinates, leafBoxCenters[leafIndices[i]]);
+    }
+
+    auto bestCost = std::numeric_limits<float>::max();
+    auto bestAxis = -1;
+    auto bestBin = -1;
+    float binScales[3];
+
+    for (auto axis = 0; axis < 3; ++axis)
+    {
+        auto extent = centroidBox.maxCoordinates[axis] - centroidBox.minCoordinates[axis];
+        binScales[axis] = (extent > 0.0f) ? (kNumBins * (1.0f - 1e-5f)) / extent : 0.0f;
+        if (binScales[axis] <= 0.0f)
+            continue;
+
+        // Place each leaf into a bin based on its centroid.
+        GrowableBox binBoxes[kNumBins];
+        int32_t binCounts[kNumBins] = {};
+
+        for (auto i = startIndex; i <= endIndex; ++i)
+        {
+            auto bin = static_cast<int>((leafBoxCenters[leafIndices[i]][axis] - centroidBox.minCoordinates[axis]) * binScales[axis]);
+            bin = std::min(std::max(bin, 0), kNumBins - 1);
+            binBoxes[bin].growToContain(leafNodes[leafIndices[i]]);
+            ++binCounts[bin];
+        }
+
+        // Consider all splits between bins, and evaluate the surface area of
+        // the left child for each case.
+        float leftSurfaceAreas[kNumBins - 1];
+        int32_t leftCounts[kNumBins - 1];
+
+        GrowableBox leftChildBox;
+        auto numLeftChildren = 0;
+        for (auto bin = 0; bin < kNumBins - 1; ++bin)
+        {
+            leftChildBox.growToContain(binBoxes[bin]);
+            numLeftChildren += binCounts[bin];
+            leftSurfaceAreas[bin] = (numLeftChildren > 0) ? leftChildBox.getSurfaceArea() : 0.0f;
+            leftCounts[bin] = numLeftChildren;
+        }
+
+        // Evaluate the surface area of the right child for each split, along
+        // with the SAH cost function.
+        GrowableBox rightChildBox;
+        auto numRightChildren = 0;
+        for (auto bin = kNumBins - 1; bin > 0; --bin)
+        {
+            rightChildBox.growToContain(binBoxes[bin]);
+            numRightChildren += binCounts[bin];
+
+            if (leftCounts[bin - 1] == 0 || numRightChildren == 0)
+                continue;
+
+            auto cost = sahCost(leftSurfaceAreas[bin - 1], leftCounts[bin - 1], rightChildBox.getSurfaceArea(), numRightChildren, parentSurfaceArea);
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = bin;
+            }
+        }
+    }
+
+    if (bestAxis < 0)
+        return Split{ -1, -1 };
+
+    // Partition the leafIndices of this node's subarray, so that all leaves
+    // in bins before the split come first.
+    auto middle = std::partition(&leafIndices[startIndex], &leafIndices[endIndex + 1], [&](int32_t leafIndex)
+    {
+        auto bin = static_cast<int>((leafBoxCenters[leafIndex][bestAxis] - centroidBox.minCoordinates[bestAxis]) * binScales[bestAxis]);
+        return (std::min(std::max(bin, 0), kNumBins - 1) < bestBin);
+    });
+
+    return Split{ static_cast<int32_t>(middle - &leafIndices[startIndex]), bestAxis };
+}
+
 float BVH::sahCost(float leftChildSurfaceArea,
                    int32_t numLeftChildren,
                    float rightChildSurfaceArea,
@@ -285,71 +798,230 @@ float BVH::sahCost(float leftChildSurfaceArea,
     return (leftChildSurfaceArea * numLeftChildren + rightChildSurfaceArea * numRightChildren) / parentSurfaceArea;
 }
 
+void BVH::collapse()
+{
+    auto surfaceArea = [](const Box& box)
+    {
+        auto extents = box.maxCoordinates - box.minCoordinates;
+        return 2.0f * (extents.elements[0] * extents.elements[1] + extents.elements[1] * extents.elements[2] + extents.elements[2] * extents.elements[0]);
+    };
+
+    // Each task collapses the subtree rooted at a binary node into the wide
+    // node with the given index.
+    struct CollapseTask
+    {
+        int32_t nodeIndex;
+        int32_t wideNodeIndex;
+    };
+
+    vector<WideBVHNode> wideNodes(1);
+    Stack<CollapseTask, kConstructionStackDepth * WideBVHNode::kWidth> stack;
+    stack.push(CollapseTask{ 0, 0 });
+
+    while (!stack.isEmpty())
+    {
+        auto task = stack.pop();
+
+        // Start with the two children of the binary node (or the node itself,
+        // if the BVH consists of a single leaf), and repeatedly open up the
+        // internal child with the largest surface area.
+        int32_t children[WideBVHNode::kWidth];
+        auto numChildren = 0;
+
+        const auto& node = mNodes[task.nodeIndex];
+        if (node.isLeaf())
+        {
+            children[numChildren++] = task.nodeIndex;
+        }
+        else
+        {
+            children[numChildren++] = task.nodeIndex + node.getTriangleIndex();
+            children[numChildren++] = task.nodeIndex + node.getTriangleIndex() + 1;
+        }
+
+        while (numChildren < WideBVHNode::kWidth)
+        {
+            auto largestChild = -1;
+            auto largestSurfaceArea = -1.0f;
+            for (auto i = 0; i < numChildren; ++i)
+            {
+                const auto& child = mNodes[children[i]];
+                if (!child.isLeaf() && surfaceArea(child.boundingBox()) > largestSurfaceArea)
+                {
+                    largestChild = i;
+                    largestSurfaceArea = surfaceArea(child.boundingBox());
+                }
+            }
+
+            if (largestChild < 0)
+                break;
+
+            auto childIndex = children[largestChild];
+            auto childOffset = mNodes[childIndex].getTriangleIndex();
+            children[largestChild] = childIndex + childOffset;
+            children[numChildren++] = childIndex + childOffset + 1;
+        }
+
+        wideNodes[task.wideNodeIndex].setBoundingBox(node.boundingBox());
+
+        for (auto i = 0; i < numChildren; ++i)
+        {
+            const auto& child = mNodes[children[i]];
+            if (child.isLeaf())
+            {
+                wideNodes[task.wideNodeIndex].setChild(i, ~child.getTriangleIndex(), child.boundingBox());
+            }
+            else
+            {
+                auto wideNodeIndex = static_cast<int32_t>(wideNodes.size());
+                wideNodes.emplace_back();
+                wideNodes[task.wideNodeIndex].setChild(i, wideNodeIndex, child.boundingBox());
+                stack.push(CollapseTask{ children[i], wideNodeIndex });
+            }
+        }
+    }
+
+    mWideNodes.resize(wideNodes.size());
+    std::copy(wideNodes.begin(), wideNodes.end(), mWideNodes.data());
+}
+
+float BVH::traversalCost() const
+{
+    auto rootSurfaceArea = mNodes[0].boundingBox().surfaceArea();
+    if (rootSurfaceArea <= 0.0f)
+        return 0.0f;
+
+    auto totalSurfaceArea = 0.0f;
+    for (auto i = 0; i < numNodes(); ++i)
+    {
+        totalSurfaceArea += mNodes[i].boundingBox().surfaceArea();
+    }
+
+    return totalSurfaceArea / rootSurfaceArea;
+}
+
+// Tests a ray against the bounding boxes of all children of a wide BVH node. Returns a bitmask indicating which
+// children are intersected within [tMin, tMax], along with the distance at which the ray enters each child box.
+// NaNs (which occur when a ray lies in a slab plane) leave the running extent unchanged.
+static inline int intersectChildren(const WideBVHNode& node,
+                                    const float4_t* origin,
+                                    const float4_t* reciprocalDirection,
+                                    const int* directionSigns,
+                                    float4_t tMin,
+                                    float4_t tMax,
+                                    float* entryDistances)
+{
+    auto tNear = tMin;
+    auto tFar = tMax;
+
+    for (auto i = 0; i < 3; ++i)
+    {
+        auto minCoordinates = node.minCoordinates(i);
+        auto maxCoordinates = node.maxCoordinates(i);
+        auto nearCoordinates = (directionSigns[i]) ? minCoordinates : maxCoordinates;
+        auto farCoordinates = (directionSigns[i]) ? maxCoordinates : minCoordinates;
+
+        tNear = float4::max(float4::mul(float4::sub(nearCoordinates, origin[i]), reciprocalDirection[i]), tNear);
+        tFar = float4::min(float4::mul(float4::sub(farCoordinates, origin[i]), reciprocalDirection[i]), tFar);
+    }
+
+    float4::storeu(entryDistances, tNear);
+    return float4::movemask(float4::cmple(tNear, tFar));
+}
+
+// Inserts a traversal task into a small array sorted by decreasing entry distance, so that pushing the array onto
+// the traversal stack in order results in the nearest node being visited first.
+static inline void insertSorted(TraversalTask* tasks,
+                                int& numTasks,
+                                const TraversalTask& task)
+{
+    auto i = numTasks++;
+    for (; i > 0 && tasks[i - 1].tMin < task.tMin; --i)
+    {
+        tasks[i] = tasks[i - 1];
+    }
+
+    tasks[i] = task;
+}
+
 Hit BVH::intersect(const Ray& ray,
                    const Mesh& mesh,
                    float minDistance,
                    float maxDistance) const
 {
     Hit hit;
+    hit.distance = maxDistance;
 
-    Vector3f reciprocalDirection(1.0f / ray.direction.x(), 1.0f / ray.direction.y(), 1.0f / ray.direction.z());
-    if (ray.direction.x() == -0.0f) reciprocalDirection.x() = std::numeric_limits<float>::infinity();
-    if (ray.direction.y() == -0.0f) reciprocalDirection.y() = std::numeric_limits<float>::infinity();
-    if (ray.direction.z() == -0.0f) reciprocalDirection.z() = std::numeric_limits<float>::infinity();
-
+    float4_t origin[3];
+    float4_t reciprocalDirection[3];
     int directionSigns[3];
-    directionSigns[0] = (ray.direction.x() >= 0) ? 1 : 0;
-    directionSigns[1] = (ray.direction.y() >= 0) ? 1 : 0;
-    directionSigns[2] = (ray.direction.z() >= 0) ? 1 : 0;
 
-    // We start by checking for intersection with the root node.
-    Stack<TraversalTask, kTraversalStackDepth> stack;
-    TraversalTask task = { 0, minDistance, maxDistance };
+    for (auto i = 0; i < 3; ++i)
+    {
+        origin[i] = float4::set1(ray.origin.elements[i]);
+        reciprocalDirection[i] = float4::set1((ray.direction.elements[i] == -0.0f) ? std::numeric_limits<float>::infinity() : 1.0f / ray.direction.elements[i]);
+        directionSigns[i] = (ray.direction.elements[i] >= 0) ? 1 : 0;
+    }
 
-    // In every step of the traversal, we test for intersection against
-    // the current node.
-    while (true)
+    // We start by checking for intersection with the children of the root
+    // node.
+    TraversalTask stack[kWideTraversalStackDepth];
+    auto top = 0;
+    stack[top++] = TraversalTask{ 0, minDistance };
+
+    while (top > 0)
     {
-        const auto& node = mNodes[task.nodeIndex];
+        auto task = stack[--top];
+
+        // If a closer hit was found after this node was pushed, skip it.
+        if (task.tMin > hit.distance)
+            continue;
+
+        const auto& node = mWideNodes[task.nodeIndex];
 
-        // Check whether the ray passes through the bounding box of the
-        // node.
-        if (ray.intersect(node.boundingBox(), reciprocalDirection, directionSigns, task.tMin, task.tMax))
+        // Check which children's bounding boxes the ray passes through,
+        // given the current closest hit.
+        float entryDistances[WideBVHNode::kWidth];
+        auto hitMask = intersectChildren(node, origin, reciprocalDirection, directionSigns, float4::set1(minDistance),
+                                         float4::set1(hit.distance), entryDistances);
+
+        TraversalTask children[WideBVHNode::kWidth];
+        auto numChildren = 0;
+
+        for (auto i = 0; i < WideBVHNode::kWidth; ++i)
         {
-            if (node.isLeaf())
+            if (!(hitMask & (1 << i)) || node.isEmpty(i))
+                continue;
+
+            if (node.isLeaf(i))
             {
-                // For leaf nodes, calculate the intersection of the ray
+                // For leaf children, calculate the intersection of the ray
                 // and the triangle. If this intersection lies on the ray,
                 // and before the current closest hit, make this the
                 // current closest hit.
-                auto t = ray.intersect(mesh, node.getTriangleIndex());
+                auto t = ray.intersect(mesh, node.triangleIndex(i));
                 if (minDistance <= t && t < hit.distance)
                 {
                     hit.distance = t;
-                    hit.triangleIndex = node.getTriangleIndex();
+                    hit.triangleIndex = node.triangleIndex(i);
                 }
             }
             else
             {
-                // Based on the ray signs, decide which of the two children
-                // is the near child, and which is the far child. Push the
-                // far child onto the stack, set the current node to the
-                // near child, and continue.
-                auto leftChildOffset = node.getTriangleIndex();
-                auto splitAxis = node.getSplitAxis();
-                stack.push(TraversalTask{ task.nodeIndex + leftChildOffset + directionSigns[splitAxis], task.tMin, task.tMax });
-                task.nodeIndex += leftChildOffset + (directionSigns[splitAxis] ^ 1);
-                continue;
+                insertSorted(children, numChildren, TraversalTask{ node.childNodeIndex(i), entryDistances[i] });
             }
         }
 
-        // If we've just processed a leaf, pop a new task off the stack.
-        // If the stack is empty, stop.
-        if (stack.isEmpty())
-            break;
+        // Push internal children so that the nearest one is visited next.
+        for (auto i = 0; i < numChildren; ++i)
+        {
+            stack[top++] = children[i];
+        }
+    }
 
-        task = stack.pop();
-        task.tMax = std::min(task.tMax, hit.distance);
+    if (hit.triangleIndex < 0)
+    {
+        hit.distance = std::numeric_limits<float>::infinity();
     }
 
     return hit;
@@ -360,64 +1032,234 @@ bool BVH::isOccluded(const Ray& ray,
                      float minDistance,
                      float maxDistance) const
 {
-    Vector3f reciprocalDirection(1.0f / ray.direction.x(), 1.0f / ray.direction.y(), 1.0f / ray.direction.z());
-    if (ray.direction.x() == -0.0f) reciprocalDirection.x() = std::numeric_limits<float>::infinity();
-    if (ray.direction.y() == -0.0f) reciprocalDirection.y() = std::numeric_limits<float>::infinity();
-    if (ray.direction.z() == -0.0f) reciprocalDirection.z() = std::numeric_limits<float>::infinity();
-
+    float4_t origin[3];
+    float4_t reciprocalDirection[3];
     int directionSigns[3];
-    directionSigns[0] = (ray.direction.x() >= 0) ? 1 : 0;
-    directionSigns[1] = (ray.direction.y() >= 0) ? 1 : 0;
-    directionSigns[2] = (ray.direction.z() >= 0) ? 1 : 0;
 
-    // We start by checking for intersection with the root node.
-    BVHNode* stack[kTraversalStackDepth];
+    for (auto i = 0; i < 3; ++i)
+    {
+        origin[i] = float4::set1(ray.origin.elements[i]);
+        reciprocalDirection[i] = float4::set1((ray.direction.elements[i] == -0.0f) ? std::numeric_limits<float>::infinity() : 1.0f / ray.direction.elements[i]);
+        directionSigns[i] = (ray.direction.elements[i] >= 0) ? 1 : 0;
+    }
+
+    auto tMin = float4::set1(minDistance);
+    auto tMax = float4::set1(maxDistance);
+
+    // We start by checking for intersection with the children of the root
+    // node. Since any hit will do, children are visited in storage order.
+    int32_t stack[kWideTraversalStackDepth];
     auto top = 0;
-    auto node = const_cast<BVHNode*>(&mNodes[0]);
+    stack[top++] = 0;
 
-    // In every step of the traversal, we test for intersection against
-    // the current node.
-    while (true)
+    while (top > 0)
     {
-        float tMin = minDistance;
-        float tMax = maxDistance;
+        const auto& node = mWideNodes[stack[--top]];
+
+        float entryDistances[WideBVHNode::kWidth];
+        auto hitMask = intersectChildren(node, origin, reciprocalDirection, directionSigns, tMin, tMax, entryDistances);
 
-        // Check whether the ray passes through the bounding box of the
-        // node.
-        if (ray.intersect(node->boundingBox(), reciprocalDirection, directionSigns, tMin, tMax))
+        for (auto i = 0; i < WideBVHNode::kWidth; ++i)
         {
-            if (node->isLeaf())
+            if (!(hitMask & (1 << i)) || node.isEmpty(i))
+                continue;
+
+            if (node.isLeaf(i))
             {
-                // For leaf nodes, calculate the intersection of the ray
+                // For leaf children, calculate the intersection of the ray
                 // and the triangle. If this intersection lies on the ray,
                 // the ray is occluded.
-                auto t = ray.intersect(mesh, node->getTriangleIndex());
+                auto t = ray.intersect(mesh, node.triangleIndex(i));
                 if (minDistance <= t && t < maxDistance)
                     return true;
             }
             else
             {
-                // Based on the ray signs, decide which of the two children
-                // is the near child, and which is the far child. Push the
-                // far child onto the stack, set the current node to the
-                // near child, and continue.
-                auto leftChildOffset = node->getTriangleIndex();
-                auto splitAxis = node->getSplitAxis();
-                stack[top++] = node + leftChildOffset + directionSigns[splitAxis];
-                node += leftChildOffset + (directionSigns[splitAxis] ^ 1);
+                stack[top++] = node.childNodeIndex(i);
+            }
+        }
+    }
+
+    return false;
+}
+
+int BVH::intersect(int numRays,
+                   const Ray* rays,
+                   const float* minDistances,
+                   const float* maxDistances,
+                   const Mesh& mesh,
+                   Hit* hits) const
+{
+    alignas(Memory::kDefaultAlignment) float tMaxValues[kPacketSize];
+    for (auto i = 0; i < kPacketSize; ++i)
+    {
+        tMaxValues[i] = (i < numRays) ? std::min(maxDistances[i], hits[i].distance) : 0.0f;
+    }
+
+    RayPacket packet(numRays, rays, minDistances, tMaxValues);
+
+    // The current extent of each ray. This shrinks as closer hits are found.
+    auto tMax = packet.maxDistance;
+
+    int32_t triangleIndices[kPacketSize] = { -1, -1, -1, -1 };
+    auto hitMask = 0;
+
+    // We start by checking for intersection with the children of the root
+    // node.
+    int32_t stack[kWideTraversalStackDepth];
+    auto top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const auto& node = mWideNodes[stack[--top]];
+
+        TraversalTask children[WideBVHNode::kWidth];
+        auto numChildren = 0;
+
+        for (auto i = 0; i < WideBVHNode::kWidth && !node.isEmpty(i); ++i)
+        {
+            // Test all rays in the packet against the child's bounding box.
+            auto box = node.childBoundingBox(i);
+            float4_t tNear;
+            auto activeMask = packet.intersect(box.minCoordinates.elements, box.maxCoordinates.elements, tMax, tNear) & packet.validMask;
+            if (!activeMask)
                 continue;
+
+            if (node.isLeaf(i))
+            {
+                // For leaf children, intersect all rays with the triangle at
+                // once. Rays for which the intersection lies within their
+                // current extent record a new closest hit.
+                auto t = packet.intersect(mesh, node.triangleIndex(i));
+                auto closer = float4::andbits(float4::cmple(packet.minDistance, t), float4::cmplt(t, tMax));
+                auto closerMask = float4::movemask(closer) & activeMask;
+
+                if (closerMask)
+                {
+                    closer = float4::andbits(closer, RayPacket::laneMask(activeMask));
+                    tMax = float4::orbits(float4::andbits(closer, t), float4::andnotbits(closer, tMax));
+
+                    for (auto j = 0; j < kPacketSize; ++j)
+                    {
+                        if (closerMask & (1 << j))
+                        {
+                            triangleIndices[j] = node.triangleIndex(i);
+                        }
+                    }
+
+                    hitMask |= closerMask;
+                }
+            }
+            else
+            {
+                // Order internal children by the distance at which the
+                // nearest active ray enters them.
+                alignas(Memory::kDefaultAlignment) float entryDistances[kPacketSize];
+                float4::store(entryDistances, tNear);
+
+                auto entryDistance = std::numeric_limits<float>::infinity();
+                for (auto j = 0; j < kPacketSize; ++j)
+                {
+                    if (activeMask & (1 << j))
+                    {
+                        entryDistance = std::min(entryDistance, entryDistances[j]);
+                    }
+                }
+
+                insertSorted(children, numChildren, TraversalTask{ node.childNodeIndex(i), entryDistance });
             }
         }
 
-        // If we've just processed a leaf, pop a new task off the stack.
-        // If the stack is empty, stop.
-        if (top <= 0)
-            break;
+        // Push internal children so that the nearest one is visited next.
+        for (auto i = 0; i < numChildren; ++i)
+        {
+            stack[top++] = children[i].nodeIndex;
+        }
+    }
+
+    if (hitMask)
+    {
+        alignas(Memory::kDefaultAlignment) float distances[kPacketSize];
+        float4::store(distances, tMax);
 
-        node = stack[--top];
+        for (auto i = 0; i < numRays; ++i)
+        {
+            if (hitMask & (1 << i))
+            {
+                hits[i].distance = distances[i];
+                hits[i].triangleIndex = triangleIndices[i];
+            }
+        }
     }
 
-    return false;
+    return hitMask;
+}
+
+void BVH::isOccluded(int numRays,
+                     const Ray* rays,
+                     const float* minDistances,
+                     const float* maxDistances,
+                     const Mesh& mesh,
+                     bool* occluded) const
+{
+    RayPacket packet(numRays, rays, minDistances, maxDistances);
+
+    // Rays that are already occluded don't need to be traced.
+    auto unoccludedMask = packet.validMask;
+    for (auto i = 0; i < numRays; ++i)
+    {
+        if (occluded[i])
+        {
+            unoccludedMask &= ~(1 << i);
+        }
+    }
+
+    // We start by checking for intersection with the children of the root
+    // node. Since any hit will do, children are visited in storage order.
+    int32_t stack[kWideTraversalStackDepth];
+    auto top = 0;
+    stack[top++] = 0;
+
+    while (unoccludedMask && top > 0)
+    {
+        const auto& node = mWideNodes[stack[--top]];
+
+        for (auto i = 0; i < WideBVHNode::kWidth && !node.isEmpty(i); ++i)
+        {
+            auto box = node.childBoundingBox(i);
+            float4_t tNear;
+            auto activeMask = packet.intersect(box.minCoordinates.elements, box.maxCoordinates.elements, packet.maxDistance, tNear) & unoccludedMask;
+            if (!activeMask)
+                continue;
+
+            if (node.isLeaf(i))
+            {
+                // For leaf children, intersect all rays with the triangle at
+                // once. Rays for which the intersection lies within their
+                // extent are occluded.
+                auto t = packet.intersect(mesh, node.triangleIndex(i));
+                auto hit = float4::andbits(float4::cmple(packet.minDistance, t), float4::cmplt(t, packet.maxDistance));
+                auto hitMask = float4::movemask(hit) & activeMask;
+
+                for (auto j = 0; j < numRays; ++j)
+                {
+                    if (hitMask & (1 << j))
+                    {
+                        occluded[j] = true;
+                    }
+                }
+
+                unoccludedMask &= ~hitMask;
+                if (!unoccludedMask)
+                    break;
+            }
+            else
+            {
+                stack[top++] = node.childNodeIndex(i);
+            }
+        }
+    }
 }
 
 bool BVH::isOccluded(const Vector3f& start,
@@ -105,6 +105,81 @@ private:
 };
 
 
+// --------------------------------------------------------------------------------------------------------------------
+// WideBVHNode
+// --------------------------------------------------------------------------------------------------------------------
+
+// A node in a 4-ary BVH, obtained by collapsing a binary BVH. The bounding boxes of all children are stored in SoA
+// form, so a ray can be tested against all of them at once using SIMD instructions. To reduce memory traffic during
+// traversal, each child box is quantized to 8 bits per coordinate, relative to the bounding box of the node itself
+// (which is stored as an origin and a per-axis scale). Quantization always rounds outwards, so decoded child boxes
+// contain the original child boxes. This way, a node fits in a single 64-byte cache line.
+//
+// Each child reference is encoded as follows:
+//
+//  Internal nodes:     index of the child node (>= 0)
+//  Leaf nodes:         bitwise complement of the triangle index (< 0)
+//  Empty slots:        kEmptyChild
+//
+// Empty slots, if any, always come after all non-empty slots.
+class WideBVHNode
+{
+public:
+    static const int kWidth = 4;
+    static const int32_t kEmptyChild = INT32_MIN;
+
+    bool isEmpty(int childIndex) const
+    {
+        return (mChildren[childIndex] == kEmptyChild);
+    }
+
+    bool isLeaf(int childIndex) const
+    {
+        return (mChildren[childIndex] < 0);
+    }
+
+    int32_t childNodeIndex(int childIndex) const
+    {
+        return mChildren[childIndex];
+    }
+
+    int32_t triangleIndex(int childIndex) const
+    {
+        return ~mChildren[childIndex];
+    }
+
+    // Returns the minimum coordinates along the given axis of all child boxes.
+    float4_t minCoordinates(int axis) const
+    {
+        return float4::add(float4::set1(mOrigin[axis]), float4::mul(float4::loadu8(mQuantizedMin[axis]), float4::set1(mScale[axis])));
+    }
+
+    // Returns the maximum coordinates along the given axis of all child boxes.
+    float4_t maxCoordinates(int axis) const
+    {
+        return float4::add(float4::set1(mOrigin[axis]), float4::mul(float4::loadu8(mQuantizedMax[axis]), float4::set1(mScale[axis])));
+    }
+
+    // Decodes the bounding box of a single child.
+    Box childBoundingBox(int childIndex) const;
+
+    // Initializes the node to have the given bounding box, and no children.
+    void setBoundingBox(const Box& box);
+
+    // Sets a child reference and its bounding box. setBoundingBox must be called first.
+    void setChild(int childIndex,
+                  int32_t child,
+                  const Box& box);
+
+private:
+    float mOrigin[3];
+    float mScale[3];
+    uint8_t mQuantizedMin[3][kWidth];
+    uint8_t mQuantizedMax[3][kWidth];
+    int32_t mChildren[kWidth];
+};
+
+
 // --------------------------------------------------------------------------------------------------------------------
 // GrowableBox
 // --------------------------------------------------------------------------------------------------------------------
@@ -219,13 +294,24 @@ struct Split
 // BVH
 // --------------------------------------------------------------------------------------------------------------------
 
-// A Bounding Volume Hierarchy (BVH), consisting of axis-aligned bounding boxes (AABBs).
+struct ConstructionTask;
+class JobScheduler;
+
+// A Bounding Volume Hierarchy (BVH), consisting of axis-aligned bounding boxes (AABBs). The BVH is built as a binary
+// tree, which is then collapsed into a 4-ary tree of compressed nodes that is used for ray traversal. The binary tree
+// is retained for box queries.
 class BVH
 {
 public:
+    static const int kPacketSize = 4; // Maximum number of rays that can be traversed together as a packet.
+
+    // Builds a BVH for the given mesh. If a scheduler is given and the mesh is large enough, the top levels of the BVH
+    // are built serially, and the resulting subtrees are then built in parallel on the scheduler's threads. Otherwise,
+    // the BVH is built serially on the calling thread. The resulting BVH does not depend on the number of threads.
     BVH(const Mesh& mesh,
         ProgressCallback progressCallback = nullptr,
-        void* userData = nullptr);
+        void* userData = nullptr,
+        JobScheduler* scheduler = nullptr);
 
     int32_t numNodes() const
     {
@@ -242,6 +328,28 @@ public:
         return mNodes[index];
     }
 
+    int32_t numWideNodes() const
+    {
+        return static_cast<int32_t>(mWideNodes.size(0));
+    }
+
+    const WideBVHNode& wideNode(int32_t index) const
+    {
+        return mWideNodes[index];
+    }
+
+    // Recalculates the bounding boxes of all nodes bottom-up, after the vertices of the mesh have been moved. The
+    // topology of the tree is left unchanged, so this is much cheaper than rebuilding the BVH, but traversal
+    // performance degrades as the vertices move further away from the positions they had when the BVH was built.
+    // Returns the SAH cost of the refitted BVH, relative to its SAH cost when it was last built. The caller can use
+    // this to decide when to call rebuild() instead.
+    float refit(const Mesh& mesh);
+
+    // Rebuilds the BVH from scratch, using the current vertices of the mesh. The mesh must have the same number of
+    // triangles as when the BVH was first built. The scheduler is used as in the constructor.
+    void rebuild(const Mesh& mesh,
+                 JobScheduler* scheduler = nullptr);
+
     // Calculates the first intersection between a ray and any triangle in the BVH.
     Hit intersect(const Ray& ray,
                   const Mesh& mesh,
@@ -254,6 +362,27 @@ public:
                     float minDistance,
                     float maxDistance) const;
 
+    // Calculates the first intersections between a packet of up to kPacketSize rays and any triangle in the BVH. All
+    // rays in the packet are tested against each node together using SIMD instructions, so the packet should consist
+    // of coherent rays (i.e., rays with similar origins and directions) for best performance. On input, the distance
+    // of each hit is used as an additional upper bound on the corresponding ray's extent; a hit is only overwritten if
+    // a closer intersection is found. Returns a bitmask indicating which hits were overwritten.
+    int intersect(int numRays,
+                  const Ray* rays,
+                  const float* minDistances,
+                  const float* maxDistances,
+                  const Mesh& mesh,
+                  Hit* hits) const;
+
+    // Checks whether each ray in a packet of up to kPacketSize rays is occluded by any triangle in the BVH. Rays
+    // already marked as occluded on input are not traced. Traversal stops as soon as all rays are occluded.
+    void isOccluded(int numRays,
+                    const Ray* rays,
+                    const float* minDistances,
+                    const float* maxDistances,
+                    const Mesh& mesh,
+                    bool* occluded) const;
+
     // Checks whether the ray between two points is occluded by any
     // triangle in the BVH. This function does not apply any tolerances
     // at either end point, so if either start or end is close to a
@@ -274,14 +403,51 @@ public:
 
 private:
     static const int kConstructionStackDepth = 128; // Maximum recursion depth during BVH construction.
+    static const int kNumBins = 32; // Number of bins used when evaluating binned SAH splits.
+    static const int kMinBinnedSplitSize = 1024; // Nodes with at least this many triangles use binned SAH splits.
+    static const int kMinParallelBuildSize = 16384; // Meshes with fewer triangles are always built serially.
+    static const int kMinParallelSubtreeSize = 4096; // Subtrees with fewer triangles are not split further before parallel construction.
+    static const int kSubtreesPerThread = 4; // Number of subtrees to build in parallel, per thread.
     static const int kTraversalStackDepth = 128; // Maximum recursion depth during BVH traversal.
+    static const int kWideTraversalStackDepth = (WideBVHNode::kWidth - 1) * kTraversalStackDepth; // Maximum stack size during wide BVH traversal.
 
     Array<BVHNode> mNodes; // The nodes of the BVH.
+    Array<WideBVHNode> mWideNodes; // The nodes of the collapsed 4-ary BVH.
+    float mBuildCost; // SAH cost of the BVH when it was last built.
 
     // Builds a BVH using the triangles in a Mesh.
     void build(const Mesh& mesh,
                ProgressCallback progressCallback,
-               void* userData);
+               void* userData,
+               JobScheduler* scheduler);
+
+    // Builds the subtree rooted at the node described by a construction task. Subtrees for disjoint ranges of
+    // leafIndices write to disjoint ranges of all arrays, so they can be built concurrently.
+    void buildSubtree(const ConstructionTask& rootTask,
+                      GrowableBox* leafNodes,
+                      const Vector3f* leafBoxCenters,
+                      int32_t* leafIndices,
+                      CentroidCoordinate* const* centroids,
+                      float* surfaceAreas);
+
+    // Builds a single node. If the node is an internal node, returns true and sets the construction tasks for its
+    // children; otherwise returns false.
+    bool buildNode(const ConstructionTask& task,
+                   GrowableBox* leafNodes,
+                   const Vector3f* leafBoxCenters,
+                   int32_t* leafIndices,
+                   CentroidCoordinate* const* centroids,
+                   float* surfaceAreas,
+                   ConstructionTask& leftChildTask,
+                   ConstructionTask& rightChildTask);
+
+    // Collapses the binary BVH into a 4-ary BVH, by repeatedly replacing the child with the largest surface area
+    // with its own children, until each node has 4 children or only leaves remain.
+    void collapse();
+
+    // Calculates the SAH cost of traversing the binary BVH, i.e., the total surface area of all nodes relative to
+    // the surface area of the root node.
+    float traversalCost() const;
 
     // Calculates the best split between the triangles in an internal node.
     Split bestSplit(GrowableBox* leafNodes,
@@ -315,6 +481,17 @@ private:
                    int32_t startIndex,
                    int32_t endIndex);
 
+    // Uses the binned SAH approach for splitting an internal node. Instead of sorting the triangles along each axis,
+    // triangles are placed into a fixed number of bins based on their centroids, and only splits between bins are
+    // considered. This is much faster than the full SAH split for large nodes, at a small cost in quality. The
+    // leafIndices of the node's subarray are partitioned in place. Returns a split with axis -1 if no split was found.
+    Split binnedSahSplit(GrowableBox* leafNodes,
+                         const Vector3f* leafBoxCenters,
+                         int32_t* leafIndices,
+                         const Box& boundingBox,
+                         int32_t startIndex,
+                         int32_t endIndex);
+
     // Evaluates the SAH cost function.
     float sahCost(float leftChildSurfaceArea,
                   int32_t numLeftChildren,
@@ -0,0 +1,294 @@
+//
+// Copyright 2017-2023 Valve Corporation.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "compressed_energy_field.h"
+
+#include "bands.h"
+
+namespace ipl {
+
+// --------------------------------------------------------------------------------------------------------------------
+// CompressedEnergyField
+// --------------------------------------------------------------------------------------------------------------------
+
+const float CompressedEnergyField::kDynamicRange8 = 28.0f;
+const float CompressedEnergyField::kDynamicRange16 = 48.0f;
+
+CompressedEnergyField::CompressedEnergyField(const EnergyField& energyField,
+                                             EnergyFieldCompression compression)
+    : mCompression(compression)
+    , mNumChannels(energyField.numChannels())
+    , mNumBins(energyField.numBins())
+    , mScales(energyField.numChannels(), Bands::kNumBands)
+{
+    assert(compression != EnergyFieldCompression::None);
+
+    auto numValues = mNumChannels * Bands::kNumBands * mNumBins;
+
+    if (compression == EnergyFieldCompression::LogQuantized8)
+    {
+        mCodes8.resize(numValues);
+        encode(energyField, 8, kDynamicRange8, mCodes8.data());
+    }
+    else
+    {
+        mCodes16.resize(numValues);
+        encode(energyField, 16, kDynamicRange16, mCodes16.data());
+    }
+}
+
+CompressedEnergyField::CompressedEnergyField(const Serialized::CompressedEnergyField* serializedObject)
+{
+    assert(serializedObject);
+    assert(serializedObject->num_channels() > 0);
+    assert(serializedObject->num_bins() > 0);
+    assert(serializedObject->scales());
+
+    mNumChannels = serializedObject->num_channels();
+    mNumBins = serializedObject->num_bins();
+    mScales.resize(mNumChannels, Bands::kNumBands);
+
+    memcpy(mScales.flatData(), serializedObject->scales()->data(), mScales.totalSize() * sizeof(float));
+
+    auto numValues = mNumChannels * Bands::kNumBands * mNumBins;
+
+    if (serializedObject->codes_8bit())
+    {
+        mCompression = EnergyFieldCompression::LogQuantized8;
+        mCodes8.resize(numValues);
+        memcpy(mCodes8.data(), serializedObject->codes_8bit()->data(), numValues * sizeof(uint8_t));
+    }
+    else
+    {
+        assert(serializedObject->codes_16bit());
+
+        mCompression = EnergyFieldCompression::LogQuantized16;
+        mCodes16.resize(numValues);
+        for (auto i = 0; i < numValues; ++i)
+        {
+            mCodes16[i] = serializedObject->codes_16bit()->Get(i);
+        }
+    }
+}
+
+CompressedEnergyField::CompressedEnergyField(const CompressedEnergyField& other)
+    : mCompression(other.mCompression)
+    , mNumChannels(other.mNumChannels)
+    , mNumBins(other.mNumBins)
+    , mScales(other.mNumChannels, Bands::kNumBands)
+{
+    memcpy(mScales.flatData(), other.mScales.flatData(), mScales.totalSize() * sizeof(float));
+
+    if (mCompression == EnergyFieldCompression::LogQuantized8)
+    {
+        mCodes8.resize(other.mCodes8.totalSize());
+        memcpy(mCodes8.data(), other.mCodes8.data(), mCodes8.totalSize() * sizeof(uint8_t));
+    }
+    else
+    {
+        mCodes16.resize(other.mCodes16.totalSize());
+        memcpy(mCodes16.data(), other.mCodes16.data(), mCodes16.totalSize() * sizeof(uint16_t));
+    }
+}
+
+void CompressedEnergyField::decode(EnergyField& out) const
+{
+    if (mCompression == EnergyFieldCompression::LogQuantized8)
+    {
+        decodeScaleAccumulate(mNumChannels, mNumBins, mScales.flatData(), mCodes8.data(), decodingTable(mCompression), 1.0f, false, out);
+    }
+    else
+    {
+        decodeScaleAccumulate(mNumChannels, mNumBins, mScales.flatData(), mCodes16.data(), decodingTable(mCompression), 1.0f, false, out);
+    }
+
+    out.markAllBinsDirty();
+}
+
+void CompressedEnergyField::scaleAccumulate(float scalar,
+                                            EnergyField& out) const
+{
+    if (mCompression == EnergyFieldCompression::LogQuantized8)
+    {
+        decodeScaleAccumulate(mNumChannels, mNumBins, mScales.flatData(), mCodes8.data(), decodingTable(mCompression), scalar, true, out);
+    }
+    else
+    {
+        decodeScaleAccumulate(mNumChannels, mNumBins, mScales.flatData(), mCodes16.data(), decodingTable(mCompression), scalar, true, out);
+    }
+}
+
+void CompressedEnergyField::scaleAccumulate(const Serialized::CompressedEnergyField* in,
+                                            float scalar,
+                                            EnergyField& out)
+{
+    assert(in);
+    assert(in->scales());
+
+    if (in->codes_8bit())
+    {
+        decodeScaleAccumulate(in->num_channels(), in->num_bins(), in->scales()->data(), in->codes_8bit()->data(),
+                              decodingTable(EnergyFieldCompression::LogQuantized8), scalar, true, out);
+    }
+    else
+    {
+        assert(in->codes_16bit());
+
+        decodeScaleAccumulate(in->num_channels(), in->num_bins(), in->scales()->data(), in->codes_16bit()->data(),
+                              decodingTable(EnergyFieldCompression::LogQuantized16), scalar, true, out);
+    }
+}
+
+uint64_t CompressedEnergyField::serializedSize() const
+{
+    auto bytesPerValue = (mCompression == EnergyFieldCompression::LogQuantized8) ? sizeof(uint8_t) : sizeof(uint16_t);
+
+    return (2 * sizeof(int32_t) +
+            mScales.totalSize() * sizeof(float) +
+            mNumChannels * Bands::kNumBands * mNumBins * bytesPerValue);
+}
+
+flatbuffers::Offset<Serialized::CompressedEnergyField> CompressedEnergyField::serialize(SerializedObject& serializedObject) const
+{
+    auto& fbb = serializedObject.fbb();
+
+    auto scalesOffset = fbb.CreateVector(mScales.flatData(), mScales.totalSize());
+
+    flatbuffers::Offset<flatbuffers::Vector<uint8_t>> codes8Offset = 0;
+    flatbuffers::Offset<flatbuffers::Vector<uint16_t>> codes16Offset = 0;
+
+    if (mCompression == EnergyFieldCompression::LogQuantized8)
+    {
+        codes8Offset = fbb.CreateVector(mCodes8.data(), mCodes8.totalSize());
+    }
+    else
+    {
+        codes16Offset = fbb.CreateVector(mCodes16.data(), mCodes16.totalSize());
+    }
+
+    return Serialized::CreateCompressedEnergyField(fbb, mNumChannels, mNumBins, scalesOffset, codes8Offset, codes16Offset);
+}
+
+template <typename T>
+void CompressedEnergyField::encode(const EnergyField& energyField,
+                                   int numBits,
+                                   float dynamicRange,
+                                   T* codes)
+{
+    auto signBit = 1 << (numBits - 1);
+    auto maxMagnitudeCode = signBit - 1;
+    auto codesPerOctave = maxMagnitudeCode / dynamicRange;
+
+    for (auto i = 0, index = 0; i < mNumChannels; ++i)
+    {
+        for (auto j = 0; j < Bands::kNumBands; ++j)
+        {
+            const auto* values = energyField[i][j];
+
+            auto scale = 0.0f;
+            for (auto k = 0; k < mNumBins; ++k)
+            {
+                scale = std::max(scale, fabsf(values[k]));
+            }
+
+            mScales[i][j] = scale;
+
+            for (auto k = 0; k < mNumBins; ++k, ++index)
+            {
+                auto magnitude = (scale > 0.0f) ? fabsf(values[k]) / scale : 0.0f;
+
+                auto magnitudeCode = 0;
+                if (magnitude > 0.0f)
+                {
+                    auto code = static_cast<int>(roundf(maxMagnitudeCode + codesPerOctave * log2f(magnitude)));
+                    magnitudeCode = std::min(std::max(code, 0), maxMagnitudeCode);
+                }
+
+                auto signCode = (values[k] < 0.0f && magnitudeCode > 0) ? signBit : 0;
+
+                codes[index] = static_cast<T>(magnitudeCode | signCode);
+            }
+        }
+    }
+}
+
+template <typename T>
+void CompressedEnergyField::decodeScaleAccumulate(int numChannels,
+                                                  int numBins,
+                                                  const float* scales,
+                                                  const T* codes,
+                                                  const float* decodingTable,
+                                                  float scalar,
+                                                  bool accumulate,
+                                                  EnergyField& out)
+{
+    auto numChannelsToDecode = std::min(numChannels, out.numChannels());
+    auto numBinsToDecode = std::min(numBins, out.numBins());
+
+    for (auto i = 0; i < numChannelsToDecode; ++i)
+    {
+        for (auto j = 0; j < Bands::kNumBands; ++j)
+        {
+            const auto* channelCodes = &codes[(i * Bands::kNumBands + j) * numBins];
+            auto* values = out[i][j];
+            auto scale = scalar * scales[i * Bands::kNumBands + j];
+
+            if (accumulate)
+            {
+                for (auto k = 0; k < numBinsToDecode; ++k)
+                {
+                    values[k] += scale * decodingTable[channelCodes[k]];
+                }
+            }
+            else
+            {
+                for (auto k = 0; k < numBinsToDecode; ++k)
+                {
+                    values[k] = scale * decodingTable[channelCodes[k]];
+                }
+            }
+        }
+    }
+}
+
+const float* CompressedEnergyField::decodingTable(EnergyFieldCompression compression)
+{
+    static const auto kDecodingTable8 = createDecodingTable(8, kDynamicRange8);
+    static const auto kDecodingTable16 = createDecodingTable(16, kDynamicRange16);
+
+    return (compression == EnergyFieldCompression::LogQuantized8) ? kDecodingTable8.data() : kDecodingTable16.data();
+}
+
+vector<float> CompressedEnergyField::createDecodingTable(int numBits,
+                                                         float dynamicRange)
+{
+    auto signBit = 1 << (numBits - 1);
+    auto maxMagnitudeCode = signBit - 1;
+
+    vector<float> decodingTable(1 << numBits);
+
+    for (auto i = 0; i < signBit; ++i)
+    {
+        auto magnitude = (i == 0) ? 0.0f : exp2f(-dynamicRange * (maxMagnitudeCode - i) / maxMagnitudeCode);
+
+        decodingTable[i] = magnitude;
+        decodingTable[i | signBit] = -magnitude;
+    }
+
+    return decodingTable;
+}
+
+}
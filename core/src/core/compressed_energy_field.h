@@ -0,0 +1,115 @@
+//
+// Copyright 2017-2023 Valve Corporation.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include "containers.h"
+#include "energy_field.h"
+
+namespace ipl {
+
+// --------------------------------------------------------------------------------------------------------------------
+// CompressedEnergyField
+// --------------------------------------------------------------------------------------------------------------------
+
+enum class EnergyFieldCompression
+{
+    None,
+    LogQuantized16,
+    LogQuantized8,
+};
+
+// An energy field stored using 8 or 16 bits per value, for reducing the memory used by baked data. Each value is
+// stored as a sign bit and a quantized logarithm of its magnitude relative to the largest magnitude in its channel
+// and band. Values are decoded when they are looked up, without expanding the whole energy field.
+class CompressedEnergyField
+{
+public:
+    CompressedEnergyField(const EnergyField& energyField,
+                          EnergyFieldCompression compression);
+
+    CompressedEnergyField(const Serialized::CompressedEnergyField* serializedObject);
+
+    CompressedEnergyField(const CompressedEnergyField& other);
+
+    int numChannels() const
+    {
+        return mNumChannels;
+    }
+
+    int numBins() const
+    {
+        return mNumBins;
+    }
+
+    EnergyFieldCompression compression() const
+    {
+        return mCompression;
+    }
+
+    // Decodes all values into the given energy field.
+    void decode(EnergyField& out) const;
+
+    // Decodes all values, multiplies them by the given scalar, and adds them to the given energy field.
+    void scaleAccumulate(float scalar,
+                         EnergyField& out) const;
+
+    // Same as above, but reads the codes directly from serialized data (for example, a memory-mapped file), without
+    // copying them into a CompressedEnergyField first.
+    static void scaleAccumulate(const Serialized::CompressedEnergyField* in,
+                                float scalar,
+                                EnergyField& out);
+
+    uint64_t serializedSize() const;
+
+    flatbuffers::Offset<Serialized::CompressedEnergyField> serialize(SerializedObject& serializedObject) const;
+
+private:
+    // Magnitudes smaller than this many octaves below the largest magnitude in a channel and band are stored as 0.
+    static const float kDynamicRange8;
+    static const float kDynamicRange16;
+
+    EnergyFieldCompression mCompression;
+    int mNumChannels;
+    int mNumBins;
+    Array<float, 2> mScales; // Largest magnitude in each channel and band.
+    Array<uint8_t> mCodes8;
+    Array<uint16_t> mCodes16;
+
+    template <typename T>
+    void encode(const EnergyField& energyField,
+                int numBits,
+                float dynamicRange,
+                T* codes);
+
+    template <typename T>
+    static void decodeScaleAccumulate(int numChannels,
+                                      int numBins,
+                                      const float* scales,
+                                      const T* codes,
+                                      const float* decodingTable,
+                                      float scalar,
+                                      bool accumulate,
+                                      EnergyField& out);
+
+    // Returns a table that maps each code to the corresponding value, assuming a scale of 1.
+    static const float* decodingTable(EnergyFieldCompression compression);
+
+    static vector<float> createDecodingTable(int numBits,
+                                             float dynamicRange);
+};
+
+}
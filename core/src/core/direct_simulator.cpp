@@ -18,10 +18,35 @@
 
 namespace ipl {
 
+// --------------------------------------------------------------------------------------------------------------------
+// DirectSimulationState
+// --------------------------------------------------------------------------------------------------------------------
+
+DirectSimulationState::DirectSimulationState()
+    : valid(false)
+    , prevSource(Vector3f::kZero)
+    , prevListener(Vector3f::kZero)
+    , prevSceneVersion(0)
+    , prevOcclusionRadius(0.0f)
+    , prevNumOcclusionSamples(0)
+    , nextSample(0)
+    , numStaleSamples(0)
+    , sourceStale(true)
+    , numSamplesPerUpdate(1)
+    , occlusion(1.0f)
+{}
+
+
 // --------------------------------------------------------------------------------------------------------------------
 // DirectSimulator
 // --------------------------------------------------------------------------------------------------------------------
 
+const float DirectSimulator::kTransmissionRayOffset = 1e-2f;
+const int DirectSimulator::kMinRaysPerJob = 256;
+const float DirectSimulator::kTemporalOcclusionMinMovement = 1e-3f;
+const float DirectSimulator::kTemporalOcclusionChangeThreshold = 0.05f;
+const int DirectSimulator::kTemporalOcclusionMaxUpdateInterval = 8;
+
 DirectSimulator::DirectSimulator(int maxNumOcclusionSamples)
 {
     if (maxNumOcclusionSamples > 1)
@@ -44,92 +69,344 @@ void DirectSimulator::simulate(const IScene* scene,
                                int numTransmissionRays,
                                DirectSoundPath& directSoundPath)
 {
-    auto distance = (source.origin - listener.origin).length();
+    simulateUnoccluded(flags, source, listener, distanceAttenuationModel, airAbsorptionModel, directivity, directSoundPath);
 
-    if (flags & CalcDistanceAttenuation)
+    // Constructor for DirectSoundPath sets the default value correctly.
+    if (scene && (flags & CalcOcclusion))
     {
-        directSoundPath.distanceAttenuation = distanceAttenuationModel.evaluate(distance);
+        switch (occlusionType)
+        {
+        case OcclusionType::Raycast:
+            directSoundPath.occlusion =
+                raycastOcclusion(*scene, listener.origin, source.origin);
+            break;
+
+        case OcclusionType::Volumetric:
+            directSoundPath.occlusion =
+                volumetricOcclusion(*scene, listener.origin, source.origin, occlusionRadius, numOcclusionSamples);
+            break;
+
+        default:
+            directSoundPath.occlusion = 0.0f;
+            break;
+        }
     }
     else
     {
-        directSoundPath.distanceAttenuation = 1.0f;
+        directSoundPath.occlusion = 1.0f;
     }
 
-    if (flags & CalcAirAbsorption)
+    if (scene && (flags & CalcTransmission))
+    {
+        transmission(*scene, listener.origin, source.origin, directSoundPath.transmission, numTransmissionRays);
+    }
+    else
     {
         for (auto i = 0; i < Bands::kNumBands; ++i)
         {
-            directSoundPath.airAbsorption[i] = airAbsorptionModel.evaluate(distance, i);
+            directSoundPath.transmission[i] = 1.0f;
         }
     }
-    else
+}
+
+void DirectSimulator::simulate(const IScene* scene,
+                               int numSources,
+                               const DirectSimulationInputs* const* inputs,
+                               DirectSimulationState* const* states,
+                               const CoordinateSpace3f& listener,
+                               DirectSoundPath* const* directSoundPaths,
+                               JobScheduler* scheduler)
+{
+    mRayOffsets.resize(numSources);
+    mOcclusionUpdates.resize(numSources);
+
+    // Gather the occlusion rays for all sources. For volumetric occlusion, the ray from the listener to a sample is
+    // traced even if the sample turns out not to be visible from the source, so that all rays can be traced in a
+    // single pass.
+    auto numRays = 0;
+    for (auto i = 0; i < numSources; ++i)
     {
-        for (auto i = 0; i < Bands::kNumBands; ++i)
+        const auto& sourceInputs = *inputs[i];
+
+        simulateUnoccluded(sourceInputs.flags, sourceInputs.source, listener, sourceInputs.distanceAttenuationModel,
+                           sourceInputs.airAbsorptionModel, sourceInputs.directivity, *directSoundPaths[i]);
+
+        mRayOffsets[i] = -1;
+
+        if (!scene || !(sourceInputs.flags & CalcOcclusion))
+            continue;
+
+        if (sourceInputs.occlusionType == OcclusionType::Raycast)
         {
-            directSoundPath.airAbsorption[i] = 1.0f;
+            mRayOffsets[i] = numRays;
+            numRays += 1;
+        }
+        else if (sourceInputs.occlusionType == OcclusionType::Volumetric)
+        {
+            auto numSamples = std::max(std::min(sourceInputs.numOcclusionSamples, static_cast<int>(mSphereVolumeSamples.size(0))), 0);
+
+            auto& update = mOcclusionUpdates[i];
+            if (sourceInputs.temporalOcclusion && states && states[i])
+            {
+                update = planOcclusionUpdate(sourceInputs, listener.origin, scene->version(), numSamples, *states[i]);
+            }
+            else
+            {
+                update = OcclusionUpdate{0, numSamples, true};
+            }
+
+            mRayOffsets[i] = numRays;
+            numRays += (update.traceSource) ? 2 * update.numSamples : update.numSamples;
         }
     }
 
-    if (flags & CalcDelay)
+    reserveRays(numRays);
+
+    for (auto i = 0; i < numSources; ++i)
     {
-        directSoundPath.delay = directPathDelay(listener.origin, source.origin);
+        if (mRayOffsets[i] < 0)
+            continue;
+
+        const auto& sourceInputs = *inputs[i];
+        const auto& sourcePosition = sourceInputs.source.origin;
+
+        if (sourceInputs.occlusionType == OcclusionType::Raycast)
+        {
+            setRay(mRayOffsets[i], listener.origin, sourcePosition);
+        }
+        else
+        {
+            auto numSamples = std::min(sourceInputs.numOcclusionSamples, static_cast<int>(mSphereVolumeSamples.size(0)));
+            const auto& update = mOcclusionUpdates[i];
+            Sphere sphere(sourcePosition, sourceInputs.occlusionRadius);
+
+            for (auto j = 0; j < update.numSamples; ++j)
+            {
+                auto sampleIndex = (update.firstSample + j) % numSamples;
+                auto sample = Sampling::transformSphereVolumeSample(mSphereVolumeSamples[sampleIndex], sphere);
+
+                if (update.traceSource)
+                {
+                    setRay(mRayOffsets[i] + 2 * j, sourcePosition, sample);
+                    setRay(mRayOffsets[i] + 2 * j + 1, listener.origin, sample);
+                }
+                else
+                {
+                    setRay(mRayOffsets[i] + j, listener.origin, sample);
+                }
+            }
+        }
     }
-    else
+
+    if (numRays > 0)
     {
-        directSoundPath.delay = 0.0f;
+        traceRays(*scene, numRays, false, scheduler);
     }
 
-    if (flags & CalcDirectivity)
+    for (auto i = 0; i < numSources; ++i)
     {
-        directSoundPath.directivity = directivity.evaluateAt(listener.origin, source);
+        const auto& sourceInputs = *inputs[i];
+        auto& directSoundPath = *directSoundPaths[i];
+
+        if (!scene || !(sourceInputs.flags & CalcOcclusion))
+        {
+            directSoundPath.occlusion = 1.0f;
+        }
+        else if (sourceInputs.occlusionType == OcclusionType::Raycast)
+        {
+            directSoundPath.occlusion = (mOccluded[mRayOffsets[i]]) ? 0.0f : 1.0f;
+        }
+        else if (sourceInputs.occlusionType == OcclusionType::Volumetric && sourceInputs.temporalOcclusion && states && states[i])
+        {
+            auto numSamples = std::max(std::min(sourceInputs.numOcclusionSamples, static_cast<int>(mSphereVolumeSamples.size(0))), 0);
+            const auto& update = mOcclusionUpdates[i];
+            auto& state = *states[i];
+
+            for (auto j = 0; j < update.numSamples; ++j)
+            {
+                auto sampleIndex = (update.firstSample + j) % numSamples;
+
+                if (update.traceSource)
+                {
+                    state.sourceVisible[sampleIndex] = !mOccluded[mRayOffsets[i] + 2 * j];
+                    state.listenerVisible[sampleIndex] = !mOccluded[mRayOffsets[i] + 2 * j + 1];
+                }
+                else
+                {
+                    state.listenerVisible[sampleIndex] = !mOccluded[mRayOffsets[i] + j];
+                }
+            }
+
+            directSoundPath.occlusion = finishOcclusionUpdate(update, numSamples, state);
+        }
+        else if (sourceInputs.occlusionType == OcclusionType::Volumetric)
+        {
+            auto numSamples = std::min(sourceInputs.numOcclusionSamples, static_cast<int>(mSphereVolumeSamples.size(0)));
+            auto occlusion = 0.0f;
+            auto numValidSamples = 0;
+
+            for (auto j = 0; j < numSamples; ++j)
+            {
+                if (mOccluded[mRayOffsets[i] + 2 * j])
+                    continue;
+
+                ++numValidSamples;
+
+                if (!mOccluded[mRayOffsets[i] + 2 * j + 1])
+                {
+                    occlusion += 1.0f;
+                }
+            }
+
+            directSoundPath.occlusion = (numValidSamples > 0) ? occlusion / numValidSamples : 0.0f;
+        }
+        else
+        {
+            directSoundPath.occlusion = 0.0f;
+        }
     }
-    else
+
+    // Transmission rays for a given source must be traced one after the other, since each ray starts where the
+    // previous one ended. So rays are traced in rounds, with each round tracing the next ray for every source that
+    // still needs one.
+    mTransmissionStates.resize(numSources);
+
+    for (auto i = 0; i < numSources; ++i)
     {
-        directSoundPath.directivity = 1.0f;
+        const auto& sourceInputs = *inputs[i];
+
+        if (scene && (sourceInputs.flags & CalcTransmission))
+        {
+            beginTransmission(listener.origin, sourceInputs.source.origin, sourceInputs.numTransmissionRays, mTransmissionStates[i]);
+        }
+        else
+        {
+            mTransmissionStates[i].numRaysRemaining = 0;
+        }
     }
 
-    // Constructor for DirectSoundPath sets the default value correctly.
-    if (scene && (flags & CalcOcclusion))
+    while (true)
     {
-        switch (occlusionType)
+        numRays = 0;
+        for (auto i = 0; i < numSources; ++i)
         {
-        case OcclusionType::Raycast:
-            directSoundPath.occlusion =
-                raycastOcclusion(*scene, listener.origin, source.origin);
-            break;
+            auto& state = mTransmissionStates[i];
 
-        case OcclusionType::Volumetric:
-            directSoundPath.occlusion =
-                volumetricOcclusion(*scene, listener.origin, source.origin, occlusionRadius, numOcclusionSamples);
-            break;
+            mRayOffsets[i] = -1;
 
-        default:
-            directSoundPath.occlusion = 0.0f;
+            if (state.numRaysRemaining <= 0)
+                continue;
+
+            mRayOffsets[i] = numRays++;
+        }
+
+        if (numRays == 0)
             break;
+
+        reserveRays(numRays);
+
+        for (auto i = 0; i < numSources; ++i)
+        {
+            if (mRayOffsets[i] < 0)
+                continue;
+
+            const auto& state = mTransmissionStates[i];
+            mRays[mRayOffsets[i]] = state.rays[state.currentRayIndex];
+            mMinDistances[mRayOffsets[i]] = state.minDistances[state.currentRayIndex];
+            mMaxDistances[mRayOffsets[i]] = state.maxDistance;
+        }
+
+        traceRays(*scene, numRays, true, scheduler);
+
+        for (auto i = 0; i < numSources; ++i)
+        {
+            if (mRayOffsets[i] < 0)
+                continue;
+
+            auto& state = mTransmissionStates[i];
+            if (!updateTransmission(mHits[mRayOffsets[i]], state))
+            {
+                state.numRaysRemaining = 0;
+            }
+        }
+    }
+
+    for (auto i = 0; i < numSources; ++i)
+    {
+        const auto& sourceInputs = *inputs[i];
+        auto& directSoundPath = *directSoundPaths[i];
+
+        if (scene && (sourceInputs.flags & CalcTransmission))
+        {
+            endTransmission(mTransmissionStates[i], directSoundPath.transmission);
         }
+        else
+        {
+            for (auto j = 0; j < Bands::kNumBands; ++j)
+            {
+                directSoundPath.transmission[j] = 1.0f;
+            }
+        }
+    }
+}
+
+float DirectSimulator::directPathDelay(const Vector3f& listener,
+                                       const Vector3f& source)
+{
+    return (source - listener).length() / PropagationMedium::kSpeedOfSound;
+}
+
+void DirectSimulator::simulateUnoccluded(DirectSimulationFlags flags,
+                                         const CoordinateSpace3f& source,
+                                         const CoordinateSpace3f& listener,
+                                         const DistanceAttenuationModel& distanceAttenuationModel,
+                                         const AirAbsorptionModel& airAbsorptionModel,
+                                         const Directivity& directivity,
+                                         DirectSoundPath& directSoundPath)
+{
+    auto distance = (source.origin - listener.origin).length();
+
+    if (flags & CalcDistanceAttenuation)
+    {
+        directSoundPath.distanceAttenuation = distanceAttenuationModel.evaluate(distance);
     }
     else
     {
-        directSoundPath.occlusion = 1.0f;
+        directSoundPath.distanceAttenuation = 1.0f;
     }
 
-    if (scene && (flags & CalcTransmission))
+    if (flags & CalcAirAbsorption)
     {
-        transmission(*scene, listener.origin, source.origin, directSoundPath.transmission, numTransmissionRays);
+        for (auto i = 0; i < Bands::kNumBands; ++i)
+        {
+            directSoundPath.airAbsorption[i] = airAbsorptionModel.evaluate(distance, i);
+        }
     }
     else
     {
         for (auto i = 0; i < Bands::kNumBands; ++i)
         {
-            directSoundPath.transmission[i] = 1.0f;
+            directSoundPath.airAbsorption[i] = 1.0f;
         }
     }
-}
 
-float DirectSimulator::directPathDelay(const Vector3f& listener,
-                                       const Vector3f& source)
-{
-    return (source - listener).length() / PropagationMedium::kSpeedOfSound;
+    if (flags & CalcDelay)
+    {
+        directSoundPath.delay = directPathDelay(listener.origin, source.origin);
+    }
+    else
+    {
+        directSoundPath.delay = 0.0f;
+    }
+
+    if (flags & CalcDirectivity)
+    {
+        directSoundPath.directivity = directivity.evaluateAt(listener.origin, source);
+    }
+    else
+    {
+        directSoundPath.directivity = 1.0f;
+    }
 }
 
 float DirectSimulator::raycastOcclusion(const IScene& scene,
@@ -182,6 +459,120 @@ float DirectSimulator::volumetricOcclusion(const IScene& scene,
     return occlusion / numValidSamples;
 }
 
+DirectSimulator::OcclusionUpdate DirectSimulator::planOcclusionUpdate(const DirectSimulationInputs& inputs,
+                                                                     const Vector3f& listenerPosition,
+                                                                     uint32_t sceneVersion,
+                                                                     int numSamples,
+                                                                     DirectSimulationState& state)
+{
+    if (static_cast<int>(state.sourceVisible.size(0)) < numSamples)
+    {
+        state.sourceVisible.resize(numSamples);
+        state.listenerVisible.resize(numSamples);
+        state.valid = false;
+    }
+
+    auto sourceMovement = (inputs.source.origin - state.prevSource).length();
+    auto listenerMovement = (listenerPosition - state.prevListener).length();
+    auto maxMovement = std::max(inputs.occlusionRadius, kTemporalOcclusionMinMovement);
+
+    // If the sampling parameters have changed, or an endpoint has moved by more than the size of the source, the
+    // cached visibility is unlikely to be useful, so all samples are traced again right away.
+    if (!state.valid ||
+        numSamples != state.prevNumOcclusionSamples ||
+        inputs.occlusionRadius != state.prevOcclusionRadius ||
+        sourceMovement > maxMovement ||
+        listenerMovement > maxMovement)
+    {
+        state.valid = false;
+        state.nextSample = 0;
+        state.numStaleSamples = numSamples;
+        state.sourceStale = true;
+    }
+    else
+    {
+        auto sourceChanged = (sourceMovement > kTemporalOcclusionMinMovement) || (sceneVersion != state.prevSceneVersion);
+        auto listenerChanged = (listenerMovement > kTemporalOcclusionMinMovement);
+
+        if (sourceChanged || listenerChanged)
+        {
+            state.numStaleSamples = numSamples;
+            state.sourceStale = state.sourceStale || sourceChanged;
+        }
+    }
+
+    state.prevSource = inputs.source.origin;
+    state.prevListener = listenerPosition;
+    state.prevSceneVersion = sceneVersion;
+    state.prevOcclusionRadius = inputs.occlusionRadius;
+    state.prevNumOcclusionSamples = numSamples;
+
+    state.numSamplesPerUpdate = std::max(minOcclusionSamplesPerUpdate(numSamples), std::min(state.numSamplesPerUpdate, numSamples));
+
+    OcclusionUpdate update;
+    update.firstSample = state.nextSample;
+    update.numSamples = (state.valid) ? std::min(state.numSamplesPerUpdate, state.numStaleSamples) : state.numStaleSamples;
+    update.traceSource = state.sourceStale;
+    return update;
+}
+
+float DirectSimulator::finishOcclusionUpdate(const OcclusionUpdate& update,
+                                             int numSamples,
+                                             DirectSimulationState& state)
+{
+    if (numSamples <= 0)
+        return 0.0f;
+
+    state.nextSample = (update.firstSample + update.numSamples) % numSamples;
+    state.numStaleSamples -= update.numSamples;
+    if (state.numStaleSamples <= 0)
+    {
+        state.numStaleSamples = 0;
+        state.sourceStale = false;
+        state.valid = true;
+    }
+
+    auto occlusion = 0.0f;
+    auto numValidSamples = 0;
+
+    for (auto i = 0; i < numSamples; ++i)
+    {
+        if (!state.sourceVisible[i])
+            continue;
+
+        ++numValidSamples;
+
+        if (state.listenerVisible[i])
+        {
+            occlusion += 1.0f;
+        }
+    }
+
+    occlusion = (numValidSamples > 0) ? occlusion / numValidSamples : 0.0f;
+
+    // Trace more samples while occlusion is changing quickly, so the cached visibility catches up sooner, and fewer
+    // samples once it has settled.
+    if (update.numSamples > 0)
+    {
+        if (fabsf(occlusion - state.occlusion) > kTemporalOcclusionChangeThreshold)
+        {
+            state.numSamplesPerUpdate = std::min(2 * state.numSamplesPerUpdate, numSamples);
+        }
+        else
+        {
+            state.numSamplesPerUpdate = std::max(state.numSamplesPerUpdate / 2, minOcclusionSamplesPerUpdate(numSamples));
+        }
+    }
+
+    state.occlusion = occlusion;
+    return occlusion;
+}
+
+int DirectSimulator::minOcclusionSamplesPerUpdate(int numSamples)
+{
+    return std::max(1, (numSamples + kTemporalOcclusionMaxUpdateInterval - 1) / kTemporalOcclusionMaxUpdateInterval);
+}
+
 void DirectSimulator::transmission(const IScene& scene,
                                    const Vector3f& listenerPosition,
                                    const Vector3f& sourcePosition,
@@ -190,69 +581,89 @@ void DirectSimulator::transmission(const IScene& scene,
 {
     assert(numTransmissionRays > 0);
 
-    // If, after finding a hit point, we want to continue tracing the ray towards the
-    // source, then offset the ray origin by this distance along the ray direction, to
-    // prevent self-intersection.
-    constexpr auto kRayOffset = 1e-2f;
+    TransmissionState state;
+    beginTransmission(listenerPosition, sourcePosition, numTransmissionRays, state);
+
+    while (state.numRaysRemaining > 0)
+    {
+        auto hit = scene.closestHit(state.rays[state.currentRayIndex], state.minDistances[state.currentRayIndex], state.maxDistance);
+
+        if (!updateTransmission(hit, state))
+            break;
+    }
+
+    endTransmission(state, transmissionFactors);
+}
 
+void DirectSimulator::beginTransmission(const Vector3f& listenerPosition,
+                                        const Vector3f& sourcePosition,
+                                        int numTransmissionRays,
+                                        TransmissionState& state)
+{
     // We will alternate between tracing a ray from the listener to the source, and from the source to the listener.
     // The motivation is that if the listener observes the source go behind an object, then that object's material is
     // most relevant in terms of the expected amount of transmitted sound, even if there are multiple other occluders
     // between the source and the listener.
-    Ray rays[] = {
-        Ray{listenerPosition, Vector3f::unitVector(sourcePosition - listenerPosition)},
-        Ray{sourcePosition, Vector3f::unitVector(listenerPosition - sourcePosition)},
-    };
-
-    auto currentRayIndex = 0;
-    auto numHits = 0;
-    float minDistances[] = {0.0f, 0.0f};
-    auto maxDistance = (sourcePosition - listenerPosition).length();
+    state.rays[0] = Ray{listenerPosition, Vector3f::unitVector(sourcePosition - listenerPosition)};
+    state.rays[1] = Ray{sourcePosition, Vector3f::unitVector(listenerPosition - sourcePosition)};
+    state.minDistances[0] = 0.0f;
+    state.minDistances[1] = 0.0f;
+    state.maxDistance = (sourcePosition - listenerPosition).length();
+    state.currentRayIndex = 0;
+    state.numHits = 0;
+    state.numRaysRemaining = numTransmissionRays;
 
     // Product of the transmission coefficients of all hit points.
-    float accumulatedTransmission[Bands::kNumBands] = {1.0f, 1.0f, 1.0f};
-
-    for (auto i = 0; i < numTransmissionRays; ++i)
+    for (auto i = 0; i < Bands::kNumBands; ++i)
     {
-        // Select the ray we want to trace for this iteration.
-        const auto& ray = rays[currentRayIndex];
-        auto& minDistance = minDistances[currentRayIndex];
+        state.accumulatedTransmission[i] = 1.0f;
+    }
+}
 
-        auto hit = scene.closestHit(ray, minDistance, maxDistance);
+bool DirectSimulator::updateTransmission(const Hit& hit,
+                                         TransmissionState& state)
+{
+    --state.numRaysRemaining;
 
-        // If there's nothing more between the ray origin and the source, stop.
-        if (!hit.isValid())
-            break;
+    // If there's nothing more between the ray origin and the source, stop.
+    if (!hit.isValid())
+        return false;
 
-        numHits++;
+    state.numHits++;
 
-        // Accumulate the product of the transmission coefficients of all materials
-        // encountered so far.
-        for (auto j = 0; j < Bands::kNumBands; ++j)
-        {
-            accumulatedTransmission[j] *= hit.material->transmission[j];
-        }
+    // Accumulate the product of the transmission coefficients of all materials
+    // encountered so far.
+    for (auto i = 0; i < Bands::kNumBands; ++i)
+    {
+        state.accumulatedTransmission[i] *= hit.material->transmission[i];
+    }
 
-        // Calculate the origin of the next ray segment we'll trace, if any.
-        minDistance = hit.distance + kRayOffset;
-        if (minDistance >= maxDistance)
-            break;
+    // Calculate the origin of the next ray segment we'll trace, if any.
+    auto& minDistance = state.minDistances[state.currentRayIndex];
+    minDistance = hit.distance + kTransmissionRayOffset;
+    if (minDistance >= state.maxDistance)
+        return false;
 
-        // If the total distance traveled by both rays is greater than the distance between the source and the
-        // listener, then the rays have crossed, so stop.
-        if ((minDistances[0] + minDistances[1]) >= maxDistance)
-            break;
+    // If the total distance traveled by both rays is greater than the distance between the source and the
+    // listener, then the rays have crossed, so stop.
+    if ((state.minDistances[0] + state.minDistances[1]) >= state.maxDistance)
+        return false;
 
-        // Switch to the other ray for the next iteration.
-        currentRayIndex = 1 - currentRayIndex;
-    }
+    // Switch to the other ray for the next iteration.
+    state.currentRayIndex = 1 - state.currentRayIndex;
+
+    return (state.numRaysRemaining > 0);
+}
 
-    if (numHits <= 1)
+void DirectSimulator::endTransmission(const TransmissionState& state,
+                                      float* transmissionFactors)
+{
+    if (state.numHits <= 1)
     {
         // If we have only 1 hit, then use the transmission coefficients of that material.
         // If we have no hits, this will automatically set the transmission coefficients to
         // [1, 1, 1] (i.e., 100% transmission).
-        memcpy(transmissionFactors, accumulatedTransmission, Bands::kNumBands * sizeof(float));
+        memcpy(transmissionFactors, state.accumulatedTransmission, Bands::kNumBands * sizeof(float));
     }
     else
     {
@@ -262,9 +673,77 @@ void DirectSimulator::transmission(const IScene& scene,
         // double-counting the transmission due to both sides of the wall.
         for (auto i = 0; i < Bands::kNumBands; ++i)
         {
-            transmissionFactors[i] = sqrtf(accumulatedTransmission[i]);
+            transmissionFactors[i] = sqrtf(state.accumulatedTransmission[i]);
+        }
+    }
+}
+
+void DirectSimulator::setRay(int index,
+                             const Vector3f& from,
+                             const Vector3f& to)
+{
+    // Same as IScene::isOccluded.
+    mRays[index] = Ray{from, Vector3f::unitVector(to - from)};
+    mMinDistances[index] = 0.0f;
+    mMaxDistances[index] = (to - from).length();
+}
+
+void DirectSimulator::reserveRays(int numRays)
+{
+    if (static_cast<int>(mRays.size(0)) >= numRays)
+        return;
+
+    mRays.resize(numRays);
+    mMinDistances.resize(numRays);
+    mMaxDistances.resize(numRays);
+    mOccluded.resize(numRays);
+    mHits.resize(numRays);
+}
+
+void DirectSimulator::traceRays(const IScene& scene,
+                                int numRays,
+                                bool closestHits,
+                                JobScheduler* scheduler)
+{
+    auto traceBatch = [this, &scene, closestHits](int start, int end)
+    {
+        if (closestHits)
+        {
+            scene.closestHits(end - start, &mRays[start], &mMinDistances[start], &mMaxDistances[start], &mHits[start]);
         }
+        else
+        {
+            scene.anyHits(end - start, &mRays[start], &mMinDistances[start], &mMaxDistances[start], &mOccluded[start]);
+        }
+    };
+
+    auto numJobs = 1;
+    if (scheduler)
+    {
+        numJobs = std::min(scheduler->numThreads(), (numRays + kMinRaysPerJob - 1) / kMinRaysPerJob);
     }
+
+    if (numJobs <= 1)
+    {
+        traceBatch(0, numRays);
+        return;
+    }
+
+    mJobGraph.reset();
+
+    for (auto i = 0; i < numJobs; ++i)
+    {
+        auto start = static_cast<int>((static_cast<int64_t>(numRays) * i) / numJobs);
+        auto end = static_cast<int>((static_cast<int64_t>(numRays) * (i + 1)) / numJobs);
+
+        mJobGraph.addJob([&traceBatch, start, end](int threadId, std::atomic<bool>& cancel)
+        {
+            traceBatch(start, end);
+        });
+    }
+
+    scheduler->submit(mJobGraph);
+    scheduler->wait(mJobGraph);
 }
 
 }
@@ -20,6 +20,7 @@
 #include "coordinate_space.h"
 #include "directivity.h"
 #include "distance_attenuation.h"
+#include "job_scheduler.h"
 #include "propagation_medium.h"
 #include "sampling.h"
 #include "scene.h"
@@ -57,6 +58,44 @@ struct DirectSoundPath
     float directivity;
 };
 
+// Inputs for simulating direct sound from a single source.
+struct DirectSimulationInputs
+{
+    DirectSimulationFlags flags;
+    CoordinateSpace3f source;
+    DistanceAttenuationModel distanceAttenuationModel;
+    AirAbsorptionModel airAbsorptionModel;
+    Directivity directivity;
+    OcclusionType occlusionType;
+    float occlusionRadius;
+    int numOcclusionSamples;
+    int numTransmissionRays;
+    bool temporalOcclusion; // If true, volumetric occlusion is amortized over multiple simulation runs.
+};
+
+// State carried over between simulation runs for a single source, used when volumetric occlusion is amortized over
+// time. The visibility of each occlusion sample is cached, and only some of the samples are traced again in each
+// simulation run, in rotation. Nothing is traced if the source, the listener, and the scene have not changed since
+// all samples were last traced.
+struct DirectSimulationState
+{
+    bool valid; // False until all samples have been traced at least once.
+    Vector3f prevSource;
+    Vector3f prevListener;
+    uint32_t prevSceneVersion;
+    float prevOcclusionRadius;
+    int prevNumOcclusionSamples;
+    Array<bool> sourceVisible; // For each sample, whether it was visible from the source when last traced.
+    Array<bool> listenerVisible; // For each sample, whether it was visible from the listener when last traced.
+    int nextSample; // Index of the next sample to trace.
+    int numStaleSamples; // Number of samples that have not been traced since the last change.
+    bool sourceStale; // True if the source-to-sample rays of stale samples need to be traced again.
+    int numSamplesPerUpdate; // Number of stale samples traced per simulation run. Adapts to how quickly occlusion changes.
+    float occlusion; // Occlusion value calculated in the previous simulation run.
+
+    DirectSimulationState();
+};
+
 // Encapsulates the state required to simulate direct sound, including distance attenuation, air absorption,
 // partial occlusion, and propagation delays.
 class DirectSimulator
@@ -77,11 +116,80 @@ public:
                   int numTransmissionRays,
                   DirectSoundPath& directSoundPath);
 
+    // Simulates direct sound for several sources at once. The occlusion rays for all sources are gathered into a
+    // single stream and traced together, as are the transmission rays. If a scheduler is specified, each stream is
+    // split into batches that are traced in parallel. The results are the same as calling simulate() for each source,
+    // except for sources that use temporally amortized volumetric occlusion, whose state is read from and written to
+    // the corresponding element of states.
+    void simulate(const IScene* scene,
+                  int numSources,
+                  const DirectSimulationInputs* const* inputs,
+                  DirectSimulationState* const* states,
+                  const CoordinateSpace3f& listener,
+                  DirectSoundPath* const* directSoundPaths,
+                  JobScheduler* scheduler);
+
     static float directPathDelay(const Vector3f& listener,
                                  const Vector3f& source);
 
 private:
+    // When tracing transmission rays beyond a hit point, the ray origin is offset by this distance along the ray
+    // direction, to prevent self-intersection.
+    static const float kTransmissionRayOffset;
+
+    // Minimum number of rays traced by a single job when tracing rays for several sources at once.
+    static const int kMinRaysPerJob;
+
+    // With temporally amortized occlusion, an endpoint is considered to have moved if it moves by more than this
+    // distance (in meters).
+    static const float kTemporalOcclusionMinMovement;
+
+    // With temporally amortized occlusion, if the occlusion value changes by more than this amount between
+    // simulation runs, the number of samples traced per simulation run is doubled. Otherwise, it is halved.
+    static const float kTemporalOcclusionChangeThreshold;
+
+    // With temporally amortized occlusion, the minimum number of samples traced per simulation run is the number of
+    // samples divided by this value, so all samples are traced at least this often.
+    static const int kTemporalOcclusionMaxUpdateInterval;
+
+    // The samples whose rays are traced for a single source, in the current stream of occlusion rays.
+    struct OcclusionUpdate
+    {
+        int firstSample;
+        int numSamples;
+        bool traceSource; // If false, only the listener-to-sample rays are traced.
+    };
+
+    // Intermediate state used when tracing transmission rays for a single source.
+    struct TransmissionState
+    {
+        Ray rays[2];
+        float minDistances[2];
+        float maxDistance;
+        int currentRayIndex;
+        int numHits;
+        int numRaysRemaining;
+        float accumulatedTransmission[Bands::kNumBands];
+    };
+
     Array<Vector3f> mSphereVolumeSamples;
+    Array<Ray> mRays;
+    Array<float> mMinDistances;
+    Array<float> mMaxDistances;
+    Array<bool> mOccluded;
+    Array<Hit> mHits;
+    vector<int> mRayOffsets; // For each source, index of its first ray in the current stream, or -1 if it has none.
+    vector<OcclusionUpdate> mOcclusionUpdates;
+    vector<TransmissionState> mTransmissionStates;
+    JobGraph mJobGraph;
+
+    void simulateUnoccluded(DirectSimulationFlags flags,
+                            const CoordinateSpace3f& source,
+                            const CoordinateSpace3f& listener,
+                            const DistanceAttenuationModel& distanceAttenuationModel,
+                            const AirAbsorptionModel& airAbsorptionModel,
+                            const Directivity& directivity,
+                            DirectSoundPath& directSoundPath);
 
     float raycastOcclusion(const IScene& scene,
                            const Vector3f& listenerPosition,
@@ -98,6 +206,44 @@ private:
                       const Vector3f& sourcePosition,
                       float* transmissionFactors,
                       int numTransmissionRays);
+
+    static OcclusionUpdate planOcclusionUpdate(const DirectSimulationInputs& inputs,
+                                               const Vector3f& listenerPosition,
+                                               uint32_t sceneVersion,
+                                               int numSamples,
+                                               DirectSimulationState& state);
+
+    static float finishOcclusionUpdate(const OcclusionUpdate& update,
+                                       int numSamples,
+                                       DirectSimulationState& state);
+
+    // Returns the smallest number of samples that can be traced per simulation run, such that every sample is traced
+    // at least once every kTemporalOcclusionMaxUpdateInterval runs.
+    static int minOcclusionSamplesPerUpdate(int numSamples);
+
+    static void beginTransmission(const Vector3f& listenerPosition,
+                                  const Vector3f& sourcePosition,
+                                  int numTransmissionRays,
+                                  TransmissionState& state);
+
+    // Updates the transmission state with the result of tracing the current ray. Returns true if more rays need to
+    // be traced.
+    static bool updateTransmission(const Hit& hit,
+                                   TransmissionState& state);
+
+    static void endTransmission(const TransmissionState& state,
+                                float* transmissionFactors);
+
+    void setRay(int index,
+                const Vector3f& from,
+                const Vector3f& to);
+
+    void reserveRays(int numRays);
+
+    void traceRays(const IScene& scene,
+                   int numRays,
+                   bool closestHits,
+                   JobScheduler* scheduler);
 };
 
 }
@@ -27,12 +27,15 @@ namespace ipl {
 // --------------------------------------------------------------------------------------------------------------------
 
 const float EnergyField::kBinDuration = 1e-2f;
+const float EnergyField::kMinRelativeBinValue = 1e-3f;
 
 EnergyField::EnergyField(float duration,
                          int order)
 {
     mData.resize(SphericalHarmonics::numCoeffsForOrder(order), Bands::kNumBands,
                  static_cast<int>(ceilf(duration / kBinDuration)));
+    mDirtyBins.resize(numBins());
+    mBinChanges.resize(numBins());
 
     reset();
 }
@@ -48,13 +51,64 @@ EnergyField::EnergyField(const Serialized::EnergyField* serializedObject)
     auto numBins = serializedObject->num_bins();
 
     mData.resize(numChannels, Bands::kNumBands, numBins);
+    mDirtyBins.resize(numBins);
+    mBinChanges.resize(numBins);
 
     memcpy(mData.flatData(), serializedObject->data()->data(), mData.totalSize() * sizeof(float));
+
+    markAllBinsDirty();
+}
+
+EnergyField::EnergyField(const EnergyField& other)
+{
+    mData.resize(other.numChannels(), Bands::kNumBands, other.numBins());
+    mDirtyBins.resize(other.numBins());
+    mBinChanges.resize(other.numBins());
+
+    memcpy(mData.flatData(), other.mData.flatData(), mData.totalSize() * sizeof(float));
+
+    markAllBinsDirty();
 }
 
 void EnergyField::reset()
 {
     mData.zero();
+
+    markAllBinsDirty();
+}
+
+bool EnergyField::hasDirtyBins() const
+{
+    for (auto i = 0; i < numBins(); ++i)
+    {
+        if (mDirtyBins[i])
+            return true;
+    }
+
+    return false;
+}
+
+void EnergyField::markAllBinsDirty()
+{
+    for (auto i = 0; i < numBins(); ++i)
+    {
+        mDirtyBins[i] = true;
+    }
+
+    mBinChanges.zero();
+}
+
+void EnergyField::clearDirtyBins()
+{
+    // Bins that are not dirty keep their accumulated change, so that many small changes eventually mark them dirty.
+    for (auto i = 0; i < numBins(); ++i)
+    {
+        if (mDirtyBins[i])
+        {
+            mDirtyBins[i] = false;
+            mBinChanges[i] = 0.0f;
+        }
+    }
 }
 
 uint64_t EnergyField::serializedSize() const
@@ -84,6 +138,8 @@ void EnergyField::copyFrom(const EnergyField& other)
             memcpy(mData[i][j], other.mData[i][j], numBinsToCopy * sizeof(float));
         }
     }
+
+    markAllBinsDirty();
 }
 
 void EnergyField::add(const EnergyField& in1,
@@ -134,4 +190,82 @@ void EnergyField::scaleAccumulate(const EnergyField& in,
     }
 }
 
+void EnergyField::scaleAccumulate(const Serialized::EnergyField* in,
+                                  float scalar,
+                                  EnergyField& out)
+{
+    assert(in);
+    assert(in->data());
+
+    auto numChannels = std::min(in->num_channels(), out.numChannels());
+    auto numBins = std::min(in->num_bins(), out.numBins());
+
+    const auto* data = in->data()->data();
+
+    for (auto i = 0; i < numChannels; ++i)
+    {
+        for (auto j = 0; j < Bands::kNumBands; ++j)
+        {
+            ArrayMath::scaleAccumulate(numBins, &data[(i * Bands::kNumBands + j) * in->num_bins()], scalar, out[i][j]);
+        }
+    }
+}
+
+void EnergyField::accumulate(const EnergyField& in,
+                             int numFramesAccumulated,
+                             float changeThreshold,
+                             EnergyField& accum)
+{
+    auto numChannels = std::min({in.numChannels(), accum.numChannels()});
+    auto numBins = std::min({in.numBins(), accum.numBins()});
+
+    auto weight = 1.0f / (1.0f + numFramesAccumulated);
+    auto maxValueSquared = 0.0f;
+
+    for (auto k = 0; k < numBins; ++k)
+    {
+        auto changeSquared = 0.0f;
+        auto valueSquared = 0.0f;
+
+        for (auto i = 0; i < numChannels; ++i)
+        {
+            for (auto j = 0; j < Bands::kNumBands; ++j)
+            {
+                auto change = weight * (in[i][j][k] - accum[i][j][k]);
+                accum[i][j][k] += change;
+
+                changeSquared += change * change;
+                valueSquared += accum[i][j][k] * accum[i][j][k];
+            }
+        }
+
+        accum.mBinChanges[k] += sqrtf(changeSquared);
+        maxValueSquared = std::max(maxValueSquared, valueSquared);
+    }
+
+    // Changes are measured relative to the bin itself, but bins much quieter than the loudest bin are compared
+    // against a floor instead, so the noisy, near-silent tail doesn't keep getting marked dirty.
+    auto minValue = kMinRelativeBinValue * sqrtf(maxValueSquared);
+
+    for (auto k = 0; k < numBins; ++k)
+    {
+        if (accum.mDirtyBins[k])
+            continue;
+
+        auto valueSquared = 0.0f;
+        for (auto i = 0; i < numChannels; ++i)
+        {
+            for (auto j = 0; j < Bands::kNumBands; ++j)
+            {
+                valueSquared += accum[i][j][k] * accum[i][j][k];
+            }
+        }
+
+        if (accum.mBinChanges[k] > changeThreshold * std::max(sqrtf(valueSquared), minValue))
+        {
+            accum.mDirtyBins[k] = true;
+        }
+    }
+}
+
 }
@@ -37,6 +37,8 @@ public:
 
     EnergyField(const Serialized::EnergyField* serializedObject);
 
+    EnergyField(const EnergyField& other);
+
     virtual ~EnergyField()
     {}
 
@@ -92,6 +94,20 @@ public:
 
     virtual void reset();
 
+    // Returns true if the given bin has changed significantly since the last call to clearDirtyBins.
+    bool isBinDirty(int bin) const
+    {
+        return mDirtyBins[bin];
+    }
+
+    bool hasDirtyBins() const;
+
+    // Marks all bins as changed. Must be called whenever the energy field is modified other than through accumulate.
+    void markAllBinsDirty();
+
+    // Clears the dirty flag of all bins, e.g. after an impulse response has been reconstructed from this energy field.
+    void clearDirtyBins();
+
     uint64_t serializedSize() const;
 
     flatbuffers::Offset<Serialized::EnergyField> serialize(SerializedObject& serializedObject) const;
@@ -110,8 +126,27 @@ public:
                                 float scalar,
                                 EnergyField& out);
 
+    // Same as above, but reads the input directly from serialized data (for example, a memory-mapped file), without
+    // copying it into an EnergyField first.
+    static void scaleAccumulate(const Serialized::EnergyField* in,
+                                float scalar,
+                                EnergyField& out);
+
+    // Updates a running average over numFramesAccumulated frames with a new frame of data. Tracks the L2 norm of the
+    // change in each bin (over all channels and bands) since its dirty flag was last cleared, and marks the bin as
+    // dirty once this exceeds changeThreshold times the L2 norm of the bin (or kMinRelativeBinValue times that of the
+    // loudest bin, whichever is larger).
+    static void accumulate(const EnergyField& in,
+                           int numFramesAccumulated,
+                           float changeThreshold,
+                           EnergyField& accum);
+
 protected:
+    static const float kMinRelativeBinValue;
+
     Array<float, 3> mData;
+    Array<bool> mDirtyBins;
+    Array<float> mBinChanges;
 };
 
 }
@@ -24,17 +24,65 @@ namespace ipl {
 // ImpulseResponse
 // --------------------------------------------------------------------------------------------------------------------
 
+const int ImpulseResponse::kModifiedChunkSize = 64;
+
 ImpulseResponse::ImpulseResponse(float duration,
                                  int order,
                                  int samplingRate)
 {
     mData.resize(SphericalHarmonics::numCoeffsForOrder(order), static_cast<int>(ceilf(duration * samplingRate)));
+    mModifiedChunks.resize((numSamples() + kModifiedChunkSize - 1) / kModifiedChunkSize);
     reset();
 }
 
 void ImpulseResponse::reset()
 {
     mData.zero();
+
+    markModified(0, numSamples());
+}
+
+void ImpulseResponse::markModified(int beginSample,
+                                   int endSample)
+{
+    auto numChunks = static_cast<int>(mModifiedChunks.size(0));
+    auto beginChunk = std::max(beginSample / kModifiedChunkSize, 0);
+    auto endChunk = std::min((endSample + kModifiedChunkSize - 1) / kModifiedChunkSize, numChunks);
+
+    for (auto i = beginChunk; i < endChunk; ++i)
+    {
+        mModifiedChunks[i] = true;
+    }
+}
+
+bool ImpulseResponse::isModified(int beginSample,
+                                 int endSample) const
+{
+    auto numChunks = static_cast<int>(mModifiedChunks.size(0));
+    auto beginChunk = std::max(beginSample / kModifiedChunkSize, 0);
+    auto endChunk = std::min((endSample + kModifiedChunkSize - 1) / kModifiedChunkSize, numChunks);
+
+    for (auto i = beginChunk; i < endChunk; ++i)
+    {
+        if (mModifiedChunks[i])
+            return true;
+    }
+
+    return false;
+}
+
+void ImpulseResponse::clearModified(int beginSample,
+                                    int endSample)
+{
+    // Only chunks that lie entirely within the range are cleared, so modifications outside it are never lost.
+    auto numChunks = static_cast<int>(mModifiedChunks.size(0));
+    auto beginChunk = std::max((beginSample + kModifiedChunkSize - 1) / kModifiedChunkSize, 0);
+    auto endChunk = (endSample >= numSamples()) ? numChunks : std::min(endSample / kModifiedChunkSize, numChunks);
+
+    for (auto i = beginChunk; i < endChunk; ++i)
+    {
+        mModifiedChunks[i] = false;
+    }
 }
 
 }
@@ -66,8 +66,22 @@ public:
 
     virtual void reset();
 
+    // Tracks which samples (in all channels) have been modified since they were last consumed, e.g. by partitioning
+    // for convolution. Tracking is done in chunks of kModifiedChunkSize samples.
+    void markModified(int beginSample,
+                      int endSample);
+
+    bool isModified(int beginSample,
+                    int endSample) const;
+
+    void clearModified(int beginSample,
+                       int endSample);
+
 protected:
+    static const int kModifiedChunkSize;
+
     Array<float, 2> mData;
+    Array<bool> mModifiedChunks;
 };
 
 }
@@ -29,7 +29,19 @@ IndirectEffect::IndirectEffect(const AudioSettings& audioSettings,
     switch (effectSettings.type)
     {
     case IndirectEffectType::Convolution:
-        mConvolutionEffect = make_unique<OverlapSaveConvolutionEffect>(audioSettings, OverlapSaveConvolutionEffectSettings{effectSettings.numChannels, effectSettings.irSize});
+        if (effectSettings.nonUniformPartitioning)
+        {
+            NonUniformConvolutionEffectSettings nonUniformSettings{};
+            nonUniformSettings.numChannels = effectSettings.numChannels;
+            nonUniformSettings.irSize = effectSettings.irSize;
+            nonUniformSettings.jobQueue = effectSettings.jobQueue;
+
+            mNonUniformConvolutionEffect = make_unique<NonUniformConvolutionEffect>(audioSettings, nonUniformSettings);
+        }
+        else
+        {
+            mConvolutionEffect = make_unique<OverlapSaveConvolutionEffect>(audioSettings, OverlapSaveConvolutionEffectSettings{effectSettings.numChannels, effectSettings.irSize});
+        }
         break;
 
     case IndirectEffectType::Parametric:
@@ -56,7 +68,14 @@ void IndirectEffect::reset()
     switch (mType)
     {
     case IndirectEffectType::Convolution:
-        mConvolutionEffect->reset();
+        if (mNonUniformConvolutionEffect)
+        {
+            mNonUniformConvolutionEffect->reset();
+        }
+        else
+        {
+            mConvolutionEffect->reset();
+        }
         break;
 
     case IndirectEffectType::Parametric:
@@ -95,6 +114,9 @@ AudioEffectState IndirectEffect::apply(const IndirectEffectParams& params,
         overlapSaveParams.numChannels = params.numChannels;
         overlapSaveParams.numSamples = params.numSamples;
 
+        if (mNonUniformConvolutionEffect)
+            return mNonUniformConvolutionEffect->apply(overlapSaveParams, in, out);
+
         return mConvolutionEffect->apply(overlapSaveParams, in, out);
     }
     else if (mType == IndirectEffectType::Parametric)
@@ -134,6 +156,9 @@ AudioEffectState IndirectEffect::apply(const IndirectEffectParams& params,
         overlapSaveParams.numChannels = params.numChannels;
         overlapSaveParams.numSamples = params.numSamples;
 
+        if (mNonUniformConvolutionEffect)
+            return mNonUniformConvolutionEffect->apply(overlapSaveParams, in, mixer.convolutionMixer());
+
         return mConvolutionEffect->apply(overlapSaveParams, in, mixer.convolutionMixer());
     }
 #if defined(IPL_USES_TRUEAUDIONEXT)
@@ -155,6 +180,8 @@ AudioEffectState IndirectEffect::tail(AudioBuffer& out)
     switch (mType)
     {
     case IndirectEffectType::Convolution:
+        if (mNonUniformConvolutionEffect)
+            return mNonUniformConvolutionEffect->tail(out);
         return mConvolutionEffect->tail(out);
     case IndirectEffectType::Parametric:
         return mParametricEffect->tail(out);
@@ -170,6 +197,8 @@ AudioEffectState IndirectEffect::tail(IndirectMixer& mixer)
     switch (mType)
     {
     case IndirectEffectType::Convolution:
+        if (mNonUniformConvolutionEffect)
+            return mNonUniformConvolutionEffect->tail(mixer.convolutionMixer());
         return mConvolutionEffect->tail(mixer.convolutionMixer());
 #if defined(IPL_USES_TRUEAUDIONEXT)
     case IndirectEffectType::TrueAudioNext:
@@ -185,6 +214,8 @@ int IndirectEffect::numTailSamplesRemaining() const
     switch (mType)
     {
     case IndirectEffectType::Convolution:
+        if (mNonUniformConvolutionEffect)
+            return mNonUniformConvolutionEffect->numTailSamplesRemaining();
         return mConvolutionEffect->numTailSamplesRemaining();
     case IndirectEffectType::Parametric:
         return mParametricEffect->numTailSamplesRemaining();
@@ -18,6 +18,7 @@
 
 #include "audio_buffer.h"
 #include "hybrid_reverb_effect.h"
+#include "non_uniform_convolution_effect.h"
 #include "overlap_save_convolution_effect.h"
 #include "reverb_effect.h"
 #include "tan_device.h"
@@ -42,6 +43,8 @@ struct IndirectEffectSettings
     IndirectEffectType type = IndirectEffectType::Convolution;
     int numChannels = 0;
     int irSize = 0;
+    bool nonUniformPartitioning = false; // For Convolution. Uses NonUniformConvolutionEffect.
+    shared_ptr<BackgroundJobQueue> jobQueue; // For nonUniformPartitioning. Runs the jobs for the tail partitions.
 };
 
 struct IndirectEffectParams
@@ -89,6 +92,7 @@ public:
 private:
     IndirectEffectType mType;
     unique_ptr<OverlapSaveConvolutionEffect> mConvolutionEffect;
+    unique_ptr<NonUniformConvolutionEffect> mNonUniformConvolutionEffect;
     unique_ptr<ReverbEffect> mParametricEffect;
     unique_ptr<HybridReverbEffect> mHybridEffect;
 #if defined(IPL_USES_TRUEAUDIONEXT)
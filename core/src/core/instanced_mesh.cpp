@@ -89,6 +89,72 @@ bool InstancedMesh::anyHit(const Ray& ray,
     return mSubScene->anyHit(transformedRay, minDistance, maxDistance);
 }
 
+void InstancedMesh::closestHits(int numRays,
+                                const Ray* rays,
+                                const float* minDistances,
+                                const float* maxDistances,
+                                Hit* hits) const
+{
+    assert(numRays <= BVH::kPacketSize);
+
+    Ray transformedRays[BVH::kPacketSize];
+    float transformedMinDistances[BVH::kPacketSize];
+    float transformedMaxDistances[BVH::kPacketSize];
+    Hit transformedHits[BVH::kPacketSize];
+
+    for (auto i = 0; i < numRays; ++i)
+    {
+        transformedMinDistances[i] = minDistances[i];
+        transformedMaxDistances[i] = std::min(maxDistances[i], hits[i].distance);
+        transformedRays[i] = inverseTransformRay(rays[i], transformedMinDistances[i], transformedMaxDistances[i]);
+    }
+
+    mSubScene->closestHits(numRays, transformedRays, transformedMinDistances, transformedMaxDistances, transformedHits);
+
+    for (auto i = 0; i < numRays; ++i)
+    {
+        auto hit = transformHit(transformedHits[i], transformedRays[i]);
+        if (hit.distance < hits[i].distance)
+        {
+            hits[i] = hit;
+        }
+    }
+}
+
+void InstancedMesh::anyHits(int numRays,
+                            const Ray* rays,
+                            const float* minDistances,
+                            const float* maxDistances,
+                            bool* occluded) const
+{
+    assert(numRays <= BVH::kPacketSize);
+
+    Ray transformedRays[BVH::kPacketSize];
+    float transformedMinDistances[BVH::kPacketSize];
+    float transformedMaxDistances[BVH::kPacketSize];
+    bool transformedOccluded[BVH::kPacketSize];
+
+    for (auto i = 0; i < numRays; ++i)
+    {
+        transformedMinDistances[i] = minDistances[i];
+        transformedMaxDistances[i] = maxDistances[i];
+        transformedRays[i] = inverseTransformRay(rays[i], transformedMinDistances[i], transformedMaxDistances[i]);
+
+        // A negative max distance tells the sub-scene to skip the ray.
+        if (occluded[i])
+        {
+            transformedMaxDistances[i] = -1.0f;
+        }
+    }
+
+    mSubScene->anyHits(numRays, transformedRays, transformedMinDistances, transformedMaxDistances, transformedOccluded);
+
+    for (auto i = 0; i < numRays; ++i)
+    {
+        occluded[i] = occluded[i] || transformedOccluded[i];
+    }
+}
+
 Ray InstancedMesh::inverseTransformRay(const Ray& ray,
                                        float& minDistance,
                                        float& maxDistance) const
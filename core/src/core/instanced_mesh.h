@@ -95,6 +95,22 @@ public:
                 float minDistance,
                 float maxDistance) const;
 
+    // Updates the closest hits for a packet of up to BVH::kPacketSize rays. A hit is only overwritten if a closer
+    // intersection with this instance is found.
+    void closestHits(int numRays,
+                     const Ray* rays,
+                     const float* minDistances,
+                     const float* maxDistances,
+                     Hit* hits) const;
+
+    // Updates the occlusion status for a packet of up to BVH::kPacketSize rays. Rays already marked as occluded are
+    // not traced.
+    void anyHits(int numRays,
+                 const Ray* rays,
+                 const float* minDistances,
+                 const float* maxDistances,
+                 bool* occluded) const;
+
 private:
     shared_ptr<Scene> mSubScene;
     Matrix4x4f mTransform;
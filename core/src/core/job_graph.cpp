@@ -25,6 +25,8 @@ namespace ipl {
 // --------------------------------------------------------------------------------------------------------------------
 
 JobGraph::JobGraph()
+    : mNumRemainingJobs(0)
+    , mCancel(false)
 {
     reset();
 }
@@ -36,40 +38,30 @@ bool JobGraph::isEmpty() const
 
 void JobGraph::reset()
 {
+    assert(isComplete());
+
     mJobs.clear();
-    mJobConsumerIndex = -1;
+    mDependents.clear();
+    mNumDependencies.clear();
+    mCancel = false;
 }
 
-void JobGraph::addJob(JobCallback callback)
+int JobGraph::addJob(JobCallback callback)
 {
     mJobs.push_back(Job(callback));
+    mDependents.emplace_back();
+    mNumDependencies.push_back(0);
+
+    return numJobs() - 1;
 }
 
-// This function could possibly return different codes depending on
-// whether simulation has completed or not.
-bool JobGraph::processNextJob(int threadId,
-                              std::atomic<bool>& cancel)
+void JobGraph::addDependency(int jobIndex,
+                             int dependencyIndex)
 {
-    auto jobQueueSize = static_cast<int>(mJobs.size());
-
-    // Possibly nothing added.
-    if (jobQueueSize == 0)
-        return false;
-
-    // Possibly return processing complete.
-    if (mJobConsumerIndex >= jobQueueSize - 1)
-        return false;
-
-    // Increment is done after size check to avoid any index overrun due to
-    // integer size limits.
-    auto consumerIndex = ++mJobConsumerIndex;
-    if (consumerIndex < jobQueueSize)
-    {
-        mJobs[consumerIndex].process(threadId, cancel);
-    }
+    assert(0 <= dependencyIndex && dependencyIndex < jobIndex && jobIndex < numJobs());
 
-    // Possibly return continue processing.
-    return true;
+    mDependents[dependencyIndex].push_back(jobIndex);
+    mNumDependencies[jobIndex]++;
 }
 
 }
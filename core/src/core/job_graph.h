@@ -28,9 +28,9 @@ namespace ipl {
 // JobGraph
 // --------------------------------------------------------------------------------------------------------------------
 
-// Describes a job graph. A job graph is initialized with a fixed number of jobs. All the jobs in a job graph must be
-// inserted before calls to processing next jobs is made. Effectively, there is a single producer (which produces at
-// the beginning) and multiple consumers.
+// Describes a job graph: a set of jobs, along with dependencies between them that form a directed acyclic graph. All
+// jobs and dependencies must be added before the job graph is submitted to a JobScheduler (or a ThreadPool). A job
+// only starts once all the jobs it depends on have completed.
 class JobGraph
 {
 public:
@@ -38,16 +38,45 @@ public:
 
     bool isEmpty() const;
 
+    int numJobs() const
+    {
+        return static_cast<int>(mJobs.size());
+    }
+
+    // Removes all jobs and dependencies, and clears the cancellation flag.
     void reset();
 
-    void addJob(JobCallback callback);
+    // Adds a job, and returns its index.
+    int addJob(JobCallback callback);
+
+    // Specifies that the job with index jobIndex must not start until the job with index dependencyIndex has
+    // completed. A job can only depend on jobs that were added before it, which guarantees that there are no cycles.
+    void addDependency(int jobIndex,
+                       int dependencyIndex);
 
-    bool processNextJob(int threadId,
-                        std::atomic<bool>& cancel);
+    // Returns true if all jobs have completed since the job graph was last submitted. This can be used to poll for
+    // completion without blocking.
+    bool isComplete() const
+    {
+        return (mNumRemainingJobs == 0);
+    }
+
+    // Requests cancellation. Jobs that have not yet started will be skipped, and jobs that are running can check the
+    // cancellation flag passed to them to stop early.
+    void cancel()
+    {
+        mCancel = true;
+    }
 
 private:
     vector<Job> mJobs;
-    std::atomic<int> mJobConsumerIndex;
+    vector<vector<int>> mDependents; // For each job, the jobs that depend on it.
+    vector<int> mNumDependencies; // For each job, the number of jobs it depends on.
+    Array<std::atomic<int>> mNumPendingDependencies; // For each job, the number of dependencies yet to complete.
+    std::atomic<int> mNumRemainingJobs; // Number of jobs yet to complete.
+    std::atomic<bool> mCancel;
+
+    friend class JobScheduler;
 };
 
 }
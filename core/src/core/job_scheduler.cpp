@@ -0,0 +1,213 @@
+//
+// Copyright 2017-2023 Valve Corporation.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "job_scheduler.h"
+
+namespace ipl {
+
+// --------------------------------------------------------------------------------------------------------------------
+// JobScheduler
+// --------------------------------------------------------------------------------------------------------------------
+
+JobScheduler::JobScheduler(int numThreads)
+    : mThreads(numThreads)
+    , mQueues(numThreads)
+    , mNumQueuedTasks(0)
+    , mNextQueue(0)
+    , mQuit(false)
+{
+    assert(numThreads > 0);
+
+    for (auto i = 0; i < numThreads; ++i)
+    {
+        mThreads[i] = std::thread(&JobScheduler::threadFunc, this, i);
+    }
+}
+
+JobScheduler::~JobScheduler()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mQuit = true;
+    mCondVarReady.notify_all();
+    lock.unlock();
+
+    for (auto i = 0u; i < mThreads.size(0); ++i)
+    {
+        mThreads[i].join();
+    }
+}
+
+void JobScheduler::submit(JobGraph& jobGraph)
+{
+    auto numJobs = jobGraph.numJobs();
+
+    if (static_cast<int>(jobGraph.mNumPendingDependencies.size(0)) != numJobs)
+    {
+        jobGraph.mNumPendingDependencies.resize(numJobs);
+    }
+
+    for (auto i = 0; i < numJobs; ++i)
+    {
+        jobGraph.mNumPendingDependencies[i] = jobGraph.mNumDependencies[i];
+    }
+
+    jobGraph.mNumRemainingJobs = numJobs;
+
+    // Distribute the jobs that are ready to run round-robin across all
+    // queues, so workers start off without having to steal.
+    auto numReadyJobs = 0;
+    for (auto i = 0; i < numJobs; ++i)
+    {
+        if (jobGraph.mNumDependencies[i] == 0)
+        {
+            push(static_cast<int>(mNextQueue++ % static_cast<unsigned int>(numThreads())), Task{ &jobGraph, i });
+            ++numReadyJobs;
+        }
+    }
+
+    wake(numReadyJobs);
+}
+
+void JobScheduler::wait(JobGraph& jobGraph)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondVarComplete.wait(lock, [&jobGraph]() { return jobGraph.isComplete(); });
+}
+
+void JobScheduler::push(int queueIndex,
+                        const Task& task)
+{
+    auto& queue = mQueues[queueIndex];
+
+    std::unique_lock<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(task);
+    lock.unlock();
+
+    ++mNumQueuedTasks;
+}
+
+bool JobScheduler::pop(int threadId,
+                       Task& task)
+{
+    // Take the most recently queued task from our own queue, since it is
+    // most likely to use data that is still in cache.
+    {
+        auto& queue = mQueues[threadId];
+
+        std::unique_lock<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            task = queue.tasks.back();
+            queue.tasks.pop_back();
+            --mNumQueuedTasks;
+            return true;
+        }
+    }
+
+    // Otherwise, steal the oldest task from some other queue.
+    for (auto i = 1; i < numThreads(); ++i)
+    {
+        auto& queue = mQueues[(threadId + i) % numThreads()];
+
+        std::unique_lock<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+            --mNumQueuedTasks;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void JobScheduler::wake(int numTasks)
+{
+    if (numTasks <= 0)
+        return;
+
+    // Acquiring the mutex here ensures that a worker that has just found
+    // mNumQueuedTasks to be 0 is waiting on the condition variable before
+    // we notify it.
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+    }
+
+    if (numTasks == 1)
+    {
+        mCondVarReady.notify_one();
+    }
+    else
+    {
+        mCondVarReady.notify_all();
+    }
+}
+
+void JobScheduler::execute(int threadId,
+                           const Task& task)
+{
+    auto& jobGraph = *task.jobGraph;
+
+    if (!jobGraph.mCancel)
+    {
+        jobGraph.mJobs[task.jobIndex].process(threadId, jobGraph.mCancel);
+    }
+
+    // Dependent jobs that are now ready go onto our own queue, and will
+    // typically be run next by this thread.
+    auto numReadyJobs = 0;
+    for (auto dependent : jobGraph.mDependents[task.jobIndex])
+    {
+        if (--jobGraph.mNumPendingDependencies[dependent] == 0)
+        {
+            push(threadId, Task{ &jobGraph, dependent });
+            ++numReadyJobs;
+        }
+    }
+
+    // The current thread will pick up one of the ready jobs itself.
+    wake(numReadyJobs - 1);
+
+    // The job graph may be destroyed as soon as the last job completes, so
+    // it must not be accessed after this point.
+    if (--jobGraph.mNumRemainingJobs == 0)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCondVarComplete.notify_all();
+    }
+}
+
+void JobScheduler::threadFunc(int threadId)
+{
+    while (true)
+    {
+        Task task;
+        if (pop(threadId, task))
+        {
+            execute(threadId, task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondVarReady.wait(lock, [this]() { return (mNumQueuedTasks > 0 || mQuit); });
+
+        if (mQuit)
+            break;
+    }
+}
+
+}
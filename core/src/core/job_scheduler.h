@@ -0,0 +1,96 @@
+//
+// Copyright 2017-2023 Valve Corporation.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "job_graph.h"
+
+namespace ipl {
+
+// --------------------------------------------------------------------------------------------------------------------
+// JobScheduler
+// --------------------------------------------------------------------------------------------------------------------
+
+// A persistent pool of worker threads that execute the jobs in one or more job graphs. Each worker thread has its own
+// queue of jobs. A worker takes jobs from the back of its own queue, and when its queue is empty, steals jobs from the
+// front of other workers' queues. When a job completes, any dependent jobs that become ready are pushed onto the
+// queue of the worker that ran it. Idle workers sleep until new jobs are queued, and only as many workers are woken
+// up as there are jobs to run.
+//
+// Multiple job graphs can be in flight at the same time, so independent pieces of work can overlap. Jobs are always
+// given a thread id in [0, numThreads), so they can use per-thread scratch storage.
+class JobScheduler
+{
+public:
+    JobScheduler(int numThreads);
+
+    ~JobScheduler();
+
+    int numThreads() const
+    {
+        return static_cast<int>(mThreads.size(0));
+    }
+
+    // Queues all jobs in a job graph for execution, and returns immediately. The job graph must not be modified or
+    // destroyed until it is complete. Use JobGraph::isComplete to poll for completion, or wait() to block.
+    void submit(JobGraph& jobGraph);
+
+    // Blocks until all jobs in a submitted job graph have completed.
+    void wait(JobGraph& jobGraph);
+
+private:
+    // A single job that is ready to run.
+    struct Task
+    {
+        JobGraph* jobGraph;
+        int jobIndex;
+    };
+
+    // A queue of ready jobs owned by a single worker thread.
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        deque<Task> tasks;
+    };
+
+    Array<std::thread> mThreads;
+    Array<WorkQueue> mQueues;
+    std::atomic<int> mNumQueuedTasks; // Total number of tasks in all queues.
+    std::atomic<unsigned int> mNextQueue; // Queue into which the next submitted task will be pushed. Wraps around.
+    std::atomic<bool> mQuit;
+    std::mutex mMutex;
+    std::condition_variable mCondVarReady;
+    std::condition_variable mCondVarComplete;
+
+    void push(int queueIndex,
+              const Task& task);
+
+    bool pop(int threadId,
+             Task& task);
+
+    void wake(int numTasks);
+
+    void execute(int threadId,
+                 const Task& task);
+
+    void threadFunc(int threadId);
+};
+
+}
@@ -69,6 +69,16 @@ Mesh::Mesh(const Serialized::Mesh* serializedObject)
     calcNormals();
 }
 
+void Mesh::updateVertices(const Vector3f* vertices)
+{
+    for (auto i = 0; i < numVertices(); ++i)
+    {
+        mVertices[i] = Vector4f(vertices[i].x(), vertices[i].y(), vertices[i].z(), 1.0f);
+    }
+
+    calcNormals();
+}
+
 flatbuffers::Offset<Serialized::Mesh> Mesh::serialize(SerializedObject& serializedObject) const
 {
     auto& fbb = serializedObject.fbb();
@@ -112,6 +112,10 @@ public:
         return mNormals[i];
     }
 
+    // Replaces the positions of all vertices, and recalculates the triangle normals. The triangles are left
+    // unchanged.
+    void updateVertices(const Vector3f* vertices);
+
     flatbuffers::Offset<Serialized::Mesh> serialize(SerializedObject& serializedObject) const;
 
 private:
@@ -16,6 +16,9 @@
 
 #pragma once
 
+#include <cstdint>
+#include <cstring>
+
 #include <arm_neon.h>
 
 #include "platform.h"
@@ -188,6 +191,16 @@ namespace float4
         return vld1q_dup_f32(p);
     }
 
+    // Load 4 unsigned bytes (with no alignment requirement), converting each to a float.
+    inline float4_t loadu8(const uint8_t* p)
+    {
+        uint32_t bytes;
+        memcpy(&bytes, p, sizeof(bytes));
+
+        auto x = vmovl_u16(vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(bytes)))));
+        return vcvtq_f32_u32(x);
+    }
+
     // Aligned store.
     inline void store(float* p,
                       float4_t x)
@@ -240,6 +253,14 @@ namespace float4
     {
         return vgetq_lane_f32(in, 0);
     }
+
+    // Returns a 4-bit integer whose i-th bit is the sign bit of lane i. Typically used to test comparison masks.
+    inline int movemask(float4_t in)
+    {
+        uint32x4_t signs = vshrq_n_u32(vreinterpretq_u32_f32(in), 31);
+        return static_cast<int>(vgetq_lane_u32(signs, 0) | (vgetq_lane_u32(signs, 1) << 1) |
+                                (vgetq_lane_u32(signs, 2) << 2) | (vgetq_lane_u32(signs, 3) << 3));
+    }
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,476 @@
+//
+// Copyright 2017-2023 Valve Corporation.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "non_uniform_convolution_effect.h"
+
+#include "array_math.h"
+#include "profiler.h"
+
+namespace ipl {
+
+// --------------------------------------------------------------------------------------------------------------------
+// NonUniformConvolutionEffect
+// --------------------------------------------------------------------------------------------------------------------
+
+const int NonUniformConvolutionEffect::kNumHeadBlocks = 4;
+const int NonUniformConvolutionEffect::kMaxPartitionSize = 8192;
+
+NonUniformConvolutionEffect::PartitionGroup::PartitionGroup(int numChannels,
+                                                            int frameSize,
+                                                            int firstBlock,
+                                                            int blockSize,
+                                                            int numPartitions)
+    : firstBlock(firstBlock)
+    , blockSize(blockSize)
+    , numPartitions(numPartitions)
+    , fft(2 * blockSize)
+    , irBlockFFT(2 * frameSize)
+    , dryBlock(fft.numRealSamples)
+    , fftDryBlocks(numPartitions, fft.numComplexSamples)
+    , irBlock(fft.numRealSamples)
+    , fftWet(fft.numComplexSamples)
+    , prevFFTWet(fft.numComplexSamples)
+    , wet(fft.numRealSamples)
+    , prevWet(fft.numRealSamples)
+    , output(2, numChannels, blockSize)
+    , nextJob(0)
+    , pendingJob(nullptr)
+{
+    fftIR[0].resize(numChannels, numPartitions, fft.numComplexSamples);
+    fftIR[1].resize(numChannels, numPartitions, fft.numComplexSamples);
+}
+
+NonUniformConvolutionEffect::NonUniformConvolutionEffect(const AudioSettings& audioSettings,
+                                                         const NonUniformConvolutionEffectSettings& effectSettings)
+    : mFrameSize(audioSettings.frameSize)
+    , mIRSize(effectSettings.irSize)
+    , mNumChannels(effectSettings.numChannels)
+    , mJobQueue(effectSettings.jobQueue)
+    , mFFT(2 * audioSettings.frameSize)
+    , mDryBlock(mFFT.numRealSamples)
+    , mFFTWet(effectSettings.numChannels, mFFT.numComplexSamples)
+    , mPrevFFTWet(effectSettings.numChannels, mFFT.numComplexSamples)
+    , mWet(effectSettings.numChannels, mFFT.numRealSamples)
+    , mPrevWet(effectSettings.numChannels, mFFT.numRealSamples)
+    , mTailWet(effectSettings.numChannels, audioSettings.frameSize)
+    , mTailFFTIR(effectSettings.numChannels, effectSettings.irSize, audioSettings.frameSize)
+{
+    auto numBlocks = OverlapSaveConvolutionEffect::numBlocks(mFrameSize, mIRSize);
+
+    mNumHeadBlocks = std::min(numBlocks, kNumHeadBlocks);
+    mFFTDryBlocks.resize(mNumHeadBlocks, mFFT.numComplexSamples);
+
+    // Partition sizes double every two partitions. Since the head covers 4 frames, each partition of size M starts at
+    // least 2M samples into the IR. Once partitions reach the maximum size, the last group covers the rest of the IR.
+    auto maxPartitionSize = std::max(kMaxPartitionSize, 2 * mFrameSize);
+    auto firstBlock = mNumHeadBlocks;
+    auto blockSize = 2 * mFrameSize;
+    auto maxBlockSize = 0;
+
+    while (firstBlock < numBlocks)
+    {
+        auto numBlocksPerPartition = blockSize / mFrameSize;
+        auto numPartitionsLeft = (numBlocks - firstBlock + numBlocksPerPartition - 1) / numBlocksPerPartition;
+        auto numPartitions = (2 * blockSize <= maxPartitionSize) ? std::min(2, numPartitionsLeft) : numPartitionsLeft;
+
+        mGroups.push_back(ipl::make_unique<PartitionGroup>(mNumChannels, mFrameSize, firstBlock, blockSize, numPartitions));
+
+        maxBlockSize = blockSize;
+        firstBlock += numPartitions * numBlocksPerPartition;
+        blockSize *= 2;
+    }
+
+    mInputHistory.resize(std::max(2 * maxBlockSize, mFrameSize));
+
+    for (auto& group : mGroups)
+    {
+        auto groupPtr = group.get();
+        for (auto& job : group->jobs)
+        {
+            job = ipl::make_unique<BackgroundJob>([this, groupPtr]()
+            {
+                process(*groupPtr);
+            });
+        }
+    }
+
+    mFFTIR = ipl::make_unique<OverlapSaveFIR>(mNumChannels, mIRSize, mFrameSize);
+
+    reset();
+}
+
+NonUniformConvolutionEffect::~NonUniformConvolutionEffect()
+{
+    // Jobs may still be queued even after their deadline has passed, so wait for the worker to discard them before
+    // the state they refer to is destroyed.
+    for (auto& group : mGroups)
+    {
+        finish(*group);
+
+        for (auto& job : group->jobs)
+        {
+            job->waitUntilIdle();
+        }
+    }
+}
+
+void NonUniformConvolutionEffect::reset()
+{
+    for (auto& group : mGroups)
+    {
+        finish(*group);
+
+        group->blockOffset = 0;
+        group->outputIndex = 1;
+        group->irChanged = false;
+        group->spectraIndex = 0;
+        group->dryBlock.zero();
+        group->fftDryBlocks.zero();
+        group->dryBlockIndex = 0;
+        group->fftIR[0].zero();
+        group->fftIR[1].zero();
+        group->output.zero();
+    }
+
+    mDryBlock.zero();
+    mFFTDryBlocks.zero();
+    mDryBlockIndex = 0;
+    mInputHistory.zero();
+    mInputHistoryIndex = 0;
+    mFFTIR->reset();
+    mTailFFTIR.reset();
+    mNumTailSamplesRemaining = 0;
+}
+
+AudioEffectState NonUniformConvolutionEffect::apply(const OverlapSaveConvolutionEffectParams& params,
+                                                    const AudioBuffer& in,
+                                                    AudioBuffer& out)
+{
+    assert(in.numSamples() == out.numSamples());
+    assert(in.numChannels() == 1);
+    assert(out.numChannels() == mNumChannels);
+
+    PROFILE_FUNCTION();
+
+    auto crossfade = apply(&params, in[0]);
+
+    out.makeSilent();
+
+    for (auto i = 0; i < params.numChannels; ++i)
+    {
+        mFFT.applyInverse(mFFTWet[i], mWet[i]);
+
+        if (crossfade)
+        {
+            mFFT.applyInverse(mPrevFFTWet[i], mPrevWet[i]);
+
+            for (auto j = 0; j < mFrameSize; ++j)
+            {
+                auto weight = static_cast<float>(j) / static_cast<float>(mFrameSize);
+                mWet[i][j + mFrameSize] = (1.0f - weight) * mPrevWet[i][j + mFrameSize] + weight * mWet[i][j + mFrameSize];
+            }
+        }
+
+        ArrayMath::add(mFrameSize, &mWet[i][mFrameSize], mTailWet[i], out[i]);
+    }
+
+    mNumTailSamplesRemaining = (OverlapSaveConvolutionEffect::numBlocks(mFrameSize, mIRSize) - 1) * mFrameSize;
+
+    return (mNumTailSamplesRemaining > 0) ? AudioEffectState::TailRemaining : AudioEffectState::TailComplete;
+}
+
+AudioEffectState NonUniformConvolutionEffect::apply(const OverlapSaveConvolutionEffectParams& params,
+                                                    const AudioBuffer& in,
+                                                    OverlapSaveConvolutionMixer& mixer)
+{
+    assert(in.numChannels() == 1);
+
+    PROFILE_FUNCTION();
+
+    auto crossfade = apply(&params, in[0]);
+
+    mixer.mix(mFFTWet.data(), (crossfade) ? mPrevFFTWet.data() : nullptr);
+    mixer.mixTimeDomain(mTailWet.data());
+
+    mNumTailSamplesRemaining = (OverlapSaveConvolutionEffect::numBlocks(mFrameSize, mIRSize) - 1) * mFrameSize;
+
+    return (mNumTailSamplesRemaining > 0) ? AudioEffectState::TailRemaining : AudioEffectState::TailComplete;
+}
+
+AudioEffectState NonUniformConvolutionEffect::tail(AudioBuffer& out)
+{
+    assert(out.numChannels() <= mNumChannels);
+    assert(out.numSamples() == mFrameSize);
+
+    apply(nullptr, nullptr);
+
+    out.makeSilent();
+
+    auto numChannels = std::min(out.numChannels(), mNumChannels);
+    for (auto i = 0; i < numChannels; ++i)
+    {
+        mFFT.applyInverse(mFFTWet[i], mWet[i]);
+        ArrayMath::add(mFrameSize, &mWet[i][mFrameSize], mTailWet[i], out[i]);
+    }
+
+    mNumTailSamplesRemaining = std::max(mNumTailSamplesRemaining - mFrameSize, 0);
+
+    return (mNumTailSamplesRemaining > 0) ? AudioEffectState::TailRemaining : AudioEffectState::TailComplete;
+}
+
+AudioEffectState NonUniformConvolutionEffect::tail(OverlapSaveConvolutionMixer& mixer)
+{
+    apply(nullptr, nullptr);
+
+    mixer.mix(mFFTWet.data(), nullptr);
+    mixer.mixTimeDomain(mTailWet.data());
+
+    mNumTailSamplesRemaining = std::max(mNumTailSamplesRemaining - mFrameSize, 0);
+
+    return (mNumTailSamplesRemaining > 0) ? AudioEffectState::TailRemaining : AudioEffectState::TailComplete;
+}
+
+bool NonUniformConvolutionEffect::apply(const OverlapSaveConvolutionEffectParams* params,
+                                        const float* in)
+{
+    auto numChannels = (params) ? params->numChannels : mNumChannels;
+
+    memcpy(&mDryBlock[0], &mDryBlock[mFrameSize], mFrameSize * sizeof(float));
+    if (in)
+    {
+        memcpy(&mDryBlock[mFrameSize], in, mFrameSize * sizeof(float));
+    }
+    else
+    {
+        memset(&mDryBlock[mFrameSize], 0, mFrameSize * sizeof(float));
+    }
+
+    --mDryBlockIndex;
+    if (mDryBlockIndex < 0)
+    {
+        mDryBlockIndex = static_cast<int>(mFFTDryBlocks.size(0)) - 1;
+    }
+
+    mFFT.applyForward(mDryBlock.data(), mFFTDryBlocks[mDryBlockIndex]);
+
+    auto crossfade = (params) ? params->fftIR->updateReadBuffer() : false;
+    if (crossfade)
+    {
+        applyHead(*mFFTIR, numChannels, mPrevFFTWet);
+        mFFTIR.swap(params->fftIR->readBuffer);
+    }
+
+    applyHead(*mFFTIR, numChannels, mFFTWet);
+
+    // Tail jobs only need input up to the start of the current frame.
+    applyTail(numChannels);
+
+    memcpy(&mInputHistory[mInputHistoryIndex], &mDryBlock[mFrameSize], mFrameSize * sizeof(float));
+    mInputHistoryIndex = (mInputHistoryIndex + mFrameSize) % static_cast<int>(mInputHistory.size(0));
+
+    return crossfade;
+}
+
+void NonUniformConvolutionEffect::applyHead(const OverlapSaveFIR& fftIR,
+                                            int numChannels,
+                                            Array<complex_t, 2>& fftWet)
+{
+    fftWet.zero();
+    for (auto i = 0; i < numChannels; ++i)
+    {
+        for (auto j = 0; j < mNumHeadBlocks; ++j)
+        {
+            auto index = (mDryBlockIndex + j) % mNumHeadBlocks;
+            ArrayMath::multiplyAccumulate(mFFT.numComplexSamples, mFFTDryBlocks[index], fftIR[i][j], fftWet[i]);
+        }
+    }
+}
+
+void NonUniformConvolutionEffect::applyTail(int numChannels)
+{
+    mTailWet.zero();
+
+    for (auto& group : mGroups)
+    {
+        // At the start of each block, the output of the previous job is needed, and the next job can be started.
+        if (group->blockOffset == 0)
+        {
+            finish(*group);
+            group->outputIndex = 1 - group->outputIndex;
+            submit(*group, numChannels);
+        }
+
+        auto output = group->output[1 - group->outputIndex];
+        for (auto i = 0; i < numChannels; ++i)
+        {
+            ArrayMath::add(mFrameSize, mTailWet[i], &output[i][group->blockOffset], mTailWet[i]);
+        }
+
+        group->blockOffset += mFrameSize;
+        if (group->blockOffset >= group->blockSize)
+        {
+            group->blockOffset = 0;
+        }
+    }
+}
+
+void NonUniformConvolutionEffect::submit(PartitionGroup& group,
+                                         int numChannels)
+{
+    // Copy the most recent 2 blocks of input.
+    auto historySize = static_cast<int>(mInputHistory.size(0));
+    auto start = (mInputHistoryIndex - 2 * group.blockSize + historySize) % historySize;
+    auto numSamplesBeforeWrap = std::min(2 * group.blockSize, historySize - start);
+    memcpy(group.dryBlock.data(), &mInputHistory[start], numSamplesBeforeWrap * sizeof(float));
+    memcpy(&group.dryBlock[numSamplesBeforeWrap], mInputHistory.data(), (2 * group.blockSize - numSamplesBeforeWrap) * sizeof(float));
+
+    group.numChannels = numChannels;
+
+    auto endBlock = std::min(group.firstBlock + group.numPartitions * (group.blockSize / mFrameSize), mTailFFTIR.numBlocks());
+    group.irChanged = mTailFFTIR.copyChangedBlocks(*mFFTIR, group.firstBlock, endBlock);
+
+    if (!mJobQueue)
+    {
+        process(group);
+        return;
+    }
+
+    // If the worker still hasn't gotten around to the job we submitted two blocks ago, or the queue is full, don't
+    // queue up any more work behind it.
+    auto& job = *group.jobs[group.nextJob];
+    if (!mJobQueue->submit(job))
+    {
+        process(group);
+        return;
+    }
+
+    group.pendingJob = &job;
+    group.nextJob = 1 - group.nextJob;
+}
+
+void NonUniformConvolutionEffect::finish(PartitionGroup& group)
+{
+    if (!group.pendingJob)
+        return;
+
+    auto& job = *group.pendingJob;
+    group.pendingJob = nullptr;
+
+    // If the worker has not started the job by its deadline, run it here instead of waiting for it to.
+    if (job.claimOrWait())
+    {
+        process(group);
+    }
+}
+
+void NonUniformConvolutionEffect::process(PartitionGroup& group)
+{
+    PROFILE_FUNCTION();
+
+    auto crossfade = group.irChanged;
+    if (crossfade)
+    {
+        partition(group);
+        group.irChanged = false;
+    }
+
+    --group.dryBlockIndex;
+    if (group.dryBlockIndex < 0)
+    {
+        group.dryBlockIndex = group.numPartitions - 1;
+    }
+
+    group.fft.applyForward(group.dryBlock.data(), group.fftDryBlocks[group.dryBlockIndex]);
+
+    const auto& fftIR = group.fftIR[group.spectraIndex];
+    const auto& prevFFTIR = group.fftIR[1 - group.spectraIndex];
+    auto output = group.output[group.outputIndex];
+
+    for (auto i = 0; i < group.numChannels; ++i)
+    {
+        group.fftWet.zero();
+        for (auto j = 0; j < group.numPartitions; ++j)
+        {
+            auto index = (group.dryBlockIndex + j) % group.numPartitions;
+            ArrayMath::multiplyAccumulate(group.fft.numComplexSamples, group.fftDryBlocks[index], fftIR[i][j], group.fftWet.data());
+        }
+
+        group.fft.applyInverse(group.fftWet.data(), group.wet.data());
+
+        // The new partitions are crossfaded in over an entire block, which is much longer than a frame.
+        if (crossfade)
+        {
+            group.prevFFTWet.zero();
+            for (auto j = 0; j < group.numPartitions; ++j)
+            {
+                auto index = (group.dryBlockIndex + j) % group.numPartitions;
+                ArrayMath::multiplyAccumulate(group.fft.numComplexSamples, group.fftDryBlocks[index], prevFFTIR[i][j], group.prevFFTWet.data());
+            }
+
+            group.fft.applyInverse(group.prevFFTWet.data(), group.prevWet.data());
+
+            for (auto j = 0; j < group.blockSize; ++j)
+            {
+                auto weight = static_cast<float>(j) / static_cast<float>(group.blockSize);
+                group.wet[j + group.blockSize] = (1.0f - weight) * group.prevWet[j + group.blockSize] + weight * group.wet[j + group.blockSize];
+            }
+        }
+
+        memcpy(output[i], &group.wet[group.blockSize], group.blockSize * sizeof(float));
+    }
+
+    for (auto i = group.numChannels; i < mNumChannels; ++i)
+    {
+        memset(output[i], 0, group.blockSize * sizeof(float));
+    }
+}
+
+void NonUniformConvolutionEffect::partition(PartitionGroup& group)
+{
+    PROFILE_FUNCTION();
+
+    auto spectraIndex = 1 - group.spectraIndex;
+    auto numBlocksPerPartition = group.blockSize / mFrameSize;
+
+    for (auto i = 0; i < mNumChannels; ++i)
+    {
+        for (auto j = 0; j < group.numPartitions; ++j)
+        {
+            group.irBlock.zero();
+
+            // Recover the time-domain IR from the frame-sized blocks. The spectrum of each block was calculated with
+            // the second half of the block zero-padded, so the first half of its inverse is the IR itself.
+            for (auto k = 0; k < numBlocksPerPartition; ++k)
+            {
+                auto block = group.firstBlock + j * numBlocksPerPartition + k;
+                if (block >= mTailFFTIR.numBlocks())
+                    break;
+
+                if (mTailFFTIR.blockVersion(block) == 0)
+                    continue;
+
+                group.irBlockFFT.applyInverse(mTailFFTIR[i][block], group.wet.data());
+                memcpy(&group.irBlock[k * mFrameSize], group.wet.data(), mFrameSize * sizeof(float));
+            }
+
+            group.fft.applyForward(group.irBlock.data(), group.fftIR[spectraIndex][i][j]);
+        }
+    }
+
+    group.spectraIndex = spectraIndex;
+}
+
+}
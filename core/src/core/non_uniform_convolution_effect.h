@@ -0,0 +1,158 @@
+//
+// Copyright 2017-2023 Valve Corporation.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include "background_job_queue.h"
+#include "containers.h"
+#include "overlap_save_convolution_effect.h"
+
+namespace ipl {
+
+// --------------------------------------------------------------------------------------------------------------------
+// NonUniformConvolutionEffect
+// --------------------------------------------------------------------------------------------------------------------
+
+struct NonUniformConvolutionEffectSettings
+{
+    int numChannels = 0;
+    int irSize = 0;
+    shared_ptr<BackgroundJobQueue> jobQueue; // If nullptr, all partitions are processed on the calling thread.
+};
+
+// Convolves audio with an IR using partitions of non-uniform size. The first few frame-sized partitions of the IR are
+// processed every frame, so there is no added latency. Later parts of the IR are split into partitions whose size
+// doubles every two partitions, up to kMaxPartitionSize samples. A partition of size M starts at least 2M samples
+// into the IR, so its output is only needed M samples after all of the input it depends on has been received: each
+// group of equally-sized partitions is processed once every M samples, as a job on the job queue, and must be complete
+// by the start of the next block of M samples. If the job has not started running by then, it is run on the calling
+// thread instead. Handing jobs to the queue and waiting for them never locks or allocates.
+//
+// This accepts the same uniformly partitioned IRs as OverlapSaveConvolutionEffect, and can be mixed using an
+// OverlapSaveConvolutionMixer. The tail partitions are built from the uniform partitions as part of their jobs,
+// whenever the corresponding blocks of the IR change. Changes to the tail of the IR are applied, with a crossfade, at
+// the start of the next block of the corresponding partition size.
+class NonUniformConvolutionEffect
+{
+public:
+    static const int kNumHeadBlocks;
+    static const int kMaxPartitionSize;
+
+    NonUniformConvolutionEffect(const AudioSettings& audioSettings,
+                                const NonUniformConvolutionEffectSettings& effectSettings);
+
+    ~NonUniformConvolutionEffect();
+
+    void reset();
+
+    AudioEffectState apply(const OverlapSaveConvolutionEffectParams& params,
+                           const AudioBuffer& in,
+                           AudioBuffer& out);
+
+    AudioEffectState apply(const OverlapSaveConvolutionEffectParams& params,
+                           const AudioBuffer& in,
+                           OverlapSaveConvolutionMixer& mixer);
+
+    AudioEffectState tail(AudioBuffer& out);
+
+    AudioEffectState tail(OverlapSaveConvolutionMixer& mixer);
+
+    int numTailSamplesRemaining() const { return mNumTailSamplesRemaining; }
+
+    // Returns the number of tail partition groups. Each group contains one or more partitions of the same size.
+    int numPartitionGroups() const
+    {
+        return static_cast<int>(mGroups.size());
+    }
+
+private:
+    // A group of tail partitions of the same size, processed using uniformly partitioned convolution with blocks of
+    // blockSize samples.
+    struct PartitionGroup
+    {
+        int firstBlock; // Index of the first frame-sized IR block covered by this group.
+        int blockSize;
+        int numPartitions;
+        int numChannels; // Number of channels to process in the current job.
+        int blockOffset; // Number of samples of the current block that have been output.
+        int outputIndex; // Index of the output buffer being written to by the current job. The other one is read.
+        bool irChanged; // True if the IR blocks covered by this group have changed since the last job.
+        int spectraIndex; // Index of the set of partition spectra that is currently being used.
+        FFT fft;
+        FFT irBlockFFT;
+        Array<float> dryBlock;
+        Array<complex_t, 2> fftDryBlocks;
+        int dryBlockIndex;
+        Array<complex_t, 3> fftIR[2];
+        Array<float> irBlock;
+        Array<complex_t> fftWet;
+        Array<complex_t> prevFFTWet;
+        Array<float> wet;
+        Array<float> prevWet;
+        Array<float, 3> output;
+        unique_ptr<BackgroundJob> jobs[2]; // Alternated, so a job can be submitted while the previous one, which was
+                                           // run on the calling thread instead, is still in the queue.
+        int nextJob;
+        BackgroundJob* pendingJob; // The job submitted at the start of the current block, if any.
+
+        PartitionGroup(int numChannels,
+                       int frameSize,
+                       int firstBlock,
+                       int blockSize,
+                       int numPartitions);
+    };
+
+    int mFrameSize;
+    int mIRSize;
+    int mNumChannels;
+    int mNumHeadBlocks;
+    shared_ptr<BackgroundJobQueue> mJobQueue;
+    FFT mFFT;
+    Array<float> mDryBlock;
+    Array<complex_t, 2> mFFTDryBlocks;
+    int mDryBlockIndex;
+    Array<complex_t, 2> mFFTWet;
+    Array<complex_t, 2> mPrevFFTWet;
+    Array<float, 2> mWet;
+    Array<float, 2> mPrevWet;
+    Array<float, 2> mTailWet;
+    Array<float> mInputHistory;
+    int mInputHistoryIndex;
+    unique_ptr<OverlapSaveFIR> mFFTIR; // The latest IR received from the simulation.
+    OverlapSaveFIR mTailFFTIR; // For each group, the IR blocks used by its current job.
+    vector<unique_ptr<PartitionGroup>> mGroups;
+    int mNumTailSamplesRemaining;
+
+    bool apply(const OverlapSaveConvolutionEffectParams* params,
+               const float* in);
+
+    void applyHead(const OverlapSaveFIR& fftIR,
+                   int numChannels,
+                   Array<complex_t, 2>& fftWet);
+
+    void applyTail(int numChannels);
+
+    void submit(PartitionGroup& group,
+                int numChannels);
+
+    void finish(PartitionGroup& group);
+
+    void process(PartitionGroup& group);
+
+    void partition(PartitionGroup& group);
+};
+
+}
@@ -35,6 +35,7 @@ OverlapSaveFIR::OverlapSaveFIR(int numChannels,
     auto numSpectrumSamples = Math::nextpow2(2 * frameSize) / 2 + 1;
 
     mData.resize(numChannels, numBlocks, numSpectrumSamples);
+    mBlockVersions.resize(numBlocks);
 
     reset();
 }
@@ -42,6 +43,38 @@ OverlapSaveFIR::OverlapSaveFIR(int numChannels,
 void OverlapSaveFIR::reset()
 {
     memset(mData.flatData(), 0, mData.totalSize() * sizeof(complex_t));
+    mBlockVersions.zero();
+}
+
+void OverlapSaveFIR::copyChangedBlocks(const OverlapSaveFIR& other)
+{
+    copyChangedBlocks(other, 0, numBlocks());
+}
+
+bool OverlapSaveFIR::copyChangedBlocks(const OverlapSaveFIR& other,
+                                       int beginBlock,
+                                       int endBlock)
+{
+    assert(numChannels() == other.numChannels());
+    assert(numBlocks() == other.numBlocks());
+
+    auto anyBlocksCopied = false;
+
+    for (auto j = beginBlock; j < endBlock; ++j)
+    {
+        if (mBlockVersions[j] == other.mBlockVersions[j])
+            continue;
+
+        for (auto i = 0; i < numChannels(); ++i)
+        {
+            memcpy(mData[i][j], other.mData[i][j], numSpectrumSamples() * sizeof(complex_t));
+        }
+
+        mBlockVersions[j] = other.mBlockVersions[j];
+        anyBlocksCopied = true;
+    }
+
+    return anyBlocksCopied;
 }
 
 
@@ -49,6 +82,8 @@ void OverlapSaveFIR::reset()
 // OverlapSavePartitioner
 // --------------------------------------------------------------------------------------------------------------------
 
+std::atomic<uint64_t> OverlapSavePartitioner::sNextVersion(1);
+
 OverlapSavePartitioner::OverlapSavePartitioner(int frameSize)
     : mFrameSize(frameSize)
     , mFFT(2 * frameSize)
@@ -80,9 +115,75 @@ void OverlapSavePartitioner::partition(const ImpulseResponse& ir,
                 break;
 
             memcpy(mTempIRBlock.data(), &ir[i][j * mFrameSize], numSamplesToCopy * sizeof(float));
+            memset(&mTempIRBlock[numSamplesToCopy], 0, (mFrameSize - numSamplesToCopy) * sizeof(float));
             mFFT.applyForward(mTempIRBlock.data(), fftIR[i][j]);
         }
     }
+
+    auto version = sNextVersion++;
+    for (auto j = 0; j < fftIR.numBlocks(); ++j)
+    {
+        fftIR.setBlockVersion(j, version);
+    }
+}
+
+int OverlapSavePartitioner::partitionModified(ImpulseResponse& ir,
+                                              int numChannels,
+                                              int numSamples,
+                                              int numBlocksToUpdate,
+                                              OverlapSaveFIR& fftIR)
+{
+    PROFILE_FUNCTION();
+
+    numChannels = std::min({numChannels, ir.numChannels(), fftIR.numChannels()});
+    numSamples = std::min(numSamples, ir.numSamples());
+    numBlocksToUpdate = std::min(numBlocksToUpdate, fftIR.numBlocks());
+
+    auto numBlocksUpdated = 0;
+    uint64_t version = 0;
+
+    for (auto j = 0; j < numBlocksToUpdate; ++j)
+    {
+        if (!ir.isModified(j * mFrameSize, (j + 1) * mFrameSize))
+            continue;
+
+        if (numBlocksUpdated == 0)
+        {
+            version = sNextVersion++;
+        }
+
+        partitionBlock(ir, numChannels, numSamples, j, fftIR);
+        fftIR.setBlockVersion(j, version);
+        ++numBlocksUpdated;
+    }
+
+    ir.clearModified(0, (numBlocksToUpdate < fftIR.numBlocks()) ? numBlocksToUpdate * mFrameSize : ir.numSamples());
+
+    return numBlocksUpdated;
+}
+
+void OverlapSavePartitioner::partitionBlock(const ImpulseResponse& ir,
+                                            int numChannels,
+                                            int numSamples,
+                                            int block,
+                                            OverlapSaveFIR& fftIR)
+{
+    auto firstSample = block * mFrameSize;
+    auto numSamplesToCopy = std::max(std::min(mFrameSize, numSamples - firstSample), 0);
+
+    for (auto i = 0; i < fftIR.numChannels(); ++i)
+    {
+        // Blocks past the end of the IR, and channels past the requested order, are silent.
+        if (i >= numChannels || numSamplesToCopy == 0)
+        {
+            memset(fftIR[i][block], 0, fftIR.numSpectrumSamples() * sizeof(complex_t));
+            continue;
+        }
+
+        memcpy(mTempIRBlock.data(), &ir[i][firstSample], numSamplesToCopy * sizeof(float));
+        memset(&mTempIRBlock[numSamplesToCopy], 0, (mFrameSize - numSamplesToCopy) * sizeof(float));
+        mFFT.applyForward(mTempIRBlock.data(), fftIR[i][block]);
+    }
 }
 
 
@@ -192,22 +293,37 @@ bool OverlapSaveConvolutionEffect::apply(const OverlapSaveConvolutionEffectParam
     auto crossfade = params.fftIR->updateReadBuffer();
     if (crossfade)
     {
+        const auto& fftIR = *params.fftIR->readBuffer;
+
+        // Blocks with the same version in the old and new IRs contribute equally to both wet signals, so they are
+        // only multiplied once. Only the blocks that changed are crossfaded.
         mFFTWet.zero();
         for (auto i = 0; i < params.numChannels; ++i)
         {
             for (auto j = 0; j < numBlocks; ++j)
             {
+                if (fftIR.blockVersion(j) != mPrevFFTIR->blockVersion(j))
+                    continue;
+
                 auto index = static_cast<int>((mDryBlockIndex + j) % mFFTDryBlocks.size(0));
-                ArrayMath::multiplyAccumulate(static_cast<int>(mFFTDryBlocks.size(1)), mFFTDryBlocks[index], (*params.fftIR->readBuffer)[i][j], mFFTWet[i]);
+                ArrayMath::multiplyAccumulate(static_cast<int>(mFFTDryBlocks.size(1)), mFFTDryBlocks[index], fftIR[i][j], mFFTWet[i]);
             }
         }
 
-        mPrevFFTWet.zero();
-        for (auto i = 0; i < params.numChannels; ++i)
+        memcpy(mPrevFFTWet.flatData(), mFFTWet.flatData(), mFFTWet.totalSize() * sizeof(complex_t));
+
+        crossfade = false;
+        for (auto j = 0; j < numBlocks; ++j)
         {
-            for (auto j = 0; j < numBlocks; ++j)
+            if (fftIR.blockVersion(j) == mPrevFFTIR->blockVersion(j))
+                continue;
+
+            crossfade = true;
+
+            auto index = static_cast<int>((mDryBlockIndex + j) % mFFTDryBlocks.size(0));
+            for (auto i = 0; i < params.numChannels; ++i)
             {
-                auto index = static_cast<int>((mDryBlockIndex + j) % mFFTDryBlocks.size(0));
+                ArrayMath::multiplyAccumulate(static_cast<int>(mFFTDryBlocks.size(1)), mFFTDryBlocks[index], fftIR[i][j], mFFTWet[i]);
                 ArrayMath::multiplyAccumulate(static_cast<int>(mFFTDryBlocks.size(1)), mFFTDryBlocks[index], (*mPrevFFTIR)[i][j], mPrevFFTWet[i]);
             }
         }
@@ -297,6 +413,7 @@ OverlapSaveConvolutionMixer::OverlapSaveConvolutionMixer(const AudioSettings& au
     , mPrevFFTWet(effectSettings.numChannels, mFFT.numComplexSamples)
     , mWet(effectSettings.numChannels, mFFT.numRealSamples)
     , mPrevWet(effectSettings.numChannels, mFFT.numRealSamples)
+    , mTimeDomainWet(effectSettings.numChannels, audioSettings.frameSize)
 {
     reset();
 }
@@ -308,6 +425,8 @@ void OverlapSaveConvolutionMixer::reset()
 
     mWet.zero();
     mPrevWet.zero();
+
+    mTimeDomainWet.zero();
 }
 
 void OverlapSaveConvolutionMixer::mix(const complex_t* const* fftWet,
@@ -320,6 +439,14 @@ void OverlapSaveConvolutionMixer::mix(const complex_t* const* fftWet,
     }
 }
 
+void OverlapSaveConvolutionMixer::mixTimeDomain(const float* const* wet)
+{
+    for (auto i = 0; i < mNumChannels; ++i)
+    {
+        ArrayMath::add(mFrameSize, wet[i], mTimeDomainWet[i], mTimeDomainWet[i]);
+    }
+}
+
 void OverlapSaveConvolutionMixer::apply(const OverlapSaveConvolutionMixerParams& params,
                                         AudioBuffer& out)
 {
@@ -336,7 +463,7 @@ void OverlapSaveConvolutionMixer::apply(const OverlapSaveConvolutionMixerParams&
             mWet[i][j + mFrameSize] = (1.0f - weight) * mPrevWet[i][j + mFrameSize] + weight * mWet[i][j + mFrameSize];
         }
 
-        memcpy(out[i], &mWet[i][mFrameSize], mFrameSize * sizeof(float));
+        ArrayMath::add(mFrameSize, &mWet[i][mFrameSize], mTimeDomainWet[i], out[i]);
     }
 
     reset();
@@ -69,10 +69,33 @@ public:
         return mData[i];
     }
 
+    // Each block (in all channels) carries a version number, which changes whenever the block is partitioned again.
+    // Version numbers are unique across all FIRs, and version 0 means the block is silent.
+    uint64_t blockVersion(int block) const
+    {
+        return mBlockVersions[block];
+    }
+
+    void setBlockVersion(int block,
+                         uint64_t version)
+    {
+        mBlockVersions[block] = version;
+    }
+
     void reset();
 
+    // Copies all blocks whose version differs from that of the corresponding block in other.
+    void copyChangedBlocks(const OverlapSaveFIR& other);
+
+    // Copies all blocks in [beginBlock, endBlock) whose version differs from that of the corresponding block in other.
+    // Returns true if any blocks were copied.
+    bool copyChangedBlocks(const OverlapSaveFIR& other,
+                           int beginBlock,
+                           int endBlock);
+
 private:
     Array<complex_t, 3> mData;
+    Array<uint64_t> mBlockVersions;
 };
 
 
@@ -90,10 +113,27 @@ public:
                    int numSamples,
                    OverlapSaveFIR& fftIR);
 
+    // Partitions only those of the first numBlocksToUpdate blocks that overlap samples of the IR marked as modified,
+    // and clears the modified flags for these samples. fftIR must hold the result of previous calls to this function
+    // for the same IR. Returns the number of blocks that were updated.
+    int partitionModified(ImpulseResponse& ir,
+                          int numChannels,
+                          int numSamples,
+                          int numBlocksToUpdate,
+                          OverlapSaveFIR& fftIR);
+
 private:
     int mFrameSize;
     FFT mFFT;
     Array<float> mTempIRBlock;
+
+    static std::atomic<uint64_t> sNextVersion;
+
+    void partitionBlock(const ImpulseResponse& ir,
+                        int numChannels,
+                        int numSamples,
+                        int block,
+                        OverlapSaveFIR& fftIR);
 };
 
 
@@ -196,6 +236,10 @@ public:
     void mix(const complex_t* const* fftWet,
              const complex_t* const* fftWetPrev);
 
+    // Mixes in one frame of output that has already been converted to the time domain, and does not need to be
+    // crossfaded.
+    void mixTimeDomain(const float* const* wet);
+
 private:
     int mFrameSize;
     int mNumChannels;
@@ -204,6 +248,7 @@ private:
     Array<complex_t, 2> mPrevFFTWet;
     Array<float, 2> mWet;
     Array<float, 2> mPrevWet;
+    Array<float, 2> mTimeDomainWet;
 };
 
 }
@@ -192,6 +192,43 @@ Vector3f SoundPath::toVirtualSource(const ProbeBatch& probes,
 // BakedPathData
 // --------------------------------------------------------------------------------------------------------------------
 
+// Used for finding SoundPaths that are identical, so only one copy of each is stored. Different pairs of probes
+// often share the same SoundPath, since SoundPaths do not store the start and end probes.
+struct SoundPathHash
+{
+    size_t operator()(const SoundPath& soundPath) const
+    {
+        uint32_t distanceBits = 0;
+        uint32_t deviationBits = 0;
+        memcpy(&distanceBits, &soundPath.distanceInternal, sizeof(float));
+        memcpy(&deviationBits, &soundPath.deviationInternal, sizeof(float));
+
+        auto hash = static_cast<size_t>(static_cast<uint16_t>(soundPath.firstProbe));
+        hash = (hash * 31) + static_cast<uint16_t>(soundPath.lastProbe);
+        hash = (hash * 31) + static_cast<uint16_t>(soundPath.probeAfterFirst);
+        hash = (hash * 31) + static_cast<uint16_t>(soundPath.probeBeforeLast);
+        hash = (hash * 31) + (soundPath.direct ? 1 : 0);
+        hash = (hash * 31) + distanceBits;
+        hash = (hash * 31) + deviationBits;
+        return hash;
+    }
+};
+
+struct SoundPathEqual
+{
+    bool operator()(const SoundPath& lhs,
+                    const SoundPath& rhs) const
+    {
+        return (lhs.firstProbe == rhs.firstProbe &&
+                lhs.lastProbe == rhs.lastProbe &&
+                lhs.probeAfterFirst == rhs.probeAfterFirst &&
+                lhs.probeBeforeLast == rhs.probeBeforeLast &&
+                lhs.direct == rhs.direct &&
+                lhs.distanceInternal == rhs.distanceInternal &&
+                lhs.deviationInternal == rhs.deviationInternal);
+    }
+};
+
 BakedPathData::BakedPathData(const IScene& scene,
                              const ProbeBatch& probes,
                              int numSamples,
@@ -208,21 +245,40 @@ BakedPathData::BakedPathData(const IScene& scene,
                              std::atomic<bool>& cancel,
                              ProgressCallback progressCallback,
                              void* callbackUserData)
-    : mBakedPathRefs(probes.numProbes(), probes.numProbes())
+    : mPathRange(pathRange)
 {
     // First, generate the visibility graph.
     ProbeVisibilityTester visTester(numSamples, asymmetricVisRange, down);
     mVisGraph = ipl::make_unique<ProbeVisibilityGraph>(scene, probes, visTester, radius, threshold, visRange,
                                                        numThreads, cancel, progressCallback, callbackUserData);
 
-    // Next, using multiple threads, calculate shortest paths between every pair of probes.
+    // Next, using multiple threads, calculate shortest paths from every probe. Only paths to probes with lower or
+    // equal indices are kept, since the rest can be reconstructed from them due to symmetry.
+    const int kMaxProbesToBakeInParallel = 50;
+
+    auto numProbes = probes.numProbes();
     PathFinder pathFinder(probes, numThreads);
-    Array<ProbePath, 2> probePaths(probes.numProbes(), probes.numProbes());
-    Array<ProbePath, 2> threadPaths(numThreads, probes.numProbes());
-    auto totalIterations = probes.numProbes() * probes.numProbes();
-    std::atomic<int> iterationsDone(0);
+    Array<ProbePath, 2> threadPaths(numThreads, numProbes);
+    vector<vector<std::pair<int16_t, SoundPath>>> groupPaths(kMaxProbesToBakeInParallel);
     JobGraph jobGraph;
 
+    // The unique SoundPaths, and the index of each one in uniqueSoundPaths. The first SoundPath is always invalid,
+    // so that a default-constructed SoundPathRef refers to it.
+    vector<SoundPath> uniqueSoundPaths;
+    unordered_map<SoundPath, int32_t, SoundPathHash, SoundPathEqual> uniqueSoundPathIndices;
+    uniqueSoundPaths.push_back(SoundPath());
+
+    vector<int32_t> pathOffsets;
+    vector<int16_t> pathEnds;
+    vector<SoundPathRef> pathRefs;
+    pathOffsets.reserve(numProbes + 1);
+    pathOffsets.push_back(0);
+
+    // If baking is cancelled, leave the baked data in a valid state with no paths.
+    mUniqueBakedPaths.resize(1);
+    mPathOffsets.resize(numProbes + 1);
+    mPathOffsets.zero();
+
     if (cancel)
     {
         cancel = false;
@@ -230,9 +286,9 @@ BakedPathData::BakedPathData(const IScene& scene,
     }
 
     // Allow a certain number of maximum probes to be baked in parallel so that progress callback
-    // can be called from the main thread.
-    const int kMaxProbesToBakeInParallel = 50;
-    for (auto i = 0; i < probes.numProbes();)
+    // can be called from the main thread. This also limits the memory needed to hold paths before they are
+    // compacted.
+    for (auto i = 0; i < numProbes;)
     {
         if (cancel)
         {
@@ -240,26 +296,32 @@ BakedPathData::BakedPathData(const IScene& scene,
             return;
         }
 
-        for (auto k = 0; k < kMaxProbesToBakeInParallel && i < probes.numProbes(); ++i, ++k)
+        // Only run the jobs for this group of probes; the job graph otherwise retains jobs for previous groups.
+        jobGraph.reset();
+
+        auto numGroupProbes = 0;
+        for (; numGroupProbes < kMaxProbesToBakeInParallel && i < numProbes; ++i, ++numGroupProbes)
         {
-            auto bakeJob = [this, i, &scene, &probes, radius, threshold, pathRange, progressCallback,
-                callbackUserData, &pathFinder, &probePaths, &threadPaths, &totalIterations, &iterationsDone]
+            auto bakeJob = [this, i, numGroupProbes, &scene, &probes, radius, threshold, pathRange, &pathFinder,
+                &threadPaths, &groupPaths]
                 (int threadIndex,
                     std::atomic<bool>&)
             {
                 PROFILE_ZONE("BakedPathData::bakeJob");
-                for (auto j = 0; j < probes.numProbes(); ++j)
-                {
-                    threadPaths[threadIndex][j].nodes.clear();
-                }
 
+                // The paths for each thread are overwritten in place, reusing their storage across start probes.
                 pathFinder.findAllShortestPaths(scene, probes, *mVisGraph, i, radius, threshold, pathRange,
                     threadIndex, threadPaths[threadIndex]);
 
-                for (auto j = 0; j < probes.numProbes(); ++j)
+                auto& paths = groupPaths[numGroupProbes];
+                paths.clear();
+                for (auto j = 0; j <= i; ++j)
                 {
-                    probePaths[i][j] = threadPaths[threadIndex][j];
-                    ++iterationsDone;
+                    SoundPath soundPath(threadPaths[threadIndex][j], probes);
+                    if (soundPath.isValid())
+                    {
+                        paths.push_back(std::make_pair(static_cast<int16_t>(j), soundPath));
+                    }
                 }
             };
 
@@ -268,75 +330,39 @@ BakedPathData::BakedPathData(const IScene& scene,
 
         threadPool.process(jobGraph);
 
-        if (progressCallback)
-        {
-            progressCallback(static_cast<float>(i) / probes.numProbes(), callbackUserData);
-        }
-    }
-
-    // Remove all data with j > i, since they can be reconstructed from the data with j < i due to symmetry.
-    ProbePath invalidProbePath;
-    for (auto i = 0; i < probes.numProbes(); ++i)
-    {
-        for (auto j = i + 1; j < probes.numProbes(); ++j)
+        // Extract the unique sound paths found for this group of probes, in order of start probe.
+        for (auto k = 0; k < numGroupProbes; ++k)
         {
-            probePaths[i][j] = invalidProbePath;
-        }
-    }
-
-    if (cancel)
-    {
-        cancel = false;
-        return;
-    }
-
-    // Sort the probe paths.
-    auto compareProbePaths = [](const ProbePath& lhs,
-                                const ProbePath& rhs)
-    {
-        if (!lhs.valid && rhs.valid)
-            return true;
+            for (const auto& path : groupPaths[k])
+            {
+                auto index = static_cast<int32_t>(uniqueSoundPaths.size());
 
-        return std::lexicographical_compare(lhs.nodes.begin(), lhs.nodes.end(), rhs.nodes.begin(), rhs.nodes.end());
-    };
+                auto uniqueSoundPathIter = uniqueSoundPathIndices.find(path.second);
+                if (uniqueSoundPathIter != uniqueSoundPathIndices.end())
+                {
+                    index = uniqueSoundPathIter->second;
+                }
+                else
+                {
+                    uniqueSoundPaths.push_back(path.second);
+                    uniqueSoundPathIndices[path.second] = index;
+                }
 
-    std::sort(probePaths.flatData(), probePaths.flatData() + probePaths.totalSize(), compareProbePaths);
+                SoundPathRef pathRef;
+                pathRef.index = index;
 
-    if (cancel)
-    {
-        cancel = false;
-        return;
-    }
+                pathEnds.push_back(path.first);
+                pathRefs.push_back(pathRef);
+            }
 
-    // Extract all the unique sound paths. At the end of this process, mUniqueBakedPaths contains the k unique
-    // sound paths, and mBakedPathRefs are n^2 indices (each between 0 and k-1), into the mUniqueBakedPaths
-    // array.
-    SoundPathRef invalidSoundPathRef;
-    for (auto i = 0; i < probes.numProbes(); ++i)
-    {
-        for (auto j = 0; j < probes.numProbes(); ++j)
-        {
-            mBakedPathRefs[i][j] = invalidSoundPathRef;
+            pathOffsets.push_back(static_cast<int32_t>(pathEnds.size()));
         }
-    }
-
-    auto areProbePathsEqual = [](const ProbePath& lhs,
-                                 const ProbePath& rhs)
-    {
-        if (lhs.valid ^ rhs.valid)
-            return false;
-
-        if (lhs.nodes.size() != rhs.nodes.size())
-            return false;
 
-        for (auto i = 0u; i < lhs.nodes.size(); ++i)
+        if (progressCallback)
         {
-            if (lhs.nodes[i] != rhs.nodes[i])
-                return false;
+            progressCallback(static_cast<float>(i) / numProbes, callbackUserData);
         }
-
-        return true;
-    };
+    }
 
     if (cancel)
     {
@@ -344,39 +370,21 @@ BakedPathData::BakedPathData(const IScene& scene,
         return;
     }
 
-    vector<SoundPath> uniqueSoundPaths;
-    for (auto i = 0, index = 0; i < probes.numProbes(); ++i)
-    {
-        for (auto j = 0; j < probes.numProbes(); ++j, ++index)
-        {
-            if (index == 0 || !areProbePathsEqual(probePaths.flatData()[index], probePaths.flatData()[index - 1]))
-            {
-                uniqueSoundPaths.push_back(SoundPath(probePaths.flatData()[index], probes));
-            }
-
-            if (uniqueSoundPaths.back().isValid())
-            {
-                auto start = probePaths.flatData()[index].start;
-                auto end = probePaths.flatData()[index].end;
+    mUniqueBakedPaths.resize(uniqueSoundPaths.size());
+    memcpy(mUniqueBakedPaths.data(), uniqueSoundPaths.data(), uniqueSoundPaths.size() * sizeof(SoundPath));
 
-                mBakedPathRefs[start][end].index = static_cast<int>(uniqueSoundPaths.size()) - 1;
-            }
-        }
+    mPathOffsets.resize(pathOffsets.size());
+    memcpy(mPathOffsets.data(), pathOffsets.data(), pathOffsets.size() * sizeof(int32_t));
 
-        if (cancel)
-        {
-            cancel = false;
-            return;
-        }
+    if (!pathEnds.empty())
+    {
+        mPathEnds.resize(pathEnds.size());
+        memcpy(mPathEnds.data(), pathEnds.data(), pathEnds.size() * sizeof(int16_t));
 
-        if (progressCallback)
-        {
-            progressCallback(static_cast<float>(index) / probePaths.totalSize(), callbackUserData);
-        }
+        mBakedPathRefs.resize(pathRefs.size());
+        memcpy(mBakedPathRefs.data(), pathRefs.data(), pathRefs.size() * sizeof(SoundPathRef));
     }
 
-    mUniqueBakedPaths.resize(uniqueSoundPaths.size());
-    memcpy(mUniqueBakedPaths.data(), uniqueSoundPaths.data(), uniqueSoundPaths.size() * sizeof(SoundPath));
     if (progressCallback)
     {
         progressCallback(1.0f, callbackUserData);
@@ -399,7 +407,6 @@ BakedPathData::BakedPathData(const Serialized::BakedPathingData* serializedObjec
     assert(serializedObject);
     assert(serializedObject->vis_graph() && serializedObject->vis_graph()->nodes() && serializedObject->vis_graph()->nodes()->Length() > 0);
     assert(serializedObject->unique_paths() && serializedObject->unique_paths()->Length() > 0);
-    assert(serializedObject->path_indices() && serializedObject->path_indices()->Length() > 0);
     assert(serializedObject->paths() && serializedObject->paths()->Length() > 0);
 
     // # probes
@@ -408,6 +415,13 @@ BakedPathData::BakedPathData(const Serialized::BakedPathingData* serializedObjec
     // vis graph
     mVisGraph = ipl::make_unique<ProbeVisibilityGraph>(serializedObject->vis_graph());
 
+    // path range
+    mPathRange = serializedObject->path_range();
+    if (mPathRange <= 0.0f)
+    {
+        mPathRange = std::numeric_limits<float>::infinity();
+    }
+
     // # valid SoundPaths
     auto numValidPaths = serializedObject->paths()->Length();
 
@@ -427,25 +441,79 @@ BakedPathData::BakedPathData(const Serialized::BakedPathingData* serializedObjec
         mUniqueBakedPaths[i].deviationInternal = serializedObject->unique_paths()->Get(i)->deviation_internal();
     }
 
-    // SoundPathRefs (index/value pair for each valid path)
-    mBakedPathRefs.resize(numProbes, numProbes);
+    // SoundPathRefs (one for each valid path)
+    mPathOffsets.resize(numProbes + 1);
+    mPathEnds.resize(numValidPaths);
+    mBakedPathRefs.resize(numValidPaths);
+
+    for (auto i = 0u; i < numValidPaths; ++i)
+    {
+        mBakedPathRefs[i].index = serializedObject->paths()->Get(i);
+    }
 
-    SoundPathRef invalidSoundPathRef;
-    for (auto i = 0u; i < numProbes; ++i)
+    if (serializedObject->format() == Serialized::BakedPathingDataFormat::SPARSE)
     {
-        for (auto j = 0u; j < numProbes; ++j)
+        assert(serializedObject->path_offsets() && serializedObject->path_offsets()->Length() == numProbes + 1);
+        assert(serializedObject->path_end_deltas() && serializedObject->path_end_deltas()->Length() == numValidPaths);
+
+        // End probes (delta-encoded relative to the previous end probe with the same start probe)
+        for (auto i = 0u; i <= numProbes; ++i)
         {
-            mBakedPathRefs[i][j] = invalidSoundPathRef;
+            mPathOffsets[i] = serializedObject->path_offsets()->Get(i);
         }
-    }
 
-    for (auto i = 0u; i < numValidPaths; ++i)
+        for (auto i = 0u; i < numProbes; ++i)
+        {
+            auto end = 0;
+            for (auto j = mPathOffsets[i]; j < mPathOffsets[i + 1]; ++j)
+            {
+                end += serializedObject->path_end_deltas()->Get(j);
+                mPathEnds[j] = static_cast<int16_t>(end);
+            }
+        }
+    }
+    else
     {
-        auto index = serializedObject->path_indices()->Get(i);
-        mBakedPathRefs.flatData()[index].index = serializedObject->paths()->Get(i);
+        assert(serializedObject->path_indices() && serializedObject->path_indices()->Length() == numValidPaths);
+
+        // Older data stores the index of each valid path in a (# probes)x(# probes) table, in increasing order, so
+        // the end probes and offsets can be read off directly.
+        auto start = 0u;
+        mPathOffsets[0] = 0;
+
+        for (auto i = 0u; i < numValidPaths; ++i)
+        {
+            auto index = static_cast<uint32_t>(serializedObject->path_indices()->Get(i));
+            for (; start < index / numProbes; ++start)
+            {
+                mPathOffsets[start + 1] = i;
+            }
+
+            mPathEnds[i] = static_cast<int16_t>(index % numProbes);
+        }
+
+        for (; start < numProbes; ++start)
+        {
+            mPathOffsets[start + 1] = numValidPaths;
+        }
     }
 }
 
+SoundPathRef BakedPathData::lookupPathRef(int start,
+                                          int end) const
+{
+    assert(start >= end);
+
+    auto firstEnd = mPathEnds.data() + mPathOffsets[start];
+    auto lastEnd = mPathEnds.data() + mPathOffsets[start + 1];
+    auto endIter = std::lower_bound(firstEnd, lastEnd, end);
+
+    if (endIter == lastEnd || *endIter != end)
+        return SoundPathRef();
+
+    return mBakedPathRefs[static_cast<int>(endIter - mPathEnds.data())];
+}
+
 SoundPath BakedPathData::lookupShortestPath(int start,
                                             int end,
                                             ProbePath* probePath) const
@@ -456,13 +524,13 @@ SoundPath BakedPathData::lookupShortestPath(int start,
 
     if (start < end)
     {
-        soundPath = mUniqueBakedPaths[mBakedPathRefs[end][start].index];
+        soundPath = mUniqueBakedPaths[lookupPathRef(end, start).index];
         std::swap(soundPath.firstProbe, soundPath.lastProbe);
         std::swap(soundPath.probeAfterFirst, soundPath.probeBeforeLast);
     }
     else
     {
-        soundPath = mUniqueBakedPaths[mBakedPathRefs[start][end].index];
+        soundPath = mUniqueBakedPaths[lookupPathRef(start, end).index];
     }
 
     if (probePath)
@@ -532,18 +600,17 @@ uint64_t BakedPathData::serializedSize() const
     // unique SoundPaths
     size += mUniqueBakedPaths.totalSize() * sizeof(SoundPath);
 
-    // SoundPathRefs. For valid paths only.
-    auto numProbes = mBakedPathRefs.size(0);
-    for (auto i = 0u; i < numProbes; ++i)
-    {
-        for (auto j = 0u; j < numProbes; ++j)
-        {
-            if (mUniqueBakedPaths[mBakedPathRefs[i][j].index].isValid())
-            {
-                size += sizeof(int32_t) + sizeof(SoundPathRef);
-            }
-        }
-    }
+    // format
+    size += sizeof(int8_t);
+
+    // path range
+    size += sizeof(float);
+
+    // offsets of the paths for each start probe
+    size += mPathOffsets.totalSize() * sizeof(int32_t);
+
+    // end probes and SoundPathRefs. For valid paths only.
+    size += mBakedPathRefs.totalSize() * (sizeof(uint16_t) + sizeof(SoundPathRef));
 
     return size;
 }
@@ -568,39 +635,31 @@ flatbuffers::Offset<Serialized::BakedPathingData> BakedPathData::serialize(Seria
 
     auto soundPathsOffset = fbb.CreateVector(soundPathOffsets.data(), soundPathOffsets.size());
 
-    auto numProbes = mBakedPathRefs.size(0);
-    auto numValidPaths = 0;
-    for (auto i = 0u; i < numProbes; ++i)
-    {
-        for (auto j = 0u; j < numProbes; ++j)
-        {
-            if (mUniqueBakedPaths[mBakedPathRefs[i][j].index].isValid())
-            {
-                ++numValidPaths;
-            }
-        }
-    }
+    auto numProbes = static_cast<int>(mPathOffsets.totalSize()) - 1;
+    auto numValidPaths = mBakedPathRefs.totalSize();
 
-    vector<int32_t> pathIndices;
-    vector<int32_t> paths;
-    pathIndices.reserve(numValidPaths);
-    paths.reserve(numValidPaths);
-    for (auto i = 0u; i < numProbes; ++i)
+    // End probes are stored relative to the previous end probe with the same start probe, so they fit in 16 bits
+    // regardless of how many paths there are.
+    vector<uint16_t> pathEndDeltas(numValidPaths);
+    vector<int32_t> paths(numValidPaths);
+    for (auto i = 0; i < numProbes; ++i)
     {
-        for (auto j = 0u; j < numProbes; ++j)
+        auto prevEnd = 0;
+        for (auto j = mPathOffsets[i]; j < mPathOffsets[i + 1]; ++j)
         {
-            if (mUniqueBakedPaths[mBakedPathRefs[i][j].index].isValid())
-            {
-                pathIndices.push_back(static_cast<int>(i * numProbes + j));
-                paths.push_back(mBakedPathRefs[i][j].index);
-            }
+            pathEndDeltas[j] = static_cast<uint16_t>(mPathEnds[j] - prevEnd);
+            paths[j] = mBakedPathRefs[j].index;
+            prevEnd = mPathEnds[j];
         }
     }
 
-    auto pathIndicesOffset = fbb.CreateVector(pathIndices.data(), pathIndices.size());
+    auto pathOffsetsOffset = fbb.CreateVector(mPathOffsets.data(), mPathOffsets.totalSize());
+    auto pathEndDeltasOffset = fbb.CreateVector(pathEndDeltas.data(), pathEndDeltas.size());
     auto pathsOffset = fbb.CreateVector(paths.data(), paths.size());
 
-    return Serialized::CreateBakedPathingData(fbb, visGraphOffset, soundPathsOffset, pathIndicesOffset, pathsOffset);
+    return Serialized::CreateBakedPathingData(fbb, visGraphOffset, soundPathsOffset, 0, pathsOffset,
+                                              Serialized::BakedPathingDataFormat::SPARSE, pathOffsetsOffset,
+                                              pathEndDeltasOffset, mPathRange);
 }
 
 
@@ -115,7 +115,9 @@ public:
 // --------------------------------------------------------------------------------------------------------------------
 
 // Represents the baked data used for looking up paths at runtime. This is the data that should be serialized to disk
-// during baking. The data stored is a SoundPath for every pair of probes.
+// during baking. Since paths are symmetric, only paths whose start probe index is greater than or equal to the end
+// probe index are stored. Most pairs of probes are out of range of each other, so for each start probe, we store a
+// sorted list of only the end probes that it has a valid path to, along with a SoundPathRef for each of them.
 class BakedPathData : public IBakedData
 {
 public:
@@ -174,6 +176,25 @@ public:
         return mNeedsUpdate;
     }
 
+    // Returns the path range used when baking. Paths found at run-time must stay within this range too. Data baked by
+    // older versions does not record it, in which case it is infinite.
+    float pathRange() const
+    {
+        return mPathRange;
+    }
+
+    // Returns the number of probe pairs with a valid path between them, counting each pair once.
+    int numValidPaths() const
+    {
+        return static_cast<int>(mBakedPathRefs.totalSize());
+    }
+
+    // Returns the number of unique SoundPaths.
+    int numUniquePaths() const
+    {
+        return static_cast<int>(mUniqueBakedPaths.totalSize());
+    }
+
     // Queries the baked data for the shortest path between the start probe and the end probe.
     SoundPath lookupShortestPath(int start,
                                  int end,
@@ -187,10 +208,18 @@ public:
 
 private:
     unique_ptr<ProbeVisibilityGraph> mVisGraph; // The visibility graph.
-    Array<SoundPath> mUniqueBakedPaths; // The unique SoundPaths.
-    Array<SoundPathRef, 2> mBakedPathRefs; // SoundPathRefs for SoundPaths between every pair of probes.
+    Array<SoundPath> mUniqueBakedPaths; // The unique SoundPaths. The first one is always invalid.
+    Array<int32_t> mPathOffsets; // For each start probe, the index of its first entry in mPathEnds and mBakedPathRefs.
+                                 // Contains one more entry than the number of probes.
+    Array<int16_t> mPathEnds; // End probes of all valid paths, in increasing order for each start probe.
+    Array<SoundPathRef> mBakedPathRefs; // SoundPathRefs for all valid paths, in the same order as mPathEnds.
+    float mPathRange; // The path range used when baking.
     bool mNeedsUpdate;
 
+    // Looks up the SoundPathRef for the path between the start probe and the end probe, where start >= end.
+    SoundPathRef lookupPathRef(int start,
+                               int end) const;
+
     void reconstructProbePath(int start,
                               int end,
                               const SoundPath& soundPath,
@@ -19,6 +19,103 @@
 
 namespace ipl {
 
+// --------------------------------------------------------------------------------------------------------------------
+// RadixHeap
+// --------------------------------------------------------------------------------------------------------------------
+
+const int RadixHeap::kNumBuckets;
+
+RadixHeap::RadixHeap()
+    : mLastKey(0)
+    , mSize(0)
+{}
+
+void RadixHeap::clear()
+{
+    for (auto& bucket : mBuckets)
+    {
+        bucket.clear();
+    }
+
+    mLastKey = 0;
+    mSize = 0;
+}
+
+void RadixHeap::push(int nodeIndex,
+                     float cost)
+{
+    auto entryKey = std::max(key(cost), mLastKey);
+    mBuckets[bucketIndex(entryKey)].push_back(Entry{nodeIndex, cost});
+    ++mSize;
+}
+
+const RadixHeap::Entry& RadixHeap::top()
+{
+    assert(mSize > 0);
+
+    if (mBuckets[0].empty())
+    {
+        // Find the lowest non-empty bucket, and redistribute its contents relative to its lowest cost. Every entry
+        // moves to a lower bucket, and the entry with the lowest cost moves to bucket 0.
+        auto index = 1;
+        while (mBuckets[index].empty())
+        {
+            ++index;
+        }
+
+        auto& bucket = mBuckets[index];
+
+        mLastKey = key(bucket[0].cost);
+        for (const auto& entry : bucket)
+        {
+            mLastKey = std::min(mLastKey, key(entry.cost));
+        }
+
+        for (const auto& entry : bucket)
+        {
+            mBuckets[bucketIndex(std::max(key(entry.cost), mLastKey))].push_back(entry);
+        }
+
+        bucket.clear();
+    }
+
+    return mBuckets[0].back();
+}
+
+void RadixHeap::pop()
+{
+    top();
+
+    mBuckets[0].pop_back();
+    --mSize;
+}
+
+uint32_t RadixHeap::key(float cost)
+{
+    // For non-negative floats, the ordering of bit patterns matches the ordering of values.
+    uint32_t bits = 0;
+    memcpy(&bits, &cost, sizeof(bits));
+    return bits;
+}
+
+int RadixHeap::bucketIndex(uint32_t key) const
+{
+    auto difference = key ^ mLastKey;
+
+    auto index = 0;
+    for (auto shift = 16; shift > 0; shift /= 2)
+    {
+        if (difference >> shift)
+        {
+            difference >>= shift;
+            index += shift;
+        }
+    }
+
+    return (difference) ? index + 1 : 0;
+}
+
+
 // --------------------------------------------------------------------------------------------------------------------
 // PathFinder
 // --------------------------------------------------------------------------------------------------------------------
@@ -27,16 +124,14 @@ PathFinder::PathFinder(const ProbeBatch& probes,
                        int numThreads)
     : mParents(numThreads, probes.numProbes())
     , mCosts(numThreads, probes.numProbes())
+    , mBackwardParents(numThreads, probes.numProbes())
+    , mBackwardCosts(numThreads, probes.numProbes())
+    , mVisitStamps(numThreads, probes.numProbes())
+    , mSearchStamps(numThreads, 0)
+    , mPriorityQueue(numThreads)
+    , mBackwardPriorityQueue(numThreads)
 {
-    for (auto i = 0; i < numThreads; ++i)
-    {
-        vector<PriorityQueueEntry> container;
-        container.reserve(2 * probes.numProbes());
-
-        priority_queue<PriorityQueueEntry> priorityQueue(std::less<PriorityQueueEntry>(), std::move(container));
-
-        mPriorityQueue.push_back(priorityQueue);
-    }
+    mVisitStamps.zero();
 }
 
 // Uses Dijkstra's algorithm to find the minimum spanning tree rooted at the start node.
@@ -52,37 +147,48 @@ void PathFinder::findAllShortestPaths(const IScene& scene,
 {
     PROFILE_FUNCTION();
 
+    auto* parents = mParents[threadIndex];
+    auto* costs = mCosts[threadIndex];
+    auto& priorityQueue = mPriorityQueue[threadIndex];
+
     for (auto i = 0; i < probes.numProbes(); ++i)
     {
-        mParents[threadIndex][i] = -1;
-        mCosts[threadIndex][i] = std::numeric_limits<float>::infinity();
+        parents[i] = -1;
+        costs[i] = std::numeric_limits<float>::infinity();
     }
 
-    mCosts[threadIndex][start] = 0.0f;
+    const auto& startCenter = probes[start].influence.center;
 
-    while (!mPriorityQueue[threadIndex].empty())
-    {
-        mPriorityQueue[threadIndex].pop();
-    }
+    costs[start] = 0.0f;
 
-    mPriorityQueue[threadIndex].push(PriorityQueueEntry{start, mCosts[threadIndex][start]});
+    priorityQueue.clear();
+    priorityQueue.push(start, costs[start]);
 
-    while (!mPriorityQueue[threadIndex].empty())
+    while (!priorityQueue.empty())
     {
-        auto u = mPriorityQueue[threadIndex].top().nodeIndex;
+        auto entry = priorityQueue.top();
+        priorityQueue.pop();
 
-        mPriorityQueue[threadIndex].pop();
+        auto u = entry.nodeIndex;
+
+        // Skip stale entries for nodes whose cost has since been lowered.
+        if (entry.cost > costs[u])
+            continue;
 
         for (auto v : visGraph.mAdjacent[u])
         {
+            // Probes outside the path range cannot be part of any valid path, so don't search through them.
+            if ((probes[v].influence.center - startCenter).length() > pathRange)
+                continue;
+
             auto uvDistance = (probes[u].influence.center - probes[v].influence.center).length();
 
-            if (mCosts[threadIndex][u] + uvDistance < mCosts[threadIndex][v])
+            if (costs[u] + uvDistance < costs[v])
             {
-                mCosts[threadIndex][v] = mCosts[threadIndex][u] + uvDistance;
-                mParents[threadIndex][v] = u;
+                costs[v] = costs[u] + uvDistance;
+                parents[v] = u;
 
-                mPriorityQueue[threadIndex].push(PriorityQueueEntry{v, mCosts[threadIndex][v]});
+                priorityQueue.push(v, costs[v]);
             }
         }
     }
@@ -91,56 +197,33 @@ void PathFinder::findAllShortestPaths(const IScene& scene,
     {
         paths[i].start = start;
         paths[i].end = i;
+        paths[i].nodes.clear();
 
-        if ((probes[start].influence.center - probes[i].influence.center).length() > pathRange)
-        {
-            paths[i].valid = false;
-            continue;
-        }
-
-        if (mParents[threadIndex][i] >= 0)
-        {
-            paths[i].valid = true;
-
-            auto parentIndex = mParents[threadIndex][i];
-            while (parentIndex >= 0 && parentIndex != start)
-            {
-                paths[i].nodes.insert(paths[i].nodes.begin(), parentIndex);
-                parentIndex = mParents[threadIndex][parentIndex];
-            }
-        }
-        else
-        {
-            paths[i].valid = false;
-        }
-    }
-
-    for (auto i = 0; i < probes.numProbes(); ++i)
-    {
+        // Probes outside the path range are never reached, so have no parent.
+        paths[i].valid = (parents[i] >= 0);
         if (!paths[i].valid)
             continue;
 
-        bool pathValid = true;
-        for (auto j = 0; j < paths[i].nodes.size() && pathValid; ++j)
-        {
-            float dist = (probes[paths[i].start].influence.center - probes[paths[i].nodes[j]].influence.center).length();
-            pathValid = pathValid && (dist <= pathRange);
-        }
-
-        for (int j = static_cast<int>(paths[i].nodes.size()) - 1; j >= 0 && pathValid; --j)
-        {
-            float dist = (probes[paths[i].end].influence.center - probes[paths[i].nodes[j]].influence.center).length();
-            pathValid = pathValid && (dist <= pathRange);
-        }
+        reconstructPath(parents, i, start, probes.numProbes(), paths[i].nodes);
 
-        if (!pathValid)
+        // All probes in the path are within the path range of the start probe, but must also be within the path
+        // range of the end probe.
+        for (auto node : paths[i].nodes)
         {
-            paths[i].reset();
+            if ((probes[i].influence.center - probes[node].influence.center).length() > pathRange)
+            {
+                paths[i].reset();
+                break;
+            }
         }
     }
 }
 
-// Uses A* to speed up processing.
+// Uses bidirectional A* to speed up processing. Both halves of the search use the same potential function (the
+// average of the distance to the end node and the negated distance from the start node), so they search the same
+// graph of reduced edge costs, and the usual stopping criterion of bidirectional Dijkstra applies. Distances are
+// Euclidean, as are edge costs, so by the triangle inequality, reduced edge costs are never negative, and the path
+// found is the shortest one.
 ProbePath PathFinder::findShortestPath(const IScene& scene,
                                        const ProbeBatch& probes,
                                        const ProbeVisibilityGraph& visGraph,
@@ -150,6 +233,7 @@ ProbePath PathFinder::findShortestPath(const IScene& scene,
                                        float radius,
                                        float threshold,
                                        float visRange,
+                                       float pathRange,
                                        bool simplifyPaths,
                                        bool realTimeVis,
                                        int threadIndex) const
@@ -160,81 +244,179 @@ ProbePath PathFinder::findShortestPath(const IScene& scene,
     result.start = start;
     result.end = end;
 
-    for (auto i = 0; i < probes.numProbes(); ++i)
+    if (start == end)
+        return result;
+
+    auto* parents = mParents[threadIndex];
+    auto* costs = mCosts[threadIndex];
+    auto* backwardParents = mBackwardParents[threadIndex];
+    auto* backwardCosts = mBackwardCosts[threadIndex];
+    auto* visitStamps = mVisitStamps[threadIndex];
+    auto& forwardQueue = mPriorityQueue[threadIndex];
+    auto& backwardQueue = mBackwardPriorityQueue[threadIndex];
+
+    // Per-node state is only initialized when a node is first visited by this search, so the cost of a search
+    // depends on the number of nodes visited, not the total number of probes.
+    auto& searchStamp = mSearchStamps[threadIndex];
+    if (++searchStamp == 0)
     {
-        mParents[threadIndex][i] = -1;
-        mCosts[threadIndex][i] = std::numeric_limits<float>::infinity();
+        for (auto i = 0; i < probes.numProbes(); ++i)
+        {
+            visitStamps[i] = 0;
+        }
+
+        searchStamp = 1;
     }
 
-    auto ProbeDistance = [&probes](int start, int end) -> float
+    auto visit = [&](int node)
+    {
+        if (visitStamps[node] != searchStamp)
         {
-            auto d = Vector3f(probes[start].influence.center - probes[end].influence.center);
-            auto dx = fabsf(d.x());
-            auto dy = fabsf(d.y());
-            auto dz = fabsf(d.z());
-
-            return (dx + dy + dz);
-        };
+            visitStamps[node] = searchStamp;
+            parents[node] = -1;
+            backwardParents[node] = -1;
+            costs[node] = std::numeric_limits<float>::infinity();
+            backwardCosts[node] = std::numeric_limits<float>::infinity();
+        }
+    };
 
-    mCosts[threadIndex][start] = ProbeDistance(start, end);
+    auto ProbeDistance = [&probes](int start, int end) -> float
+    {
+        return (probes[start].influence.center - probes[end].influence.center).length();
+    };
 
-    while (!mPriorityQueue[threadIndex].empty())
+    // Probes outside the path range of either end of the path cannot be part of any valid path, so don't search
+    // through them.
+    auto InPathRange = [&](int node) -> bool
     {
-        mPriorityQueue[threadIndex].pop();
-    }
+        return (ProbeDistance(start, node) <= pathRange && ProbeDistance(node, end) <= pathRange);
+    };
 
-    mPriorityQueue[threadIndex].push(PriorityQueueEntry{start, mCosts[threadIndex][start]});
+    if (!InPathRange(start))
+        return result;
 
-    while (!mPriorityQueue[threadIndex].empty())
+    auto Potential = [&](int node) -> float
     {
-        auto u = mPriorityQueue[threadIndex].top().nodeIndex;
+        return 0.5f * (ProbeDistance(node, end) - ProbeDistance(start, node));
+    };
 
-        if (u == end)
+    // The reduced cost of the edge from u to v, which is never negative, since the potential is consistent. Clamping
+    // only guards against round-off.
+    auto ReducedDistance = [&](int u, int v) -> float
+    {
+        return std::max(ProbeDistance(u, v) + Potential(v) - Potential(u), 0.0f);
+    };
+
+    visit(start);
+    visit(end);
+
+    costs[start] = 0.0f;
+    backwardCosts[end] = 0.0f;
+
+    forwardQueue.clear();
+    backwardQueue.clear();
+    forwardQueue.push(start, 0.0f);
+    backwardQueue.push(end, 0.0f);
+
+    auto bestCost = std::numeric_limits<float>::infinity();
+    auto meetingNode = -1;
+
+    while (!forwardQueue.empty() && !backwardQueue.empty())
+    {
+        if (forwardQueue.top().cost + backwardQueue.top().cost >= bestCost)
             break;
 
-        mPriorityQueue[threadIndex].pop();
+        auto forward = (forwardQueue.top().cost <= backwardQueue.top().cost);
+        auto& queue = (forward) ? forwardQueue : backwardQueue;
+        auto* searchCosts = (forward) ? costs : backwardCosts;
+        auto* searchParents = (forward) ? parents : backwardParents;
+        const auto* otherCosts = (forward) ? backwardCosts : costs;
+
+        auto entry = queue.top();
+        queue.pop();
+
+        auto u = entry.nodeIndex;
+
+        // Skip stale entries for nodes whose cost has since been lowered.
+        if (entry.cost > searchCosts[u])
+            continue;
 
         for (auto v : visGraph.mAdjacent[u])
         {
-            auto uvDistance = ProbeDistance(u, v);
-            auto uEndDistance = ProbeDistance(u, end);
-            auto vEndDistance = ProbeDistance(v, end);
+            if (!InPathRange(v))
+                continue;
+
+            visit(v);
 
-            if ((mCosts[threadIndex][u] + uvDistance - uEndDistance + vEndDistance) < mCosts[threadIndex][v])
+            // The backward search follows edges in reverse, from v to u.
+            auto uvDistance = (forward) ? ReducedDistance(u, v) : ReducedDistance(v, u);
+
+            if (searchCosts[u] + uvDistance < searchCosts[v])
             {
                 if (realTimeVis)
                 {
-                    if (!visTester.areProbesVisible(scene, probes, u, v, radius, threshold))
+                    auto visible = (forward) ? visTester.areProbesVisible(scene, probes, u, v, radius, threshold) :
+                                               visTester.areProbesVisible(scene, probes, v, u, radius, threshold);
+                    if (!visible)
                         continue;
                 }
 
-                mCosts[threadIndex][v] = mCosts[threadIndex][u] + uvDistance - uEndDistance + vEndDistance;
-                mParents[threadIndex][v] = u;
+                searchCosts[v] = searchCosts[u] + uvDistance;
+                searchParents[v] = u;
+
+                queue.push(v, searchCosts[v]);
 
-                mPriorityQueue[threadIndex].push(PriorityQueueEntry{v, mCosts[threadIndex][v]});
+                if (searchCosts[v] + otherCosts[v] < bestCost)
+                {
+                    bestCost = searchCosts[v] + otherCosts[v];
+                    meetingNode = v;
+                }
             }
         }
     }
 
-    if (mParents[threadIndex][end] < 0)
+    if (meetingNode < 0)
         return result;
 
-    if (simplifyPaths)
+    // Join the two halves of the path, by making each node after the meeting node the parent of the next one.
+    for (auto node = meetingNode; node != end; node = backwardParents[node])
     {
-        simplifyPath(scene, probes, visGraph, visTester, start, end, radius, threshold, realTimeVis, mParents[threadIndex]);
+        parents[backwardParents[node]] = node;
     }
 
-    auto parentIndex = mParents[threadIndex][end];
-    while (parentIndex >= 0)
+    if (simplifyPaths)
     {
-        result.nodes.insert(result.nodes.begin(), parentIndex);
-        parentIndex = mParents[threadIndex][parentIndex];
+        simplifyPath(scene, probes, visGraph, visTester, start, end, radius, threshold, realTimeVis, parents);
     }
 
+    reconstructPath(parents, end, -1, probes.numProbes(), result.nodes);
+
     result.valid = true;
     return result;
 }
 
+void PathFinder::reconstructPath(const int* parents,
+                                 int end,
+                                 int stop,
+                                 int maxLength,
+                                 vector<int>& nodes)
+{
+    auto length = 0;
+    for (auto node = parents[end]; node >= 0 && node != stop && length < maxLength; node = parents[node])
+    {
+        ++length;
+    }
+
+    nodes.resize(length);
+
+    auto node = parents[end];
+    for (auto i = length - 1; i >= 0; --i)
+    {
+        nodes[i] = node;
+        node = parents[node];
+    }
+}
+
 void PathFinder::simplifyPath(const IScene& scene,
                               const ProbeBatch& probes,
                               const ProbeVisibilityGraph& visGraph,
@@ -279,10 +461,4 @@ void PathFinder::simplifyPath(const IScene& scene,
     }
 }
 
-bool operator<(const PathFinder::PriorityQueueEntry& lhs,
-               const PathFinder::PriorityQueueEntry& rhs)
-{
-    return (lhs.cost > rhs.cost);
-}
-
 }
@@ -53,26 +53,78 @@ public:
 
 
 // --------------------------------------------------------------------------------------------------------------------
-// PathFinder
+// RadixHeap
 // --------------------------------------------------------------------------------------------------------------------
 
-// Finds paths between pairs of probes (at run-time) or from one probe to all other probes (when baking), using
-// information in a visibility graph.
-class PathFinder
+// A monotone priority queue of nodes keyed by non-negative float costs, for use with Dijkstra-style searches in which
+// the cost of every node pushed is at least the cost of the node most recently popped. Costs are compared using their
+// bit patterns, and each node is kept in a bucket according to the highest bit in which its cost differs from the
+// most recently popped cost. Push is O(1), and each node is moved between buckets at most 32 times in total. Bucket
+// storage is retained across searches, so after the first few searches, no memory is allocated.
+class RadixHeap
 {
 public:
-    struct PriorityQueueEntry
+    struct Entry
     {
         int nodeIndex;
         float cost;
     };
 
+    RadixHeap();
+
+    bool empty() const
+    {
+        return (mSize == 0);
+    }
+
+    int size() const
+    {
+        return mSize;
+    }
+
+    // Removes all nodes, and allows costs to start again from zero.
+    void clear();
+
+    // Adds a node. Costs lower than that of the most recently popped node are treated as being equal to it.
+    void push(int nodeIndex,
+              float cost);
+
+    // Returns the node with the lowest cost.
+    const Entry& top();
+
+    // Removes the node with the lowest cost.
+    void pop();
+
+private:
+    static const int kNumBuckets = 33;
+
+    vector<Entry> mBuckets[kNumBuckets];
+    uint32_t mLastKey;
+    int mSize;
+
+    static uint32_t key(float cost);
+
+    int bucketIndex(uint32_t key) const;
+};
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// PathFinder
+// --------------------------------------------------------------------------------------------------------------------
+
+// Finds paths between pairs of probes (at run-time) or from one probe to all other probes (when baking), using
+// information in a visibility graph.
+class PathFinder
+{
+public:
     // Initializes a PathFinder.
     PathFinder(const ProbeBatch& probes,
                int numThreads);
 
     // Finds shortest paths from the start probe to every other probe. Intended for use when baking paths as a
-    // preprocess.
+    // preprocess. Since a path is only valid if all of its probes are within pathRange of the start probe, the search
+    // never visits probes outside this range. Paths are written into the existing storage of each element of paths,
+    // so no memory is allocated once it has grown large enough.
     void findAllShortestPaths(const IScene& scene,
                               const ProbeBatch& probes,
                               const ProbeVisibilityGraph& visGraph,
@@ -84,7 +136,9 @@ public:
                               ProbePath* paths) const;
 
     // Finds the shortest path from the start probe to the end probe. Intended for use when recalculating paths
-    // on the fly.
+    // on the fly. Uses a bidirectional A* search, which stops as soon as the shortest path is known, and only touches
+    // per-probe state for the probes it visits. As with baked paths, only probes within pathRange of both the start
+    // and end probes are searched.
     ProbePath findShortestPath(const IScene& scene,
                                const ProbeBatch& probes,
                                const ProbeVisibilityGraph& visGraph,
@@ -94,6 +148,7 @@ public:
                                float radius,
                                float threshold,
                                float visRange,
+                               float pathRange,
                                bool simplifyPaths,
                                bool realTimeVis,
                                int threadIndex = 0) const;
@@ -101,7 +156,12 @@ public:
 private:
     Array<int, 2> mParents; // Per-thread array indicating the predecessor of each node, used during path finding.
     Array<float, 2> mCosts; // Per-thread array indicating the cost of each node, used during path finding.
-    mutable vector<priority_queue<PriorityQueueEntry>> mPriorityQueue; // Per-thread priority queues for use during path finding.
+    Array<int, 2> mBackwardParents; // Per-thread array indicating the successor of each node, used by the backward half of a bidirectional search.
+    Array<float, 2> mBackwardCosts; // Per-thread array indicating the cost to the end node, used by the backward half of a bidirectional search.
+    Array<uint32_t, 2> mVisitStamps; // Per-thread array indicating the search in which each node's state was last initialized.
+    mutable vector<uint32_t> mSearchStamps; // Per-thread stamp of the most recent search.
+    mutable vector<RadixHeap> mPriorityQueue; // Per-thread priority queues for use during path finding.
+    mutable vector<RadixHeap> mBackwardPriorityQueue; // Per-thread priority queues for the backward half of a bidirectional search.
 
     // Simplifies paths computed by findShortestPath. Typically, the visGraph passed to findShortestPath will have a
     // shorter visibility range than what was used for baking, for perf reasons. This can cause paths to be jagged.
@@ -117,9 +177,15 @@ private:
                       float threshold,
                       bool realTimeVis,
                       int* parents) const;
-};
 
-bool operator<(const PathFinder::PriorityQueueEntry& lhs,
-               const PathFinder::PriorityQueueEntry& rhs);
+    // Follows parents back from end, and writes the probes found along the way into nodes, in order from the
+    // earliest to the latest. Stops at (and does not include) the probe stop, or after the first probe with no parent.
+    // The length of the path is found first, so nodes is resized at most once.
+    static void reconstructPath(const int* parents,
+                                int end,
+                                int stop,
+                                int maxLength,
+                                vector<int>& nodes);
+};
 
 }
@@ -34,9 +34,10 @@ bool PathSimulator::sEnablePathsFromAllSourceProbes = false;
 PathSimulator::PathSimulator(const ProbeBatch& probes,
                              int numSamples,
                              bool asymmetricVisRange,
-                             const Vector3f& down)
+                             const Vector3f& down,
+                             int numThreads)
     : mVisTester(numSamples, asymmetricVisRange, down)
-    , mPathFinder(probes, 1)
+    , mPathFinder(probes, numThreads)
 {}
 
 bool PathSimulator::isPathOccluded(const SoundPath& path,
@@ -142,7 +143,8 @@ bool PathSimulator::findPaths(const Vector3f& source,
                               float* distanceRatio,
                               ValidationRayVisualizationCallback validationRayVisualization,
                               void* userData,
-                              bool forceDirectOcclusion)
+                              bool forceDirectOcclusion,
+                              int threadIndex)
 {
     PROFILE_FUNCTION();
 
@@ -172,14 +174,14 @@ bool PathSimulator::findPaths(const Vector3f& source,
                     {
                         findPathsFromSourceProbe(scene, probes, sourceProbes, listenerProbes, bakedPathData, i, sourceProbes.weights[i],
                                                  radius, threshold, visRange, enableValidation, findAlternatePaths, simplifyPaths, realTimeVis,
-                                                 validationRayVisualization, userData, numPaths, paths, pathWeights, starts, ends);
+                                                 validationRayVisualization, userData, threadIndex, numPaths, paths, pathWeights, starts, ends);
                     }
                 }
                 else
                 {
                     findPathsFromSourceProbe(scene, probes, sourceProbes, listenerProbes, bakedPathData, sourceProbes.findNearest(source), 1.0f,
                                              radius, threshold, visRange, enableValidation, findAlternatePaths, simplifyPaths, realTimeVis,
-                                             validationRayVisualization, userData, numPaths, paths, pathWeights, starts, ends);
+                                             validationRayVisualization, userData, threadIndex, numPaths, paths, pathWeights, starts, ends);
                 }
             }
         }
@@ -226,6 +228,7 @@ void PathSimulator::findPathsFromSourceProbe(const IScene& scene,
                                              bool realTimeVis,
                                              ValidationRayVisualizationCallback validationRayVisualization,
                                              void* userData,
+                                             int threadIndex,
                                              int& numPaths,
                                              SoundPath* paths,
                                              float* pathWeights,
@@ -242,7 +245,7 @@ void PathSimulator::findPathsFromSourceProbe(const IScene& scene,
         findPathsFromSourceProbeToListenerProbe(scene, probes, listenerProbes, bakedPathData, sourceProbeIndex, sourceProbeWeight, i,
                                                 radius, threshold, visRange, enableValidation, findAlternatePaths,
                                                 simplifyPaths, realTimeVis, validationRayVisualization, userData,
-                                                numPaths, paths, pathWeights, starts, ends);
+                                                threadIndex, numPaths, paths, pathWeights, starts, ends);
     }
 }
 
@@ -262,6 +265,7 @@ void PathSimulator::findPathsFromSourceProbeToListenerProbe(const IScene& scene,
                                                             bool realTimeVis,
                                                             ValidationRayVisualizationCallback validationRayVisualization,
                                                             void* userData,
+                                                            int threadIndex,
                                                             int& numPaths,
                                                             SoundPath* paths,
                                                             float* pathWeights,
@@ -294,7 +298,8 @@ void PathSimulator::findPathsFromSourceProbeToListenerProbe(const IScene& scene,
         ProbePath probePath;
         probePath = mPathFinder.findShortestPath(scene, probes, bakedPathData.visGraph(),
                                                  mVisTester, sourceProbeIndex, listenerProbeIndex, radius,
-                                                 threshold, visRange, simplifyPaths, realTimeVis);
+                                                 threshold, visRange, bakedPathData.pathRange(), simplifyPaths,
+                                                 realTimeVis, threadIndex);
 
         soundPath = SoundPath(probePath, probes);
     }
@@ -340,7 +345,7 @@ SoundPath PathSimulator::findShortestPathFromSourceProbeToListenerProbe(const IS
     {
         probePath = mPathFinder.findShortestPath(scene, probes, bakedPathData.visGraph(),
             mVisTester, sourceProbeIndex, listenerProbeIndex, radius,
-            threshold, visRange, simplifyPaths, realTimeVis);
+            threshold, visRange, bakedPathData.pathRange(), simplifyPaths, realTimeVis);
 
         soundPath = SoundPath(probePath, probes);
     }
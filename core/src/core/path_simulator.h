@@ -36,11 +36,13 @@ class PathSimulator
 public:
     static bool sEnablePathsFromAllSourceProbes;
 
-    // Initializes the simulator.
+    // Initializes the simulator. If numThreads is greater than 1, findPaths can be called concurrently from up to
+    // numThreads threads, each with a different threadIndex.
     PathSimulator(const ProbeBatch& probes,
                   int numSamples,
                   bool asymmetricVisRange,
-                  const Vector3f& down);
+                  const Vector3f& down,
+                  int numThreads = 1);
 
     // Calculates an Ambisonics sound field describing one or more paths from the source to the listener. The sound
     // field is described using two components: SH coefficients describing the directional distribution of sound, and
@@ -65,7 +67,8 @@ public:
                    float* distanceRatio = nullptr,
                    ValidationRayVisualizationCallback validationRayVisualization = nullptr,
                    void* userData = nullptr,
-                   bool forceDirectOcclusion = false);
+                   bool forceDirectOcclusion = false,
+                   int threadIndex = 0);
 
     SoundPath findShortestPathFromSourceProbeToListenerProbe(const IScene& scene, const ProbeBatch& probes,
         int sourceProbeIndex, int listenerProbeIndex, const BakedPathData& bakedPathData, float radius, float threshold,
@@ -92,6 +95,7 @@ private:
                                   bool realTimeVis,
                                   ValidationRayVisualizationCallback validationRayVisualization,
                                   void* userData,
+                                  int threadIndex,
                                   int& numPaths,
                                   SoundPath* paths,
                                   float* pathWeights,
@@ -114,6 +118,7 @@ private:
                                                  bool realTimeVis,
                                                  ValidationRayVisualizationCallback validationRayVisualization,
                                                  void* userData,
+                                                 int threadIndex,
                                                  int& numPaths,
                                                  SoundPath* paths,
                                                  float* pathWeights,
@@ -315,6 +315,23 @@ typedef struct {
 */
 IPLAPI IPLerror IPLCALL iplSerializedObjectCreate(IPLContext context, IPLSerializedObjectSettings* settings, IPLSerializedObject* serializedObject);
 
+/** Creates a serialized object containing the contents of a file. Instead of reading the whole file into memory,
+    the file is memory-mapped, so its contents are only read from disk when they are accessed.
+
+    Probe batches loaded from a serialized object created using this function keep a reference to the mapped file,
+    and read baked reflections data directly from it, without copying the data for each probe into separately
+    allocated memory. This way, load times and resident memory scale with the probes whose baked data is actually
+    used, rather than with the total size of the baked data. The file must not be modified while any such probe
+    batch exists.
+
+    \param  context             The context used to initialize Steam Audio.
+    \param  fileName            Name of the file to map.
+    \param  serializedObject    [out] The created serialized object.
+
+    \return Status code indicating whether or not the operation succeeded.
+*/
+IPLAPI IPLerror IPLCALL iplSerializedObjectCreateFromFile(IPLContext context, IPLstring fileName, IPLSerializedObject* serializedObject);
+
 /** Retains an additional reference to a serialized object.
 
     \param  serializedObject    The serialized object to retain a reference to.
@@ -919,6 +936,12 @@ typedef struct {
 
     /** Handle to a Radeon Rays device. Only for \c IPL_SCENETYPE_RADEONRAYS. */
     IPLRadeonRaysDevice radeonRaysDevice;
+
+    /** Number of threads used to build the acceleration structures of large static meshes, both when they are created
+        and when they are rebuilt by \c iplSceneCommit or \c iplSceneCommitWithFlags. The threads are created along
+        with the scene and reused for all static meshes in it. If less than 2, acceleration structures are built
+        serially on the calling thread. Only for \c IPL_SCENETYPE_DEFAULT. */
+    IPLint32 numBuildThreads;
 } IPLSceneSettings;
 
 /** Settings used to create a static mesh. */
@@ -954,6 +977,16 @@ typedef struct {
     IPLMatrix4x4 transform;
 } IPLInstancedMeshSettings;
 
+/** Flags that control how changes to the geometry of static meshes are applied when committing a scene. */
+typedef enum {
+    /** Only refit the acceleration structures of deformed static meshes, never rebuild them. Refitting is fast, but
+        ray tracing performance degrades as the geometry deforms further away from its original shape. */
+    IPL_SCENECOMMITFLAGS_REFITONLY = 1 << 0,
+
+    /** Rebuild the acceleration structures of deformed static meshes from scratch. */
+    IPL_SCENECOMMITFLAGS_FORCEREBUILD = 1 << 1
+} IPLSceneCommitFlags;
+
 /** Creates a scene.
 
     A scene does not store any geometry information on its own; for that you need to create one or more
@@ -1026,15 +1059,32 @@ IPLAPI void IPLCALL iplSceneSaveOBJ(IPLScene scene, IPLstring fileBaseName);
     -   \c iplInstancedMeshAdd
     -   \c iplInstancedMeshRemove
     -   \c iplInstancedMeshUpdateTransform
+    -   \c iplStaticMeshUpdateVertices
 
     For best performance, call this function once after all changes have been made for a given frame.
 
+    The acceleration structures of static meshes whose vertices have been updated are refitted, and rebuilt only if
+    refitting has degraded ray tracing performance too much. Use \c iplSceneCommitWithFlags to control this behavior.
+
     **This function cannot be called concurrently with any simulation functions.**
 
     \param  scene   The scene to commit changes to.
 */
 IPLAPI void IPLCALL iplSceneCommit(IPLScene scene);
 
+/** Commits any changes to the scene, using the given flags to control how changes to the geometry of static meshes
+    are applied.
+
+    Flags are ignored for scenes not created with \c IPL_SCENETYPE_DEFAULT. Otherwise, this function is identical
+    to \c iplSceneCommit.
+
+    **This function cannot be called concurrently with any simulation functions.**
+
+    \param  scene   The scene to commit changes to.
+    \param  flags   Flags that control how changes to the geometry of static meshes are applied.
+*/
+IPLAPI void IPLCALL iplSceneCommitWithFlags(IPLScene scene, IPLSceneCommitFlags flags);
+
 /** Creates a static mesh.
 
     A static mesh represents a triangle mesh that does not change after it is created. A static mesh also contains
@@ -1115,6 +1165,24 @@ IPLAPI void IPLCALL iplStaticMeshAdd(IPLStaticMesh staticMesh, IPLScene scene);
 */
 IPLAPI void IPLCALL iplStaticMeshRemove(IPLStaticMesh staticMesh, IPLScene scene);
 
+/** Updates the positions of the vertices of a static mesh, e.g., for geometry that deforms over time. The triangles
+    and materials of the static mesh remain unchanged. This is much cheaper than removing the static mesh and
+    creating a new one.
+
+    **This function can only be called on a static mesh that is part of a scene created with
+    \c IPL_SCENETYPE_DEFAULT.**
+
+    After calling this function, \c iplSceneCommit must be called for the changes to take effect.
+
+    \param  staticMesh  The static mesh whose vertices should be updated.
+    \param  scene       The scene containing the static mesh. This must be the scene which was passed when
+                        calling \c iplStaticMeshCreate.
+    \param  numVertices Number of vertices. This must be the same as the number of vertices with which the static
+                        mesh was created.
+    \param  vertices    Array containing the new positions of all vertices.
+*/
+IPLAPI void IPLCALL iplStaticMeshUpdateVertices(IPLStaticMesh staticMesh, IPLScene scene, IPLint32 numVertices, IPLVector3* vertices);
+
 /** Creates an instanced mesh.
 
     An instanced mesh takes one scene and positions it within another scene. This is useful if you have the
@@ -2479,6 +2547,12 @@ typedef struct {
 
     /** Number of channels in the IR. */
     IPLint32 numChannels;
+
+    /** If \c IPL_TRUE, the IR is split into partitions of increasing size. The start of the IR is processed in
+        frame-sized partitions with no added latency, and later parts of the IR are processed in larger partitions, on
+        a background thread. This significantly reduces CPU usage on the audio thread for long IRs. For
+        \c IPL_REFLECTIONEFFECTTYPE_CONVOLUTION. Ignored when creating a reflection mixer. */
+    IPLbool nonUniformPartitioning;
 } IPLReflectionEffectSettings;
 
 /** Parameters for applying a reflection effect to an audio buffer. */
@@ -3021,6 +3095,12 @@ typedef enum {
 
     /** Bake parametric reverb for \c IPL_REFLECTIONEFFECTTYPE_PARAMETRIC or \c IPL_REFLECTIONEFFECTTYPE_HYBRID. */
     IPL_REFLECTIONSBAKEFLAGS_BAKEPARAMETRIC = 1 << 1,
+
+    /** Store the data baked for \c IPL_REFLECTIONSBAKEFLAGS_BAKECONVOLUTION using 8 bits per value instead of 32,
+        reducing its size by about 4x. Values are stored with an error of at most about 0.3 dB, and values more than
+        about 84 dB below the loudest value for each channel and frequency band are stored as zero. The data is kept
+        in compressed form after loading, and decoded when it is looked up during simulation. */
+    IPL_REFLECTIONSBAKEFLAGS_COMPRESSCONVOLUTION = 1 << 2,
 } IPLReflectionsBakeFlags;
 
 /** Parameters used to control how reflections data is baked. */
@@ -3414,7 +3494,10 @@ typedef struct {
     /** The maximum number of sources for which reflection simulations will be run at any given time. */
     IPLint32 maxNumSources;
 
-    /** The number of threads used for real-time reflection simulations. */
+    /** The number of threads used for real-time simulations. If reflections are simulated along with direct sound
+        or pathing, and there are at least 8 threads, a quarter of them are used for direct and pathing
+        simulations, and the rest are used for reflection simulations. Otherwise, all of them are used for
+        reflection simulations, and direct and pathing simulations run on the calling thread. */
     IPLint32 numThreads;
 
     /** If using custom ray tracer callbacks, this the number of rays that will be passed to the callbacks
@@ -3442,6 +3525,10 @@ typedef struct {
 
     /** The TrueAudio Next device being used. Only necessary if \c reflectionType is \c IPL_REFLECTIONEFFECTTYPE_TAN. */
     IPLTrueAudioNextDevice tanDevice;
+
+    /** The maximum number of listeners for which reflections can be simulated in a single call to
+        \c iplSimulatorRunReflections. Values less than 1 are treated as 1. */
+    IPLint32 maxNumListeners;
 } IPLSimulationSettings;
 
 /** Settings used to create a source. */
@@ -3542,6 +3629,14 @@ typedef struct {
         results when multiple surfaces lie between the source and the listener, at the cost of
         increased CPU usage. */
     IPLint32 numTransmissionRays;
+
+    /** If \c IPL_TRUE, and using volumetric occlusion, the visibility of each point sample is remembered across
+        simulation runs, and only some of the point samples are traced again each time direct simulation is run.
+        More point samples are traced while the occlusion value is changing quickly. No rays are traced if the
+        source, the listener, and the scene have not changed since all point samples were last traced. This
+        significantly reduces the number of rays traced per simulation run, at the cost of occlusion taking a few
+        simulation runs to fully respond to changes. */
+    IPLbool temporalOcclusion;
 } IPLSimulationInputs;
 
 /** Callback for visualizing valid path segments during call to \c iplSimulatorRunPathing.
@@ -3591,6 +3686,60 @@ typedef struct {
     /** Pointer to arbitrary user-specified data provided when calling the function that will
         call this callback.*/
     void* pathingUserData;
+
+    /** If \c IPL_TRUE, when simulating reflections, sources are grouped into clusters at each point where a ray
+        hits a surface, and all sources in a cluster share a single visibility test. This reduces the number of
+        rays traced in scenes with many sources, at the cost of some accuracy. Only supported when using
+        \c IPL_SCENETYPE_DEFAULT; ignored otherwise. */
+    IPLbool clusterSources;
+
+    /** If clustering sources, a cluster is split into smaller clusters if its estimated error is more than this
+        fraction of the total energy reaching the surface from all sources. The estimate is a heuristic, so the
+        actual error may be larger. Lower values result in more accurate reflections, at the cost of tracing more
+        rays. */
+    IPLfloat32 maxClusteringError;
+
+    /** If \c IPL_TRUE, when simulating reflections, rays whose remaining energy is low are terminated at random
+        after each bounce, and the energy of rays that survive is scaled up to compensate. This reduces the number
+        of rays traced in absorptive scenes without changing the expected results, at the cost of some extra
+        noise. Only supported when using \c IPL_SCENETYPE_DEFAULT; ignored otherwise. */
+    IPLbool russianRoulette;
+
+    /** If using Russian roulette, a ray is only considered for termination once its remaining energy in every band
+        is below this fraction of its initial energy. Higher values terminate more rays, at the cost of more noise. */
+    IPLfloat32 survivalThreshold;
+
+    /** If \c IPL_TRUE, when simulating reflections, each diffuse reflection direction is rotated about the surface
+        normal by a random angle, so that rays are not restricted to the \c numDiffuseSamples directions specified
+        when creating the simulator. Results will differ from those with this set to \c IPL_FALSE. Only supported
+        when using \c IPL_SCENETYPE_DEFAULT; ignored otherwise. */
+    IPLbool rotateDiffuseSamples;
+
+    /** If \c IPL_TRUE, when simulating reflections, paths traced in earlier calls to \c iplSimulatorRunReflections
+        are kept and reused, so results converge with fewer rays traced per call. When the listener moves, cached
+        paths are reprojected to the new listener position. Cached paths are discarded whenever the scene
+        changes. Only supported when using \c IPL_SCENETYPE_DEFAULT; ignored otherwise. */
+    IPLbool cachePaths;
+
+    /** If caching paths, the number of paths kept for each ray. Higher values result in smoother reflections, at the
+        cost of more memory, and of reflections that take longer to adapt after the listener moves. */
+    IPLint32 pathHistoryLength;
+
+    /** The number of listeners, other than \c listener, for which reflections are simulated. Listeners beyond
+        \c maxNumListeners - 1, as specified when creating the simulator, are ignored. Results for each listener
+        can be retrieved using \c iplSourceGetListenerReflectionOutputs. Baked reflections are only looked up for
+        \c listener. */
+    IPLint32 numAdditionalListeners;
+
+    /** Array containing \c numAdditionalListeners listener coordinate systems. */
+    IPLCoordinateSpace3* additionalListeners;
+
+    /** If \c IPL_TRUE, when simulating reflections for more than one listener, rays are only traced in full from
+        \c listener. For each additional listener, rays that hit a surface close to where the same ray from
+        \c listener hit it reuse the rest of that ray's path. This makes additional listeners that are near
+        \c listener much cheaper to simulate, at the cost of some accuracy. Ignored if caching paths. Only supported
+        when using \c IPL_SCENETYPE_DEFAULT; ignored otherwise. */
+    IPLbool shareListenerPaths;
 } IPLSimulationSharedInputs;
 
 /** Simulation results for a source. */
@@ -3664,6 +3813,74 @@ IPLAPI void IPLCALL iplSimulatorAddProbeBatch(IPLSimulator simulator, IPLProbeBa
 */
 IPLAPI void IPLCALL iplSimulatorRemoveProbeBatch(IPLSimulator simulator, IPLProbeBatch probeBatch);
 
+/** Settings used for streaming baked data from probe batches added using \c iplSimulatorAddStreamedProbeBatch. */
+typedef struct {
+    /** Maximum number of bytes of baked data from streamed probe batches to keep in memory. Tiles that are not needed
+        are evicted, least recently used first, to stay within this budget. */
+    IPLsize memoryBudget;
+
+    /** Tiles whose probes are within this distance (in meters) of the listener, or of any source that uses baked
+        data with a static listener, are loaded in the background. */
+    IPLfloat32 prefetchRadius;
+} IPLProbeStreamingSettings;
+
+/** Statistics describing the current state of probe batch streaming. */
+typedef struct {
+    /** Total number of tiles in all streamed probe batches. */
+    IPLint32 numTiles;
+
+    /** Number of tiles whose baked data is currently in memory. */
+    IPLint32 numResidentTiles;
+
+    /** Number of tiles currently waiting to be loaded, or being loaded. */
+    IPLint32 numLoadingTiles;
+
+    /** Number of bytes of baked data currently in memory. */
+    IPLsize residentBytes;
+
+    /** Total number of tiles loaded so far. */
+    IPLuint64 numLoads;
+
+    /** Total number of tiles evicted so far. */
+    IPLuint64 numEvictions;
+} IPLProbeStreamingStats;
+
+/** Adds a probe batch whose baked data is streamed in and out of memory as needed, for use in subsequent simulations.
+
+    The probe batch is partitioned into cubical tiles of a given size. Tiles near the listener and sources are loaded
+    on a background thread, and evicted when no longer needed, subject to the memory budget specified using
+    \c iplSimulatorSetProbeStreamingSettings. While a tile that is needed for a source is still loading, the source
+    continues to use the results of its most recent baked data lookup.
+
+    Only baked reflections data is streamed. For streaming to reduce memory usage, the probe batch should be loaded
+    from a serialized object created using \c iplSerializedObjectCreateFromFile. The probe batch must not be
+    modified while it is being streamed. Remove it using \c iplSimulatorRemoveProbeBatch.
+
+    Call \c iplSimulatorCommit after calling this function for the changes to take effect.
+
+    This function cannot be called while any simulation is running.
+
+    \param  simulator   The simulator being used.
+    \param  probeBatch  The probe batch to add.
+    \param  tileSize    Size (in meters) of each tile.
+*/
+IPLAPI void IPLCALL iplSimulatorAddStreamedProbeBatch(IPLSimulator simulator, IPLProbeBatch probeBatch, IPLfloat32 tileSize);
+
+/** Specifies the memory budget and prefetch radius used for streaming probe batches.
+
+    \param  simulator   The simulator being used.
+    \param  settings    The streaming settings to use.
+*/
+IPLAPI void IPLCALL iplSimulatorSetProbeStreamingSettings(IPLSimulator simulator, IPLProbeStreamingSettings* settings);
+
+/** Retrieves statistics describing the current state of probe batch streaming. The statistics are updated each time
+    \c iplSimulatorRunReflections is called.
+
+    \param  simulator   The simulator being used.
+    \param  stats       [out] The streaming statistics.
+*/
+IPLAPI void IPLCALL iplSimulatorGetProbeStreamingStats(IPLSimulator simulator, IPLProbeStreamingStats* stats);
+
 /** Specifies simulation parameters that are not associated with any particular source.
 
     \param  simulator       The simulator being used.
@@ -3774,6 +3991,17 @@ IPLAPI void IPLCALL iplSourceSetInputs(IPLSource source, IPLSimulationFlags flag
 */
 IPLAPI void IPLCALL iplSourceGetOutputs(IPLSource source, IPLSimulationFlags flags, IPLSimulationOutputs* outputs);
 
+/** Retrieves reflection simulation results for a source, as heard by one of the listeners for which reflections are
+    simulated.
+
+    \param  source          The source to retrieve results for.
+    \param  listenerIndex   Index of the listener. 0 is \c listener in \c IPLSimulationSharedInputs, and 1 onwards
+                            are the entries of \c additionalListeners.
+    \param  params          [out] The reflection simulation results. Left unchanged if \c listenerIndex is not less
+                            than the \c maxNumListeners specified when creating the simulator.
+*/
+IPLAPI void IPLCALL iplSourceGetListenerReflectionOutputs(IPLSource source, IPLint32 listenerIndex, IPLReflectionEffectParams* params);
+
 /** \} */
 
 /*********************************************************************************************************************/
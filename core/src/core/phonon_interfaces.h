@@ -66,6 +66,9 @@ public:
     virtual IPLerror createSerializedObject(IPLSerializedObjectSettings* settings,
                                             ISerializedObject** serializedObject) = 0;
 
+    virtual IPLerror createSerializedObjectFromFile(IPLstring fileName,
+                                                    ISerializedObject** serializedObject) = 0;
+
     virtual IPLerror createEmbreeDevice(IPLEmbreeDeviceSettings* settings,
                                         IEmbreeDevice** device) = 0;
 
@@ -286,6 +289,8 @@ public:
 
     virtual IPLerror createInstancedMesh(IPLInstancedMeshSettings* settings,
                                          IInstancedMesh** instancedMesh) = 0;
+
+    virtual void commitWithFlags(IPLSceneCommitFlags flags) = 0;
 };
 
 class IStaticMesh
@@ -300,6 +305,10 @@ public:
     virtual void add(IScene* scene) = 0;
 
     virtual void remove(IScene* scene) = 0;
+
+    virtual void updateVertices(IScene* scene,
+                                IPLint32 numVertices,
+                                IPLVector3* vertices) = 0;
 };
 
 class IInstancedMesh
@@ -603,6 +612,13 @@ public:
 
     virtual IPLerror createSource(IPLSourceSettings* settings,
                                   ISource** source) = 0;
+
+    virtual void addStreamedProbeBatch(IProbeBatch* probeBatch,
+                                       IPLfloat32 tileSize) = 0;
+
+    virtual void setProbeStreamingSettings(IPLProbeStreamingSettings* settings) = 0;
+
+    virtual void getProbeStreamingStats(IPLProbeStreamingStats* stats) = 0;
 };
 
 class ISource
@@ -621,6 +637,9 @@ public:
 
     virtual void getOutputs(IPLSimulationFlags flags,
                             IPLSimulationOutputs* outputs) = 0;
+
+    virtual void getListenerReflectionOutputs(IPLint32 listenerIndex,
+                                              IPLReflectionEffectParams* params) = 0;
 };
 
 }
@@ -675,6 +694,16 @@ IPLerror IPLCALL iplSerializedObjectCreate(IPLContext context,
     return reinterpret_cast<api::IContext*>(context)->createSerializedObject(settings, reinterpret_cast<api::ISerializedObject**>(serializedObject));
 }
 
+IPLerror IPLCALL iplSerializedObjectCreateFromFile(IPLContext context,
+                                                   IPLstring fileName,
+                                                   IPLSerializedObject* serializedObject)
+{
+    if (!context)
+        return IPL_STATUS_FAILURE;
+
+    return reinterpret_cast<api::IContext*>(context)->createSerializedObjectFromFile(fileName, reinterpret_cast<api::ISerializedObject**>(serializedObject));
+}
+
 IPLSerializedObject IPLCALL iplSerializedObjectRetain(IPLSerializedObject serializedObject)
 {
     if (!serializedObject)
@@ -948,6 +977,14 @@ void IPLCALL iplSceneCommit(IPLScene scene)
     reinterpret_cast<api::IScene*>(scene)->commit();
 }
 
+void IPLCALL iplSceneCommitWithFlags(IPLScene scene, IPLSceneCommitFlags flags)
+{
+    if (!scene)
+        return;
+
+    reinterpret_cast<api::IScene*>(scene)->commitWithFlags(flags);
+}
+
 IPLerror IPLCALL iplStaticMeshCreate(IPLScene scene,
                              IPLStaticMeshSettings* settings,
                              IPLStaticMesh* staticMesh)
@@ -1015,6 +1052,14 @@ void IPLCALL iplStaticMeshRemove(IPLStaticMesh staticMesh, IPLScene scene)
     reinterpret_cast<api::IStaticMesh*>(staticMesh)->remove(reinterpret_cast<api::IScene*>(scene));
 }
 
+void IPLCALL iplStaticMeshUpdateVertices(IPLStaticMesh staticMesh, IPLScene scene, IPLint32 numVertices, IPLVector3* vertices)
+{
+    if (!staticMesh)
+        return;
+
+    reinterpret_cast<api::IStaticMesh*>(staticMesh)->updateVertices(reinterpret_cast<api::IScene*>(scene), numVertices, vertices);
+}
+
 IPLerror IPLCALL iplInstancedMeshCreate(IPLScene scene,
                                 IPLInstancedMeshSettings* settings,
                                 IPLInstancedMesh* instancedMesh)
@@ -2215,6 +2260,30 @@ void IPLCALL iplSimulatorRemoveProbeBatch(IPLSimulator simulator, IPLProbeBatch
     reinterpret_cast<api::ISimulator*>(simulator)->removeProbeBatch(reinterpret_cast<api::IProbeBatch*>(probeBatch));
 }
 
+void IPLCALL iplSimulatorAddStreamedProbeBatch(IPLSimulator simulator, IPLProbeBatch probeBatch, IPLfloat32 tileSize)
+{
+    if (!simulator)
+        return;
+
+    reinterpret_cast<api::ISimulator*>(simulator)->addStreamedProbeBatch(reinterpret_cast<api::IProbeBatch*>(probeBatch), tileSize);
+}
+
+void IPLCALL iplSimulatorSetProbeStreamingSettings(IPLSimulator simulator, IPLProbeStreamingSettings* settings)
+{
+    if (!simulator)
+        return;
+
+    reinterpret_cast<api::ISimulator*>(simulator)->setProbeStreamingSettings(settings);
+}
+
+void IPLCALL iplSimulatorGetProbeStreamingStats(IPLSimulator simulator, IPLProbeStreamingStats* stats)
+{
+    if (!simulator)
+        return;
+
+    reinterpret_cast<api::ISimulator*>(simulator)->getProbeStreamingStats(stats);
+}
+
 void IPLCALL iplSimulatorSetSharedInputs(IPLSimulator simulator,
                                  IPLSimulationFlags flags,
                                  IPLSimulationSharedInputs* sharedInputs)
@@ -2321,6 +2390,16 @@ void IPLCALL iplSourceGetOutputs(IPLSource source,
     reinterpret_cast<api::ISource*>(source)->getOutputs(flags, outputs);
 }
 
+void IPLCALL iplSourceGetListenerReflectionOutputs(IPLSource source,
+                                           IPLint32 listenerIndex,
+                                           IPLReflectionEffectParams* params)
+{
+    if (!source)
+        return;
+
+    reinterpret_cast<api::ISource*>(source)->getListenerReflectionOutputs(listenerIndex, params);
+}
+
 IPLfloat32 IPLCALL iplDistanceAttenuationCalculate(IPLContext context,
                                            IPLVector3 source,
                                            IPLVector3 listener,
@@ -25,7 +25,8 @@ namespace ipl {
 // ProbeBatch
 // ---------------------------------------------------------------------------------------------------------------------
 
-ProbeBatch::ProbeBatch(const Serialized::ProbeBatch* serializedObject)
+ProbeBatch::ProbeBatch(const Serialized::ProbeBatch* serializedObject,
+                       shared_ptr<const MappedFile> mappedFile)
 {
     assert(serializedObject);
     assert(serializedObject->probes() && serializedObject->probes()->Length() > 0);
@@ -48,7 +49,7 @@ ProbeBatch::ProbeBatch(const Serialized::ProbeBatch* serializedObject)
 
         if (identifier.type == BakedDataType::Reflections)
         {
-            data = ipl::make_unique<BakedReflectionsData>(identifier, numProbes, serializedObject->data_layers()->Get(i)->reflections_data());
+            data = ipl::make_unique<BakedReflectionsData>(identifier, numProbes, serializedObject->data_layers()->Get(i)->reflections_data(), mappedFile);
         }
         else if (identifier.type == BakedDataType::Pathing)
         {
@@ -60,7 +61,7 @@ ProbeBatch::ProbeBatch(const Serialized::ProbeBatch* serializedObject)
 }
 
 ProbeBatch::ProbeBatch(SerializedObject& serializedObject)
-    : ProbeBatch(Serialized::GetProbeBatch(serializedObject.data()))
+    : ProbeBatch(Serialized::GetProbeBatch(serializedObject.data()), serializedObject.mappedFile())
 {}
 
 void ProbeBatch::toProbeArray(ProbeArray& probeArray) const
@@ -73,6 +74,11 @@ void ProbeBatch::updateProbeRadius(int index,
                                    float radius)
 {
     mProbes[index].influence.radius = radius;
+
+    if (mProbeTree)
+    {
+        mProbeTree->updateProbe(index, mProbes[index].influence);
+    }
 }
 
 void ProbeBatch::updateProbePosition(int index,
@@ -80,6 +86,11 @@ void ProbeBatch::updateProbePosition(int index,
 {
     mProbes[index].influence.center = position;
 
+    if (mProbeTree)
+    {
+        mProbeTree->updateProbe(index, mProbes[index].influence);
+    }
+
     for (auto& data : mData)
     {
         data.second->updateProbePosition(index, position);
@@ -93,6 +104,11 @@ void ProbeBatch::addProbe(const Sphere& influence)
 
     mProbes.push_back(probe);
 
+    if (mProbeTree)
+    {
+        mProbeTree->insertProbe(influence);
+    }
+
     for (auto& data : mData)
     {
         data.second->addProbe(influence);
@@ -111,6 +127,11 @@ void ProbeBatch::removeProbe(int index)
 {
     mProbes.erase(mProbes.begin() + index);
 
+    if (mProbeTree)
+    {
+        mProbeTree->removeProbe(index);
+    }
+
     for (auto& data : mData)
     {
         data.second->removeProbe(index);
@@ -128,7 +149,12 @@ void ProbeBatch::updateEndpoint(const BakedDataIdentifier& identifier,
 
 void ProbeBatch::commit()
 {
-    mProbeTree = make_unique<ProbeTree>(static_cast<int>(mProbes.size()), mProbes.data());
+    // Once the probe tree has been built, it is kept up to date as probes are added, removed, or moved, and is only
+    // rebuilt once enough changes have accumulated to noticeably degrade it.
+    if (!mProbeTree || mProbeTree->needsRebuild())
+    {
+        mProbeTree = make_unique<ProbeTree>(static_cast<int>(mProbes.size()), mProbes.data());
+    }
 }
 
 void ProbeBatch::addData(const BakedDataIdentifier& identifier,
@@ -148,7 +174,7 @@ void ProbeBatch::getInfluencingProbes(const Vector3f& point,
 {
     assert(mProbeTree);
 
-    mProbeTree->getInfluencingProbes(point, mProbes.data(), ProbeNeighborhood::kMaxProbesPerBatch, &neighborhood.probeIndices[offset]);
+    mProbeTree->getInfluencingProbes(point, ProbeNeighborhood::kMaxProbesPerBatch, &neighborhood.probeIndices[offset]);
 
     for (auto i = 0; i < ProbeNeighborhood::kMaxProbesPerBatch; ++i)
     {
@@ -156,6 +182,34 @@ void ProbeBatch::getInfluencingProbes(const Vector3f& point,
     }
 }
 
+void ProbeBatch::getInfluencingProbes(const Vector3f* points,
+                                      ProbeNeighborhoodBatch& neighborhoods,
+                                      int offset /* = 0 */)
+{
+    assert(mProbeTree);
+
+    int* probeIndices[ProbeTree::kPacketSize];
+
+    for (auto packetStart = 0; packetStart < neighborhoods.numNeighborhoods(); packetStart += ProbeTree::kPacketSize)
+    {
+        auto packetSize = std::min(ProbeTree::kPacketSize, neighborhoods.numNeighborhoods() - packetStart);
+
+        for (auto i = 0; i < packetSize; ++i)
+        {
+            auto& neighborhood = neighborhoods[packetStart + i];
+
+            probeIndices[i] = &neighborhood.probeIndices[offset];
+
+            for (auto j = 0; j < ProbeNeighborhood::kMaxProbesPerBatch; ++j)
+            {
+                neighborhood.batches[offset + j] = this;
+            }
+        }
+
+        mProbeTree->getInfluencingProbes(packetSize, &points[packetStart], ProbeNeighborhood::kMaxProbesPerBatch, probeIndices);
+    }
+}
+
 flatbuffers::Offset<Serialized::ProbeBatch> ProbeBatch::serialize(SerializedObject& serializedObject) const
 {
     auto& fbb = serializedObject.fbb();
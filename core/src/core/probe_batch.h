@@ -91,6 +91,55 @@ public:
 };
 
 
+// ---------------------------------------------------------------------------------------------------------------------
+// ProbeNeighborhoodBatch
+// ---------------------------------------------------------------------------------------------------------------------
+
+// Probe neighborhoods for several query points, which are found, checked for occlusion, and weighted together. All
+// occlusion rays for all query points are traced with a single call to IScene::anyHits.
+class ProbeNeighborhoodBatch
+{
+public:
+    ProbeNeighborhoodBatch();
+
+    int numNeighborhoods() const
+    {
+        return mNumNeighborhoods;
+    }
+
+    ProbeNeighborhood& operator[](int index)
+    {
+        return *mNeighborhoods[index];
+    }
+
+    const ProbeNeighborhood& operator[](int index) const
+    {
+        return *mNeighborhoods[index];
+    }
+
+    // Makes numNeighborhoods neighborhoods available, each with space for maxProbes probes, and resets them.
+    void resize(int numNeighborhoods,
+                int maxProbes);
+
+    void checkOcclusion(const IScene& scene,
+                        const Vector3f* points);
+
+    void calcWeights(const Vector3f* points);
+
+private:
+    int mNumNeighborhoods;
+    vector<unique_ptr<ProbeNeighborhood>> mNeighborhoods;
+
+    // Buffers for occlusion checks
+    Array<Ray> mRays;
+    Array<float> mMinDistances;
+    Array<float> mMaxDistances;
+    Array<int> mRayNeighborhoods;
+    Array<int> mRayProbes;
+    Array<bool> mIsOccluded;
+};
+
+
 // ---------------------------------------------------------------------------------------------------------------------
 // ProbeBatch
 // ---------------------------------------------------------------------------------------------------------------------
@@ -101,7 +150,10 @@ public:
     ProbeBatch()
     {}
 
-    ProbeBatch(const Serialized::ProbeBatch* serializedObject);
+    // If mappedFile is non-null, serializedObject points into it, and baked data may keep a reference to the mapping
+    // and read from it directly instead of copying data.
+    ProbeBatch(const Serialized::ProbeBatch* serializedObject,
+               shared_ptr<const MappedFile> mappedFile = nullptr);
 
     ProbeBatch(SerializedObject& serializedObject);
 
@@ -183,6 +235,11 @@ public:
                                       ProbeNeighborhood& neighborhood,
                                       int offset = 0);
 
+    // Finds the influencing probes for neighborhoods[i] at points[i], for every neighborhood in the batch.
+    void getInfluencingProbes(const Vector3f* points,
+                              ProbeNeighborhoodBatch& neighborhoods,
+                              int offset = 0);
+
     flatbuffers::Offset<Serialized::ProbeBatch> serialize(SerializedObject& serializedObject) const;
 
     void serializeAsRoot(SerializedObject& serializedObject) const;
@@ -15,6 +15,8 @@
 //
 
 #include "probe_manager.h"
+
+#include "float4.h"
 #include "profiler.h"
 
 namespace ipl {
@@ -23,6 +25,8 @@ namespace ipl {
 // ProbeNeighborhood
 // ---------------------------------------------------------------------------------------------------------------------
 
+const int ProbeNeighborhood::kMaxProbesPerBatch;
+
 void ProbeNeighborhood::resize(int maxProbes)
 {
     batches.resize(maxProbes);
@@ -120,26 +124,173 @@ void ProbeNeighborhood::calcWeights(const Vector3f& point)
 {
     PROFILE_FUNCTION();
 
-    float totalWeight = 0.0f;
-    for (auto i = 0u; i < weights.size(0); ++i)
+    // Weights are evaluated for 4 probes at a time. Probe centers are gathered into SoA form, and invalid probes are
+    // given a weight of zero.
+    auto pointX = float4::set1(point.x());
+    auto pointY = float4::set1(point.y());
+    auto pointZ = float4::set1(point.z());
+    auto offset = float4::set1(1e-4f);
+    auto totalWeight4 = float4::zero();
+
+    float centerX[4];
+    float centerY[4];
+    float centerZ[4];
+    float isValid[4];
+
+    auto nProbes = numProbes();
+    auto i = 0;
+    for (; i + 4 <= nProbes; i += 4)
+    {
+        for (auto j = 0; j < 4; ++j)
+        {
+            const auto& center = (batches[i + j] && probeIndices[i + j] >= 0) ? (*batches[i + j])[probeIndices[i + j]].influence.center : point;
+            centerX[j] = center.x();
+            centerY[j] = center.y();
+            centerZ[j] = center.z();
+            isValid[j] = (batches[i + j] && probeIndices[i + j] >= 0) ? 1.0f : 0.0f;
+        }
+
+        auto dx = float4::sub(float4::loadu(centerX), pointX);
+        auto dy = float4::sub(float4::loadu(centerY), pointY);
+        auto dz = float4::sub(float4::loadu(centerZ), pointZ);
+        auto distance = float4::sqrt(float4::add(float4::add(float4::mul(dx, dx), float4::mul(dy, dy)), float4::mul(dz, dz)));
+
+        // Offset zero distance. Evaluate exponential weights in future.
+        auto weight = float4::div(float4::loadu(isValid), float4::add(distance, offset));
+
+        float4::storeu(&weights[i], weight);
+        totalWeight4 = float4::add(totalWeight4, weight);
+    }
+
+    float totalWeights[4];
+    float4::storeu(totalWeights, totalWeight4);
+    auto totalWeight = (totalWeights[0] + totalWeights[1]) + (totalWeights[2] + totalWeights[3]);
+
+    for (; i < nProbes; ++i)
     {
         if (batches[i] && probeIndices[i] >= 0)
         {
-            // Offset zero distance. Evaluate exponential weights in future.
             weights[i] = 1.0f / ((point - (*batches[i])[probeIndices[i]].influence.center).length() + 1e-4f);
             totalWeight += weights[i];
         }
+        else
+        {
+            weights[i] = 0.0f;
+        }
     }
 
-    for (auto i = 0u; i < weights.size(0); ++i)
+    if (totalWeight <= 0.0f)
+        return;
+
+    auto scale = float4::set1(1.0f / totalWeight);
+
+    i = 0;
+    for (; i + 4 <= nProbes; i += 4)
     {
-        if (batches[i] && probeIndices[i] >= 0)
+        float4::storeu(&weights[i], float4::mul(float4::loadu(&weights[i]), scale));
+    }
+
+    for (; i < nProbes; ++i)
+    {
+        weights[i] /= totalWeight;
+    }
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ProbeNeighborhoodBatch
+// ---------------------------------------------------------------------------------------------------------------------
+
+ProbeNeighborhoodBatch::ProbeNeighborhoodBatch()
+    : mNumNeighborhoods(0)
+{}
+
+void ProbeNeighborhoodBatch::resize(int numNeighborhoods,
+                                    int maxProbes)
+{
+    while (static_cast<int>(mNeighborhoods.size()) < numNeighborhoods)
+    {
+        mNeighborhoods.push_back(make_unique<ProbeNeighborhood>());
+    }
+
+    for (auto i = 0; i < numNeighborhoods; ++i)
+    {
+        if (mNeighborhoods[i]->numProbes() != maxProbes)
+        {
+            mNeighborhoods[i]->resize(maxProbes);
+        }
+        else
+        {
+            mNeighborhoods[i]->reset();
+        }
+    }
+
+    mNumNeighborhoods = numNeighborhoods;
+
+    auto maxRays = static_cast<size_t>(numNeighborhoods) * maxProbes;
+    if (mRays.size(0) < maxRays)
+    {
+        mRays.resize(maxRays);
+        mMinDistances.resize(maxRays);
+        mMaxDistances.resize(maxRays);
+        mRayNeighborhoods.resize(maxRays);
+        mRayProbes.resize(maxRays);
+        mIsOccluded.resize(maxRays);
+    }
+}
+
+void ProbeNeighborhoodBatch::checkOcclusion(const IScene& scene,
+                                            const Vector3f* points)
+{
+    PROFILE_FUNCTION();
+
+    auto numRays = 0;
+
+    for (auto i = 0; i < mNumNeighborhoods; ++i)
+    {
+        auto& neighborhood = *mNeighborhoods[i];
+
+        for (auto j = 0; j < neighborhood.numProbes(); ++j)
+        {
+            if (neighborhood.batches[j] && neighborhood.probeIndices[j] >= 0)
+            {
+                Vector3f dir = (*neighborhood.batches[j])[neighborhood.probeIndices[j]].influence.center - points[i];
+                mRays[numRays] = { points[i], Vector3f::unitVector(dir) };
+                mMinDistances[numRays] = 0.0f;
+                mMaxDistances[numRays] = dir.length();
+                mRayNeighborhoods[numRays] = i;
+                mRayProbes[numRays] = j;
+                ++numRays;
+            }
+        }
+    }
+
+    if (numRays == 0)
+        return;
+
+    scene.anyHits(numRays, mRays.data(), mMinDistances.data(), mMaxDistances.data(), mIsOccluded.data());
+
+    for (auto i = 0; i < numRays; ++i)
+    {
+        if (mIsOccluded[i])
         {
-            weights[i] /= totalWeight;
+            auto& neighborhood = *mNeighborhoods[mRayNeighborhoods[i]];
+            neighborhood.batches[mRayProbes[i]] = nullptr;
+            neighborhood.probeIndices[mRayProbes[i]] = -1;
         }
     }
 }
 
+void ProbeNeighborhoodBatch::calcWeights(const Vector3f* points)
+{
+    PROFILE_FUNCTION();
+
+    for (auto i = 0; i < mNumNeighborhoods; ++i)
+    {
+        mNeighborhoods[i]->calcWeights(points[i]);
+    }
+}
+
 
 // ---------------------------------------------------------------------------------------------------------------------
 // ProbeManager
@@ -150,14 +301,48 @@ void ProbeManager::addProbeBatch(shared_ptr<ProbeBatch> probeBatch)
     mProbeBatches[1].push_back(probeBatch);
 }
 
+void ProbeManager::addStreamedProbeBatch(shared_ptr<ProbeBatch> probeBatch,
+                                         float tileSize)
+{
+    mStreamedProbeBatches[1][probeBatch] = tileSize;
+}
+
 void ProbeManager::removeProbeBatch(shared_ptr<ProbeBatch> probeBatch)
 {
     mProbeBatches[1].remove(probeBatch);
+    mStreamedProbeBatches[1].erase(probeBatch);
 }
 
 void ProbeManager::commit()
 {
     mProbeBatches[0] = mProbeBatches[1];
+
+    for (const auto& probeBatch : mStreamedProbeBatches[0])
+    {
+        if (mStreamedProbeBatches[1].find(probeBatch.first) == mStreamedProbeBatches[1].end())
+        {
+            mStreamer.removeProbeBatch(probeBatch.first);
+        }
+    }
+
+    for (const auto& probeBatch : mStreamedProbeBatches[1])
+    {
+        if (mStreamedProbeBatches[0].find(probeBatch.first) == mStreamedProbeBatches[0].end())
+        {
+            mStreamer.addProbeBatch(probeBatch.first, probeBatch.second);
+        }
+    }
+
+    mStreamedProbeBatches[0] = mStreamedProbeBatches[1];
+}
+
+void ProbeManager::updateStreaming(int numPoints,
+                                   const Vector3f* points)
+{
+    if (mStreamer.numProbeBatches() > 0)
+    {
+        mStreamer.update(numPoints, points);
+    }
 }
 
 void ProbeManager::getInfluencingProbes(const Vector3f& point,
@@ -165,7 +350,10 @@ void ProbeManager::getInfluencingProbes(const Vector3f& point,
 {
     PROFILE_FUNCTION();
 
-    auto numProbes = static_cast<int>(mProbeBatches[0].size() * ProbeNeighborhood::kMaxProbesPerBatch);
+    const auto& streamedProbeBatches = mStreamer.residentProbeBatches();
+
+    auto numProbeBatches = mProbeBatches[0].size() + streamedProbeBatches.size();
+    auto numProbes = static_cast<int>(numProbeBatches * ProbeNeighborhood::kMaxProbesPerBatch);
     if (neighborhood.numProbes() != numProbes)
     {
         neighborhood.resize(numProbes);
@@ -181,6 +369,38 @@ void ProbeManager::getInfluencingProbes(const Vector3f& point,
         batch->getInfluencingProbes(point, neighborhood, offset);
         offset += ProbeNeighborhood::kMaxProbesPerBatch;
     }
+
+    for (const auto& batch : streamedProbeBatches)
+    {
+        batch->getInfluencingProbes(point, neighborhood, offset);
+        offset += ProbeNeighborhood::kMaxProbesPerBatch;
+    }
+}
+
+void ProbeManager::getInfluencingProbes(int numPoints,
+                                        const Vector3f* points,
+                                        ProbeNeighborhoodBatch& neighborhoods)
+{
+    PROFILE_FUNCTION();
+
+    const auto& streamedProbeBatches = mStreamer.residentProbeBatches();
+
+    auto numProbeBatches = mProbeBatches[0].size() + streamedProbeBatches.size();
+    auto numProbes = static_cast<int>(numProbeBatches * ProbeNeighborhood::kMaxProbesPerBatch);
+    neighborhoods.resize(numPoints, numProbes);
+
+    auto offset = 0;
+    for (const auto& batch : mProbeBatches[0])
+    {
+        batch->getInfluencingProbes(points, neighborhoods, offset);
+        offset += ProbeNeighborhood::kMaxProbesPerBatch;
+    }
+
+    for (const auto& batch : streamedProbeBatches)
+    {
+        batch->getInfluencingProbes(points, neighborhoods, offset);
+        offset += ProbeNeighborhood::kMaxProbesPerBatch;
+    }
 }
 
 }
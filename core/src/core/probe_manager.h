@@ -17,6 +17,7 @@
 #pragma once
 
 #include "probe_batch.h"
+#include "probe_streamer.h"
 
 namespace ipl {
 
@@ -42,17 +43,39 @@ public:
         return mProbeBatches[0];
     }
 
+    ProbeStreamer& streamer()
+    {
+        return mStreamer;
+    }
+
     void addProbeBatch(shared_ptr<ProbeBatch> probeBatch);
 
+    // Adds a probe batch whose baked data is streamed in and out of memory in tiles of the given size, instead of
+    // being used directly. Only probes in resident tiles are returned by getInfluencingProbes.
+    void addStreamedProbeBatch(shared_ptr<ProbeBatch> probeBatch,
+                               float tileSize);
+
+    // Removes a probe batch, whether it was added as a streamed probe batch or not.
     void removeProbeBatch(shared_ptr<ProbeBatch> probeBatch);
 
     void commit();
 
+    // Updates which tiles of streamed probe batches are resident, based on the given points of interest.
+    void updateStreaming(int numPoints,
+                         const Vector3f* points);
+
     void getInfluencingProbes(const Vector3f& point,
                               ProbeNeighborhood& neighborhood);
 
+    // Finds the influencing probes for several points at once, in neighborhoods[0] through neighborhoods[numPoints - 1].
+    void getInfluencingProbes(int numPoints,
+                              const Vector3f* points,
+                              ProbeNeighborhoodBatch& neighborhoods);
+
 private:
     list<shared_ptr<ProbeBatch>> mProbeBatches[2];
+    map<shared_ptr<ProbeBatch>, float> mStreamedProbeBatches[2];
+    ProbeStreamer mStreamer;
 };
 
 }
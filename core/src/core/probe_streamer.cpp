@@ -0,0 +1,462 @@
+//
+// Copyright 2017-2023 Valve Corporation.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "probe_streamer.h"
+
+#include "baked_reflection_data.h"
+#include "profiler.h"
+
+namespace ipl {
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ProbeStreamer
+// ---------------------------------------------------------------------------------------------------------------------
+
+const ProbeStreamingSettings ProbeStreamer::kDefaultSettings{128 * 1024 * 1024, 32.0f};
+
+ProbeStreamer::ProbeStreamer()
+    : mSettings(kDefaultSettings)
+    , mResidentBytes(0)
+    , mBytesPerProbe(0.0f)
+    , mFrame(0)
+    , mNumLoads(0)
+    , mNumEvictions(0)
+    , mStats{}
+    , mQuit(false)
+    , mLoading(false)
+{}
+
+ProbeStreamer::~ProbeStreamer()
+{
+    if (mThread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mQuit = true;
+        }
+
+        mCondVarLoad.notify_one();
+        mThread.join();
+    }
+}
+
+ProbeStreamingSettings ProbeStreamer::settings() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mSettings;
+}
+
+void ProbeStreamer::setSettings(const ProbeStreamingSettings& settings)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSettings = settings;
+}
+
+ProbeStreamingStats ProbeStreamer::stats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+void ProbeStreamer::addProbeBatch(shared_ptr<ProbeBatch> probeBatch,
+                                  float tileSize)
+{
+    assert(probeBatch);
+    assert(tileSize > 0.0f);
+
+    if (mProbeBatches.find(probeBatch) != mProbeBatches.end())
+        return;
+
+    // Bin probes into tiles based on the grid cell containing their centers.
+    map<std::tuple<int, int, int>, shared_ptr<Tile>> tiles;
+
+    for (auto i = 0; i < probeBatch->numProbes(); ++i)
+    {
+        const auto& influence = (*probeBatch)[i].influence;
+
+        auto key = std::make_tuple(static_cast<int>(floorf(influence.center.x() / tileSize)),
+                                   static_cast<int>(floorf(influence.center.y() / tileSize)),
+                                   static_cast<int>(floorf(influence.center.z() / tileSize)));
+
+        auto& tile = tiles[key];
+        if (!tile)
+        {
+            tile = ipl::make_shared<Tile>();
+            tile->probeBatch = probeBatch;
+            tile->state = TileState::Unloaded;
+            tile->size = 0;
+            tile->lastUsedFrame = -1;
+        }
+
+        auto radius = Vector3f(influence.radius, influence.radius, influence.radius);
+
+        tile->probeIndices.push_back(i);
+        tile->bounds.minCoordinates = Vector3f::min(tile->bounds.minCoordinates, influence.center - radius);
+        tile->bounds.maxCoordinates = Vector3f::max(tile->bounds.maxCoordinates, influence.center + radius);
+    }
+
+    auto& batchTiles = mProbeBatches[probeBatch];
+    for (auto& tile : tiles)
+    {
+        batchTiles.push_back(tile.second);
+    }
+
+    // Estimate the size of a tile from the baked data that will be streamed, so the first tiles requested don't all
+    // look free and get loaded regardless of the budget. The estimate is refined as tiles are actually loaded.
+    if (probeBatch->numProbes() > 0)
+    {
+        uint64_t bakedDataSize = 0;
+        for (const auto& data : probeBatch->getData())
+        {
+            if (data.first.type == BakedDataType::Reflections)
+            {
+                bakedDataSize += data.second->serializedSize();
+            }
+        }
+
+        mBytesPerProbe = std::max(mBytesPerProbe, static_cast<float>(bakedDataSize) / probeBatch->numProbes());
+    }
+
+    if (!mThread.joinable())
+    {
+        mThread = std::thread(&ProbeStreamer::loaderThread, this);
+    }
+
+    updateStats();
+}
+
+void ProbeStreamer::removeProbeBatch(shared_ptr<ProbeBatch> probeBatch)
+{
+    auto it = mProbeBatches.find(probeBatch);
+    if (it == mProbeBatches.end())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        for (auto& tile : it->second)
+        {
+            if (tile->state == TileState::Resident)
+            {
+                mResidentBytes -= tile->size;
+                tile->residentProbeBatch = nullptr;
+            }
+
+            // Any load of this tile that is in progress will be discarded when it completes.
+            tile->state = TileState::Removed;
+        }
+
+        mLoadQueue.erase(std::remove_if(mLoadQueue.begin(), mLoadQueue.end(), [&](const shared_ptr<Tile>& tile)
+        {
+            return (tile->probeBatch == probeBatch);
+        }), mLoadQueue.end());
+    }
+
+    mProbeBatches.erase(it);
+
+    updateResidentProbeBatches();
+    updateStats();
+}
+
+void ProbeStreamer::update(int numPoints,
+                           const Vector3f* points)
+{
+    PROFILE_FUNCTION();
+
+    ++mFrame;
+
+    auto settings = this->settings();
+    auto residentProbeBatchesChanged = false;
+
+    // Take back all loads that haven't started yet; they are re-requested below, in the order in which they are
+    // currently needed.
+    vector<std::pair<shared_ptr<Tile>, shared_ptr<ProbeBatch>>> loadedTiles;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        loadedTiles.swap(mLoadedTiles);
+
+        for (auto& tile : mLoadQueue)
+        {
+            tile->state = TileState::Unloaded;
+        }
+
+        mLoadQueue.clear();
+    }
+
+    for (auto& loadedTile : loadedTiles)
+    {
+        auto& tile = *loadedTile.first;
+        if (tile.state != TileState::Loading)
+            continue;
+
+        tile.state = TileState::Resident;
+        tile.residentProbeBatch = loadedTile.second;
+        mResidentBytes += tile.size;
+        ++mNumLoads;
+
+        mBytesPerProbe = std::max(mBytesPerProbe, static_cast<float>(tile.size) / tile.probeIndices.size());
+
+        residentProbeBatchesChanged = true;
+    }
+
+    // Find all tiles near the points of interest, and sort them so the nearest ones are considered first.
+    mRequestedTiles.clear();
+    for (auto& probeBatch : mProbeBatches)
+    {
+        for (auto& tile : probeBatch.second)
+        {
+            auto minDistance = std::numeric_limits<float>::infinity();
+            for (auto i = 0; i < numPoints; ++i)
+            {
+                minDistance = std::min(minDistance, distance(tile->bounds, points[i]));
+            }
+
+            if (minDistance <= settings.prefetchRadius)
+            {
+                mRequestedTiles.push_back(std::make_pair(minDistance, tile));
+            }
+        }
+    }
+
+    std::sort(mRequestedTiles.begin(), mRequestedTiles.end(), [](const std::pair<float, shared_ptr<Tile>>& a,
+                                                                 const std::pair<float, shared_ptr<Tile>>& b)
+    {
+        return (a.first < b.first);
+    });
+
+    // Keep as many of the nearest tiles as fit in the budget. The nearest tile is always kept, even if it doesn't fit,
+    // since it's the one most likely to be needed for lookups.
+    vector<shared_ptr<Tile>> tilesToLoad;
+    uint64_t requiredBytes = 0;
+    for (auto& requestedTile : mRequestedTiles)
+    {
+        auto& tile = requestedTile.second;
+
+        auto size = (tile->state == TileState::Resident) ? tile->size : static_cast<uint64_t>(mBytesPerProbe * tile->probeIndices.size());
+        if (requiredBytes > 0 && requiredBytes + size > settings.memoryBudget)
+            break;
+
+        requiredBytes += size;
+        tile->lastUsedFrame = mFrame;
+
+        if (tile->state == TileState::Unloaded)
+        {
+            tile->state = TileState::Loading;
+            tilesToLoad.push_back(tile);
+        }
+    }
+
+    // Evict the least recently used tiles that are not needed this frame, until the budget is met.
+    while (mResidentBytes > settings.memoryBudget)
+    {
+        Tile* lruTile = nullptr;
+        for (auto& probeBatch : mProbeBatches)
+        {
+            for (auto& tile : probeBatch.second)
+            {
+                if (tile->state == TileState::Resident && tile->lastUsedFrame < mFrame &&
+                    (!lruTile || tile->lastUsedFrame < lruTile->lastUsedFrame))
+                {
+                    lruTile = tile.get();
+                }
+            }
+        }
+
+        if (!lruTile)
+            break;
+
+        evict(*lruTile);
+        residentProbeBatchesChanged = true;
+    }
+
+    if (residentProbeBatchesChanged)
+    {
+        updateResidentProbeBatches();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        for (auto& tile : tilesToLoad)
+        {
+            mLoadQueue.push_back(tile);
+        }
+    }
+
+    if (!tilesToLoad.empty())
+    {
+        mCondVarLoad.notify_one();
+    }
+
+    updateStats();
+}
+
+bool ProbeStreamer::isLoading(const Vector3f& point) const
+{
+    for (const auto& probeBatch : mProbeBatches)
+    {
+        for (const auto& tile : probeBatch.second)
+        {
+            if (tile->state == TileState::Loading && tile->bounds.contains(point))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+void ProbeStreamer::waitUntilIdle()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondVarIdle.wait(lock, [this]()
+    {
+        return (mLoadQueue.empty() && !mLoading);
+    });
+}
+
+void ProbeStreamer::evict(Tile& tile)
+{
+    assert(tile.state == TileState::Resident);
+
+    tile.state = TileState::Unloaded;
+    tile.residentProbeBatch = nullptr;
+    mResidentBytes -= tile.size;
+    ++mNumEvictions;
+}
+
+void ProbeStreamer::updateResidentProbeBatches()
+{
+    mResidentProbeBatches.clear();
+
+    for (auto& probeBatch : mProbeBatches)
+    {
+        for (auto& tile : probeBatch.second)
+        {
+            if (tile->state == TileState::Resident)
+            {
+                mResidentProbeBatches.push_back(tile->residentProbeBatch);
+            }
+        }
+    }
+}
+
+void ProbeStreamer::updateStats()
+{
+    ProbeStreamingStats stats{};
+
+    for (const auto& probeBatch : mProbeBatches)
+    {
+        for (const auto& tile : probeBatch.second)
+        {
+            ++stats.numTiles;
+
+            if (tile->state == TileState::Resident)
+            {
+                ++stats.numResidentTiles;
+            }
+            else if (tile->state == TileState::Loading)
+            {
+                ++stats.numLoadingTiles;
+            }
+        }
+    }
+
+    stats.residentBytes = mResidentBytes;
+    stats.numLoads = mNumLoads;
+    stats.numEvictions = mNumEvictions;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStats = stats;
+}
+
+void ProbeStreamer::loaderThread()
+{
+    while (true)
+    {
+        shared_ptr<Tile> tile;
+
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondVarLoad.wait(lock, [this]()
+            {
+                return (mQuit || !mLoadQueue.empty());
+            });
+
+            if (mQuit)
+                break;
+
+            tile = mLoadQueue.front();
+            mLoadQueue.pop_front();
+            mLoading = true;
+        }
+
+        auto probeBatch = loadTile(*tile);
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            // The size is written here, and only read on the updating thread after the tile has been handed over.
+            tile->size = 0;
+            for (const auto& data : probeBatch->getData())
+            {
+                tile->size += data.second->serializedSize();
+            }
+
+            mLoadedTiles.push_back(std::make_pair(tile, probeBatch));
+            mLoading = false;
+        }
+
+        mCondVarIdle.notify_all();
+    }
+}
+
+shared_ptr<ProbeBatch> ProbeStreamer::loadTile(const Tile& tile)
+{
+    PROFILE_FUNCTION();
+
+    auto probeBatch = ipl::make_shared<ProbeBatch>();
+
+    for (auto index : tile.probeIndices)
+    {
+        probeBatch->addProbe((*tile.probeBatch)[index].influence);
+    }
+
+    probeBatch->commit();
+
+    for (const auto& data : tile.probeBatch->getData())
+    {
+        if (data.first.type != BakedDataType::Reflections)
+            continue;
+
+        const auto& reflectionsData = static_cast<const BakedReflectionsData&>(*data.second);
+        probeBatch->addData(data.first, ipl::make_unique<BakedReflectionsData>(reflectionsData, tile.probeIndices));
+    }
+
+    return probeBatch;
+}
+
+float ProbeStreamer::distance(const Box& box,
+                              const Vector3f& point)
+{
+    auto dx = std::max({box.minCoordinates.x() - point.x(), 0.0f, point.x() - box.maxCoordinates.x()});
+    auto dy = std::max({box.minCoordinates.y() - point.y(), 0.0f, point.y() - box.maxCoordinates.y()});
+    auto dz = std::max({box.minCoordinates.z() - point.z(), 0.0f, point.z() - box.maxCoordinates.z()});
+
+    return sqrtf(dx * dx + dy * dy + dz * dz);
+}
+
+}
@@ -0,0 +1,155 @@
+//
+// Copyright 2017-2023 Valve Corporation.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "box.h"
+#include "probe_batch.h"
+
+namespace ipl {
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ProbeStreamer
+// ---------------------------------------------------------------------------------------------------------------------
+
+struct ProbeStreamingSettings
+{
+    uint64_t memoryBudget; // Maximum number of bytes of baked data to keep resident.
+    float prefetchRadius; // Tiles within this distance of any point of interest are loaded.
+};
+
+struct ProbeStreamingStats
+{
+    int numTiles;
+    int numResidentTiles;
+    int numLoadingTiles;
+    uint64_t residentBytes;
+    uint64_t numLoads; // Total number of tile loads completed so far.
+    uint64_t numEvictions; // Total number of tiles evicted so far.
+};
+
+// Streams baked data from large probe batches in and out of memory. Each probe batch is partitioned into tiles on a
+// regular grid. Tiles near points of interest (typically the listener and sources) are loaded on a background thread
+// as separate probe batches containing copies of the baked reflections data of their probes. Tiles are evicted in
+// least-recently-used order when the resident baked data exceeds the memory budget.
+//
+// The streamed probe batches themselves should ideally be loaded from memory-mapped files, so that baked data for
+// tiles that are not resident does not occupy memory. Only baked reflections data is streamed. Streamed probe batches
+// must not be modified while they are being streamed.
+class ProbeStreamer
+{
+public:
+    static const ProbeStreamingSettings kDefaultSettings;
+
+    ProbeStreamer();
+
+    ~ProbeStreamer();
+
+    int numProbeBatches() const
+    {
+        return static_cast<int>(mProbeBatches.size());
+    }
+
+    // Probe batches for all tiles that are currently resident. These are only modified by update().
+    const vector<shared_ptr<ProbeBatch>>& residentProbeBatches() const
+    {
+        return mResidentProbeBatches;
+    }
+
+    ProbeStreamingSettings settings() const;
+
+    void setSettings(const ProbeStreamingSettings& settings);
+
+    ProbeStreamingStats stats() const;
+
+    void addProbeBatch(shared_ptr<ProbeBatch> probeBatch,
+                       float tileSize);
+
+    void removeProbeBatch(shared_ptr<ProbeBatch> probeBatch);
+
+    // Makes tiles whose loads have completed resident, requests loads for tiles near the given points (nearest first),
+    // and evicts tiles if needed to stay within the memory budget. Must be called from the thread that looks up baked
+    // data from resident probe batches.
+    void update(int numPoints,
+                const Vector3f* points);
+
+    // Returns true if a tile that may contain probes influencing the given point is currently being loaded.
+    bool isLoading(const Vector3f& point) const;
+
+    // Blocks until all requested tile loads have completed. The loaded tiles become resident on the next call to
+    // update().
+    void waitUntilIdle();
+
+private:
+    enum class TileState
+    {
+        Unloaded,
+        Loading,
+        Resident,
+        Removed,
+    };
+
+    struct Tile
+    {
+        shared_ptr<ProbeBatch> probeBatch;
+        vector<int> probeIndices;
+        Box bounds; // Bounds of the influence spheres of all probes in the tile.
+        TileState state;
+        shared_ptr<ProbeBatch> residentProbeBatch;
+        uint64_t size;
+        int64_t lastUsedFrame;
+    };
+
+    ProbeStreamingSettings mSettings;
+    map<shared_ptr<ProbeBatch>, vector<shared_ptr<Tile>>> mProbeBatches;
+    vector<shared_ptr<ProbeBatch>> mResidentProbeBatches;
+    uint64_t mResidentBytes;
+    float mBytesPerProbe; // Estimated from the baked data of each probe batch and the tiles loaded so far, used to
+                          // decide how many tiles fit in the budget.
+    int64_t mFrame;
+    uint64_t mNumLoads;
+    uint64_t mNumEvictions;
+    ProbeStreamingStats mStats;
+    vector<std::pair<float, shared_ptr<Tile>>> mRequestedTiles;
+
+    std::thread mThread;
+    bool mQuit;
+    bool mLoading;
+    deque<shared_ptr<Tile>> mLoadQueue;
+    vector<std::pair<shared_ptr<Tile>, shared_ptr<ProbeBatch>>> mLoadedTiles;
+    mutable std::mutex mMutex;
+    std::condition_variable mCondVarLoad;
+    std::condition_variable mCondVarIdle;
+
+    void evict(Tile& tile);
+
+    void updateResidentProbeBatches();
+
+    void updateStats();
+
+    void loaderThread();
+
+    static shared_ptr<ProbeBatch> loadTile(const Tile& tile);
+
+    static float distance(const Box& box,
+                          const Vector3f& point);
+};
+
+}
@@ -16,126 +16,527 @@
 
 #include "probe_tree.h"
 
+#include <algorithm>
 #include <numeric>
 
-#include "bvh.h"
+#include "float4.h"
 #include "profiler.h"
 #include "stack.h"
 
 namespace ipl {
 
 // --------------------------------------------------------------------------------------------------------------------
-// ProbeTreeConstructionTask
+// ProbeTreeNode / ProbeTreeLeaf
 // --------------------------------------------------------------------------------------------------------------------
 
-struct ProbeTreeConstructionTask
+const int ProbeTreeNode::kWidth;
+const int32_t ProbeTreeNode::kEmptyChild;
+const int ProbeTreeLeaf::kCapacity;
+
+// Returns a bitmask indicating which children of a node have bounding boxes that contain a point.
+static int childrenContaining(const ProbeTreeNode& node,
+                              float4_t x,
+                              float4_t y,
+                              float4_t z)
+{
+    auto inside = float4::andbits(float4::andbits(float4::cmple(float4::loadu(node.minX), x),
+                                                  float4::cmple(float4::loadu(node.minY), y)),
+                                  float4::cmple(float4::loadu(node.minZ), z));
+
+    inside = float4::andbits(inside, float4::andbits(float4::andbits(float4::cmple(x, float4::loadu(node.maxX)),
+                                                                     float4::cmple(y, float4::loadu(node.maxY))),
+                                                     float4::cmple(z, float4::loadu(node.maxZ))));
+
+    return float4::movemask(inside);
+}
+
+// Returns the squared distances from a point to the centers of all the probes in a leaf.
+static float4_t centerDistancesSquared(const ProbeTreeLeaf& leaf,
+                                       float4_t x,
+                                       float4_t y,
+                                       float4_t z)
+{
+    auto dx = float4::sub(float4::loadu(leaf.centerX), x);
+    auto dy = float4::sub(float4::loadu(leaf.centerY), y);
+    auto dz = float4::sub(float4::loadu(leaf.centerZ), z);
+    return float4::add(float4::add(float4::mul(dx, dx), float4::mul(dy, dy)), float4::mul(dz, dz));
+}
+
+// Returns a bitmask indicating which probes in a leaf have influence spheres that contain a point.
+static int probesContaining(const ProbeTreeLeaf& leaf,
+                            float4_t x,
+                            float4_t y,
+                            float4_t z)
 {
-    int32_t nodeIndex;
-    int32_t startIndex;
-    int32_t endIndex;
-    int32_t leftChildIndex;
-};
+    return float4::movemask(float4::cmple(centerDistancesSquared(leaf, x, y, z), float4::loadu(leaf.radiusSquared)));
+}
 
 
 // --------------------------------------------------------------------------------------------------------------------
 // ProbeTree
 // --------------------------------------------------------------------------------------------------------------------
 
+const int ProbeTree::kPacketSize;
 const int ProbeTree::kProbeLookupStackSize = 128;
 
+// Each node visited during traversal pushes at most 3 more nodes than it pops, so this keeps the traversal stack
+// within kProbeLookupStackSize entries.
+const int ProbeTree::kMaxDepth = 40;
+
 ProbeTree::ProbeTree(int numProbes,
                      const Probe* probes)
+    : mNumIncrementalUpdates(0)
+{
+    vector<Sphere> spheres(std::max(numProbes, 0));
+    for (auto i = 0; i < numProbes; ++i)
+    {
+        spheres[i] = probes[i].influence;
+    }
+
+    build(numProbes, spheres.data());
+}
+
+void ProbeTree::build(int numProbes,
+                      const Sphere* spheres)
 {
+    PROFILE_FUNCTION();
+
+    mNodes.clear();
+    mLeaves.clear();
+    mFreeNodes.clear();
+    mFreeLeaves.clear();
+    mProbeLeaves.assign(std::max(numProbes, 0), -1);
+    mProbeSlots.assign(std::max(numProbes, 0), -1);
+    mNumIncrementalUpdates = 0;
+
+    allocateNode(-1, 0);
+
     if (numProbes <= 0)
         return;
 
-    mNodes.resize(2 * numProbes - 1);
+    vector<int32_t> indices(numProbes);
+    std::iota(indices.begin(), indices.end(), 0);
 
-    Array<int32_t> leafIndices(numProbes);
-    Array<Box> leafBounds(numProbes);
-    Array<Vector3f> leafBoxCenters(numProbes);
-    for (auto i = 0; i < numProbes; ++i)
+    buildNode(0, indices.data(), numProbes, spheres);
+}
+
+void ProbeTree::buildNode(int32_t nodeIndex,
+                          int32_t* indices,
+                          int numIndices,
+                          const Sphere* spheres)
+{
+    // Split the probes into (at most) kWidth groups of roughly equal size, by repeatedly splitting in half any group
+    // too large to fit in a leaf, along the axis in which the probe centers are most spread out.
+    int32_t* groups[ProbeTreeNode::kWidth] = { indices };
+    int groupSizes[ProbeTreeNode::kWidth] = { numIndices };
+    auto numGroups = 1;
+
+    while (numGroups < ProbeTreeNode::kWidth)
+    {
+        auto numSplitGroups = numGroups;
+        for (auto i = 0; i < numSplitGroups && numGroups < ProbeTreeNode::kWidth; ++i)
+        {
+            if (groupSizes[i] <= ProbeTreeLeaf::kCapacity)
+                continue;
+
+            Box centerBounds;
+            for (auto j = 0; j < groupSizes[i]; ++j)
+            {
+                const auto& center = spheres[groups[i][j]].center;
+                centerBounds.minCoordinates = Vector3f::min(centerBounds.minCoordinates, center);
+                centerBounds.maxCoordinates = Vector3f::max(centerBounds.maxCoordinates, center);
+            }
+
+            auto splitAxis = centerBounds.extents().indexOfMaxComponent();
+            auto splitIndex = groupSizes[i] / 2;
+
+            std::nth_element(groups[i], groups[i] + splitIndex, groups[i] + groupSizes[i], [&](int32_t lhs, int32_t rhs)
+            {
+                return spheres[lhs].center.elements[splitAxis] < spheres[rhs].center.elements[splitAxis];
+            });
+
+            groups[numGroups] = groups[i] + splitIndex;
+            groupSizes[numGroups] = groupSizes[i] - splitIndex;
+            groupSizes[i] = splitIndex;
+            ++numGroups;
+        }
+
+        if (numGroups == numSplitGroups)
+            break;
+    }
+
+    for (auto i = 0; i < numGroups; ++i)
+    {
+        if (groupSizes[i] <= ProbeTreeLeaf::kCapacity)
+        {
+            auto leafIndex = allocateLeaf(nodeIndex, i);
+            for (auto j = 0; j < groupSizes[i]; ++j)
+            {
+                addProbeToLeaf(leafIndex, groups[i][j], spheres[groups[i][j]]);
+            }
+
+            mNodes[nodeIndex].setChildBox(i, calcLeafBounds(leafIndex));
+        }
+        else
+        {
+            auto childIndex = allocateNode(nodeIndex, i);
+            buildNode(childIndex, groups[i], groupSizes[i], spheres);
+
+            mNodes[nodeIndex].setChildBox(i, calcNodeBounds(childIndex));
+        }
+    }
+}
+
+void ProbeTree::rebuild()
+{
+    vector<Sphere> spheres(numProbes());
+    for (auto i = 0; i < numProbes(); ++i)
+    {
+        spheres[i] = mLeaves[mProbeLeaves[i]].getSphere(mProbeSlots[i]);
+    }
+
+    build(numProbes(), spheres.data());
+}
+
+int32_t ProbeTree::allocateNode(int32_t parent,
+                                int32_t parentSlot)
+{
+    int32_t nodeIndex = 0;
+    if (!mFreeNodes.empty())
+    {
+        nodeIndex = mFreeNodes.back();
+        mFreeNodes.pop_back();
+    }
+    else
+    {
+        nodeIndex = static_cast<int32_t>(mNodes.size());
+        mNodes.emplace_back();
+    }
+
+    auto& node = mNodes[nodeIndex];
+    for (auto i = 0; i < ProbeTreeNode::kWidth; ++i)
+    {
+        node.clearChild(i);
+    }
+    node.parent = parent;
+    node.parentSlot = parentSlot;
+
+    if (parent >= 0)
+    {
+        mNodes[parent].children[parentSlot] = nodeIndex;
+    }
+
+    return nodeIndex;
+}
+
+int32_t ProbeTree::allocateLeaf(int32_t parent,
+                                int32_t parentSlot)
+{
+    int32_t leafIndex = 0;
+    if (!mFreeLeaves.empty())
+    {
+        leafIndex = mFreeLeaves.back();
+        mFreeLeaves.pop_back();
+    }
+    else
     {
-        leafIndices[i] = i;
+        leafIndex = static_cast<int32_t>(mLeaves.size());
+        mLeaves.emplace_back();
+    }
+
+    auto& leaf = mLeaves[leafIndex];
+    for (auto i = 0; i < ProbeTreeLeaf::kCapacity; ++i)
+    {
+        leaf.clearSphere(i);
+    }
+    leaf.numProbes = 0;
+    leaf.parent = parent;
+    leaf.parentSlot = parentSlot;
+
+    mNodes[parent].setLeaf(parentSlot, leafIndex);
+
+    return leafIndex;
+}
+
+void ProbeTree::addProbeToLeaf(int32_t leafIndex,
+                               int32_t probeIndex,
+                               const Sphere& influence)
+{
+    auto& leaf = mLeaves[leafIndex];
+    assert(leaf.numProbes < ProbeTreeLeaf::kCapacity);
 
-        const auto& sphere = probes[i].influence;
+    auto slot = leaf.numProbes++;
+    leaf.setSphere(slot, influence);
+    leaf.probeIndices[slot] = probeIndex;
+
+    mProbeLeaves[probeIndex] = leafIndex;
+    mProbeSlots[probeIndex] = slot;
+}
+
+Box ProbeTree::calcNodeBounds(int32_t nodeIndex) const
+{
+    const auto& node = mNodes[nodeIndex];
+
+    Box bounds;
+    for (auto i = 0; i < ProbeTreeNode::kWidth; ++i)
+    {
+        if (node.isEmpty(i))
+            continue;
+
+        auto childBounds = node.getChildBox(i);
+        bounds.minCoordinates = Vector3f::min(bounds.minCoordinates, childBounds.minCoordinates);
+        bounds.maxCoordinates = Vector3f::max(bounds.maxCoordinates, childBounds.maxCoordinates);
+    }
+
+    return bounds;
+}
+
+Box ProbeTree::calcLeafBounds(int32_t leafIndex) const
+{
+    const auto& leaf = mLeaves[leafIndex];
+
+    Box bounds;
+    for (auto i = 0; i < leaf.numProbes; ++i)
+    {
+        auto sphere = leaf.getSphere(i);
         auto delta = sphere.radius * Vector3f(1, 1, 1);
+        bounds.minCoordinates = Vector3f::min(bounds.minCoordinates, sphere.center - delta);
+        bounds.maxCoordinates = Vector3f::max(bounds.maxCoordinates, sphere.center + delta);
+    }
 
-        leafBounds[i] = Box(sphere.center - delta, sphere.center + delta);
+    return bounds;
+}
 
-        leafBoxCenters[i] = sphere.center;
+void ProbeTree::refit(int32_t nodeIndex,
+                      int slot,
+                      const Box& bounds)
+{
+    auto childBounds = bounds;
+
+    while (nodeIndex >= 0)
+    {
+        mNodes[nodeIndex].setChildBox(slot, childBounds);
+
+        childBounds = calcNodeBounds(nodeIndex);
+        slot = mNodes[nodeIndex].parentSlot;
+        nodeIndex = mNodes[nodeIndex].parent;
     }
+}
+
+void ProbeTree::refitLeaf(int32_t leafIndex)
+{
+    const auto& leaf = mLeaves[leafIndex];
+    refit(leaf.parent, leaf.parentSlot, calcLeafBounds(leafIndex));
+}
+
+int ProbeTree::calcDepth(int32_t nodeIndex) const
+{
+    auto depth = 0;
+    for (; nodeIndex >= 0; nodeIndex = mNodes[nodeIndex].parent)
+    {
+        ++depth;
+    }
+
+    return depth;
+}
+
+void ProbeTree::insertProbe(const Sphere& influence)
+{
+    PROFILE_FUNCTION();
 
-    Array<CentroidCoordinate, 2> centroids(3, numProbes);
+    auto probeIndex = numProbes();
+    mProbeLeaves.push_back(-1);
+    mProbeSlots.push_back(-1);
+    ++mNumIncrementalUpdates;
 
-    Stack<ProbeTreeConstructionTask, kProbeLookupStackSize> stack;
-    ProbeTreeConstructionTask task{0, 0, numProbes - 1, 1};
+    auto delta = influence.radius * Vector3f(1, 1, 1);
+    Box probeBounds(influence.center - delta, influence.center + delta);
 
+    // Descend into whichever child's bounds would grow the least, until reaching a leaf.
+    int32_t nodeIndex = 0;
     while (true)
     {
-        if (task.startIndex == task.endIndex)
-        {
-            mNodes[task.nodeIndex].box = leafBounds[leafIndices[task.startIndex]];
-            mNodes[task.nodeIndex].setProbeIndex(leafIndices[task.startIndex]);
+        const auto& node = mNodes[nodeIndex];
 
-            if (stack.isEmpty())
-                break;
+        auto bestChild = -1;
+        auto emptyChild = -1;
+        auto bestGrowth = std::numeric_limits<float>::infinity();
+        auto bestArea = std::numeric_limits<float>::infinity();
 
-            task = stack.pop();
-        }
-        else
+        for (auto i = 0; i < ProbeTreeNode::kWidth; ++i)
         {
-            alignas(float4_t) GrowableBox nodeBounds;
-            for (auto i = task.startIndex; i <= task.endIndex; ++i)
+            if (node.isEmpty(i))
             {
-                alignas(float4_t) GrowableBox bounds;
-                bounds.load(leafBounds[leafIndices[i]]);
-                nodeBounds.growToContain(bounds);
+                if (emptyChild < 0)
+                {
+                    emptyChild = i;
+                }
+
+                continue;
             }
-            nodeBounds.store(mNodes[task.nodeIndex].box);
 
-            for (auto i = task.startIndex; i <= task.endIndex; ++i)
+            auto childBounds = node.getChildBox(i);
+            auto area = childBounds.surfaceArea();
+            childBounds.minCoordinates = Vector3f::min(childBounds.minCoordinates, probeBounds.minCoordinates);
+            childBounds.maxCoordinates = Vector3f::max(childBounds.maxCoordinates, probeBounds.maxCoordinates);
+            auto growth = childBounds.surfaceArea() - area;
+
+            if (growth < bestGrowth || (growth == bestGrowth && area < bestArea))
             {
-                centroids[0][i].coordinate = leafBoxCenters[leafIndices[i]].x();
-                centroids[1][i].coordinate = leafBoxCenters[leafIndices[i]].y();
-                centroids[2][i].coordinate = leafBoxCenters[leafIndices[i]].z();
-                centroids[0][i].leafIndex = leafIndices[i];
-                centroids[1][i].leafIndex = leafIndices[i];
-                centroids[2][i].leafIndex = leafIndices[i];
+                bestChild = i;
+                bestGrowth = growth;
+                bestArea = area;
             }
+        }
 
-            auto splitIndex = (task.endIndex - task.startIndex + 1) / 2;
-            auto splitAxis = mNodes[task.nodeIndex].box.extents().indexOfMaxComponent();
+        if (bestChild < 0)
+        {
+            auto leafIndex = allocateLeaf(nodeIndex, emptyChild);
+            addProbeToLeaf(leafIndex, probeIndex, influence);
+            refitLeaf(leafIndex);
+            return;
+        }
 
-            auto compareCentroids = [](const CentroidCoordinate& lhs,
-                                       const CentroidCoordinate& rhs)
-            {
-                return lhs.coordinate < rhs.coordinate;
-            };
+        if (!node.isLeaf(bestChild))
+        {
+            nodeIndex = node.children[bestChild];
+            continue;
+        }
+
+        auto leafIndex = node.getLeafIndex(bestChild);
+        if (mLeaves[leafIndex].numProbes < ProbeTreeLeaf::kCapacity)
+        {
+            addProbeToLeaf(leafIndex, probeIndex, influence);
+            refitLeaf(leafIndex);
+            return;
+        }
 
-            std::sort(&centroids[splitAxis][task.startIndex], &centroids[splitAxis][task.endIndex + 1], compareCentroids);
+        if (emptyChild >= 0)
+        {
+            auto newLeafIndex = allocateLeaf(nodeIndex, emptyChild);
+            addProbeToLeaf(newLeafIndex, probeIndex, influence);
+            refitLeaf(newLeafIndex);
+            return;
+        }
 
-            for (auto i = task.startIndex; i <= task.endIndex; ++i)
+        // The leaf is full, and so is its parent. If the tree is not already too deep, replace the leaf with a node
+        // containing the leaf and a new leaf for this probe. Otherwise, rebuild the whole tree.
+        if (calcDepth(nodeIndex) >= kMaxDepth)
+        {
+            mProbeLeaves.pop_back();
+            mProbeSlots.pop_back();
+
+            vector<Sphere> spheres(probeIndex + 1);
+            for (auto i = 0; i < probeIndex; ++i)
             {
-                leafIndices[i] = centroids[splitAxis][i].leafIndex;
+                spheres[i] = mLeaves[mProbeLeaves[i]].getSphere(mProbeSlots[i]);
             }
+            spheres[probeIndex] = influence;
+
+            build(probeIndex + 1, spheres.data());
+            return;
+        }
 
-            auto splitCoordinate = centroids[splitAxis][task.startIndex + splitIndex].coordinate;
+        auto leafBounds = node.getChildBox(bestChild);
+        auto newNodeIndex = allocateNode(nodeIndex, bestChild);
 
-            mNodes[task.nodeIndex].setInternalNodeData(task.leftChildIndex - task.nodeIndex, splitAxis);
-            mNodes[task.nodeIndex].setSplitCoordinate(splitCoordinate);
+        mLeaves[leafIndex].parent = newNodeIndex;
+        mLeaves[leafIndex].parentSlot = 0;
+        mNodes[newNodeIndex].setLeaf(0, leafIndex);
+        mNodes[newNodeIndex].setChildBox(0, leafBounds);
 
-            stack.push(ProbeTreeConstructionTask{task.leftChildIndex + 1, task.startIndex + splitIndex, task.endIndex, task.leftChildIndex + 2 * splitIndex});
-            task = ProbeTreeConstructionTask{task.leftChildIndex, task.startIndex, task.startIndex + splitIndex - 1, task.leftChildIndex + 2};
-            continue;
+        auto newLeafIndex = allocateLeaf(newNodeIndex, 1);
+        addProbeToLeaf(newLeafIndex, probeIndex, influence);
+        refitLeaf(newLeafIndex);
+        return;
+    }
+}
+
+void ProbeTree::removeProbe(int index)
+{
+    PROFILE_FUNCTION();
+
+    assert(0 <= index && index < numProbes());
+
+    ++mNumIncrementalUpdates;
+
+    auto leafIndex = mProbeLeaves[index];
+    auto slot = mProbeSlots[index];
+    auto& leaf = mLeaves[leafIndex];
+
+    // Move the last probe in the leaf into the vacated slot.
+    auto lastSlot = leaf.numProbes - 1;
+    if (slot != lastSlot)
+    {
+        leaf.setSphere(slot, leaf.getSphere(lastSlot));
+        leaf.probeIndices[slot] = leaf.probeIndices[lastSlot];
+        mProbeSlots[leaf.probeIndices[slot]] = slot;
+    }
+
+    leaf.clearSphere(lastSlot);
+    --leaf.numProbes;
+
+    if (leaf.numProbes > 0)
+    {
+        refitLeaf(leafIndex);
+    }
+    else
+    {
+        // Detach the empty leaf, along with any nodes that become empty as a result. The root is never removed.
+        auto nodeIndex = leaf.parent;
+        mNodes[nodeIndex].clearChild(leaf.parentSlot);
+        mFreeLeaves.push_back(leafIndex);
+
+        while (nodeIndex > 0 && std::all_of(mNodes[nodeIndex].children, mNodes[nodeIndex].children + ProbeTreeNode::kWidth,
+                                            [](int32_t child) { return (child == ProbeTreeNode::kEmptyChild); }))
+        {
+            auto parent = mNodes[nodeIndex].parent;
+            mNodes[parent].clearChild(mNodes[nodeIndex].parentSlot);
+            mFreeNodes.push_back(nodeIndex);
+            nodeIndex = parent;
+        }
+
+        if (mNodes[nodeIndex].parent >= 0)
+        {
+            refit(mNodes[nodeIndex].parent, mNodes[nodeIndex].parentSlot, calcNodeBounds(nodeIndex));
         }
     }
+
+    mProbeLeaves.erase(mProbeLeaves.begin() + index);
+    mProbeSlots.erase(mProbeSlots.begin() + index);
+
+    for (auto& someLeaf : mLeaves)
+    {
+        for (auto i = 0; i < someLeaf.numProbes; ++i)
+        {
+            if (someLeaf.probeIndices[i] > index)
+            {
+                --someLeaf.probeIndices[i];
+            }
+        }
+    }
+}
+
+void ProbeTree::updateProbe(int index,
+                            const Sphere& influence)
+{
+    assert(0 <= index && index < numProbes());
+
+    ++mNumIncrementalUpdates;
+
+    auto leafIndex = mProbeLeaves[index];
+    mLeaves[leafIndex].setSphere(mProbeSlots[index], influence);
+    refitLeaf(leafIndex);
+}
+
+bool ProbeTree::needsRebuild() const
+{
+    return (mNumIncrementalUpdates > std::max(ProbeTreeLeaf::kCapacity, numProbes() / 4));
 }
 
 void ProbeTree::getInfluencingProbes(const Vector3f& point,
-                                     const Probe* probes,
                                      int maxInfluencingProbes,
-                                     int* probeIndices)
+                                     int* probeIndices) const
 {
     PROFILE_FUNCTION();
 
@@ -144,45 +545,258 @@ void ProbeTree::getInfluencingProbes(const Vector3f& point,
         probeIndices[i] = -1;
     }
 
+    auto x = float4::set1(point.x());
+    auto y = float4::set1(point.y());
+    auto z = float4::set1(point.z());
+
     auto numInfluencingProbes = 0;
 
-    Stack<const ProbeTreeNode*, kProbeLookupStackSize> stack;
-    const auto* node = &mNodes[0];
+    Stack<int32_t, kProbeLookupStackSize> stack;
+    int32_t nodeIndex = 0;
 
     while (true)
     {
-        if (node->box.contains(point))
+        const auto& node = mNodes[nodeIndex];
+        auto childMask = childrenContaining(node, x, y, z);
+
+        for (auto i = 0; i < ProbeTreeNode::kWidth; ++i)
+        {
+            if (!(childMask & (1 << i)))
+                continue;
+
+            if (!node.isLeaf(i))
+            {
+                stack.push(node.children[i]);
+                continue;
+            }
+
+            const auto& leaf = mLeaves[node.getLeafIndex(i)];
+            auto probeMask = probesContaining(leaf, x, y, z);
+
+            for (auto j = 0; j < leaf.numProbes; ++j)
+            {
+                if (!(probeMask & (1 << j)))
+                    continue;
+
+                probeIndices[numInfluencingProbes] = leaf.probeIndices[j];
+                ++numInfluencingProbes;
+                if (numInfluencingProbes >= maxInfluencingProbes)
+                    return;
+            }
+        }
+
+        if (stack.isEmpty())
+            break;
+
+        nodeIndex = stack.pop();
+    }
+}
+
+void ProbeTree::getInfluencingProbes(int numPoints,
+                                     const Vector3f* points,
+                                     int maxInfluencingProbes,
+                                     int* const* probeIndices) const
+{
+    PROFILE_FUNCTION();
+
+    struct TraversalEntry
+    {
+        int32_t nodeIndex;
+        uint32_t activeMask;
+    };
+
+    for (auto packetStart = 0; packetStart < numPoints; packetStart += kPacketSize)
+    {
+        auto packetSize = std::min(kPacketSize, numPoints - packetStart);
+
+        int numInfluencingProbes[kPacketSize];
+        for (auto i = 0; i < packetSize; ++i)
+        {
+            numInfluencingProbes[i] = 0;
+            for (auto j = 0; j < maxInfluencingProbes; ++j)
+            {
+                probeIndices[packetStart + i][j] = -1;
+            }
+        }
+
+        // Bit i of a mask is set if points[packetStart + i] still needs to visit the node.
+        auto remainingMask = (packetSize == 32) ? 0xffffffffu : ((1u << packetSize) - 1);
+
+        Stack<TraversalEntry, kProbeLookupStackSize> stack;
+        TraversalEntry entry{0, remainingMask};
+
+        while (true)
         {
-            if (node->isLeaf())
+            const auto& node = mNodes[entry.nodeIndex];
+
+            // For each child, the points whose bounding boxes contain it. Points that have already found
+            // maxInfluencingProbes probes drop out of the packet.
+            uint32_t childMasks[ProbeTreeNode::kWidth] = {};
+            auto activeMask = entry.activeMask & remainingMask;
+            for (auto i = 0; i < packetSize; ++i)
             {
-                if (probes[node->getProbeIndex()].influence.contains(point))
+                if (!(activeMask & (1u << i)))
+                    continue;
+
+                const auto& point = points[packetStart + i];
+                auto childMask = childrenContaining(node, float4::set1(point.x()), float4::set1(point.y()), float4::set1(point.z()));
+
+                for (auto j = 0; j < ProbeTreeNode::kWidth; ++j)
                 {
-                    probeIndices[numInfluencingProbes] = node->getProbeIndex();
-                    ++numInfluencingProbes;
-                    if (numInfluencingProbes >= maxInfluencingProbes)
-                        break;
+                    if (childMask & (1 << j))
+                    {
+                        childMasks[j] |= (1u << i);
+                    }
                 }
             }
-            else
+
+            for (auto j = 0; j < ProbeTreeNode::kWidth; ++j)
             {
-                auto nearChild = &node->getLeftChild();
-                auto farChild = &node->getRightChild();
-                if (point.elements[node->getSplitAxis()] > node->getSplitCoordinate())
+                if (!childMasks[j])
+                    continue;
+
+                if (!node.isLeaf(j))
+                {
+                    stack.push(TraversalEntry{node.children[j], childMasks[j]});
+                    continue;
+                }
+
+                const auto& leaf = mLeaves[node.getLeafIndex(j)];
+
+                for (auto i = 0; i < packetSize; ++i)
                 {
-                    std::swap(nearChild, farChild);
+                    if (!(childMasks[j] & remainingMask & (1u << i)))
+                        continue;
+
+                    const auto& point = points[packetStart + i];
+                    auto probeMask = probesContaining(leaf, float4::set1(point.x()), float4::set1(point.y()), float4::set1(point.z()));
+
+                    for (auto k = 0; k < leaf.numProbes; ++k)
+                    {
+                        if (!(probeMask & (1 << k)) || numInfluencingProbes[i] >= maxInfluencingProbes)
+                            continue;
+
+                        probeIndices[packetStart + i][numInfluencingProbes[i]] = leaf.probeIndices[k];
+                        ++numInfluencingProbes[i];
+                        if (numInfluencingProbes[i] >= maxInfluencingProbes)
+                        {
+                            remainingMask &= ~(1u << i);
+                        }
+                    }
                 }
+            }
+
+            if (stack.isEmpty() || !remainingMask)
+                break;
+
+            entry = stack.pop();
+        }
+    }
+}
+
+int ProbeTree::kNearest(const Vector3f& point,
+                        int k,
+                        int* probeIndices,
+                        float* distances) const
+{
+    PROFILE_FUNCTION();
+
+    struct TraversalEntry
+    {
+        int32_t nodeIndex;
+        float distanceSquared;
+    };
 
-                stack.push(farChild);
-                node = nearChild;
+    if (k <= 0)
+        return 0;
+
+    auto x = float4::set1(point.x());
+    auto y = float4::set1(point.y());
+    auto z = float4::set1(point.z());
+
+    // While searching, distances holds squared distances, sorted in increasing order.
+    auto numFound = 0;
+
+    Stack<TraversalEntry, kProbeLookupStackSize> stack;
+    stack.push(TraversalEntry{0, 0.0f});
+
+    while (!stack.isEmpty())
+    {
+        auto entry = stack.pop();
+        if (numFound == k && entry.distanceSquared > distances[k - 1])
+            continue;
+
+        const auto& node = mNodes[entry.nodeIndex];
+
+        // Squared distance from the point to each child's bounding box. Empty children have inverted bounds, and so
+        // are infinitely far away.
+        auto dx = float4::max(float4::max(float4::sub(float4::loadu(node.minX), x), float4::sub(x, float4::loadu(node.maxX))), float4::zero());
+        auto dy = float4::max(float4::max(float4::sub(float4::loadu(node.minY), y), float4::sub(y, float4::loadu(node.maxY))), float4::zero());
+        auto dz = float4::max(float4::max(float4::sub(float4::loadu(node.minZ), z), float4::sub(z, float4::loadu(node.maxZ))), float4::zero());
+
+        float childDistancesSquared[ProbeTreeNode::kWidth];
+        float4::storeu(childDistancesSquared, float4::add(float4::add(float4::mul(dx, dx), float4::mul(dy, dy)), float4::mul(dz, dz)));
+
+        // Visit children from nearest to farthest. Child nodes are pushed farthest first, so the nearest is popped
+        // first.
+        int order[ProbeTreeNode::kWidth] = { 0, 1, 2, 3 };
+        std::sort(order, order + ProbeTreeNode::kWidth, [&](int lhs, int rhs)
+        {
+            return childDistancesSquared[lhs] < childDistancesSquared[rhs];
+        });
+
+        for (auto i = ProbeTreeNode::kWidth - 1; i >= 0; --i)
+        {
+            auto child = order[i];
+            if (node.isEmpty(child) || !node.isLeaf(child))
                 continue;
+
+            if (numFound == k && childDistancesSquared[child] > distances[k - 1])
+                continue;
+
+            const auto& leaf = mLeaves[node.getLeafIndex(child)];
+
+            float probeDistancesSquared[ProbeTreeLeaf::kCapacity];
+            float4::storeu(probeDistancesSquared, centerDistancesSquared(leaf, x, y, z));
+
+            for (auto j = 0; j < leaf.numProbes; ++j)
+            {
+                if (numFound == k && probeDistancesSquared[j] >= distances[k - 1])
+                    continue;
+
+                // Insert into the sorted list of nearest probes, dropping the farthest if it is full.
+                auto position = (numFound < k) ? numFound++ : k - 1;
+                while (position > 0 && distances[position - 1] > probeDistancesSquared[j])
+                {
+                    distances[position] = distances[position - 1];
+                    probeIndices[position] = probeIndices[position - 1];
+                    --position;
+                }
+
+                distances[position] = probeDistancesSquared[j];
+                probeIndices[position] = leaf.probeIndices[j];
             }
         }
 
-        if (stack.isEmpty())
-            break;
+        for (auto i = ProbeTreeNode::kWidth - 1; i >= 0; --i)
+        {
+            auto child = order[i];
+            if (node.isEmpty(child) || node.isLeaf(child))
+                continue;
+
+            if (numFound == k && childDistancesSquared[child] > distances[k - 1])
+                continue;
+
+            stack.push(TraversalEntry{node.children[child], childDistancesSquared[child]});
+        }
+    }
 
-        node = stack.pop();
+    for (auto i = 0; i < numFound; ++i)
+    {
+        distances[i] = sqrtf(distances[i]);
     }
+
+    return numFound;
 }
 
 }
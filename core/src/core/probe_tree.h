@@ -25,65 +25,111 @@ namespace ipl {
 // ProbeTreeNode
 // --------------------------------------------------------------------------------------------------------------------
 
+// An internal node of a ProbeTree, with up to kWidth children. The bounding boxes of all children are stored in SoA
+// form, so a point can be tested against all of them at once. Each child is either another node, a leaf, or empty.
+// Empty children have inverted bounds, which never contain any point.
 struct ProbeTreeNode
 {
-    int32_t data() const
+    static const int kWidth = 4;
+    static const int32_t kEmptyChild = -1;
+
+    float minX[kWidth];
+    float minY[kWidth];
+    float minZ[kWidth];
+    float maxX[kWidth];
+    float maxY[kWidth];
+    float maxZ[kWidth];
+    int32_t children[kWidth]; // Index of a child node if >= 0, kEmptyChild, or an encoded leaf index otherwise.
+    int32_t parent; // Index of the parent node, or -1 for the root.
+    int32_t parentSlot; // Which child of the parent this node is.
+
+    bool isEmpty(int i) const
     {
-        return reinterpret_cast<const int32_t*>(&box.minCoordinates)[3];
+        return (children[i] == kEmptyChild);
     }
 
-    int32_t getSplitAxis() const
+    bool isLeaf(int i) const
     {
-        return data() & 3;
+        return (children[i] < kEmptyChild);
     }
 
-    int32_t getProbeIndex() const
+    int32_t getLeafIndex(int i) const
     {
-        return data() >> 2;
+        return kEmptyChild - 1 - children[i];
     }
 
-    ProbeTreeNode const& getLeftChild() const
+    void setLeaf(int i,
+                 int32_t leafIndex)
     {
-        return this[data() >> 2];
+        children[i] = kEmptyChild - 1 - leafIndex;
     }
 
-    ProbeTreeNode const& getRightChild() const
+    Box getChildBox(int i) const
     {
-        return this[(data() >> 2) + 1];
+        return Box(Vector3f(minX[i], minY[i], minZ[i]), Vector3f(maxX[i], maxY[i], maxZ[i]));
     }
 
-    float getSplitCoordinate() const
+    void setChildBox(int i,
+                     const Box& box)
     {
-        return reinterpret_cast<float const*>(&box.maxCoordinates)[3];
+        minX[i] = box.minCoordinates.x();
+        minY[i] = box.minCoordinates.y();
+        minZ[i] = box.minCoordinates.z();
+        maxX[i] = box.maxCoordinates.x();
+        maxY[i] = box.maxCoordinates.y();
+        maxZ[i] = box.maxCoordinates.z();
     }
 
-    bool isLeaf() const
+    void clearChild(int i)
     {
-        return (getSplitAxis() == 3);
+        children[i] = kEmptyChild;
+        setChildBox(i, Box());
     }
+};
 
-    void setData(int32_t data)
-    {
-        reinterpret_cast<int32_t*>(&box.minCoordinates)[3] = data;
-    }
 
-    void setProbeIndex(int32_t probeIndex)
+// --------------------------------------------------------------------------------------------------------------------
+// ProbeTreeLeaf
+// --------------------------------------------------------------------------------------------------------------------
+
+// A leaf of a ProbeTree, containing the influence spheres of up to kCapacity probes in SoA form. Unused slots have a
+// negative squared radius, so they never contain any point.
+struct ProbeTreeLeaf
+{
+    static const int kCapacity = 4;
+
+    float centerX[kCapacity];
+    float centerY[kCapacity];
+    float centerZ[kCapacity];
+    float radiusSquared[kCapacity];
+    float radius[kCapacity];
+    int32_t probeIndices[kCapacity];
+    int32_t numProbes;
+    int32_t parent;
+    int32_t parentSlot;
+
+    Sphere getSphere(int i) const
     {
-        setData((probeIndex << 2) | 3);
+        return Sphere(Vector3f(centerX[i], centerY[i], centerZ[i]), radius[i]);
     }
 
-    void setInternalNodeData(int32_t childOffset,
-                             int32_t splitAxis)
+    void setSphere(int i,
+                   const Sphere& sphere)
     {
-        setData((childOffset << 2) | splitAxis);
+        centerX[i] = sphere.center.x();
+        centerY[i] = sphere.center.y();
+        centerZ[i] = sphere.center.z();
+        radius[i] = sphere.radius;
+        radiusSquared[i] = sphere.radius * sphere.radius;
     }
 
-    void setSplitCoordinate(float splitCoordinate)
+    void clearSphere(int i)
     {
-        reinterpret_cast<float*>(&box.maxCoordinates)[3] = splitCoordinate;
+        centerX[i] = centerY[i] = centerZ[i] = 0.0f;
+        radius[i] = 0.0f;
+        radiusSquared[i] = -1.0f;
+        probeIndices[i] = -1;
     }
-
-    Box box;
 };
 
 
@@ -91,23 +137,100 @@ struct ProbeTreeNode
 // ProbeTree
 // --------------------------------------------------------------------------------------------------------------------
 
+// A 4-wide bounding volume hierarchy over the influence spheres of a set of probes. The tree keeps its own copy of
+// the spheres, and can be updated incrementally as probes are added, removed, or moved, without being rebuilt.
+// Incremental updates gradually degrade the quality of the tree; needsRebuild() indicates when it is worth rebuilding.
 class ProbeTree
 {
 public:
+    static const int kPacketSize = 32; // Maximum number of points that can be traversed together as a packet.
+
     ProbeTree(int numProbes,
               const Probe* probes);
 
-    const ProbeTreeNode& getRootNode() const { return mNodes[0]; }
+    int numProbes() const
+    {
+        return static_cast<int>(mProbeLeaves.size());
+    }
 
     void getInfluencingProbes(const Vector3f& point,
-                              const Probe* probes,
                               int maxInfluencingProbes,
-                              int* probeIndices);
+                              int* probeIndices) const;
+
+    // Finds the influencing probes for several points at once. Points are traversed together in packets of up to
+    // kPacketSize, so each node is visited once per packet rather than once per point. The influencing probes for
+    // points[i] are written to probeIndices[i], which must have space for maxInfluencingProbes entries.
+    void getInfluencingProbes(int numPoints,
+                              const Vector3f* points,
+                              int maxInfluencingProbes,
+                              int* const* probeIndices) const;
+
+    // Finds the (at most) k probes whose centers are nearest to point, regardless of their radii of influence, and
+    // writes their indices and distances to probeIndices and distances in order of increasing distance. Both arrays
+    // must have space for k entries. Returns the number of probes found.
+    int kNearest(const Vector3f& point,
+                 int k,
+                 int* probeIndices,
+                 float* distances) const;
+
+    // Adds a probe, whose index is numProbes().
+    void insertProbe(const Sphere& influence);
+
+    // Removes a probe. Probes with higher indices are renumbered, as with ProbeBatch::removeProbe.
+    void removeProbe(int index);
+
+    // Changes the influence sphere of a probe, and refits the tree around it.
+    void updateProbe(int index,
+                     const Sphere& influence);
+
+    // Checks whether enough incremental updates have been made since the tree was built that rebuilding it is
+    // worthwhile.
+    bool needsRebuild() const;
 
 private:
     static const int kProbeLookupStackSize;
+    static const int kMaxDepth;
+
+    vector<ProbeTreeNode> mNodes; // mNodes[0] is the root.
+    vector<ProbeTreeLeaf> mLeaves;
+    vector<int32_t> mFreeNodes;
+    vector<int32_t> mFreeLeaves;
+    vector<int32_t> mProbeLeaves; // For each probe, the leaf that contains it.
+    vector<int32_t> mProbeSlots; // For each probe, its slot within the leaf that contains it.
+    int mNumIncrementalUpdates;
+
+    void build(int numProbes,
+               const Sphere* spheres);
+
+    void buildNode(int32_t nodeIndex,
+                   int32_t* indices,
+                   int numIndices,
+                   const Sphere* spheres);
+
+    void rebuild();
+
+    int32_t allocateNode(int32_t parent,
+                         int32_t parentSlot);
+
+    int32_t allocateLeaf(int32_t parent,
+                         int32_t parentSlot);
+
+    void addProbeToLeaf(int32_t leafIndex,
+                        int32_t probeIndex,
+                        const Sphere& influence);
+
+    Box calcNodeBounds(int32_t nodeIndex) const;
+
+    Box calcLeafBounds(int32_t leafIndex) const;
+
+    // Updates the bounds stored for the given child of the given node, and all its ancestors.
+    void refit(int32_t nodeIndex,
+               int slot,
+               const Box& bounds);
+
+    void refitLeaf(int32_t leafIndex);
 
-    Array<ProbeTreeNode> mNodes;
+    int calcDepth(int32_t nodeIndex) const;
 };
 
-}
\ No newline at end of file
+}
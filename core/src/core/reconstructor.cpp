@@ -36,39 +36,96 @@ namespace ipl {
 const float IReconstructor::kEnergyThreshold = 1e-7f;
 const float IReconstructor::kMinVariance = 1e-5f;
 
+void IReconstructor::reconstructDirtyBins(int numIRs,
+                                          const EnergyField* const* energyFields,
+                                          const float* const* distanceAttenuationCorrectionCurves,
+                                          const AirAbsorptionModel* airAbsorptionModels,
+                                          ImpulseResponse* const* impulseResponses,
+                                          ReconstructionType type,
+                                          float duration,
+                                          int order)
+{
+    reconstruct(numIRs, energyFields, distanceAttenuationCorrectionCurves, airAbsorptionModels, impulseResponses, type,
+                duration, order);
+}
+
 
 // --------------------------------------------------------------------------------------------------------------------
 // Reconstructor
 // --------------------------------------------------------------------------------------------------------------------
 
+const int Reconstructor::kNumGuardBins = 1;
+
 Reconstructor::Reconstructor(float maxDuration,
                              int maxOrder,
                              int samplingRate)
     : mMaxDuration(maxDuration)
     , mMaxOrder(maxOrder)
     , mSamplingRate(samplingRate)
-    , mWhiteNoise(Bands::kNumBands, static_cast<int>(ceilf(maxDuration * samplingRate)))
-    , mBandIRs(Bands::kNumBands, static_cast<int>(ceilf(maxDuration * samplingRate)))
-    , mFilters(Bands::kNumBands)
+    , mNumSamplesPerBin(static_cast<int>(ceilf(EnergyField::kBinDuration * samplingRate)))
+    , mWhiteNoise(static_cast<int>(ceilf(maxDuration * samplingRate)))
+    , mGaussianWindow(mNumSamplesPerBin)
+    , mLinearWindow(mNumSamplesPerBin)
+    , mGuardBinSamples(mNumSamplesPerBin)
 {
-    for (auto i = 0; i < Bands::kNumBands; ++i)
+    static_assert(Bands::kNumBands == 3, "band-interleaved reconstruction assumes 3 bands packed into a float4.");
+
+    auto maxNumBins = (static_cast<int>(mWhiteNoise.size(0)) + mNumSamplesPerBin - 1) / mNumSamplesPerBin;
+    mBinNormalizations.resize(maxNumBins, 4);
+    mBinAirAbsorptions.resize(maxNumBins, 4);
+    mBinGains.resize(maxNumBins, 4);
+    mBinNormalizations.zero();
+    mBinAirAbsorptions.zero();
+    mBinGains.zero();
+
+    // All bands are synthesized from the same white noise sequence; band-pass filtering decorrelates them.
+    std::default_random_engine randomGenerator;
+    std::uniform_real_distribution<float> uniformDistribution(-1.0f, 1.0f);
+    auto uniformRandom = std::bind(uniformDistribution, randomGenerator);
+
+    for (auto i = 0u; i < mWhiteNoise.size(0); ++i)
     {
-        std::default_random_engine randomGenerator;
-        std::uniform_real_distribution<float> uniformDistribution(-1.0f, 1.0f);
-        auto uniformRandom = std::bind(uniformDistribution, randomGenerator);
+        mWhiteNoise[i] = uniformRandom();
+    }
 
-        for (auto j = 0u; j < mWhiteNoise.size(1); ++j)
-        {
-            mWhiteNoise[i][j] = uniformRandom();
-        }
+    // The Gaussian envelope has the same shape in every bin, so it is evaluated once, centered on the middle of a bin.
+    // The linear envelope is the interpolation weight from the previous bin's energy to the current bin's energy.
+    auto tMean = (0.5f * mNumSamplesPerBin) / mSamplingRate;
+    auto tVariance = kMinVariance;
+
+    auto t = 0.0f;
+    auto dt = 1.0f / mSamplingRate;
+    auto g = expf(-((t - tMean) * (t - tMean)) / (2.0f * tVariance));
+    auto dg = expf(-(dt * ((2.0f * (t - tMean)) + dt)) / (2.0f * tVariance));
+    auto ddg = expf(-(dt * dt) / tVariance);
+
+    for (auto i = 0; i < mNumSamplesPerBin; ++i)
+    {
+        mGaussianWindow[i] = g;
+        mLinearWindow[i] = static_cast<float>(i) / static_cast<float>(mNumSamplesPerBin);
+
+        g *= dg;
+        dg *= ddg;
     }
 
-    mFilters[0].setFilter(IIR::lowPass(Bands::kHighCutoffFrequencies[0], samplingRate));
+    IIR filters[Bands::kNumBands];
+    filters[0] = IIR::lowPass(Bands::kHighCutoffFrequencies[0], samplingRate);
     for (auto i = 1; i < Bands::kNumBands - 1; ++i)
     {
-        mFilters[i].setFilter(IIR::bandPass(Bands::kLowCutoffFrequencies[i], Bands::kHighCutoffFrequencies[i], samplingRate));
+        filters[i] = IIR::bandPass(Bands::kLowCutoffFrequencies[i], Bands::kHighCutoffFrequencies[i], samplingRate);
+    }
+    filters[Bands::kNumBands - 1] = IIR::highPass(Bands::kLowCutoffFrequencies[Bands::kNumBands - 1], samplingRate);
+
+    // Unused lanes get all-zero coefficients, so they always output silence.
+    memset(mBandFilterCoeffs, 0, sizeof(mBandFilterCoeffs));
+    for (auto i = 0; i < Bands::kNumBands; ++i)
+    {
+        mBandFilterCoeffs[0][i] = filters[i].b0;
+        mBandFilterCoeffs[1][i] = filters[i].b1;
+        mBandFilterCoeffs[2][i] = filters[i].b2;
+        mBandFilterCoeffs[3][i] = filters[i].a1;
+        mBandFilterCoeffs[4][i] = filters[i].a2;
     }
-    mFilters[Bands::kNumBands - 1].setFilter(IIR::highPass(Bands::kLowCutoffFrequencies[Bands::kNumBands - 1], samplingRate));
 }
 
 void Reconstructor::reconstruct(int numIRs,
@@ -91,100 +148,209 @@ void Reconstructor::reconstruct(int numIRs,
         auto numSamples = static_cast<int>(ceilf(duration * mSamplingRate));
 
         numChannels = std::min({ energyField.numChannels(), impulseResponse.numChannels(), numChannels });
-        auto numSamplesPerBin = static_cast<int>(ceilf(EnergyField::kBinDuration * mSamplingRate));
-        numSamples = std::min({ impulseResponse.numSamples(), numSamples });
-        auto numBins = std::min({ energyField.numBins(), static_cast<int>(ceilf(static_cast<float>(numSamples) / static_cast<float>(numSamplesPerBin))) });
+        numSamples = std::min({ impulseResponse.numSamples(), static_cast<int>(mWhiteNoise.size(0)), numSamples });
+        auto numTotalBins = (numSamples + mNumSamplesPerBin - 1) / mNumSamplesPerBin;
+        auto numBins = std::min(energyField.numBins(), numTotalBins);
 
         impulseResponses[i]->reset();
 
+        precomputeBinGains(energyField, airAbsorptionModels[i], numBins);
+
         for (auto iChannel = 0; iChannel < numChannels; ++iChannel)
         {
-            for (auto iBand = 0; iBand < Bands::kNumBands; ++iBand)
+            reconstructChannel(energyField, iChannel, distanceAttenuationCorrectionCurves[i], type, numBins, numSamples,
+                               0, 0, numTotalBins, impulseResponse[iChannel]);
+        }
+    }
+}
+
+void Reconstructor::reconstructDirtyBins(int numIRs,
+                                         const EnergyField* const* energyFields,
+                                         const float* const* distanceAttenuationCorrectionCurves,
+                                         const AirAbsorptionModel* airAbsorptionModels,
+                                         ImpulseResponse* const* impulseResponses,
+                                         ReconstructionType type,
+                                         float duration,
+                                         int order)
+{
+    PROFILE_FUNCTION();
+
+    for (auto i = 0; i < numIRs; ++i)
+    {
+        const auto& energyField = *energyFields[i];
+        auto& impulseResponse = *impulseResponses[i];
+
+        if (!energyField.hasDirtyBins())
+            continue;
+
+        auto numChannels = SphericalHarmonics::numCoeffsForOrder(order);
+        auto numSamples = static_cast<int>(ceilf(duration * mSamplingRate));
+
+        numChannels = std::min({ energyField.numChannels(), impulseResponse.numChannels(), numChannels });
+        numSamples = std::min({ impulseResponse.numSamples(), static_cast<int>(mWhiteNoise.size(0)), numSamples });
+        auto numTotalBins = (numSamples + mNumSamplesPerBin - 1) / mNumSamplesPerBin;
+        auto numBins = std::min(energyField.numBins(), numTotalBins);
+
+        precomputeBinGains(energyField, airAbsorptionModels[i], numBins);
+
+        // A change in one bin affects the filter outputs for a short while after it, and with linear interpolation,
+        // also the envelope of the next bin. Each run of dirty bins is therefore synthesized again along with a few
+        // bins after it, and the filters are warmed up over a few bins before it. By the time the filters reach bins
+        // that are kept from the previous reconstruction, the difference in their state has decayed to nothing.
+        auto numTrailingBins = kNumGuardBins + ((type == ReconstructionType::Linear) ? 1 : 0);
+
+        auto iBin = 0;
+        while (iBin < numBins)
+        {
+            if (!energyField.isBinDirty(iBin))
+            {
+                ++iBin;
+                continue;
+            }
+
+            // Merge runs of dirty bins whose windows would overlap.
+            auto firstDirtyBin = iBin;
+            auto lastDirtyBin = iBin;
+            for (++iBin; iBin < numBins && iBin <= lastDirtyBin + numTrailingBins + kNumGuardBins; ++iBin)
             {
-                for (auto iBin = 0; iBin < numBins; ++iBin)
+                if (energyField.isBinDirty(iBin))
                 {
-                    auto numBinSamples = std::min(numSamplesPerBin, numSamples - iBin * numSamplesPerBin);
-                    auto normalization = 1.0f;
-
-                    if (type == ReconstructionType::Linear)
-                    {
-                        auto energy = 0.0f;
-                        if (fabsf(energyField[iChannel][iBand][iBin]) >= kEnergyThreshold && fabsf(energyField[0][iBand][iBin]) >= kEnergyThreshold)
-                        {
-                            energy = energyField[iChannel][iBand][iBin] / sqrtf(energyField[0][iBand][iBin] * sqrtf(4.0f * Math::kPi));
-                        }
-
-                        auto prevEnergy = 0.0f;
-                        if (iBin == 0)
-                        {
-                            prevEnergy = energy;
-                        }
-                        else if (fabsf(energyField[iChannel][iBand][iBin - 1]) >= kEnergyThreshold && fabsf(energyField[0][iBand][iBin - 1]) >= kEnergyThreshold)
-                        {
-                            prevEnergy = energyField[iChannel][iBand][iBin - 1] / sqrtf(energyField[0][iBand][iBin - 1] * sqrtf(4.0f * Math::kPi));
-                        }
-
-                        for (auto iBinSample = 0, iSample = iBin * numSamplesPerBin; iBinSample < numBinSamples; ++iBinSample, ++iSample)
-                        {
-                            auto weight = static_cast<float>(iBinSample) / static_cast<float>(numSamplesPerBin);
-                            auto sampleEnergy = (1.0f - weight) * prevEnergy + weight * energy;
-
-                            mBandIRs[iBand][iSample] = sampleEnergy * mWhiteNoise[iBand][iSample];
-                        }
-                    }
-                    else if (type == ReconstructionType::Gaussian)
-                    {
-                        if (fabsf(energyField[iChannel][iBand][iBin]) < kEnergyThreshold || fabsf(energyField[0][iBand][iBin]) < kEnergyThreshold)
-                            continue;
-
-                        auto tMean = ((iBin + 0.5f) * numSamplesPerBin) / mSamplingRate;
-                        auto tVariance = kMinVariance;
-
-                        auto iSample = iBin * numSamplesPerBin;
-
-                        auto t = iSample / static_cast<float>(mSamplingRate);
-                        auto dt = 1.0f / mSamplingRate;
-                        auto g = expf(-((t - tMean) * (t - tMean)) / (2.0f * tVariance));
-                        auto dg = expf(-(dt * ((2.0f * (t - tMean)) + dt)) / (2.0f * tVariance));
-                        auto ddg = expf(-(dt * dt) / tVariance);
-
-                        for (auto iBinSample = 0; iBinSample < numBinSamples; ++iBinSample, ++iSample)
-                        {
-                            mBandIRs[iBand][iSample] = g * mWhiteNoise[iBand][iSample];
-
-                            g *= dg;
-                            dg *= ddg;
-                        }
-
-                        normalization = energyField[iChannel][iBand][iBin] / sqrtf(energyField[0][iBand][iBin] * sqrtf(4.0f * Math::kPi));
-                        assert(Math::isFinite(normalization));
-                    }
-
-                    // 0.5 is for sqrt
-                    normalization *= airAbsorptionModels[i].evaluate(0.5f * PropagationMedium::kSpeedOfSound * ((iBin + 0.5f) * numSamplesPerBin * (1.0f / mSamplingRate)), iBand);
-
-                    auto iSample = iBin * numSamplesPerBin;
-                    ArrayMath::scale(numBinSamples, &mBandIRs[iBand][iSample], normalization, &mBandIRs[iBand][iSample]);
+                    lastDirtyBin = iBin;
                 }
             }
 
-            for (auto iBand = 0; iBand < Bands::kNumBands; ++iBand)
+            auto beginBin = std::max(firstDirtyBin - kNumGuardBins, 0);
+            auto endBin = std::min(lastDirtyBin + numTrailingBins + 1, numTotalBins);
+
+            for (auto iChannel = 0; iChannel < numChannels; ++iChannel)
             {
-                mFilters[iBand].reset();
+                reconstructChannel(energyField, iChannel, distanceAttenuationCorrectionCurves[i], type, numBins,
+                                   numSamples, beginBin, firstDirtyBin, endBin, impulseResponse[iChannel]);
             }
 
-            mFilters[0].apply(numSamples, mBandIRs[0], impulseResponse[iChannel]);
-            for (auto iBand = 1; iBand < Bands::kNumBands; ++iBand)
+            impulseResponse.markModified(firstDirtyBin * mNumSamplesPerBin, std::min(endBin * mNumSamplesPerBin, numSamples));
+
+            iBin = endBin;
+        }
+    }
+}
+
+void Reconstructor::precomputeBinGains(const EnergyField& energyField,
+                                       const AirAbsorptionModel& airAbsorptionModel,
+                                       int numBins)
+{
+    auto normalizationScalar = sqrtf(4.0f * Math::kPi);
+
+    for (auto iBin = 0; iBin < numBins; ++iBin)
+    {
+        // 0.5 is for sqrt
+        auto distance = 0.5f * PropagationMedium::kSpeedOfSound * ((iBin + 0.5f) * mNumSamplesPerBin * (1.0f / mSamplingRate));
+
+        for (auto iBand = 0; iBand < Bands::kNumBands; ++iBand)
+        {
+            auto energy = energyField[0][iBand][iBin];
+            mBinNormalizations[iBin][iBand] = (fabsf(energy) >= kEnergyThreshold) ? 1.0f / sqrtf(energy * normalizationScalar) : 0.0f;
+            mBinAirAbsorptions[iBin][iBand] = airAbsorptionModel.evaluate(distance, iBand);
+        }
+    }
+}
+
+void Reconstructor::reconstructChannel(const EnergyField& energyField,
+                                       int channel,
+                                       const float* distanceAttenuationCorrectionCurve,
+                                       ReconstructionType type,
+                                       int numBins,
+                                       int numSamples,
+                                       int beginBin,
+                                       int outputBeginBin,
+                                       int endBin,
+                                       float* impulseResponse)
+{
+    for (auto iBin = std::max(beginBin - 1, 0); iBin < std::min(endBin, numBins); ++iBin)
+    {
+        for (auto iBand = 0; iBand < Bands::kNumBands; ++iBand)
+        {
+            auto energy = energyField[channel][iBand][iBin];
+            mBinGains[iBin][iBand] = (fabsf(energy) >= kEnergyThreshold) ? energy * mBinNormalizations[iBin][iBand] : 0.0f;
+            assert(Math::isFinite(mBinGains[iBin][iBand]));
+        }
+    }
+
+    // For each bin, the envelope applied to sample k of the bin is start + window[k] * slope, evaluated for all bands
+    // at once.
+    const auto* window = (type == ReconstructionType::Linear) ? mLinearWindow.data() : mGaussianWindow.data();
+
+    auto b0 = float4::load(mBandFilterCoeffs[0]);
+    auto b1 = float4::load(mBandFilterCoeffs[1]);
+    auto b2 = float4::load(mBandFilterCoeffs[2]);
+    auto a1 = float4::load(mBandFilterCoeffs[3]);
+    auto a2 = float4::load(mBandFilterCoeffs[4]);
+
+    auto xm1 = float4::zero();
+    auto xm2 = float4::zero();
+    auto ym1 = float4::zero();
+    auto ym2 = float4::zero();
+
+    auto epsilon = float4::set1(1e-9f);
+
+    for (auto iBin = beginBin; iBin < endBin; ++iBin)
+    {
+        auto iBinStart = iBin * mNumSamplesPerBin;
+        auto numBinSamples = std::min(mNumSamplesPerBin, numSamples - iBinStart);
+
+        // Past the last bin, the envelope is silent, but the filters are still allowed to ring out.
+        auto start = float4::zero();
+        auto slope = float4::zero();
+
+        if (iBin < numBins)
+        {
+            auto airAbsorption = float4::load(mBinAirAbsorptions[iBin]);
+            auto gain = float4::mul(float4::load(mBinGains[iBin]), airAbsorption);
+
+            if (type == ReconstructionType::Linear)
             {
-                mFilters[iBand].apply(numSamples, mBandIRs[iBand], mBandIRs[iBand]);
-                ArrayMath::add(numSamples, impulseResponse[iChannel], mBandIRs[iBand], impulseResponse[iChannel]);
+                auto prevGain = float4::mul(float4::load(mBinGains[std::max(iBin - 1, 0)]), airAbsorption);
+                start = prevGain;
+                slope = float4::sub(gain, prevGain);
             }
-
-            if (distanceAttenuationCorrectionCurves[i])
+            else
             {
-                ArrayMath::multiply(numSamples, impulseResponse[iChannel], distanceAttenuationCorrectionCurves[i], impulseResponse[iChannel]);
+                slope = gain;
             }
         }
+
+        // Bins before outputBeginBin only warm up the filters, their output is discarded.
+        const auto* noise = &mWhiteNoise[iBinStart];
+        auto* out = (iBin < outputBeginBin) ? mGuardBinSamples.data() : &impulseResponse[iBinStart];
+
+        for (auto i = 0; i < numBinSamples; ++i)
+        {
+            auto envelope = float4::add(start, float4::mul(float4::set1(window[i]), slope));
+            auto x = float4::add(float4::mul(envelope, float4::set1(noise[i])), epsilon);
+
+            // The feedback term is added last, to keep the dependency between consecutive samples short.
+            auto y = float4::mul(b0, x);
+            y = float4::add(y, float4::mul(b1, xm1));
+            y = float4::add(y, float4::mul(b2, xm2));
+            y = float4::sub(y, float4::mul(a2, ym2));
+            y = float4::sub(y, float4::mul(a1, ym1));
+
+            xm2 = xm1;
+            xm1 = x;
+            ym2 = ym1;
+            ym1 = y;
+
+            out[i] = float4::get1(y) + float4::get1(float4::replicate<1>(y)) + float4::get1(float4::replicate<2>(y));
+        }
+    }
+
+    if (distanceAttenuationCorrectionCurve)
+    {
+        auto outputBeginSample = outputBeginBin * mNumSamplesPerBin;
+        auto outputEndSample = std::min(endBin * mNumSamplesPerBin, numSamples);
+
+        ArrayMath::multiply(outputEndSample - outputBeginSample, &impulseResponse[outputBeginSample],
+                            &distanceAttenuationCorrectionCurve[outputBeginSample], &impulseResponse[outputBeginSample]);
     }
 }
 
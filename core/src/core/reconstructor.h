@@ -49,6 +49,19 @@ public:
                              float duration,
                              int order) = 0;
 
+    // Like reconstruct, but only updates the parts of each impulse response affected by the dirty bins of the
+    // corresponding energy field. The rest of each impulse response must hold the result of a previous
+    // reconstruction from the same energy field with the same parameters. Updated samples are marked as modified in
+    // the impulse response. The default implementation reconstructs the entire impulse response.
+    virtual void reconstructDirtyBins(int numIRs,
+                                      const EnergyField* const* energyFields,
+                                      const float* const* distanceAttenuationCorrectionCurves,
+                                      const AirAbsorptionModel* airAbsorptionModels,
+                                      ImpulseResponse* const* impulseResponses,
+                                      ReconstructionType type,
+                                      float duration,
+                                      int order);
+
 protected:
     static const float kEnergyThreshold;
     static const float kMinVariance;
@@ -76,13 +89,50 @@ public:
                              float duration,
                              int order) override;
 
+    virtual void reconstructDirtyBins(int numIRs,
+                                      const EnergyField* const* energyFields,
+                                      const float* const* distanceAttenuationCorrectionCurves,
+                                      const AirAbsorptionModel* airAbsorptionModels,
+                                      ImpulseResponse* const* impulseResponses,
+                                      ReconstructionType type,
+                                      float duration,
+                                      int order) override;
+
 private:
+    static const int kNumGuardBins;
+
     float mMaxDuration;
     int mMaxOrder;
     int mSamplingRate;
-    Array<float, 2> mWhiteNoise;
-    Array<float, 2> mBandIRs;
-    Array<IIRFilterer> mFilters;
+    int mNumSamplesPerBin;
+    Array<float> mWhiteNoise;
+    Array<float> mGaussianWindow;
+    Array<float> mLinearWindow;
+    Array<float> mGuardBinSamples;
+    Array<float, 2> mBinNormalizations;
+    Array<float, 2> mBinAirAbsorptions;
+    Array<float, 2> mBinGains;
+    alignas(float4_t) float mBandFilterCoeffs[5][4];
+
+    // Fills mBinNormalizations and mBinAirAbsorptions for all bins of an energy field. These depend only on the
+    // 0th-order channel and the distance of each bin, so are shared by all channels of the impulse response.
+    void precomputeBinGains(const EnergyField& energyField,
+                            const AirAbsorptionModel& airAbsorptionModel,
+                            int numBins);
+
+    // Synthesizes bins [beginBin, endBin) of one channel of an impulse response, filtering all bands at once using
+    // SIMD operations. The filters start from silence at beginBin, and output is only written for bins starting at
+    // outputBeginBin.
+    void reconstructChannel(const EnergyField& energyField,
+                            int channel,
+                            const float* distanceAttenuationCorrectionCurve,
+                            ReconstructionType type,
+                            int numBins,
+                            int numSamples,
+                            int beginBin,
+                            int outputBeginBin,
+                            int endBin,
+                            float* impulseResponse);
 };
 
 }
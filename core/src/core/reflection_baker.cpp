@@ -88,7 +88,8 @@ void ReflectionBaker::bake(const IScene& scene,
                            shared_ptr<OpenCLDevice> openCL,
                            ProbeBatch& probeBatch,
                            ProgressCallback callback,
-                           void* userData)
+                           void* userData,
+                           EnergyFieldCompression energyFieldCompression)
 {
     PROFILE_FUNCTION();
 
@@ -114,6 +115,7 @@ void ReflectionBaker::bake(const IScene& scene,
 
     reflectionsData->setHasConvolution(bakeConvolution);
     reflectionsData->setHasParametric(bakeParametric);
+    reflectionsData->setEnergyFieldCompression(energyFieldCompression);
 
     JobGraph jobGraph;
     ThreadPool threadPool(numThreads);
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include "compressed_energy_field.h"
 #include "energy_field.h"
 #include "opencl_device.h"
 #include "probe_batch.h"
@@ -50,7 +51,8 @@ public:
                      shared_ptr<OpenCLDevice> openCL,
                      ProbeBatch& probeBatch,
                      ProgressCallback callback = nullptr,
-                     void* userData = nullptr);
+                     void* userData = nullptr,
+                     EnergyFieldCompression energyFieldCompression = EnergyFieldCompression::None);
 
     static void cancel();
 
@@ -0,0 +1,78 @@
+//
+// Copyright 2017-2023 Valve Corporation.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "reflection_path_cache.h"
+
+#include <algorithm>
+
+#include "profiler.h"
+
+namespace ipl {
+
+// --------------------------------------------------------------------------------------------------------------------
+// ReflectionPathCache
+// --------------------------------------------------------------------------------------------------------------------
+
+const float ReflectionPathCache::kMaxReprojectionWeight = 1.25f;
+
+ReflectionPathCache::ReflectionPathCache(int maxNumSources)
+    : mNumVisibilityWords(std::max((maxNumSources + 31) / 32, 1))
+    , mNumRays(0)
+    , mHistoryLength(1)
+    , mMaxNumVertices(0)
+    , mFrame(0)
+    , mListenerMoved(false)
+    , mPrevListenerOrigin(Vector3f::kZero)
+{}
+
+void ReflectionPathCache::reset(int numRays,
+                                int historyLength,
+                                int maxNumVertices)
+{
+    PROFILE_FUNCTION();
+
+    if (numRays != mNumRays || historyLength != mHistoryLength || maxNumVertices != mMaxNumVertices)
+    {
+        mNumRays = numRays;
+        mHistoryLength = historyLength;
+        mMaxNumVertices = maxNumVertices;
+
+        mPaths.resize(numRays, historyLength);
+        mVertices.resize(numRays * historyLength * maxNumVertices);
+        mVisibility.resize(numRays * historyLength * maxNumVertices * mNumVisibilityWords);
+    }
+
+    for (auto i = 0; i < numRays; ++i)
+    {
+        for (auto j = 0; j < historyLength; ++j)
+        {
+            mPaths[i][j].valid = false;
+            mPaths[i][j].visibilityValid = false;
+            mPaths[i][j].numVertices = 0;
+        }
+    }
+
+    mFrame = 0;
+}
+
+void ReflectionPathCache::beginFrame(const Vector3f& listenerOrigin)
+{
+    mListenerMoved = ((listenerOrigin - mPrevListenerOrigin).length() > 1e-4f);
+    mPrevListenerOrigin = listenerOrigin;
+    ++mFrame;
+}
+
+}
@@ -0,0 +1,135 @@
+//
+// Copyright 2017-2023 Valve Corporation.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include "array.h"
+#include "bands.h"
+#include "material.h"
+#include "vector.h"
+
+namespace ipl {
+
+// --------------------------------------------------------------------------------------------------------------------
+// ReflectionPathCache
+// --------------------------------------------------------------------------------------------------------------------
+
+// A surface hit by a cached reflection path.
+struct CachedPathVertex
+{
+    Vector3f point; // Hit point, offset from the surface along the normal.
+    Vector3f normal; // Surface normal, facing the incoming ray.
+    Vector3f direction; // Direction of the incoming ray.
+    const Material* material;
+    float distance; // Length of the incoming ray.
+    float accumDistance; // Length of the path from the listener up to the start of the incoming ray.
+    float accumEnergy[Bands::kNumBands]; // Energy carried by the incoming ray.
+};
+
+// A reflection path traced from the listener, stored so that it can be shaded again in later frames without tracing
+// it again.
+struct CachedPath
+{
+    bool valid; // False once the path can no longer be used, until it is traced again.
+    bool visibilityValid; // False if the visibility of sources from the vertices has not been checked yet.
+    int numVertices;
+    Vector3f origin; // Listener position from which the path was traced.
+    float firstDistance; // Distance from origin to the (offset) first hit point.
+    float firstCosine; // Cosine of the angle between the first ray and the normal at the first vertex.
+    float weight; // Ratio of the solid angle covered by this path from the current listener to that when traced.
+};
+
+// Reflection paths from previous frames, for one listener. For each listener ray direction, the cache holds paths
+// traced in each of the last few frames (the history length). When the listener moves, the first segment of each path
+// is reprojected to the new listener position and checked with a single visibility test, instead of tracing the whole
+// path again. Shading is always done against the current source positions, and the visibility of each source from
+// each vertex is cached until that source moves.
+class ReflectionPathCache
+{
+public:
+    // Paths whose solid angle changes by more than this factor when reprojected are discarded.
+    static const float kMaxReprojectionWeight;
+
+    ReflectionPathCache(int maxNumSources);
+
+    int numRays() const
+    {
+        return mNumRays;
+    }
+
+    int historyLength() const
+    {
+        return mHistoryLength;
+    }
+
+    int maxNumVertices() const
+    {
+        return mMaxNumVertices;
+    }
+
+    bool listenerMoved() const
+    {
+        return mListenerMoved;
+    }
+
+    // Index of the path to trace again for each ray direction this frame, if all paths are still valid.
+    int refreshSlot() const
+    {
+        return mFrame % mHistoryLength;
+    }
+
+    CachedPath& path(int rayIndex,
+                     int slot)
+    {
+        return mPaths[rayIndex][slot];
+    }
+
+    CachedPathVertex* vertices(int rayIndex,
+                               int slot)
+    {
+        return &mVertices[(rayIndex * mHistoryLength + slot) * mMaxNumVertices];
+    }
+
+    // Bit mask of the sources visible from the given vertex.
+    uint32_t* visibility(int rayIndex,
+                         int slot,
+                         int vertexIndex)
+    {
+        return &mVisibility[((rayIndex * mHistoryLength + slot) * mMaxNumVertices + vertexIndex) * mNumVisibilityWords];
+    }
+
+    // Discards all cached paths, resizing the cache if needed.
+    void reset(int numRays,
+               int historyLength,
+               int maxNumVertices);
+
+    // Starts a new frame, given the current listener position.
+    void beginFrame(const Vector3f& listenerOrigin);
+
+private:
+    int mNumVisibilityWords;
+    int mNumRays;
+    int mHistoryLength;
+    int mMaxNumVertices;
+    int mFrame;
+    bool mListenerMoved;
+    Vector3f mPrevListenerOrigin;
+    Array<CachedPath, 2> mPaths;
+    Array<CachedPathVertex> mVertices;
+    Array<uint32_t> mVisibility;
+};
+
+}
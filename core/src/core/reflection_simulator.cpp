@@ -16,10 +16,12 @@
 
 #include "reflection_simulator.h"
 
+#include "array_math.h"
 #include "direct_simulator.h"
 #include "propagation_medium.h"
 #include "sh.h"
 #include "profiler.h"
+#include "stack.h"
 
 namespace ipl {
 
@@ -33,27 +35,159 @@ const float IReflectionSimulator::kSourceRadius = 0.1f;
 const float IReflectionSimulator::kListenerRadius = 0.1f;
 
 
+// --------------------------------------------------------------------------------------------------------------------
+// ThreadLocalEnergyFields
+// --------------------------------------------------------------------------------------------------------------------
+
+const int ThreadLocalEnergyFields::kNumReductionJobsPerThread = 4;
+
+ThreadLocalEnergyFields::ThreadLocalEnergyFields(int numThreads,
+                                                 int maxNumSources,
+                                                 float maxDuration,
+                                                 int maxOrder)
+    : mNumThreads(numThreads)
+    , mNumChannels(SphericalHarmonics::numCoeffsForOrder(maxOrder))
+    , mEnergyFields(numThreads, maxNumSources)
+    , mTouched(numThreads, maxNumSources)
+{
+    for (auto i = 0; i < numThreads; ++i)
+    {
+        for (auto j = 0; j < maxNumSources; ++j)
+        {
+            mEnergyFields[i][j] = make_unique<EnergyField>(maxDuration, maxOrder);
+        }
+    }
+
+    mTouched.zero();
+}
+
+void ThreadLocalEnergyFields::reset(int numSources,
+                                    EnergyField* const* energyFields)
+{
+    for (auto i = 0; i < numSources; ++i)
+    {
+        energyFields[i]->reset();
+
+        for (auto j = 0; j < mNumThreads; ++j)
+        {
+            if (mTouched[j][i])
+            {
+                mEnergyFields[j][i]->reset();
+                mTouched[j][i] = false;
+            }
+        }
+    }
+}
+
+void ThreadLocalEnergyFields::reduce(EnergyField* const* energyFields,
+                                     int start,
+                                     int end)
+{
+    PROFILE_FUNCTION();
+
+    for (auto i = start; i < end; ++i)
+    {
+        auto source = i / mNumChannels;
+        auto channel = i % mNumChannels;
+
+        auto& energyField = *energyFields[source];
+        if (channel >= energyField.numChannels())
+            continue;
+
+        for (auto j = 0; j < mNumThreads; ++j)
+        {
+            if (!mTouched[j][source])
+                continue;
+
+            const auto& threadEnergyField = *mEnergyFields[j][source];
+            auto numBins = std::min(energyField.numBins(), threadEnergyField.numBins());
+
+            for (auto band = 0; band < Bands::kNumBands; ++band)
+            {
+                ArrayMath::add(numBins, energyField[channel][band], threadEnergyField[channel][band], energyField[channel][band]);
+            }
+        }
+    }
+}
+
+void ThreadLocalEnergyFields::addReductionJobs(int numSources,
+                                               EnergyField* const* energyFields,
+                                               int firstJob,
+                                               int numJobs,
+                                               JobGraph& jobGraph)
+{
+    // Funnel the dependencies on all the ray tracing jobs through a single empty job, so the number of dependencies
+    // grows with the number of ray tracing jobs plus the number of reduction jobs, rather than their product.
+    auto joinJob = jobGraph.addJob([](int threadId, std::atomic<bool>& cancel)
+    {});
+
+    for (auto i = 0; i < numJobs; ++i)
+    {
+        jobGraph.addDependency(joinJob, firstJob + i);
+    }
+
+    auto numItems = numSources * mNumChannels;
+    auto numReductionJobs = std::min(numItems, mNumThreads * kNumReductionJobsPerThread);
+
+    for (auto i = 0; i < numReductionJobs; ++i)
+    {
+        auto start = (i * numItems) / numReductionJobs;
+        auto end = ((i + 1) * numItems) / numReductionJobs;
+
+        auto reductionJob = jobGraph.addJob([this, energyFields, start, end](int threadId, std::atomic<bool>& cancel)
+        {
+            if (cancel)
+                return;
+
+            reduce(energyFields, start, end);
+        });
+
+        jobGraph.addDependency(reductionJob, joinJob);
+    }
+}
+
+
 // --------------------------------------------------------------------------------------------------------------------
 // ReflectionSimulator
 // --------------------------------------------------------------------------------------------------------------------
 
 const int ReflectionSimulator::kRayBatchSize = 32;
+const float ReflectionSimulator::kMaxSharedHitDistance = 0.5f;
+const float ReflectionSimulator::kMinSharedHitCosine = 0.99f;
 
 ReflectionSimulator::ReflectionSimulator(int maxNumRays,
                                          int numDiffuseSamples,
                                          float maxDuration,
                                          int maxOrder,
                                          int maxNumSources,
-                                         int numThreads)
+                                         int maxNumListeners,
+                                         int numThreads,
+                                         EnergyFieldReduction reduction)
     : mMaxNumRays(maxNumRays)
     , mNumDiffuseSamples(numDiffuseSamples)
     , mMaxDuration(maxDuration)
     , mMaxOrder(maxOrder)
     , mMaxNumSources(maxNumSources)
+    , mMaxNumListeners(maxNumListeners)
     , mNumThreads(numThreads)
+    , mReduction(reduction)
+    , mClusterSources(false)
+    , mMaxClusteringError(0.0f)
+    , mRussianRoulette(false)
+    , mSurvivalThreshold(0.0f)
+    , mRotateDiffuseSamples(false)
+    , mCachePaths(false)
+    , mPathHistoryLength(1)
+    , mPathCacheInvalid(true)
+    , mPathCacheScene(nullptr)
+    , mPathCacheDuration(0.0f)
+    , mPathCacheIrradianceMinDistance(0.0f)
+    , mPathCacheNumSources(0)
+    , mShareListenerPaths(false)
     , mNumSources(maxNumSources)
     , mSources(nullptr)
-    , mListener(nullptr)
+    , mNumListeners(1)
+    , mListeners(nullptr)
     , mDirectivities(nullptr)
     , mNumRays(maxNumRays)
     , mNumBounces(0)
@@ -64,6 +198,11 @@ ReflectionSimulator::ReflectionSimulator(int maxNumRays,
     , mDiffuseSamples(numDiffuseSamples)
     , mListenerCoeffs(maxNumRays, SphericalHarmonics::numCoeffsForOrder(maxOrder))
     , mThreadState(numThreads)
+    , mThreadEnergyFields(numThreads, maxNumSources * maxNumListeners, maxDuration, maxOrder)
+    , mSourceClusterTree(maxNumSources)
+    , mPrevSources(maxNumSources)
+    , mSourceMoved(maxNumSources)
+    , mSharedPathCache(maxNumSources)
 {
     Sampling::generateSphereSamples(maxNumRays, mListenerSamples.data());
     Sampling::generateHemisphereSamples(numDiffuseSamples, mDiffuseSamples.data());
@@ -79,14 +218,70 @@ ReflectionSimulator::ReflectionSimulator(int maxNumRays,
         }
     }
 
+    auto maxNumClusters = std::max(2 * maxNumSources - 1, 1);
+
     for (auto i = 0; i < numThreads; ++i)
     {
-        mThreadState[i].energyFields.resize(maxNumSources);
-        for (auto j = 0; j < maxNumSources; ++j)
-        {
-            mThreadState[i].energyFields[j] = make_unique<EnergyField>(maxDuration, maxOrder);
-        }
+        mThreadState[i].sourceEnergy.resize(maxNumSources, Bands::kNumBands);
+        mThreadState[i].sourceDelay.resize(maxNumSources);
+        mThreadState[i].sourceVisible.resize(maxNumSources);
+        mThreadState[i].clusterEnergy.resize(maxNumClusters);
+        mThreadState[i].clusterRepresentative.resize(maxNumClusters);
+        mThreadState[i].reprojectedCoeffs.resize(SphericalHarmonics::numCoeffsForOrder(maxOrder));
+    }
+
+    for (auto i = 0; i < maxNumListeners; ++i)
+    {
+        mPathCaches.push_back(ipl::make_unique<ReflectionPathCache>(maxNumSources));
+    }
+}
+
+bool ReflectionSimulator::supportsMultipleListeners() const
+{
+    return true;
+}
+
+void ReflectionSimulator::setSourceClustering(bool enable,
+                                              float maxRelativeError)
+{
+    mClusterSources = enable;
+    mMaxClusteringError = maxRelativeError;
+}
+
+void ReflectionSimulator::setRussianRoulette(bool enable,
+                                             float survivalThreshold)
+{
+    mRussianRoulette = enable;
+    mSurvivalThreshold = survivalThreshold;
+}
+
+void ReflectionSimulator::setDiffuseSampleRotation(bool enable)
+{
+    mRotateDiffuseSamples = enable;
+}
+
+void ReflectionSimulator::setPathCaching(bool enable,
+                                         int historyLength)
+{
+    historyLength = std::max(historyLength, 1);
+
+    if (enable != mCachePaths || historyLength != mPathHistoryLength)
+    {
+        mPathCacheInvalid = true;
     }
+
+    mCachePaths = enable;
+    mPathHistoryLength = historyLength;
+}
+
+void ReflectionSimulator::invalidatePathCache()
+{
+    mPathCacheInvalid = true;
+}
+
+void ReflectionSimulator::setListenerPathSharing(bool enable)
+{
+    mShareListenerPaths = enable;
 }
 
 void ReflectionSimulator::simulate(const IScene& scene,
@@ -120,7 +315,8 @@ void ReflectionSimulator::simulate(const IScene& scene,
 
     mNumSources = numSources;
     mSources = sources;
-    mListener = &listeners[0];
+    mNumListeners = 1;
+    mListeners = listeners;
     mDirectivities = directivities;
     mNumRays = numRays;
     mNumBounces = numBounces;
@@ -128,6 +324,11 @@ void ReflectionSimulator::simulate(const IScene& scene,
     mOrder = order;
     mIrradianceMinDistance = irradianceMinDistance;
 
+    if (mClusterSources)
+    {
+        mSourceClusterTree.build(numSources, sources);
+    }
+
     image.zero();
 
     for (auto i = 0; i < numRays; i += kRayBatchSize)
@@ -158,7 +359,16 @@ void ReflectionSimulator::simulate(const IScene& scene,
 {
     PROFILE_FUNCTION();
 
-    assert(numListeners == 1);
+    // If we've been asked to simulate more listeners than the max number we were initialized with, don't process the
+    // extra ones.
+    if (numListeners > mMaxNumListeners)
+    {
+        gLog().message(MessageSeverity::Warning,
+            "Simulating reflections for %d listeners, which is more than the max (%d). Some listeners will be ignored.",
+            numListeners, mMaxNumListeners);
+
+        numListeners = mMaxNumListeners;
+    }
 
     // If we've been asked to simulate more sources than the max number we were initialized with, don't process the
     // extra ones.
@@ -173,7 +383,8 @@ void ReflectionSimulator::simulate(const IScene& scene,
 
     mNumSources = numSources;
     mSources = sources;
-    mListener = &listeners[0];
+    mNumListeners = numListeners;
+    mListeners = listeners;
     mDirectivities = directivities;
     mNumRays = numRays;
     mNumBounces = numBounces;
@@ -181,33 +392,73 @@ void ReflectionSimulator::simulate(const IScene& scene,
     mOrder = order;
     mIrradianceMinDistance = irradianceMinDistance;
 
-    for (auto i = 0; i < numSources; ++i)
+    if (mClusterSources)
     {
-        energyFields[i]->reset();
-        for (auto j = 0; j < mNumThreads; ++j)
+        mSourceClusterTree.build(numSources, sources);
+    }
+
+    if (mCachePaths)
+    {
+        preparePathCaches(scene);
+    }
+
+    auto shareListenerPaths = (mShareListenerPaths && !mCachePaths && numListeners > 1);
+    if (shareListenerPaths)
+    {
+        auto maxNumVertices = std::max(numBounces, 1);
+        if (mSharedPathCache.numRays() != numRays || mSharedPathCache.maxNumVertices() != maxNumVertices)
         {
-            mThreadState[j].energyFields[i]->reset();
+            mSharedPathCache.reset(numRays, 1, maxNumVertices);
         }
     }
 
+    // Rays from all listeners are traced by the same set of jobs, and share the per-thread state, the source cluster
+    // tree, and the energy field reduction. If paths are shared, each job handles its rays for every listener.
+    auto numEnergyFields = numListeners * numSources;
+
+    mThreadEnergyFields.reset(numEnergyFields, energyFields);
+
     mNumJobsRemaining = 0;
 
-    for (auto i = 0; i < numRays; i += kRayBatchSize)
-    {
-        ++mNumJobsRemaining;
+    auto firstJob = jobGraph.numJobs();
 
-        auto start = i;
-        auto end = std::min(numRays, i + kRayBatchSize);
+    auto numJobListeners = (shareListenerPaths) ? 1 : numListeners;
 
-        jobGraph.addJob([this, &scene, energyFields, start, end](int threadId, std::atomic<bool>& cancel)
+    for (auto listenerIndex = 0; listenerIndex < numJobListeners; ++listenerIndex)
+    {
+        for (auto i = 0; i < numRays; i += kRayBatchSize)
         {
-            simulateJob(scene, start, end, threadId, cancel);
+            ++mNumJobsRemaining;
 
-            if (--mNumJobsRemaining == 0)
+            auto start = i;
+            auto end = std::min(numRays, i + kRayBatchSize);
+
+            jobGraph.addJob([this, &scene, energyFields, shareListenerPaths, listenerIndex, start, end](int threadId, std::atomic<bool>& cancel)
             {
-                finalizeJob(energyFields, cancel);
-            }
-        });
+                if (shareListenerPaths)
+                {
+                    simulateSharedJob(scene, start, end, threadId, cancel);
+                }
+                else if (mCachePaths)
+                {
+                    simulateCachedJob(scene, listenerIndex, start, end, threadId, cancel);
+                }
+                else
+                {
+                    simulateJob(scene, listenerIndex, start, end, threadId, cancel);
+                }
+
+                if (mReduction == EnergyFieldReduction::Serial && --mNumJobsRemaining == 0)
+                {
+                    finalizeJob(energyFields, cancel);
+                }
+            });
+        }
+    }
+
+    if (mReduction == EnergyFieldReduction::Parallel)
+    {
+        mThreadEnergyFields.addReductionJobs(numEnergyFields, energyFields, firstJob, jobGraph.numJobs() - firstJob, jobGraph);
     }
 }
 
@@ -239,7 +490,8 @@ void ReflectionSimulator::simulate(const IScene& scene,
 
     mNumSources = numSources;
     mSources = sources;
-    mListener = &listeners[0];
+    mNumListeners = 1;
+    mListeners = listeners;
     mDirectivities = directivities;
     mNumRays = numRays;
     mNumBounces = numBounces;
@@ -247,6 +499,11 @@ void ReflectionSimulator::simulate(const IScene& scene,
     mOrder = order;
     mIrradianceMinDistance = irradianceMinDistance;
 
+    if (mClusterSources)
+    {
+        mSourceClusterTree.build(numSources, sources);
+    }
+
     for (auto i = 0; i < numRays; ++i)
     {
         Ray ray{ listeners[0].origin, mListenerSamples[i] };
@@ -258,7 +515,7 @@ void ReflectionSimulator::simulate(const IScene& scene,
         {
             Hit hit;
             Vector3f hitPoint;
-            if (!trace(scene, ray, j, accumDistance, hit, hitPoint))
+            if (!trace(scene, listeners[0], ray, j, accumDistance, hit, hitPoint))
             {
                 if (!hit.isValid())
                 {
@@ -290,7 +547,7 @@ void ReflectionSimulator::simulateJob(const IScene& scene,
     assert(0 <= threadId && threadId < mNumThreads);
 
     const auto scalar = 500.0f;
-    const auto& camera = *mListener;
+    const auto& camera = mListeners[0];
     const auto n = static_cast<int>(floorf(sqrtf(static_cast<float>(mNumRays))));
 
     for (auto i = start; i < end; ++i)
@@ -310,16 +567,33 @@ void ReflectionSimulator::simulateJob(const IScene& scene,
         {
             Hit hit;
             Vector3f hitPoint;
-            if (!trace(scene, ray, j, accumDistance, hit, hitPoint))
+            if (!trace(scene, camera, ray, j, accumDistance, hit, hitPoint))
                 break;
 
+            if (mClusterSources)
+            {
+                shadeClusters(scene, camera, ray, hit, hitPoint, accumEnergy, accumDistance, scalar, threadId);
+            }
+
             for (auto k = 0; k < mNumSources; ++k)
             {
                 float energy[Bands::kNumBands] = { 0.0f, 0.0f, 0.0f };
                 auto delay = 0.0f;
 
-                if (!shade(scene, ray, j, k, hit, hitPoint, accumEnergy, accumDistance, scalar, energy, delay))
+                if (mClusterSources)
+                {
+                    if (!mThreadState[threadId].sourceVisible[k])
+                        continue;
+
+                    for (auto band = 0; band < Bands::kNumBands; ++band)
+                    {
+                        energy[band] = mThreadState[threadId].sourceEnergy[k][band];
+                    }
+                }
+                else if (!shade(scene, camera, ray, j, k, hit, hitPoint, accumEnergy, accumDistance, scalar, energy, delay))
+                {
                     continue;
+                }
 
                 image[i][0] += energy[0];
                 image[i][1] += energy[1];
@@ -328,13 +602,15 @@ void ReflectionSimulator::simulateJob(const IScene& scene,
 
             if (j < mNumBounces - 1)
             {
-                bounce(scene, j, hit, hitPoint, threadId, ray, accumEnergy, accumDistance);
+                if (!bounce(scene, j, hit, hitPoint, threadId, ray, accumEnergy, accumDistance))
+                    break;
             }
         }
     }
 }
 
 void ReflectionSimulator::simulateJob(const IScene& scene,
+                                      int listenerIndex,
                                       int start,
                                       int end,
                                       int threadId,
@@ -344,78 +620,467 @@ void ReflectionSimulator::simulateJob(const IScene& scene,
 
     assert(0 <= threadId && threadId < mNumThreads);
     assert(0 < mNumSources && mNumSources <= mMaxNumSources);
+    assert(0 <= listenerIndex && listenerIndex < mNumListeners);
+
+    for (auto i = start; i < end; ++i)
+    {
+        simulateRay(scene, listenerIndex, i, threadId, false, cancel);
+
+        if (cancel)
+            return;
+    }
+}
+
+void ReflectionSimulator::simulateCachedJob(const IScene& scene,
+                                            int listenerIndex,
+                                            int start,
+                                            int end,
+                                            int threadId,
+                                            std::atomic<bool>& cancel)
+{
+    PROFILE_FUNCTION();
+
+    assert(0 <= threadId && threadId < mNumThreads);
+    assert(0 < mNumSources && mNumSources <= mMaxNumSources);
+    assert(0 <= listenerIndex && listenerIndex < mNumListeners);
 
     const auto scalar = (4.0f * Math::kPi) / mNumRays;
-    const auto& listener = *mListener;
+    const auto& listener = mListeners[listenerIndex];
+    const auto firstEnergyField = listenerIndex * mNumSources;
+    auto& cache = *mPathCaches[listenerIndex];
 
     for (auto i = start; i < end; ++i)
     {
-        Ray ray{ listener.origin, mListenerSamples[i] };
+        // One path is traced for each direction, replacing a path that can no longer be used, if any, or else the
+        // oldest one.
+        auto slotToTrace = -1;
+        for (auto j = 0; j < cache.historyLength(); ++j)
+        {
+            auto& path = cache.path(i, j);
+            if (path.valid && cache.listenerMoved())
+            {
+                revalidatePath(scene, listener, path, cache.vertices(i, j));
+            }
 
-        float accumEnergy[Bands::kNumBands] = { 1.0f, 1.0f, 1.0f };
-        float accumDistance = 0.0f;
+            if (!path.valid && slotToTrace < 0)
+            {
+                slotToTrace = j;
+            }
+        }
 
-        for (auto j = 0; j < mNumBounces; ++j)
+        if (slotToTrace < 0)
         {
-            Hit hit;
-            Vector3f hitPoint;
-            if (!trace(scene, ray, j, accumDistance, hit, hitPoint))
-                break;
+            slotToTrace = cache.refreshSlot();
+        }
+
+        tracePath(scene, listener, i, threadId, cache.path(i, slotToTrace), cache.vertices(i, slotToTrace));
+
+        if (cancel)
+            return;
+
+        // Each path is weighted by the solid angle it stands in for, so the paths are averaged using the sum of their
+        // weights rather than their number. Otherwise the contribution of a direction would grow or shrink with the
+        // reprojection weights of its paths.
+        auto weightSum = 0.0f;
+        for (auto j = 0; j < cache.historyLength(); ++j)
+        {
+            const auto& path = cache.path(i, j);
+            if (path.valid)
+            {
+                weightSum += path.weight;
+            }
+        }
+
+        if (weightSum <= 0.0f)
+            continue;
+
+        for (auto j = 0; j < cache.historyLength(); ++j)
+        {
+            if (!cache.path(i, j).valid)
+                continue;
+
+            shadePath(scene, listener, i, j, scalar / weightSum, firstEnergyField, threadId, cache);
 
             if (cancel)
                 return;
+        }
+    }
+}
 
-            for (auto k = 0; k < mNumSources; ++k)
-            {
-                float energy[Bands::kNumBands] = { 0.0f, 0.0f, 0.0f };
-                auto delay = 0.0f;
+void ReflectionSimulator::simulateRay(const IScene& scene,
+                                      int listenerIndex,
+                                      int rayIndex,
+                                      int threadId,
+                                      bool reuseSharedPath,
+                                      std::atomic<bool>& cancel)
+{
+    const auto scalar = (4.0f * Math::kPi) / mNumRays;
+    const auto& listener = mListeners[listenerIndex];
+    const auto firstEnergyField = listenerIndex * mNumSources;
 
-                if (!shade(scene, ray, j, k, hit, hitPoint, accumEnergy, accumDistance, scalar, energy, delay))
-                    continue;
+    Ray ray{ listener.origin, mListenerSamples[rayIndex] };
 
-                auto& energyField = *mThreadState[threadId].energyFields[k];
+    float accumEnergy[Bands::kNumBands] = { 1.0f, 1.0f, 1.0f };
+    float accumDistance = 0.0f;
 
-                auto bin = static_cast<int>(floorf(delay / EnergyField::kBinDuration));
-                if (bin < 0 || energyField.numBins() <= bin)
+    for (auto j = 0; j < mNumBounces; ++j)
+    {
+        Hit hit;
+        Vector3f hitPoint;
+        if (!trace(scene, listener, ray, j, accumDistance, hit, hitPoint))
+            break;
+
+        if (cancel)
+            return;
+
+        if (mClusterSources)
+        {
+            shadeClusters(scene, listener, ray, hit, hitPoint, accumEnergy, accumDistance, scalar, threadId);
+        }
+
+        for (auto k = 0; k < mNumSources; ++k)
+        {
+            float energy[Bands::kNumBands] = { 0.0f, 0.0f, 0.0f };
+            auto delay = 0.0f;
+
+            if (mClusterSources)
+            {
+                if (!mThreadState[threadId].sourceVisible[k])
                     continue;
 
-                for (auto channel = 0; channel < energyField.numChannels(); ++channel)
+                for (auto band = 0; band < Bands::kNumBands; ++band)
                 {
-                    for (auto band = 0; band < Bands::kNumBands; ++band)
-                    {
-                        energyField[channel][band][bin] += mListenerCoeffs[i][channel] * energy[band];
-                    }
+                    energy[band] = mThreadState[threadId].sourceEnergy[k][band];
                 }
 
-                if (cancel)
-                    return;
+                delay = mThreadState[threadId].sourceDelay[k];
             }
-
-            if (j < mNumBounces - 1)
+            else if (!shade(scene, listener, ray, j, k, hit, hitPoint, accumEnergy, accumDistance, scalar, energy, delay))
             {
-                bounce(scene, j, hit, hitPoint, threadId, ray, accumEnergy, accumDistance);
+                continue;
+            }
+
+            addEnergy(mListenerCoeffs[rayIndex], energy, delay, mThreadEnergyFields.get(threadId, firstEnergyField + k));
 
-                if (cancel)
-                    return;
+            if (cancel)
+                return;
+        }
+
+        // If this ray hits the same surface as the path traced from the first listener along the same direction, and
+        // close to it, the rest of that path is used instead of tracing a new one.
+        if (j == 0 && reuseSharedPath)
+        {
+            const auto& sharedPath = mSharedPathCache.path(rayIndex, 0);
+            const auto& sharedVertex = mSharedPathCache.vertices(rayIndex, 0)[0];
+
+            if (sharedPath.numVertices > 0 &&
+                hit.material == sharedVertex.material &&
+                Vector3f::dot(hit.normal, sharedVertex.normal) >= kMinSharedHitCosine &&
+                (hitPoint - sharedVertex.point).length() <= kMaxSharedHitDistance)
+            {
+                auto distanceChange = hit.distance - sharedVertex.distance;
+                shadePathVertices(scene, listener, rayIndex, 0, 1, ray.direction, distanceChange, mListenerCoeffs[rayIndex],
+                                  scalar, firstEnergyField, threadId, mSharedPathCache);
+                return;
             }
         }
+
+        if (j < mNumBounces - 1)
+        {
+            if (!bounce(scene, j, hit, hitPoint, threadId, ray, accumEnergy, accumDistance))
+                break;
+
+            if (cancel)
+                return;
+        }
+    }
+}
+
+void ReflectionSimulator::simulateSharedJob(const IScene& scene,
+                                            int start,
+                                            int end,
+                                            int threadId,
+                                            std::atomic<bool>& cancel)
+{
+    PROFILE_FUNCTION();
+
+    assert(0 <= threadId && threadId < mNumThreads);
+    assert(0 < mNumSources && mNumSources <= mMaxNumSources);
+    assert(mNumListeners > 1);
+
+    const auto scalar = (4.0f * Math::kPi) / mNumRays;
+
+    for (auto i = start; i < end; ++i)
+    {
+        tracePath(scene, mListeners[0], i, threadId, mSharedPathCache.path(i, 0), mSharedPathCache.vertices(i, 0));
+
+        if (cancel)
+            return;
+
+        // Shading the path for the first listener also finds which sources are visible from each vertex. This does not
+        // depend on the listener, so other listeners can reuse it for the rest of the path.
+        shadePath(scene, mListeners[0], i, 0, scalar, 0, threadId, mSharedPathCache);
+
+        if (cancel)
+            return;
+
+        for (auto listenerIndex = 1; listenerIndex < mNumListeners; ++listenerIndex)
+        {
+            simulateRay(scene, listenerIndex, i, threadId, true, cancel);
+
+            if (cancel)
+                return;
+        }
     }
 }
 
 void ReflectionSimulator::finalizeJob(EnergyField* const* energyFields,
                                       std::atomic<bool>& cancel)
 {
+    mThreadEnergyFields.reduce(energyFields, 0, mNumListeners * mNumSources * mThreadEnergyFields.numChannels());
+}
+
+void ReflectionSimulator::preparePathCaches(const IScene& scene)
+{
+    PROFILE_FUNCTION();
+
+    auto maxNumVertices = std::max(mNumBounces, 1);
+
+    // Cached paths depend on the scene geometry and on the limits used when tracing them.
+    auto reset = mPathCacheInvalid || &scene != mPathCacheScene || mDuration != mPathCacheDuration ||
+                 mIrradianceMinDistance != mPathCacheIrradianceMinDistance;
+
+    for (auto i = 0; i < mNumListeners; ++i)
+    {
+        auto& cache = *mPathCaches[i];
+
+        if (reset || cache.numRays() != mNumRays || cache.historyLength() != mPathHistoryLength ||
+            cache.maxNumVertices() != maxNumVertices)
+        {
+            cache.reset(mNumRays, mPathHistoryLength, maxNumVertices);
+        }
+
+        cache.beginFrame(mListeners[i].origin);
+    }
+
     for (auto i = 0; i < mNumSources; ++i)
     {
-        auto& energyField = *energyFields[i];
-        for (auto j = 0; j < mNumThreads; ++j)
+        mSourceMoved[i] = reset || i >= mPathCacheNumSources ||
+                          (mSources[i].origin - mPrevSources[i].origin).length() > 1e-4f;
+
+        mPrevSources[i] = mSources[i];
+    }
+
+    mPathCacheInvalid = false;
+    mPathCacheScene = &scene;
+    mPathCacheDuration = mDuration;
+    mPathCacheIrradianceMinDistance = mIrradianceMinDistance;
+    mPathCacheNumSources = mNumSources;
+}
+
+void ReflectionSimulator::tracePath(const IScene& scene,
+                                    const CoordinateSpace3f& listener,
+                                    int rayIndex,
+                                    int threadId,
+                                    CachedPath& path,
+                                    CachedPathVertex* vertices)
+{
+    path.valid = true;
+    path.visibilityValid = false;
+    path.numVertices = 0;
+    path.origin = listener.origin;
+    path.firstDistance = 0.0f;
+    path.firstCosine = 0.0f;
+    path.weight = 1.0f;
+
+    Ray ray{ listener.origin, mListenerSamples[rayIndex] };
+
+    float accumEnergy[Bands::kNumBands] = { 1.0f, 1.0f, 1.0f };
+    float accumDistance = 0.0f;
+
+    for (auto j = 0; j < mNumBounces; ++j)
+    {
+        Hit hit;
+        Vector3f hitPoint;
+        if (!trace(scene, listener, ray, j, accumDistance, hit, hitPoint))
+            break;
+
+        auto& vertex = vertices[path.numVertices++];
+        vertex.point = hitPoint;
+        vertex.normal = hit.normal;
+        vertex.direction = ray.direction;
+        vertex.material = hit.material;
+        vertex.distance = hit.distance;
+        vertex.accumDistance = accumDistance;
+        for (auto band = 0; band < Bands::kNumBands; ++band)
+        {
+            vertex.accumEnergy[band] = accumEnergy[band];
+        }
+
+        if (j == 0)
+        {
+            path.firstDistance = (hitPoint - listener.origin).length();
+            path.firstCosine = -Vector3f::dot(hit.normal, ray.direction);
+        }
+
+        if (j < mNumBounces - 1)
+        {
+            if (!bounce(scene, j, hit, hitPoint, threadId, ray, accumEnergy, accumDistance))
+                break;
+        }
+    }
+}
+
+bool ReflectionSimulator::revalidatePath(const IScene& scene,
+                                         const CoordinateSpace3f& listener,
+                                         CachedPath& path,
+                                         const CachedPathVertex* vertices)
+{
+    path.valid = false;
+
+    if (path.numVertices == 0)
+        return false;
+
+    auto listenerToVertex = vertices[0].point - listener.origin;
+    auto distance = listenerToVertex.length();
+    if (distance <= kListenerRadius)
+        return false;
+
+    auto direction = listenerToVertex / distance;
+    auto cosine = -Vector3f::dot(vertices[0].normal, direction);
+    if (cosine <= 0.0f)
+        return false;
+
+    // The path now stands in for the listener rays in a solid angle that is scaled by the change in projected area of
+    // its first hit point, as seen from the listener. Large changes mean the path is a poor estimate from here.
+    auto weight = (path.firstDistance * path.firstDistance * cosine) / (distance * distance * path.firstCosine);
+    if (!(1.0f / ReflectionPathCache::kMaxReprojectionWeight <= weight && weight <= ReflectionPathCache::kMaxReprojectionWeight))
+        return false;
+
+    if (scene.anyHit(Ray{ listener.origin, direction }, 0.0f, distance))
+        return false;
+
+    path.valid = true;
+    path.weight = weight;
+    return true;
+}
+
+void ReflectionSimulator::shadePath(const IScene& scene,
+                                    const CoordinateSpace3f& listener,
+                                    int rayIndex,
+                                    int slot,
+                                    float scalar,
+                                    int firstEnergyField,
+                                    int threadId,
+                                    ReflectionPathCache& cache)
+{
+    auto& path = cache.path(rayIndex, slot);
+    const auto* vertices = cache.vertices(rayIndex, slot);
+
+    // If the listener has moved since the path was traced, only its first segment changes.
+    const float* coeffs = mListenerCoeffs[rayIndex];
+    auto firstDirection = vertices[0].direction;
+    auto distanceChange = 0.0f;
+
+    if ((listener.origin - path.origin).length() > 1e-4f)
+    {
+        auto listenerToVertex = vertices[0].point - listener.origin;
+        auto distance = listenerToVertex.length();
+        firstDirection = listenerToVertex / distance;
+        distanceChange = distance - path.firstDistance;
+
+        auto& reprojectedCoeffs = mThreadState[threadId].reprojectedCoeffs;
+        SphericalHarmonics::projectSinglePoint(firstDirection, mOrder, reprojectedCoeffs.data());
+        coeffs = reprojectedCoeffs.data();
+    }
+
+    shadePathVertices(scene, listener, rayIndex, slot, 0, firstDirection, distanceChange, coeffs, scalar * path.weight,
+                      firstEnergyField, threadId, cache);
+}
+
+void ReflectionSimulator::shadePathVertices(const IScene& scene,
+                                            const CoordinateSpace3f& listener,
+                                            int rayIndex,
+                                            int slot,
+                                            int firstVertex,
+                                            const Vector3f& firstDirection,
+                                            float distanceChange,
+                                            const float* coeffs,
+                                            float scalar,
+                                            int firstEnergyField,
+                                            int threadId,
+                                            ReflectionPathCache& cache)
+{
+    auto& path = cache.path(rayIndex, slot);
+    const auto* vertices = cache.vertices(rayIndex, slot);
+
+    for (auto j = firstVertex; j < path.numVertices; ++j)
+    {
+        const auto& vertex = vertices[j];
+
+        Ray ray{ (j == 0) ? listener.origin : vertices[j - 1].point, (j == 0) ? firstDirection : vertex.direction };
+
+        Hit hit;
+        hit.distance = (j == 0) ? vertex.distance + distanceChange : vertex.distance;
+        hit.normal = vertex.normal;
+        hit.material = vertex.material;
+
+        auto accumDistance = (j == 0) ? 0.0f : vertex.accumDistance + distanceChange;
+
+        auto* visibility = cache.visibility(rayIndex, slot, j);
+
+        for (auto k = 0; k < mNumSources; ++k)
+        {
+            auto word = k / 32;
+            auto bit = 1u << (k % 32);
+
+            float energy[Bands::kNumBands] = { 0.0f, 0.0f, 0.0f };
+            auto delay = 0.0f;
+
+            auto unoccluded = shadeUnoccluded(listener, ray, k, hit, vertex.point, vertex.accumEnergy, accumDistance, scalar, energy, delay);
+
+            if (!path.visibilityValid || (mCachePaths && mSourceMoved[k]))
+            {
+                if (unoccluded && isSourceVisible(scene, vertex.point, k))
+                {
+                    visibility[word] |= bit;
+                }
+                else
+                {
+                    visibility[word] &= ~bit;
+                }
+            }
+
+            if (!unoccluded || !(visibility[word] & bit))
+                continue;
+
+            addEnergy(coeffs, energy, delay, mThreadEnergyFields.get(threadId, firstEnergyField + k));
+        }
+    }
+
+    path.visibilityValid = true;
+}
+
+void ReflectionSimulator::addEnergy(const float* coeffs,
+                                    const float* energy,
+                                    float delay,
+                                    EnergyField& energyField)
+{
+    auto bin = static_cast<int>(floorf(delay / EnergyField::kBinDuration));
+    if (bin < 0 || energyField.numBins() <= bin)
+        return;
+
+    for (auto channel = 0; channel < energyField.numChannels(); ++channel)
+    {
+        for (auto band = 0; band < Bands::kNumBands; ++band)
         {
-            EnergyField::add(energyField, *mThreadState[j].energyFields[i], energyField);
+            energyField[channel][band][bin] += coeffs[channel] * energy[band];
         }
     }
 }
 
 bool ReflectionSimulator::trace(const IScene& scene,
+                                const CoordinateSpace3f& listener,
                                 const Ray& ray,
                                 int bounce,
                                 float accumDistance,
@@ -439,17 +1104,23 @@ bool ReflectionSimulator::trace(const IScene& scene,
 
     hitPoint = ray.pointAtDistance(hit.distance) + (kHitSurfaceOffset * hit.normal);
 
-    const auto& listener = *mListener;
-
     if (bounce > 0)
     {
-        for (auto i = 0; i < mNumSources; ++i)
+        if (mClusterSources)
+        {
+            if (mSourceClusterTree.anyHit(ray, hit.distance, kSourceRadius, listener.origin, mSources))
+                return false;
+        }
+        else
         {
-            if ((listener.origin - mSources[i].origin).length() > kSourceRadius)
+            for (auto i = 0; i < mNumSources; ++i)
             {
-                auto sourceHitDistance = ray.intersect(Sphere(mSources[i].origin, kSourceRadius));
-                if (0.0f <= sourceHitDistance && sourceHitDistance < hit.distance)
-                    return false;
+                if ((listener.origin - mSources[i].origin).length() > kSourceRadius)
+                {
+                    auto sourceHitDistance = ray.intersect(Sphere(mSources[i].origin, kSourceRadius));
+                    if (0.0f <= sourceHitDistance && sourceHitDistance < hit.distance)
+                        return false;
+                }
             }
         }
 
@@ -462,6 +1133,7 @@ bool ReflectionSimulator::trace(const IScene& scene,
 }
 
 bool ReflectionSimulator::shade(const IScene& scene,
+                                const CoordinateSpace3f& listener,
                                 const Ray& ray,
                                 int bounce,
                                 int sourceIndex,
@@ -473,8 +1145,23 @@ bool ReflectionSimulator::shade(const IScene& scene,
                                 float* energy,
                                 float& delay)
 {
-    const auto& listener = *mListener;
+    if (!shadeUnoccluded(listener, ray, sourceIndex, hit, hitPoint, accumEnergy, accumDistance, scalar, energy, delay))
+        return false;
 
+    return isSourceVisible(scene, hitPoint, sourceIndex);
+}
+
+bool ReflectionSimulator::shadeUnoccluded(const CoordinateSpace3f& listener,
+                                          const Ray& ray,
+                                          int sourceIndex,
+                                          const Hit& hit,
+                                          const Vector3f& hitPoint,
+                                          const float* accumEnergy,
+                                          float accumDistance,
+                                          float scalar,
+                                          float* energy,
+                                          float& delay)
+{
     auto hitToSource = mSources[sourceIndex].origin - hitPoint;
     if (Vector3f::dot(hit.normal, hitToSource) < 0.0f)
         return false;
@@ -483,12 +1170,10 @@ bool ReflectionSimulator::shade(const IScene& scene,
     if (hitToSourceDistance <= mIrradianceMinDistance)
         return false;
 
-    Ray shadowRay{ hitPoint, hitToSource / hitToSourceDistance };
-    if (scene.anyHit(shadowRay, 0.0f, hitToSourceDistance))
-        return false;
+    auto hitToSourceDirection = hitToSource / hitToSourceDistance;
 
-    auto diffuseTerm = (1.0f / Math::kPi) * hit.material->scattering * std::max(Vector3f::dot(hit.normal, shadowRay.direction), 0.0f);
-    auto halfVector = Vector3f::unitVector((shadowRay.direction - ray.direction) * 0.5f);
+    auto diffuseTerm = (1.0f / Math::kPi) * hit.material->scattering * std::max(Vector3f::dot(hit.normal, hitToSourceDirection), 0.0f);
+    auto halfVector = Vector3f::unitVector((hitToSourceDirection - ray.direction) * 0.5f);
     auto specularTerm = ((kSpecularExponent + 2.0f) / (8.0f * Math::kPi)) * (1.0f - hit.material->scattering) * powf(Vector3f::dot(halfVector, hit.normal), kSpecularExponent);
     auto attenuation = 1.0f / std::max(hitToSourceDistance, mIrradianceMinDistance);
     auto distanceTerm = (1.0f / (4.0f * Math::kPi)) * (attenuation * attenuation);
@@ -506,7 +1191,125 @@ bool ReflectionSimulator::shade(const IScene& scene,
     return true;
 }
 
-void ReflectionSimulator::bounce(const IScene& scene,
+bool ReflectionSimulator::isSourceVisible(const IScene& scene,
+                                          const Vector3f& hitPoint,
+                                          int sourceIndex)
+{
+    auto hitToSource = mSources[sourceIndex].origin - hitPoint;
+    auto hitToSourceDistance = hitToSource.length();
+
+    Ray shadowRay{ hitPoint, hitToSource / hitToSourceDistance };
+    return !scene.anyHit(shadowRay, 0.0f, hitToSourceDistance);
+}
+
+void ReflectionSimulator::shadeClusters(const IScene& scene,
+                                        const CoordinateSpace3f& listener,
+                                        const Ray& ray,
+                                        const Hit& hit,
+                                        const Vector3f& hitPoint,
+                                        const float* accumEnergy,
+                                        float accumDistance,
+                                        float scalar,
+                                        int threadId)
+{
+    auto& threadState = mThreadState[threadId];
+
+    // Calculate the energy that would be received from each source if it were visible. This is cheap compared to
+    // tracing a shadow ray, and lets us estimate the error of approximating visibility for a cluster. It is still
+    // linear in the number of sources, as is building the cluster energies below, so clustering only saves shadow
+    // rays, not the per-source work at each hit point.
+    for (auto i = 0; i < mNumSources; ++i)
+    {
+        threadState.sourceVisible[i] = false;
+
+        if (!shadeUnoccluded(listener, ray, i, hit, hitPoint, accumEnergy, accumDistance, scalar, threadState.sourceEnergy[i], threadState.sourceDelay[i]))
+        {
+            for (auto j = 0; j < Bands::kNumBands; ++j)
+            {
+                threadState.sourceEnergy[i][j] = 0.0f;
+            }
+        }
+    }
+
+    // Nodes are stored in depth-first order, so visiting them in reverse order visits children before their parents.
+    for (auto i = mSourceClusterTree.numNodes() - 1; i >= 0; --i)
+    {
+        const auto& node = mSourceClusterTree.node(i);
+
+        if (node.isLeaf())
+        {
+            auto sourceIndex = mSourceClusterTree.sourceIndex(node.start);
+            const auto* energy = threadState.sourceEnergy[sourceIndex];
+
+            threadState.clusterEnergy[i] = energy[0] + energy[1] + energy[2];
+            threadState.clusterRepresentative[i] = sourceIndex;
+        }
+        else
+        {
+            auto left = node.children[0];
+            auto right = node.children[1];
+
+            threadState.clusterEnergy[i] = threadState.clusterEnergy[left] + threadState.clusterEnergy[right];
+            threadState.clusterRepresentative[i] = (threadState.clusterEnergy[left] >= threadState.clusterEnergy[right]) ?
+                threadState.clusterRepresentative[left] : threadState.clusterRepresentative[right];
+        }
+    }
+
+    if (mSourceClusterTree.numNodes() == 0)
+        return;
+
+    auto totalEnergy = threadState.clusterEnergy[0];
+    if (totalEnergy <= 0.0f)
+        return;
+
+    Stack<int, SourceClusterTree::kMaxDepth> stack;
+    stack.push(0);
+
+    while (!stack.isEmpty())
+    {
+        auto nodeIndex = stack.pop();
+        const auto& node = mSourceClusterTree.node(nodeIndex);
+
+        auto clusterEnergy = threadState.clusterEnergy[nodeIndex];
+        if (clusterEnergy <= 0.0f)
+            continue;
+
+        if (node.isLeaf())
+        {
+            auto sourceIndex = mSourceClusterTree.sourceIndex(node.start);
+            threadState.sourceVisible[sourceIndex] = isSourceVisible(scene, hitPoint, sourceIndex);
+            continue;
+        }
+
+        // If the representative's visibility is wrong for the whole cluster, the error is at most the cluster's
+        // energy. Visibility is more likely to be shared by clusters that subtend a small angle at the hit point, so
+        // this is scaled by the cluster's angular size. The result is a heuristic estimate of the error, not a bound:
+        // a small, distant cluster can still be partly occluded.
+        auto distance = (node.bounds.center - hitPoint).length() - node.bounds.radius;
+        auto spread = (distance > 0.0f) ? std::min(node.bounds.radius / distance, 1.0f) : 1.0f;
+
+        if (clusterEnergy * spread <= mMaxClusteringError * totalEnergy)
+        {
+            if (!isSourceVisible(scene, hitPoint, threadState.clusterRepresentative[nodeIndex]))
+                continue;
+
+            for (auto i = node.start; i < node.start + node.count; ++i)
+            {
+                auto sourceIndex = mSourceClusterTree.sourceIndex(i);
+                const auto* energy = threadState.sourceEnergy[sourceIndex];
+
+                threadState.sourceVisible[sourceIndex] = (energy[0] + energy[1] + energy[2] > 0.0f);
+            }
+        }
+        else
+        {
+            stack.push(node.children[1]);
+            stack.push(node.children[0]);
+        }
+    }
+}
+
+bool ReflectionSimulator::bounce(const IScene& scene,
                                  int bounce,
                                  const Hit& hit,
                                  const Vector3f& hitPoint,
@@ -515,24 +1318,71 @@ void ReflectionSimulator::bounce(const IScene& scene,
                                  float* accumEnergy,
                                  float& accumDistance)
 {
+    auto& rng = mThreadState[threadId].rng;
+
     for (auto j = 0; j < Bands::kNumBands; ++j)
     {
         accumEnergy[j] *= (1.0f - hit.material->absorption[j]);
     }
 
+    if (mRussianRoulette)
+    {
+        auto maxEnergy = std::max({ accumEnergy[0], accumEnergy[1], accumEnergy[2] });
+        if (maxEnergy < mSurvivalThreshold)
+        {
+            auto survivalProbability = maxEnergy / mSurvivalThreshold;
+            if (rng.uniformRandomNormalized() >= survivalProbability)
+                return false;
+
+            for (auto j = 0; j < Bands::kNumBands; ++j)
+            {
+                accumEnergy[j] /= survivalProbability;
+            }
+        }
+    }
+
     accumDistance += hit.distance;
 
     ray.origin = hitPoint;
 
-    if (mThreadState[threadId].rng.uniformRandomNormalized() < hit.material->scattering)
+    auto scattering = hit.material->scattering;
+
+    auto diffuse = false;
+    if (mRotateDiffuseSamples && (scattering <= 0.0f || scattering >= 1.0f))
+    {
+        // Purely diffuse or purely specular materials don't need a random choice of lobe.
+        diffuse = (scattering >= 1.0f);
+    }
+    else
+    {
+        diffuse = (rng.uniformRandomNormalized() < scattering);
+    }
+
+    if (diffuse)
     {
-        auto diffuseSampleIndex = mThreadState[threadId].rng.uniformRandom() % mNumDiffuseSamples;
-        ray.direction = Sampling::transformHemisphereSample(mDiffuseSamples[diffuseSampleIndex], hit.normal);
+        const auto& sample = mDiffuseSamples[rng.uniformRandom() % mNumDiffuseSamples];
+
+        if (mRotateDiffuseSamples)
+        {
+            // Rotating a cosine-weighted sample about the normal leaves its distribution unchanged.
+            auto angle = 2.0f * Math::kPi * rng.uniformRandomNormalized();
+            auto cosAngle = cosf(angle);
+            auto sinAngle = sinf(angle);
+            Vector3f rotatedSample(cosAngle * sample.x() - sinAngle * sample.y(), sinAngle * sample.x() + cosAngle * sample.y(), sample.z());
+
+            ray.direction = Sampling::transformHemisphereSample(rotatedSample, hit.normal);
+        }
+        else
+        {
+            ray.direction = Sampling::transformHemisphereSample(sample, hit.normal);
+        }
     }
     else
     {
         ray.direction = Vector3f::reflect(ray.direction, hit.normal);
     }
+
+    return true;
 }
 
 
@@ -546,7 +1396,8 @@ BatchedReflectionSimulator::BatchedReflectionSimulator(int maxNumRays,
                                                        int maxOrder,
                                                        int maxNumSources,
                                                        int numThreads,
-                                                       int rayBatchSize)
+                                                       int rayBatchSize,
+                                                       EnergyFieldReduction reduction)
     : mMaxNumRays(maxNumRays)
     , mNumDiffuseSamples(numDiffuseSamples)
     , mMaxDuration(maxDuration)
@@ -554,6 +1405,7 @@ BatchedReflectionSimulator::BatchedReflectionSimulator(int maxNumRays,
     , mMaxNumSources(maxNumSources)
     , mNumThreads(numThreads)
     , mRayBatchSize(rayBatchSize)
+    , mReduction(reduction)
     , mNumSources(maxNumSources)
     , mSources(nullptr)
     , mListener(nullptr)
@@ -567,6 +1419,7 @@ BatchedReflectionSimulator::BatchedReflectionSimulator(int maxNumRays,
     , mDiffuseSamples(numDiffuseSamples)
     , mListenerCoeffs(maxNumRays, SphericalHarmonics::numCoeffsForOrder(maxOrder))
     , mThreadState(numThreads)
+    , mThreadEnergyFields(numThreads, maxNumSources, maxDuration, maxOrder)
 {
     Sampling::generateSphereSamples(maxNumRays, mListenerSamples.data());
     Sampling::generateHemisphereSamples(numDiffuseSamples, mDiffuseSamples.data());
@@ -598,12 +1451,6 @@ BatchedReflectionSimulator::BatchedReflectionSimulator(int maxNumRays,
         mThreadState[i].delay.resize(rayBatchSize);
         mThreadState[i].accumEnergy.resize(rayBatchSize, Bands::kNumBands);
         mThreadState[i].accumDistance.resize(rayBatchSize);
-
-        mThreadState[i].energyFields.resize(maxNumSources);
-        for (auto j = 0; j < maxNumSources; ++j)
-        {
-            mThreadState[i].energyFields[j] = make_unique<EnergyField>(maxDuration, maxOrder);
-        }
     }
 }
 
@@ -699,17 +1546,12 @@ void BatchedReflectionSimulator::simulate(const IScene& scene,
     mOrder = order;
     mIrradianceMinDistance = irradianceMinDistance;
 
-    for (auto i = 0; i < numSources; ++i)
-    {
-        energyFields[i]->reset();
-        for (auto j = 0; j < mNumThreads; ++j)
-        {
-            mThreadState[j].energyFields[i]->reset();
-        }
-    }
+    mThreadEnergyFields.reset(numSources, energyFields);
 
     mNumJobsRemaining = 0;
 
+    auto firstJob = jobGraph.numJobs();
+
     for (auto i = 0; i < numRays; i += mRayBatchSize)
     {
         ++mNumJobsRemaining;
@@ -721,12 +1563,17 @@ void BatchedReflectionSimulator::simulate(const IScene& scene,
         {
             simulateJob(scene, start, end, threadId, cancel);
 
-            if (--mNumJobsRemaining == 0)
+            if (mReduction == EnergyFieldReduction::Serial && --mNumJobsRemaining == 0)
             {
                 finalizeJob(energyFields, cancel);
             }
         });
     }
+
+    if (mReduction == EnergyFieldReduction::Parallel)
+    {
+        mThreadEnergyFields.addReductionJobs(numSources, energyFields, firstJob, jobGraph.numJobs() - firstJob, jobGraph);
+    }
 }
 
 void BatchedReflectionSimulator::simulate(const IScene& scene,
@@ -830,7 +1677,7 @@ void BatchedReflectionSimulator::simulateJob(const IScene& scene,
             if (cancel)
                 return;
 
-            auto& energyField = *mThreadState[threadId].energyFields[j];
+            auto& energyField = mThreadEnergyFields.get(threadId, j);
 
             for (auto k = start; k < end; ++k)
             {
@@ -867,14 +1714,7 @@ void BatchedReflectionSimulator::simulateJob(const IScene& scene,
 void BatchedReflectionSimulator::finalizeJob(EnergyField* const* energyFields,
                                              std::atomic<bool>& cancel)
 {
-    for (auto i = 0; i < mNumSources; ++i)
-    {
-        auto& energyField = *energyFields[i];
-        for (auto j = 0; j < mNumThreads; ++j)
-        {
-            EnergyField::add(energyField, *mThreadState[j].energyFields[i], energyField);
-        }
-    }
+    mThreadEnergyFields.reduce(energyFields, 0, mNumSources * mThreadEnergyFields.numChannels());
 }
 
 void BatchedReflectionSimulator::reset(int threadId)
@@ -19,8 +19,10 @@
 #include "directivity.h"
 #include "energy_field.h"
 #include "job_graph.h"
+#include "reflection_path_cache.h"
 #include "sampling.h"
 #include "scene.h"
+#include "source_cluster_tree.h"
 
 namespace ipl {
 
@@ -54,7 +56,8 @@ public:
                           JobGraph& jobGraph) = 0;
 
     // Simulates reflections from multiple sources to a multiple receivers, storing the results in an EnergyField
-    // for each source.
+    // for each source and listener. The energy field for source i and listener j is energyFields[j * numSources + i].
+    // Simulators for which supportsMultipleListeners() returns false only accept a single listener.
     virtual void simulate(const IScene& scene,
                           int numSources,
                           const CoordinateSpace3f* sources,
@@ -84,6 +87,69 @@ public:
                           float irradianceMinDistance,
                           vector<Ray>& escapedRays) = 0;
 
+    // Returns true if a single call to simulate can simulate reflections for more than one listener.
+    virtual bool supportsMultipleListeners() const
+    {
+        return false;
+    }
+
+    // Enables or disables shading against clusters of sources instead of individual sources, for scenes with many
+    // sources. At each hit point, sources are grouped using a hierarchy of clusters, and all sources in a cluster
+    // share the result of a single visibility test against the cluster's brightest source. A cluster is refined into
+    // its children if its estimated error exceeds maxRelativeError times the total unoccluded energy received from all
+    // sources at the hit point. The estimate is a heuristic based on the cluster's energy and angular size, so the
+    // actual error is not guaranteed to stay below maxRelativeError. Energy is still calculated and accumulated
+    // separately for each source, so only the number of shadow rays is reduced; the remaining cost at each hit point
+    // is still linear in the number of sources. Simulators that do not support clustering ignore this.
+    virtual void setSourceClustering(bool enable,
+                                     float maxRelativeError)
+    {}
+
+    // Enables or disables Russian roulette termination of rays. After each bounce, a ray whose remaining energy in
+    // every band is below survivalThreshold is terminated with probability 1 - (remaining energy / survivalThreshold),
+    // and if it survives, its energy is divided by the survival probability, so the expected energy field is
+    // unchanged. Simulators that do not support Russian roulette ignore this.
+    virtual void setRussianRoulette(bool enable,
+                                    float survivalThreshold)
+    {}
+
+    // Enables or disables random rotation of each diffuse sample about the surface normal, so that a small table of
+    // diffuse samples does not restrict rays to a few fixed directions. This also skips the random choice between
+    // diffuse and specular reflection for purely diffuse or purely specular materials. Both change the sequence of
+    // random numbers used, so results differ from those with this disabled, which is the default. Simulators that do
+    // not support this ignore it.
+    virtual void setDiffuseSampleRotation(bool enable)
+    {}
+
+    // Enables or disables reuse of reflection paths across calls to simulate. For each listener ray direction, paths
+    // traced in the last historyLength calls are kept. Each call traces one new path per direction, replacing the
+    // oldest or an invalid one, and shades all valid paths against the current sources, so each energy field is
+    // estimated from up to historyLength times as many paths as rays traced. When the listener moves, cached paths are
+    // reprojected to the new listener position and kept if their first hit point is still visible. The visibility of
+    // sources from cached paths is only checked again when sources move. Cached paths must be discarded using
+    // invalidatePathCache whenever the scene changes. Source clustering is not used while paths are cached. Memory use
+    // grows with the number of rays times the number of bounces times historyLength. Simulators that do not support
+    // path caching ignore this.
+    virtual void setPathCaching(bool enable,
+                                int historyLength)
+    {}
+
+    // Discards all cached reflection paths.
+    virtual void invalidatePathCache()
+    {}
+
+    // Enables or disables sharing of reflection paths between listeners, when simulating several listeners in one call
+    // to simulate. Paths are traced in full only from the first listener. Every other listener traces and shades the
+    // first segment of each ray itself. If that ray hits the same surface as the first listener's ray in the same
+    // direction, close to it, the rest of the first listener's path is shaded for this listener too, using the
+    // visibility of sources already found for the first listener. Otherwise, the listener traces its own path. For
+    // nearby listeners, this saves most of the rays traced after the first bounce, at the cost of some accuracy.
+    // Listeners that are far apart rarely share paths, and cost about as much as without sharing. Source clustering
+    // is not used for paths traced from the first listener, and sharing is disabled while paths are cached.
+    // Simulators that do not support sharing paths ignore this.
+    virtual void setListenerPathSharing(bool enable)
+    {}
+
     static const float kHitSurfaceOffset;
     static const float kSpecularExponent;
     static const float kSourceRadius;
@@ -91,6 +157,69 @@ public:
 };
 
 
+// --------------------------------------------------------------------------------------------------------------------
+// ThreadLocalEnergyFields
+// --------------------------------------------------------------------------------------------------------------------
+
+// How per-thread energy fields are summed into the per-source output energy fields once ray tracing is done.
+enum class EnergyFieldReduction
+{
+    Serial,     // The last ray tracing job to complete sums all per-thread energy fields on its own.
+    Parallel,   // Separate jobs, each summing a range of (source, channel) pairs across all threads.
+};
+
+// One energy field per source for each thread, so ray tracing jobs can accumulate energy without synchronization.
+// Only fields that a thread has written to since the last reset take part in the reduction.
+class ThreadLocalEnergyFields
+{
+public:
+    ThreadLocalEnergyFields(int numThreads,
+                            int maxNumSources,
+                            float maxDuration,
+                            int maxOrder);
+
+    // Returns the energy field that the given thread should accumulate energy into for the given source.
+    EnergyField& get(int threadId,
+                     int sourceIndex)
+    {
+        mTouched[threadId][sourceIndex] = true;
+        return *mEnergyFields[threadId][sourceIndex];
+    }
+
+    // Clears all per-thread energy fields that have been written to, along with the output energy fields.
+    void reset(int numSources,
+               EnergyField* const* energyFields);
+
+    // Sums the per-thread energy fields into the output energy fields, for (source, channel) pairs with flattened
+    // indices in [start, end). The flattened index of a pair is source * numChannels() + channel.
+    void reduce(EnergyField* const* energyFields,
+                int start,
+                int end);
+
+    // Adds jobs to a job graph that sum the per-thread energy fields for the first numSources sources into the
+    // output energy fields, in parallel. The jobs only start once all jobs with indices in
+    // [firstJob, firstJob + numJobs) have completed.
+    void addReductionJobs(int numSources,
+                          EnergyField* const* energyFields,
+                          int firstJob,
+                          int numJobs,
+                          JobGraph& jobGraph);
+
+    int numChannels() const
+    {
+        return mNumChannels;
+    }
+
+private:
+    static const int kNumReductionJobsPerThread;
+
+    int mNumThreads;
+    int mNumChannels;
+    Array<unique_ptr<EnergyField>, 2> mEnergyFields;
+    Array<bool, 2> mTouched;
+};
+
+
 // --------------------------------------------------------------------------------------------------------------------
 // ReflectionSimulator
 // --------------------------------------------------------------------------------------------------------------------
@@ -103,7 +232,9 @@ public:
                         float maxDuration,
                         int maxOrder,
                         int maxNumSources,
-                        int numThreads);
+                        int maxNumListeners,
+                        int numThreads,
+                        EnergyFieldReduction reduction = EnergyFieldReduction::Parallel);
 
     virtual void simulate(const IScene& scene,
                           int numSources,
@@ -146,13 +277,41 @@ public:
                           float irradianceMinDistance,
                           vector<Ray>& escapedRays) override;
 
+    virtual bool supportsMultipleListeners() const override;
+
+    virtual void setSourceClustering(bool enable,
+                                     float maxRelativeError) override;
+
+    virtual void setRussianRoulette(bool enable,
+                                    float survivalThreshold) override;
+
+    virtual void setDiffuseSampleRotation(bool enable) override;
+
+    virtual void setPathCaching(bool enable,
+                                int historyLength) override;
+
+    virtual void invalidatePathCache() override;
+
+    virtual void setListenerPathSharing(bool enable) override;
+
 private:
     static const int kRayBatchSize;
 
+    // A listener ray only reuses the path traced from the first listener along the same direction if its first hit
+    // point is at most this far from that of the shared path, on a surface with the same material whose normal is
+    // at least this close to that of the shared path.
+    static const float kMaxSharedHitDistance;
+    static const float kMinSharedHitCosine;
+
     struct ThreadState
     {
         RandomNumberGenerator rng;
-        Array<unique_ptr<EnergyField>> energyFields;
+        Array<float, 2> sourceEnergy; // Unoccluded energy received from each source at the current hit point.
+        Array<float> sourceDelay;
+        Array<bool> sourceVisible;
+        Array<float> clusterEnergy; // Total unoccluded energy received from each node of the source cluster tree.
+        Array<int> clusterRepresentative; // Brightest source in each node of the source cluster tree.
+        Array<float> reprojectedCoeffs; // SH coefficients for the first segment of a reprojected cached path.
     };
 
     int mMaxNumRays;
@@ -160,11 +319,27 @@ private:
     float mMaxDuration;
     int mMaxOrder;
     int mMaxNumSources;
+    int mMaxNumListeners;
     int mNumThreads;
+    EnergyFieldReduction mReduction;
+    bool mClusterSources;
+    float mMaxClusteringError;
+    bool mRussianRoulette;
+    float mSurvivalThreshold;
+    bool mRotateDiffuseSamples;
+    bool mCachePaths;
+    int mPathHistoryLength;
+    bool mPathCacheInvalid;
+    const IScene* mPathCacheScene;
+    float mPathCacheDuration;
+    float mPathCacheIrradianceMinDistance;
+    int mPathCacheNumSources;
+    bool mShareListenerPaths;
 
     int mNumSources;
     const CoordinateSpace3f* mSources;
-    const CoordinateSpace3f* mListener;
+    int mNumListeners;
+    const CoordinateSpace3f* mListeners;
     const Directivity* mDirectivities;
     int mNumRays;
     int mNumBounces;
@@ -177,6 +352,12 @@ private:
     Array<float, 2> mListenerCoeffs;
     std::atomic<int> mNumJobsRemaining;
     Array<ThreadState> mThreadState;
+    ThreadLocalEnergyFields mThreadEnergyFields;
+    SourceClusterTree mSourceClusterTree;
+    vector<unique_ptr<ReflectionPathCache>> mPathCaches; // One per listener.
+    Array<CoordinateSpace3f> mPrevSources;
+    Array<bool> mSourceMoved; // True for each source that has moved since the previous call to simulate.
+    ReflectionPathCache mSharedPathCache; // Paths traced from the first listener, if sharing paths between listeners.
 
     void simulateJob(const IScene& scene,
                      Array<float, 2>& image,
@@ -185,15 +366,93 @@ private:
                      int threadId);
 
     void simulateJob(const IScene& scene,
+                     int listenerIndex,
                      int start,
                      int end,
                      int threadId,
                      std::atomic<bool>& cancel);
 
+    // Same as above, except that rays are traced into, and shaded from, the path cache for the given listener.
+    void simulateCachedJob(const IScene& scene,
+                           int listenerIndex,
+                           int start,
+                           int end,
+                           int threadId,
+                           std::atomic<bool>& cancel);
+
+    // Traces and shades a single listener ray. If reuseSharedPath is true, the rest of the path traced from the first
+    // listener along the same direction is reused when possible, instead of tracing past the first hit point.
+    void simulateRay(const IScene& scene,
+                     int listenerIndex,
+                     int rayIndex,
+                     int threadId,
+                     bool reuseSharedPath,
+                     std::atomic<bool>& cancel);
+
+    // Traces each ray fully from the first listener only, and shades the resulting path for every listener.
+    void simulateSharedJob(const IScene& scene,
+                           int start,
+                           int end,
+                           int threadId,
+                           std::atomic<bool>& cancel);
+
     void finalizeJob(EnergyField* const* energyFields,
                      std::atomic<bool>& cancel);
 
+    // Discards cached paths if anything they depend on has changed, and finds the sources that have moved.
+    void preparePathCaches(const IScene& scene);
+
+    // Traces a path from the listener along the given listener ray, storing its vertices in the path cache.
+    void tracePath(const IScene& scene,
+                   const CoordinateSpace3f& listener,
+                   int rayIndex,
+                   int threadId,
+                   CachedPath& path,
+                   CachedPathVertex* vertices);
+
+    // Checks whether a cached path can still be used from the current listener position, and updates its weight.
+    // Returns false, and marks the path as invalid, if it has no vertices, if its first hit point is occluded from,
+    // facing away from, or too close to the listener, or if its solid angle has changed too much.
+    bool revalidatePath(const IScene& scene,
+                        const CoordinateSpace3f& listener,
+                        CachedPath& path,
+                        const CachedPathVertex* vertices);
+
+    // Shades every vertex of a cached path against all sources, and adds the results to the energy fields.
+    void shadePath(const IScene& scene,
+                   const CoordinateSpace3f& listener,
+                   int rayIndex,
+                   int slot,
+                   float scalar,
+                   int firstEnergyField,
+                   int threadId,
+                   ReflectionPathCache& cache);
+
+    // Shades the vertices of a cached path starting at firstVertex. The first segment of the path runs from the
+    // listener along firstDirection, and is longer than when the path was traced by distanceChange. Energy is added
+    // along the direction with the given SH coefficients.
+    void shadePathVertices(const IScene& scene,
+                           const CoordinateSpace3f& listener,
+                           int rayIndex,
+                           int slot,
+                           int firstVertex,
+                           const Vector3f& firstDirection,
+                           float distanceChange,
+                           const float* coeffs,
+                           float scalar,
+                           int firstEnergyField,
+                           int threadId,
+                           ReflectionPathCache& cache);
+
+    // Adds energy arriving along the direction with the given SH coefficients, with the given delay, to an energy
+    // field.
+    void addEnergy(const float* coeffs,
+                   const float* energy,
+                   float delay,
+                   EnergyField& energyField);
+
     bool trace(const IScene& scene,
+               const CoordinateSpace3f& listener,
                const Ray& ray,
                int bounce,
                float accumDistance,
@@ -201,6 +460,7 @@ private:
                Vector3f& hitPoint);
 
     bool shade(const IScene& scene,
+               const CoordinateSpace3f& listener,
                const Ray& ray,
                int bounce,
                int sourceIndex,
@@ -212,7 +472,38 @@ private:
                float* energy,
                float& delay);
 
-    void bounce(const IScene& scene,
+    // Same as shade, except that the visibility of the source from the hit point is not checked.
+    bool shadeUnoccluded(const CoordinateSpace3f& listener,
+                         const Ray& ray,
+                         int sourceIndex,
+                         const Hit& hit,
+                         const Vector3f& hitPoint,
+                         const float* accumEnergy,
+                         float accumDistance,
+                         float scalar,
+                         float* energy,
+                         float& delay);
+
+    bool isSourceVisible(const IScene& scene,
+                         const Vector3f& hitPoint,
+                         int sourceIndex);
+
+    // Shades a hit point against all sources using the source cluster tree. On return, the sourceEnergy, sourceDelay,
+    // and sourceVisible arrays of the thread state contain the results for each source.
+    void shadeClusters(const IScene& scene,
+                       const CoordinateSpace3f& listener,
+                       const Ray& ray,
+                       const Hit& hit,
+                       const Vector3f& hitPoint,
+                       const float* accumEnergy,
+                       float accumDistance,
+                       float scalar,
+                       int threadId);
+
+    // Continues a ray from a hit point, choosing between a diffuse and a specular reflection in proportion to the
+    // scattering coefficient of the material. Diffuse directions are cosine-weighted samples, optionally rotated about
+    // the normal (see setDiffuseSampleRotation). Returns false if the ray is terminated by Russian roulette.
+    bool bounce(const IScene& scene,
                 int bounce,
                 const Hit& hit,
                 const Vector3f& hitPoint,
@@ -236,7 +527,8 @@ public:
                                int maxOrder,
                                int maxNumSources,
                                int numThreads,
-                               int rayBatchSize);
+                               int rayBatchSize,
+                               EnergyFieldReduction reduction = EnergyFieldReduction::Parallel);
 
     virtual void simulate(const IScene& scene,
                           int numSources,
@@ -297,7 +589,6 @@ private:
         Array<float, 2> accumEnergy;
         Array<float> accumDistance;
         RandomNumberGenerator rng;
-        Array<unique_ptr<EnergyField>> energyFields;
     };
 
     int mMaxNumRays;
@@ -307,6 +598,7 @@ private:
     int mMaxNumSources;
     int mNumThreads;
     int mRayBatchSize;
+    EnergyFieldReduction mReduction;
 
     int mNumSources;
     const CoordinateSpace3f* mSources;
@@ -323,6 +615,7 @@ private:
     Array<float, 2> mListenerCoeffs;
     std::atomic<int> mNumJobsRemaining;
     Array<ThreadState> mThreadState;
+    ThreadLocalEnergyFields mThreadEnergyFields;
 
     void simulateJob(const IScene& scene,
                      Array<float, 2>& image,
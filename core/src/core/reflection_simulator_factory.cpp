@@ -40,7 +40,7 @@ unique_ptr<IReflectionSimulator> ReflectionSimulatorFactory::create(SceneType sc
     {
     case SceneType::Default:
         return ipl::make_unique<ReflectionSimulator>(maxNumRays, numDiffuseSamples, maxDuration, maxOrder, maxNumSources,
-                                                     numThreads);
+                                                     maxNumListeners, numThreads);
 
     case SceneType::Custom:
         return ipl::make_unique<BatchedReflectionSimulator>(maxNumRays, numDiffuseSamples, maxDuration, maxOrder,
@@ -37,13 +37,18 @@ bool IScene::isOccluded(const Vector3f& from,
 // Scene
 // --------------------------------------------------------------------------------------------------------------------
 
-Scene::Scene()
-    : mHasChanged(false)
+const int Scene::kRaySortBlockSize;
+
+Scene::Scene(shared_ptr<JobScheduler> scheduler)
+    : mScheduler(scheduler)
+    , mHasChanged(false)
     , mVersion(0)
 {}
 
-Scene::Scene(const Serialized::Scene* serializedObject)
-    : mHasChanged(false)
+Scene::Scene(const Serialized::Scene* serializedObject,
+             shared_ptr<JobScheduler> scheduler)
+    : mScheduler(scheduler)
+    , mHasChanged(false)
     , mVersion(0)
 {
     assert(serializedObject);
@@ -53,15 +58,16 @@ Scene::Scene(const Serialized::Scene* serializedObject)
 
     for (auto i = 0u; i < numObjects; ++i)
     {
-        auto staticMesh = ipl::make_shared<StaticMesh>(serializedObject->static_meshes()->Get(i));
+        auto staticMesh = ipl::make_shared<StaticMesh>(serializedObject->static_meshes()->Get(i), mScheduler);
         mStaticMeshes[1].push_back(std::static_pointer_cast<IStaticMesh>(staticMesh));
     }
 
     mStaticMeshes[0] = mStaticMeshes[1];
 }
 
-Scene::Scene(SerializedObject& serializedObject)
-    : Scene(Serialized::GetScene(serializedObject.data()))
+Scene::Scene(SerializedObject& serializedObject,
+             shared_ptr<JobScheduler> scheduler)
+    : Scene(Serialized::GetScene(serializedObject.data()), scheduler)
 {}
 
 shared_ptr<IStaticMesh> Scene::createStaticMesh(int numVertices,
@@ -73,14 +79,14 @@ shared_ptr<IStaticMesh> Scene::createStaticMesh(int numVertices,
                                                 const Material* materials)
 {
     auto staticMesh = ipl::make_shared<StaticMesh>(numVertices, numTriangles, numMaterials, vertices, triangles,
-                                                   materialIndices, materials);
+                                                   materialIndices, materials, mScheduler);
 
     return std::static_pointer_cast<IStaticMesh>(staticMesh);
 }
 
 shared_ptr<IStaticMesh> Scene::createStaticMesh(SerializedObject& serializedObject)
 {
-    auto staticMesh = ipl::make_shared<StaticMesh>(serializedObject);
+    auto staticMesh = ipl::make_shared<StaticMesh>(serializedObject, mScheduler);
     return std::static_pointer_cast<IStaticMesh>(staticMesh);
 }
 
@@ -121,6 +127,15 @@ void Scene::removeInstancedMesh(shared_ptr<IInstancedMesh> instancedMesh)
 
 void Scene::commit()
 {
+    commit(static_cast<SceneCommitFlags>(0));
+}
+
+void Scene::commit(SceneCommitFlags flags)
+{
+    // At this point, mHasChanged is only set if static/instanced meshes have been added or removed since the last
+    // commit(). Only then do the lists of meshes need to be copied.
+    auto meshesAddedOrRemoved = mHasChanged;
+
     // If no static/instanced meshes have been added or removed since the last commit(), check to see if any
     // instanced meshes have had their transforms updated.
     if (!mHasChanged)
@@ -135,14 +150,28 @@ void Scene::commit()
         }
     }
 
+    // Apply any pending vertex updates to static meshes, including ones that are about to be added to the scene.
+    for (const auto& staticMesh : mStaticMeshes[1])
+    {
+        auto phononStaticMesh = static_cast<StaticMesh*>(staticMesh.get());
+        if (phononStaticMesh->hasChanged())
+        {
+            phononStaticMesh->commit(flags);
+            mHasChanged = true;
+        }
+    }
+
     // If something changed in the scene, increment the version.
     if (mHasChanged)
     {
         mVersion++;
     }
 
-    mStaticMeshes[0] = mStaticMeshes[1];
-    mInstancedMeshes[0] = mInstancedMeshes[1];
+    if (meshesAddedOrRemoved)
+    {
+        mStaticMeshes[0] = mStaticMeshes[1];
+        mInstancedMeshes[0] = mInstancedMeshes[1];
+    }
 
     for (const auto& instancedMesh : mInstancedMeshes[0])
     {
@@ -218,9 +247,44 @@ void Scene::closestHits(int numRays,
                         const float* maxDistances,
                         Hit* hits) const
 {
-    for (auto i = 0; i < numRays; ++i)
+    if (numRays <= BVH::kPacketSize)
     {
-        hits[i] = closestHit(rays[i], minDistances[i], maxDistances[i]);
+        closestHitsInPacket(numRays, rays, minDistances, maxDistances, hits);
+        return;
+    }
+
+    // Rays are sorted in blocks, and each block is traced as a sequence of
+    // packets of coherent rays.
+    int order[kRaySortBlockSize];
+    Ray packetRays[BVH::kPacketSize];
+    float packetMinDistances[BVH::kPacketSize];
+    float packetMaxDistances[BVH::kPacketSize];
+    Hit packetHits[BVH::kPacketSize];
+
+    for (auto blockStart = 0; blockStart < numRays; blockStart += kRaySortBlockSize)
+    {
+        auto blockSize = std::min(kRaySortBlockSize, numRays - blockStart);
+        sortRays(blockSize, &rays[blockStart], order);
+
+        for (auto packetStart = 0; packetStart < blockSize; packetStart += BVH::kPacketSize)
+        {
+            auto packetSize = std::min(BVH::kPacketSize, blockSize - packetStart);
+
+            for (auto i = 0; i < packetSize; ++i)
+            {
+                auto rayIndex = blockStart + order[packetStart + i];
+                packetRays[i] = rays[rayIndex];
+                packetMinDistances[i] = minDistances[rayIndex];
+                packetMaxDistances[i] = maxDistances[rayIndex];
+            }
+
+            closestHitsInPacket(packetSize, packetRays, packetMinDistances, packetMaxDistances, packetHits);
+
+            for (auto i = 0; i < packetSize; ++i)
+            {
+                hits[blockStart + order[packetStart + i]] = packetHits[i];
+            }
+        }
     }
 }
 
@@ -230,9 +294,175 @@ void Scene::anyHits(int numRays,
                     const float* maxDistances,
                     bool* occluded) const
 {
+    if (numRays <= BVH::kPacketSize)
+    {
+        anyHitsInPacket(numRays, rays, minDistances, maxDistances, occluded);
+        return;
+    }
+
+    // Rays are sorted in blocks, and each block is traced as a sequence of
+    // packets of coherent rays.
+    int order[kRaySortBlockSize];
+    Ray packetRays[BVH::kPacketSize];
+    float packetMinDistances[BVH::kPacketSize];
+    float packetMaxDistances[BVH::kPacketSize];
+    bool packetOccluded[BVH::kPacketSize];
+
+    for (auto blockStart = 0; blockStart < numRays; blockStart += kRaySortBlockSize)
+    {
+        auto blockSize = std::min(kRaySortBlockSize, numRays - blockStart);
+        sortRays(blockSize, &rays[blockStart], order);
+
+        for (auto packetStart = 0; packetStart < blockSize; packetStart += BVH::kPacketSize)
+        {
+            auto packetSize = std::min(BVH::kPacketSize, blockSize - packetStart);
+
+            for (auto i = 0; i < packetSize; ++i)
+            {
+                auto rayIndex = blockStart + order[packetStart + i];
+                packetRays[i] = rays[rayIndex];
+                packetMinDistances[i] = minDistances[rayIndex];
+                packetMaxDistances[i] = maxDistances[rayIndex];
+            }
+
+            anyHitsInPacket(packetSize, packetRays, packetMinDistances, packetMaxDistances, packetOccluded);
+
+            for (auto i = 0; i < packetSize; ++i)
+            {
+                occluded[blockStart + order[packetStart + i]] = packetOccluded[i];
+            }
+        }
+    }
+}
+
+void Scene::closestHitsInPacket(int numRays,
+                                const Ray* rays,
+                                const float* minDistances,
+                                const float* maxDistances,
+                                Hit* hits) const
+{
+    for (auto i = 0; i < numRays; ++i)
+    {
+        hits[i] = Hit{};
+    }
+
+    // Each scene object only overwrites the hits for which it finds a
+    // closer intersection, so after visiting all objects, the hits are the
+    // overall closest hits in the scene.
+    for (const auto& staticMesh : mStaticMeshes[0])
+    {
+        const auto phononStaticMesh = static_cast<const StaticMesh*>(staticMesh.get());
+        phononStaticMesh->closestHits(numRays, rays, minDistances, maxDistances, hits);
+    }
+
+    for (const auto& instancedMesh : mInstancedMeshes[0])
+    {
+        const auto phononInstancedMesh = static_cast<const InstancedMesh*>(instancedMesh.get());
+        phononInstancedMesh->closestHits(numRays, rays, minDistances, maxDistances, hits);
+    }
+}
+
+void Scene::anyHitsInPacket(int numRays,
+                            const Ray* rays,
+                            const float* minDistances,
+                            const float* maxDistances,
+                            bool* occluded) const
+{
+    // Rays with a negative max distance are considered occluded, and are
+    // not traced.
+    auto numUnoccluded = 0;
+    for (auto i = 0; i < numRays; ++i)
+    {
+        occluded[i] = (maxDistances[i] < 0.0f);
+        if (!occluded[i])
+        {
+            ++numUnoccluded;
+        }
+    }
+
+    for (const auto& staticMesh : mStaticMeshes[0])
+    {
+        if (numUnoccluded == 0)
+            return;
+
+        const auto phononStaticMesh = static_cast<const StaticMesh*>(staticMesh.get());
+        phononStaticMesh->anyHits(numRays, rays, minDistances, maxDistances, occluded);
+        numUnoccluded = static_cast<int>(std::count(occluded, occluded + numRays, false));
+    }
+
+    for (const auto& instancedMesh : mInstancedMeshes[0])
+    {
+        if (numUnoccluded == 0)
+            return;
+
+        const auto phononInstancedMesh = static_cast<const InstancedMesh*>(instancedMesh.get());
+        phononInstancedMesh->anyHits(numRays, rays, minDistances, maxDistances, occluded);
+        numUnoccluded = static_cast<int>(std::count(occluded, occluded + numRays, false));
+    }
+}
+
+void Scene::sortRays(int numRays,
+                     const Ray* rays,
+                     int* order)
+{
+    assert(numRays <= kRaySortBlockSize);
+
+    // The sort key consists of the direction octant in the high bits,
+    // followed by each direction component quantized to 3 bits. The index of
+    // the ray within the block is packed into the low 8 bits, so sorting the
+    // keys directly yields the ordering.
+    uint32_t keys[kRaySortBlockSize];
+
+    for (auto i = 0; i < numRays; ++i)
+    {
+        const auto& direction = rays[i].direction;
+
+        uint32_t key = 0;
+        for (auto j = 0; j < 3; ++j)
+        {
+            key |= ((direction.elements[j] < 0.0f) ? 1u : 0u) << (9 + j);
+        }
+
+        for (auto j = 0; j < 3; ++j)
+        {
+            auto quantized = static_cast<uint32_t>(std::min(std::max(direction.elements[j] * 0.5f + 0.5f, 0.0f), 1.0f) * 7.0f);
+            key |= quantized << (3 * j);
+        }
+
+        keys[i] = (key << 8) | static_cast<uint32_t>(i);
+    }
+
+    // The 12-bit sort keys are sorted with two passes of a radix sort on 6-bit digits. Each pass is stable, so rays with
+    // equal keys remain in index order, just as if the packed keys were sorted directly. This is much cheaper than a
+    // comparison sort for the small blocks used here.
+    uint32_t sortedKeys[kRaySortBlockSize];
+    uint32_t* in = keys;
+    uint32_t* out = sortedKeys;
+
+    for (auto shift = 8; shift < 20; shift += 6)
+    {
+        int offsets[65] = {};
+        for (auto i = 0; i < numRays; ++i)
+        {
+            ++offsets[((in[i] >> shift) & 63) + 1];
+        }
+
+        for (auto i = 1; i < 65; ++i)
+        {
+            offsets[i] += offsets[i - 1];
+        }
+
+        for (auto i = 0; i < numRays; ++i)
+        {
+            out[offsets[(in[i] >> shift) & 63]++] = in[i];
+        }
+
+        std::swap(in, out);
+    }
+
     for (auto i = 0; i < numRays; ++i)
     {
-        occluded[i] = (maxDistances[i] >= 0.0f) ? anyHit(rays[i], minDistances[i], maxDistances[i]) : true;
+        order[i] = static_cast<int>(in[i] & 0xff);
     }
 }
 
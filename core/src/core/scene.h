@@ -65,6 +65,13 @@ public:
 
     virtual void commit() = 0;
 
+    // Commits changes to the scene. The flags control how changes to the geometry of static meshes are applied. The
+    // default implementation ignores the flags, for ray tracer backends that do not support deforming meshes.
+    virtual void commit(SceneCommitFlags flags)
+    {
+        commit();
+    }
+
     // Returns the change version of the scene. Every time commit() is called after changing the scene (e.g., by adding
     // or removing a static or instanced mesh, or by updating the transform of an instanced mesh), the version number
     // is incremented.
@@ -104,11 +111,15 @@ public:
 class Scene : public IScene
 {
 public:
-    Scene();
+    // If a scheduler is given, it is used to build the BVHs of large static meshes created by this scene in parallel,
+    // both when they are created and whenever they are rebuilt on commit. Otherwise, BVHs are built serially.
+    Scene(shared_ptr<JobScheduler> scheduler = nullptr);
 
-    Scene(const Serialized::Scene* serializedObject);
+    Scene(const Serialized::Scene* serializedObject,
+          shared_ptr<JobScheduler> scheduler = nullptr);
 
-    Scene(SerializedObject& serializedObject);
+    Scene(SerializedObject& serializedObject,
+          shared_ptr<JobScheduler> scheduler = nullptr);
 
     virtual int numStaticMeshes() const override
     {
@@ -153,9 +164,11 @@ public:
 
     virtual void commit() override;
 
+    virtual void commit(SceneCommitFlags flags) override;
+
     // Returns the change version of the scene. Every time commit() is called after changing the scene (e.g., by adding
-    // or removing a static or instanced mesh, or by updating the transform of an instanced mesh), the version number
-    // is incremented.
+    // or removing a static or instanced mesh, by updating the transform of an instanced mesh, or by updating the
+    // vertices of a static mesh), the version number is incremented.
     virtual uint32_t version() const override;
 
     virtual Hit closestHit(const Ray& ray,
@@ -187,6 +200,9 @@ public:
     void serializeAsRoot(SerializedObject& serializedObject) const;
 
 private:
+    static const int kRaySortBlockSize = 256; // Number of rays that are sorted together when forming ray packets.
+
+    shared_ptr<JobScheduler> mScheduler; // Used to build the BVHs of static meshes. May be nullptr.
     list<shared_ptr<IStaticMesh>> mStaticMeshes[2];
     list<shared_ptr<IInstancedMesh>> mInstancedMeshes[2];
 
@@ -195,6 +211,26 @@ private:
 
     // The change version of the scene.
     uint32_t mVersion;
+
+    // Calculates the closest hits for a packet of up to BVH::kPacketSize rays.
+    void closestHitsInPacket(int numRays,
+                             const Ray* rays,
+                             const float* minDistances,
+                             const float* maxDistances,
+                             Hit* hits) const;
+
+    // Calculates the occlusion status for a packet of up to BVH::kPacketSize rays.
+    void anyHitsInPacket(int numRays,
+                         const Ray* rays,
+                         const float* minDistances,
+                         const float* maxDistances,
+                         bool* occluded) const;
+
+    // Calculates an ordering of a block of (at most kRaySortBlockSize) rays such that rays with similar directions
+    // are adjacent, so that consecutive groups of rays form coherent packets.
+    static void sortRays(int numRays,
+                         const Ray* rays,
+                         int* order);
 };
 
 }
@@ -32,12 +32,13 @@ unique_ptr<IScene> SceneFactory::create(SceneType type,
                                         BatchedAnyHitCallback batchedAnyHitCallback,
                                         void* userData,
                                         shared_ptr<EmbreeDevice> embree,
-                                        shared_ptr<RadeonRaysDevice> radeonRays)
+                                        shared_ptr<RadeonRaysDevice> radeonRays,
+                                        shared_ptr<JobScheduler> scheduler)
 {
     switch (type)
     {
     case SceneType::Default:
-        return ipl::make_unique<Scene>();
+        return ipl::make_unique<Scene>(scheduler);
 
     case SceneType::Custom:
         return ipl::make_unique<CustomScene>(closestHitCallback, anyHitCallback, batchedClosestHitCallback,
@@ -61,12 +62,13 @@ unique_ptr<IScene> SceneFactory::create(SceneType type,
 unique_ptr<IScene> SceneFactory::create(SceneType type,
                                         shared_ptr<EmbreeDevice> embree,
                                         shared_ptr<RadeonRaysDevice> radeonRays,
-                                        SerializedObject& serializedObject)
+                                        SerializedObject& serializedObject,
+                                        shared_ptr<JobScheduler> scheduler)
 {
     switch (type)
     {
     case SceneType::Default:
-        return ipl::make_unique<Scene>(serializedObject);
+        return ipl::make_unique<Scene>(serializedObject, scheduler);
 
 #if defined(IPL_USES_EMBREE) && (defined(IPL_CPU_X86) || defined(IPL_CPU_X64))
     case SceneType::Embree:
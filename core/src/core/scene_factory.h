@@ -44,12 +44,14 @@ namespace SceneFactory
                               BatchedAnyHitCallback batchedAnyHitCallback,
                               void* userData,
                               shared_ptr<EmbreeDevice> embree,
-                              shared_ptr<RadeonRaysDevice> radeonRays);
+                              shared_ptr<RadeonRaysDevice> radeonRays,
+                              shared_ptr<JobScheduler> scheduler = nullptr);
 
     unique_ptr<IScene> create(SceneType type,
                               shared_ptr<EmbreeDevice> embree,
                               shared_ptr<RadeonRaysDevice> radeonRays,
-                              SerializedObject& serializedObject);
+                              SerializedObject& serializedObject,
+                              shared_ptr<JobScheduler> scheduler = nullptr);
 }
 
 }
@@ -16,6 +16,15 @@
 
 #include "serialized_object.h"
 
+#if !defined(IPL_OS_WINDOWS)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "error.h"
+
 namespace ipl {
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -38,6 +47,92 @@ public:
 };
 
 
+// --------------------------------------------------------------------------------------------------------------------
+// MappedFile
+// --------------------------------------------------------------------------------------------------------------------
+
+#if defined(IPL_OS_WINDOWS)
+
+MappedFile::MappedFile(const char* fileName)
+    : mSize(0)
+    , mData(nullptr)
+    , mFile(INVALID_HANDLE_VALUE)
+    , mMapping(nullptr)
+{
+    mFile = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (mFile == INVALID_HANDLE_VALUE)
+        throw Exception(Status::Failure);
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(mFile, &fileSize) || fileSize.QuadPart <= 0)
+    {
+        CloseHandle(mFile);
+        throw Exception(Status::Failure);
+    }
+
+    mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mMapping)
+    {
+        CloseHandle(mFile);
+        throw Exception(Status::Failure);
+    }
+
+    mData = reinterpret_cast<const byte_t*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+    if (!mData)
+    {
+        CloseHandle(mMapping);
+        CloseHandle(mFile);
+        throw Exception(Status::Failure);
+    }
+
+    mSize = static_cast<size_t>(fileSize.QuadPart);
+}
+
+MappedFile::~MappedFile()
+{
+    UnmapViewOfFile(mData);
+    CloseHandle(mMapping);
+    CloseHandle(mFile);
+}
+
+#else
+
+MappedFile::MappedFile(const char* fileName)
+    : mSize(0)
+    , mData(nullptr)
+{
+    auto file = open(fileName, O_RDONLY);
+    if (file < 0)
+        throw Exception(Status::Failure);
+
+    struct stat fileInfo;
+    if (fstat(file, &fileInfo) != 0 || fileInfo.st_size <= 0)
+    {
+        close(file);
+        throw Exception(Status::Failure);
+    }
+
+    auto size = static_cast<size_t>(fileInfo.st_size);
+    auto data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+
+    // The mapping remains valid after the file descriptor is closed.
+    close(file);
+
+    if (data == MAP_FAILED)
+        throw Exception(Status::Failure);
+
+    mSize = size;
+    mData = reinterpret_cast<const byte_t*>(data);
+}
+
+MappedFile::~MappedFile()
+{
+    munmap(const_cast<byte_t*>(mData), mSize);
+}
+
+#endif
+
+
 // --------------------------------------------------------------------------------------------------------------------
 // SerializedObject
 // --------------------------------------------------------------------------------------------------------------------
@@ -57,6 +152,12 @@ SerializedObject::SerializedObject(size_t size, const byte_t* data)
     , mData(data)
 {}
 
+SerializedObject::SerializedObject(shared_ptr<const MappedFile> mappedFile)
+    : mSize(mappedFile->size())
+    , mData(mappedFile->data())
+    , mMappedFile(mappedFile)
+{}
+
 void SerializedObject::commit()
 {
     mSize = mFBB->GetSize();
@@ -28,16 +28,42 @@ namespace ipl {
 
 class FlatBuffersAllocator;
 
+// A read-only view of the contents of a file, mapped into the address space of the process. Pages of the file are only
+// read from disk (and only count towards resident memory) once they are accessed.
+class MappedFile
+{
+public:
+    MappedFile(const char* fileName);
+
+    ~MappedFile();
+
+    size_t size() const { return mSize; }
+    const byte_t* data() const { return mData; }
+
+private:
+    size_t mSize;
+    const byte_t* mData;
+#if defined(IPL_OS_WINDOWS)
+    HANDLE mFile;
+    HANDLE mMapping;
+#endif
+};
+
 class SerializedObject
 {
 public:
     SerializedObject();
     SerializedObject(size_t size, const byte_t* data);
 
+    // Serialized data backed by a memory-mapped file. Objects loaded from this serialized object may keep a reference
+    // to the mapping, and read from it directly instead of copying data.
+    SerializedObject(shared_ptr<const MappedFile> mappedFile);
+
     size_t size() { return mSize; }
     const byte_t* data() const { return mData; }
     flatbuffers::FlatBufferBuilder& fbb() { return *mFBB; }
     const flatbuffers::FlatBufferBuilder& fbb() const { return *mFBB; }
+    shared_ptr<const MappedFile> mappedFile() const { return mMappedFile; }
 
     void commit();
 
@@ -47,6 +73,7 @@ private:
     unique_ptr<flatbuffers::FlatBufferBuilder> mFBB;
     size_t mSize;
     const byte_t* mData;
+    shared_ptr<const MappedFile> mMappedFile;
 
     static FlatBuffersAllocator sAllocator;
 };
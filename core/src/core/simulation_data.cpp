@@ -36,13 +36,15 @@ SimulationData::SimulationData(bool enableIndirect,
                                int samplingRate,
                                int frameSize,
                                shared_ptr<OpenCLDevice> openCL,
-                               shared_ptr<TANDevice> tan)
+                               shared_ptr<TANDevice> tan,
+                               int maxNumListeners)
 {
     directInputs.flags = static_cast<DirectSimulationFlags>(0);
     directInputs.occlusionType = OcclusionType::Raycast;
     directInputs.occlusionRadius = 0.0f;
     directInputs.numOcclusionSamples = maxNumOcclusionSamples;
     directInputs.numTransmissionRays = 1;
+    directInputs.temporalOcclusion = false;
 
     reflectionInputs.enabled = false;
     pathingInputs.enabled = false;
@@ -80,6 +82,9 @@ SimulationData::SimulationData(bool enableIndirect,
             reflectionState.impulseResponseCopy = ImpulseResponseFactory::create(indirectType, maxDuration, maxOrder, samplingRate, openCL);
             reflectionState.impulseResponseCopy->reset();
 
+            reflectionState.numFramesSinceTailUpdate = 0;
+            reflectionState.partitionCommitPending = false;
+
             auto numChannels = SphericalHarmonics::numCoeffsForOrder(maxOrder);
             auto irSize = static_cast<int>(ceilf(maxDuration * samplingRate));
 
@@ -90,6 +95,7 @@ SimulationData::SimulationData(bool enableIndirect,
             if (indirectType == IndirectEffectType::Convolution || indirectType == IndirectEffectType::Hybrid)
             {
                 reflectionOutputs.overlapSaveFIR.initBuffers(numChannels, irSize, frameSize);
+                reflectionState.fftIR = ipl::make_unique<OverlapSaveFIR>(numChannels, irSize, frameSize);
             }
 
             reflectionOutputs.numChannels = numChannels;
@@ -115,6 +121,14 @@ SimulationData::SimulationData(bool enableIndirect,
             reflectionOutputs.tanSlot = tan->acquireSlot();
         }
 #endif
+
+        for (auto i = 1; i < maxNumListeners; ++i)
+        {
+            additionalListenerData.push_back(ipl::make_unique<SimulationData>(true, false, sceneType, indirectType,
+                                                                              maxNumOcclusionSamples, maxDuration,
+                                                                              maxOrder, samplingRate, frameSize,
+                                                                              openCL, tan));
+        }
     }
 
     if (enablePathing)
@@ -29,19 +29,6 @@ namespace ipl {
 // SimulationData
 // --------------------------------------------------------------------------------------------------------------------
 
-struct DirectSimulationInputs
-{
-    DirectSimulationFlags flags;
-    CoordinateSpace3f source;
-    DistanceAttenuationModel distanceAttenuationModel;
-    AirAbsorptionModel airAbsorptionModel;
-    Directivity directivity;
-    OcclusionType occlusionType;
-    float occlusionRadius;
-    int numOcclusionSamples;
-    int numTransmissionRays;
-};
-
 struct DirectSimulationOutputs
 {
     DirectSoundPath directPath;
@@ -75,6 +62,10 @@ struct ReflectionSimulationState
     unique_ptr<ImpulseResponse> impulseResponseCopy;
     std::atomic<bool> impulseResponseUpdated;
     bool validSimulationData;
+    AirAbsorptionModel prevAirAbsorptionModel;
+    unique_ptr<OverlapSaveFIR> fftIR; // Latest partitioned IR, from which the triple buffer is updated.
+    int numFramesSinceTailUpdate;
+    bool partitionCommitPending; // True if the latest partitioned IR could not be committed yet.
 };
 
 struct ReflectionSimulationOutputs
@@ -110,6 +101,7 @@ struct PathingSimulationState
     Array<float> sh;
     Vector3f direction;
     float distanceRatio;
+    PathingSimulationTimings timings; // Timings for this source from the most recent call to simulatePathing().
 };
 
 struct PathingSimulationOutputs
@@ -131,10 +123,15 @@ public:
     ReflectionSimulationOutputs reflectionOutputs;
     PathingSimulationOutputs pathingOutputs;
 
+    DirectSimulationState directState;
     ReflectionSimulationState reflectionState;
     PathingSimulationState pathingState;
 
 
+    // Reflection state and outputs of this source for each listener other than the first, when simulating
+    // reflections for multiple listeners. Inputs are copied from this object before each simulation.
+    vector<unique_ptr<SimulationData>> additionalListenerData;
+
     SimulationData(bool enableIndirect,
                    bool enablePathing,
                    SceneType sceneType,
@@ -145,10 +142,22 @@ public:
                    int samplingRate,
                    int frameSize,
                    shared_ptr<OpenCLDevice> openCL,
-                   shared_ptr<TANDevice> tan);
+                   shared_ptr<TANDevice> tan,
+                   int maxNumListeners = 1);
 
     ~SimulationData();
 
+    int numListeners() const
+    {
+        return static_cast<int>(additionalListenerData.size()) + 1;
+    }
+
+    // Returns the reflection data of this source for the given listener. Listener 0 is this object itself.
+    SimulationData& listenerData(int listenerIndex)
+    {
+        return (listenerIndex == 0) ? *this : *additionalListenerData[listenerIndex - 1];
+    }
+
     bool hasSourceChanged() const;
 };
 
@@ -31,6 +31,10 @@ namespace ipl {
 // SimulationManager
 // --------------------------------------------------------------------------------------------------------------------
 
+const float SimulationManager::kEnergyFieldChangeThreshold = 1e-2f;
+const float SimulationManager::kHeadDuration = 0.1f;
+const int SimulationManager::kTailUpdateInterval = 4;
+
 bool SimulationManager::sEnableProbeCachingForMissingProbes = false;
 
 SimulationManager::SimulationManager(bool enableDirect,
@@ -63,6 +67,7 @@ SimulationManager::SimulationManager(bool enableDirect,
     , mMaxNumOcclusionSamples(maxNumOcclusionSamples)
     , mMaxDuration(maxDuration)
     , mMaxOrder(maxOrder)
+    , mMaxNumListeners(std::max(maxNumListeners, 1))
     , mNumVisSamples(numVisSamples)
     , mAsymmetricVisRange(asymmetricVisRange)
     , mDown(down)
@@ -70,13 +75,41 @@ SimulationManager::SimulationManager(bool enableDirect,
     , mFrameSize(frameSize)
     , mOpenCL(openCL)
     , mTAN(tan)
+    , mNumPathingThreads(1)
     , mSceneVersion(0)
+    , mParallelPostTrace(false)
+    , mPrevReconstructionType(ReconstructionType::Gaussian)
+    , mPrevDuration(0.0f)
+    , mPrevOrder(0)
+    , mNumHeadBlocks(OverlapSaveConvolutionEffect::numBlocks(frameSize, static_cast<int>(ceilf(kHeadDuration * samplingRate))))
 {
+    mPrevListeners.resize(mMaxNumListeners);
+
     if (enableDirect)
     {
         mDirectSimulator = make_unique<DirectSimulator>(maxNumOcclusionSamples);
     }
 
+    // Direct and pathing simulation usually run on a different thread than reflection simulation, so they use their
+    // own worker threads rather than queueing behind reflection jobs. numThreads is the total number of worker
+    // threads, so if reflections are also simulated, a quarter of them are set aside for direct and pathing
+    // simulation, and the rest are used for reflections. A single worker thread would not do any better than the
+    // calling thread, so no thread pool is created in that case. Custom scenes are only queried on the calling thread
+    // here, since applications may not expect their callbacks to be called from other threads.
+    auto numDirectPathingThreads = (enableIndirect) ? numThreads / 4 : numThreads;
+    if ((enableDirect || enablePathing) && numDirectPathingThreads > 1 && sceneType != SceneType::Custom)
+    {
+        mDirectPathingThreadPool = make_unique<ThreadPool>(numDirectPathingThreads);
+        mThreadPathingTimings.resize(numDirectPathingThreads);
+    }
+
+    if (enablePathing && mDirectPathingThreadPool)
+    {
+        mNumPathingThreads = numDirectPathingThreads;
+    }
+
+    auto numIndirectThreads = (mDirectPathingThreadPool) ? numThreads - numDirectPathingThreads : numThreads;
+
     if (enablePathing || enableIndirect)
     {
         mProbeManager = make_unique<ProbeManager>();
@@ -85,13 +118,21 @@ SimulationManager::SimulationManager(bool enableDirect,
     if (enableIndirect)
     {
         mReflectionSimulator = ReflectionSimulatorFactory::create(sceneType, maxNumRays, numDiffuseSamples, maxDuration,
-                                                                  maxOrder, maxNumSources, maxNumListeners, numThreads, rayBatchSize,
+                                                                  maxOrder, maxNumSources, maxNumListeners, numIndirectThreads, rayBatchSize,
                                                                   radeonRays);
 
+        // Reconstruction and partitioning can only run as per-source jobs if they run on the CPU. Objects with
+        // internal scratch storage are then needed for each thread.
+        mParallelPostTrace = (sceneType != SceneType::RadeonRays && indirectType != IndirectEffectType::TrueAudioNext);
+        auto numPostTraceThreads = (mParallelPostTrace) ? numIndirectThreads : 1;
+
         if (indirectType != IndirectEffectType::Parametric)
         {
-            mReconstructor = ReconstructorFactory::create(sceneType, indirectType, maxDuration, maxOrder,
-                                                          samplingRate, radeonRays);
+            for (auto i = 0; i < numPostTraceThreads; ++i)
+            {
+                mReconstructors.push_back(ReconstructorFactory::create(sceneType, indirectType, maxDuration, maxOrder,
+                                                                       samplingRate, radeonRays));
+            }
 
             if (sceneType == SceneType::RadeonRays && indirectType == IndirectEffectType::TrueAudioNext)
             {
@@ -101,15 +142,22 @@ SimulationManager::SimulationManager(bool enableDirect,
 
         if (indirectType == IndirectEffectType::Hybrid)
         {
-            mHybridReverbEstimator = make_unique<HybridReverbEstimator>(maxDuration, samplingRate, frameSize);
+            for (auto i = 0; i < numPostTraceThreads; ++i)
+            {
+                mHybridReverbEstimators.push_back(make_unique<HybridReverbEstimator>(maxDuration, samplingRate, frameSize));
+            }
         }
 
         if (indirectType == IndirectEffectType::Convolution || indirectType == IndirectEffectType::Hybrid)
         {
-            mPartitioner = make_unique<OverlapSavePartitioner>(frameSize);
+            for (auto i = 0; i < numPostTraceThreads; ++i)
+            {
+                mPartitioners.push_back(make_unique<OverlapSavePartitioner>(frameSize));
+            }
         }
 
-        mThreadPool = make_unique<ThreadPool>(numThreads);
+        mThreadPool = make_unique<ThreadPool>(numIndirectThreads);
+        mThreadIndirectTimings.resize(numIndirectThreads);
     }
 
     mSharedData = make_unique<SharedSimulationData>();
@@ -132,7 +180,8 @@ void SimulationManager::addProbeBatch(shared_ptr<ProbeBatch> probeBatch)
 
     if (mEnablePathing)
     {
-        mPathSimulators[1][probeBatch.get()] = ipl::make_shared<PathSimulator>(*probeBatch, mNumVisSamples, mAsymmetricVisRange, mDown);
+        mPathSimulators[1][probeBatch.get()] = ipl::make_shared<PathSimulator>(*probeBatch, mNumVisSamples, mAsymmetricVisRange, mDown,
+                                                                               mNumPathingThreads);
     }
 }
 
@@ -149,6 +198,28 @@ void SimulationManager::removeProbeBatch(shared_ptr<ProbeBatch> probeBatch)
     }
 }
 
+void SimulationManager::addStreamedProbeBatch(shared_ptr<ProbeBatch> probeBatch,
+                                              float tileSize)
+{
+    if (mProbeManager)
+    {
+        mProbeManager->addStreamedProbeBatch(probeBatch, tileSize);
+    }
+}
+
+void SimulationManager::setProbeStreamingSettings(const ProbeStreamingSettings& settings)
+{
+    if (mProbeManager)
+    {
+        mProbeManager->streamer().setSettings(settings);
+    }
+}
+
+ProbeStreamingStats SimulationManager::probeStreamingStats() const
+{
+    return (mProbeManager) ? mProbeManager->streamer().stats() : ProbeStreamingStats{};
+}
+
 void SimulationManager::addSource(shared_ptr<SimulationData> source)
 {
     mSourceData[1].push_back(source);
@@ -176,10 +247,23 @@ void SimulationManager::commit()
 
 void SimulationManager::simulateDirect()
 {
+    PROFILE_FUNCTION();
+
+    mDirectInputs.clear();
+    mDirectStates.clear();
+    mDirectSoundPaths.clear();
+
     for (auto& source : mSourceData[0])
     {
-        simulateDirect(*source);
+        mDirectInputs.push_back(&source->directInputs);
+        mDirectStates.push_back(&source->directState);
+        mDirectSoundPaths.push_back(&source->directOutputs.directPath);
     }
+
+    auto scheduler = (mDirectPathingThreadPool) ? &mDirectPathingThreadPool->scheduler() : nullptr;
+
+    mDirectSimulator->simulate(mScene.get(), static_cast<int>(mDirectInputs.size()), mDirectInputs.data(),
+                               mDirectStates.data(), mSharedData->direct.listener, mDirectSoundPaths.data(), scheduler);
 }
 
 void SimulationManager::simulateDirect(SimulationData& source)
@@ -196,64 +280,89 @@ void SimulationManager::simulateIndirect()
 {
     PROFILE_FUNCTION();
 
+    mIndirectTimings = IndirectSimulationTimings{};
+
     auto numChannels = SphericalHarmonics::numCoeffsForOrder(mSharedData->reflection.order);
     auto numSamples = static_cast<int>(ceilf(mSharedData->reflection.duration * mSamplingRate));
 
-    for (auto& source : mSourceData[0])
-    {
-        source->reflectionState.validSimulationData = true;
-    }
+    gatherReflectionTargets();
 
     simulateRealTimeReflections();
+
+    Timer timer;
+    timer.start();
     lookupBakedReflections();
+    mIndirectTimings.lookupBaked = timer.elapsedMilliseconds();
 
     if (mSceneType == SceneType::RadeonRays && mIndirectType != IndirectEffectType::TrueAudioNext)
     {
         copyEnergyFieldsFromDeviceToHost();
     }
 
+    timer.start();
+
     if (mIndirectType != IndirectEffectType::Parametric)
     {
         generateDistanceCorrectionCurves(numSamples);
-        reconstructImpulseResponses();
     }
 
-    if (mIndirectType == IndirectEffectType::Parametric || mIndirectType == IndirectEffectType::Hybrid)
+    if (mParallelPostTrace)
     {
-        estimateReverb();
+        processSourcesInParallel(numChannels, numSamples);
     }
-
-    if (mIndirectType == IndirectEffectType::Hybrid)
+    else
     {
-        estimateHybridReverb();
-    }
+        if (mIndirectType != IndirectEffectType::Parametric)
+        {
+            reconstructImpulseResponses();
+        }
 
-    if (mSceneType != SceneType::RadeonRays && mIndirectType == IndirectEffectType::TrueAudioNext)
-    {
-        copyImpulseResponsesFromHostToDevice();
+        if (mIndirectType == IndirectEffectType::Parametric || mIndirectType == IndirectEffectType::Hybrid)
+        {
+            estimateReverb();
+        }
+
+        if (mIndirectType == IndirectEffectType::Hybrid)
+        {
+            estimateHybridReverb();
+        }
+
+        if (mSceneType != SceneType::RadeonRays && mIndirectType == IndirectEffectType::TrueAudioNext)
+        {
+            copyImpulseResponsesFromHostToDevice();
+        }
+
+        partitionImpulseResponses(numChannels, numSamples);
+        updateImpulseResponseCopies();
     }
 
-    partitionImpulseResponses(numChannels, numSamples);
+    mIndirectTimings.postTrace = timer.elapsedMilliseconds();
+}
+
+void SimulationManager::gatherReflectionTargets()
+{
+    mReflectionTargets.clear();
 
     for (auto& source : mSourceData[0])
     {
-        if (!source->reflectionInputs.enabled)
-            continue;
-
-        if (!source->reflectionState.validSimulationData)
-            continue;
-
-        if (source->reflectionState.impulseResponseUpdated)
-            continue;
+        source->reflectionState.validSimulationData = true;
+        mReflectionTargets.push_back(source.get());
+    }
 
-        if (mIndirectType == IndirectEffectType::Convolution || mIndirectType == IndirectEffectType::Hybrid)
+    // Baked data is only looked up for the first listener, so baked sources are disabled for the others.
+    for (auto i = 1; i < numListeners(); ++i)
+    {
+        for (auto& source : mSourceData[0])
         {
-            memcpy(source->reflectionState.impulseResponseCopy->data(),
-                   source->reflectionState.impulseResponse->data(),
-                   source->reflectionState.impulseResponse->numChannels() * source->reflectionState.impulseResponse->numSamples() * sizeof(float));
+            if (source->numListeners() <= i)
+                continue;
+
+            auto& listenerData = source->listenerData(i);
+            listenerData.reflectionInputs = source->reflectionInputs;
+            listenerData.reflectionInputs.enabled = (source->reflectionInputs.enabled && !source->reflectionInputs.baked);
+            listenerData.reflectionState.validSimulationData = true;
+            mReflectionTargets.push_back(&listenerData);
         }
-
-        source->reflectionState.impulseResponseUpdated = true;
     }
 }
 
@@ -264,88 +373,173 @@ void SimulationManager::simulateRealTimeReflections()
     mRealTimeSources.clear();
     mRealTimeDirectivities.clear();
     mRealTimeEnergyFields.clear();
+    mRealTimeListeners.clear();
 
-    auto listenerChanged = hasListenerChanged();
     auto sceneChanged = hasSceneChanged();
 
-    for (auto& source : mSourceData[0])
+    // Sources created without data for some of the listeners limit the number of listeners simulated.
+    auto numRealTimeListeners = numListeners();
+    for (const auto& source : mSourceData[0])
     {
-        if (!source->reflectionInputs.enabled)
-            continue;
+        if (source->reflectionInputs.enabled && !source->reflectionInputs.baked)
+        {
+            numRealTimeListeners = std::min(numRealTimeListeners, source->numListeners());
+        }
+    }
 
-        if (source->reflectionInputs.baked)
-            continue;
+    // Energy fields are ordered by listener, then by source, as expected by IReflectionSimulator.
+    for (auto i = 0; i < numRealTimeListeners; ++i)
+    {
+        auto listenerChanged = hasListenerChanged(i);
 
-        mRealTimeSources.push_back(source->reflectionInputs.source);
-        mRealTimeDirectivities.push_back(source->reflectionInputs.directivity);
+        for (auto& source : mSourceData[0])
+        {
+            if (!source->reflectionInputs.enabled)
+                continue;
 
-        auto sourceChanged = source->hasSourceChanged();
+            if (source->reflectionInputs.baked)
+                continue;
 
-        if (listenerChanged || sourceChanged || sceneChanged)
-        {
-            mRealTimeEnergyFields.push_back(source->reflectionState.accumEnergyField.get());
-            source->reflectionState.numFramesAccumulated = 0;
-        }
-        else
-        {
-            mRealTimeEnergyFields.push_back(source->reflectionState.energyField.get());
+            auto& listenerData = source->listenerData(i);
+
+            if (i == 0)
+            {
+                mRealTimeSources.push_back(source->reflectionInputs.source);
+                mRealTimeDirectivities.push_back(source->reflectionInputs.directivity);
+            }
+
+            auto sourceChanged = listenerData.hasSourceChanged();
+
+            if (listenerChanged || sourceChanged || sceneChanged)
+            {
+                mRealTimeEnergyFields.push_back(listenerData.reflectionState.accumEnergyField.get());
+                listenerData.reflectionState.numFramesAccumulated = 0;
+            }
+            else
+            {
+                mRealTimeEnergyFields.push_back(listenerData.reflectionState.energyField.get());
+            }
         }
+
+        mRealTimeListeners.push_back(listener(i));
     }
 
     if (mRealTimeSources.empty())
         return;
 
-    mJobGraph.reset();
+    auto numSources = static_cast<int>(mRealTimeSources.size());
+
+    mReflectionSimulator->setSourceClustering(mSharedData->reflection.clusterSources, mSharedData->reflection.maxClusteringError);
+    mReflectionSimulator->setRussianRoulette(mSharedData->reflection.russianRoulette, mSharedData->reflection.survivalThreshold);
+    mReflectionSimulator->setDiffuseSampleRotation(mSharedData->reflection.rotateDiffuseSamples);
+    mReflectionSimulator->setPathCaching(mSharedData->reflection.cachePaths, mSharedData->reflection.pathHistoryLength);
+    mReflectionSimulator->setListenerPathSharing(mSharedData->reflection.shareListenerPaths);
 
-    mReflectionSimulator->simulate(*mScene, static_cast<int>(mRealTimeSources.size()), mRealTimeSources.data(), 1, &mSharedData->reflection.listener,
-                                   mRealTimeDirectivities.data(), mSharedData->reflection.numRays, mSharedData->reflection.numBounces,
-                                   mSharedData->reflection.duration, mSharedData->reflection.order, mSharedData->reflection.irradianceMinDistance,
-                                   mRealTimeEnergyFields.data(), mJobGraph);
+    if (sceneChanged)
+    {
+        mReflectionSimulator->invalidatePathCache();
+    }
+
+    Timer timer;
+
+    // Simulators that support multiple listeners share one job graph, one set of per-thread scratch data, and one
+    // reduction of per-thread energy fields across all listeners. Others are called once per listener.
+    auto numListenersPerCall = (mReflectionSimulator->supportsMultipleListeners()) ? numRealTimeListeners : 1;
+
+    for (auto i = 0; i < numRealTimeListeners; i += numListenersPerCall)
+    {
+        mJobGraph.reset();
 
-    mThreadPool->process(mJobGraph);
+        mReflectionSimulator->simulate(*mScene, numSources, mRealTimeSources.data(), numListenersPerCall, &mRealTimeListeners[i],
+                                       mRealTimeDirectivities.data(), mSharedData->reflection.numRays, mSharedData->reflection.numBounces,
+                                       mSharedData->reflection.duration, mSharedData->reflection.order, mSharedData->reflection.irradianceMinDistance,
+                                       &mRealTimeEnergyFields[i * numSources], mJobGraph);
+
+        timer.start();
+        mThreadPool->process(mJobGraph);
+        mIndirectTimings.trace += timer.elapsedMilliseconds();
+    }
 
     accumulateEnergyFields();
 }
 
 void SimulationManager::accumulateEnergyFields()
 {
-    for (auto& source : mSourceData[0])
+    // If post-trace stages run in parallel, each source's energy field is accumulated as part of its jobs instead.
+    if (!mParallelPostTrace)
     {
-        if (!source->reflectionInputs.enabled)
-            continue;
+        Timer timer;
+        timer.start();
 
-        if (source->reflectionInputs.baked)
-            continue;
-
-        if (source->reflectionState.numFramesAccumulated > 0)
+        for (auto target : mReflectionTargets)
         {
-            EnergyField::scale(*source->reflectionState.accumEnergyField, static_cast<float>(source->reflectionState.numFramesAccumulated), *source->reflectionState.accumEnergyField);
-            EnergyField::add(*source->reflectionState.energyField, *source->reflectionState.accumEnergyField, *source->reflectionState.accumEnergyField);
-            EnergyField::scale(*source->reflectionState.accumEnergyField, 1.0f / (1.0f + source->reflectionState.numFramesAccumulated), *source->reflectionState.accumEnergyField);
+            accumulateEnergyField(*target);
         }
 
-        ++source->reflectionState.numFramesAccumulated;
-
-        source->reflectionState.prevSource = source->reflectionInputs.source;
-        source->reflectionState.prevDirectivity = source->reflectionInputs.directivity;
+        mIndirectTimings.accumulate = timer.elapsedMilliseconds();
     }
 
-    mPrevListener = mSharedData->reflection.listener;
+    for (auto i = 0; i < numListeners(); ++i)
+    {
+        mPrevListeners[i] = listener(i);
+    }
 
     resetSceneChanged();
 }
 
+void SimulationManager::accumulateEnergyField(SimulationData& source)
+{
+    if (!source.reflectionInputs.enabled)
+        return;
+
+    if (source.reflectionInputs.baked)
+        return;
+
+    if (source.reflectionState.numFramesAccumulated > 0)
+    {
+        EnergyField::accumulate(*source.reflectionState.energyField, source.reflectionState.numFramesAccumulated,
+                                kEnergyFieldChangeThreshold, *source.reflectionState.accumEnergyField);
+    }
+    else
+    {
+        // The first frame was simulated directly into the accumulated energy field.
+        source.reflectionState.accumEnergyField->markAllBinsDirty();
+    }
+
+    ++source.reflectionState.numFramesAccumulated;
+
+    source.reflectionState.prevSource = source.reflectionInputs.source;
+    source.reflectionState.prevDirectivity = source.reflectionInputs.directivity;
+}
+
 void SimulationManager::lookupBakedReflections()
 {
     PROFILE_FUNCTION();
 
-    ProbeNeighborhood sourceProbes;
-    ProbeNeighborhood listenerProbes;
-    ProbeNeighborhood* probes = &listenerProbes;
+    // The probes that influence the listener, and those that influence each source that uses baked data for a static
+    // listener, are all found in a single batched query.
+    mBakedReflectionsLookupPoints.clear();
+    mBakedReflectionsLookupPoints.push_back(mSharedData->reflection.listener.origin);
+
+    for (const auto& source : mSourceData[0])
+    {
+        if (source->reflectionInputs.enabled && source->reflectionInputs.baked &&
+            source->reflectionInputs.bakedDataIdentifier.type == BakedDataType::Reflections &&
+            source->reflectionInputs.bakedDataIdentifier.variation == BakedDataVariation::StaticListener)
+        {
+            mBakedReflectionsLookupPoints.push_back(source->reflectionInputs.source.origin);
+        }
+    }
+
+    auto numPoints = static_cast<int>(mBakedReflectionsLookupPoints.size());
+
+    mProbeManager->updateStreaming(numPoints, mBakedReflectionsLookupPoints.data());
+
+    mProbeManager->getInfluencingProbes(numPoints, mBakedReflectionsLookupPoints.data(), mBakedReflectionsProbes);
+    mBakedReflectionsProbes.checkOcclusion(*mScene, mBakedReflectionsLookupPoints.data());
+    mBakedReflectionsProbes.calcWeights(mBakedReflectionsLookupPoints.data());
 
-    mProbeManager->getInfluencingProbes(mSharedData->reflection.listener.origin, listenerProbes);
-    listenerProbes.checkOcclusion(*mScene, mSharedData->reflection.listener.origin);
-    listenerProbes.calcWeights(mSharedData->reflection.listener.origin);
+    auto nextPoint = 1;
 
     for (auto& source : mSourceData[0])
     {
@@ -357,29 +551,32 @@ void SimulationManager::lookupBakedReflections()
         if (!source->reflectionInputs.baked || source->reflectionInputs.bakedDataIdentifier.type != BakedDataType::Reflections)
             continue;
 
+        auto pointIndex = 0;
         if (source->reflectionInputs.bakedDataIdentifier.variation == BakedDataVariation::StaticListener)
         {
-            mProbeManager->getInfluencingProbes(source->reflectionInputs.source.origin, sourceProbes);
-            sourceProbes.checkOcclusion(*mScene, source->reflectionInputs.source.origin);
-            sourceProbes.calcWeights(source->reflectionInputs.source.origin);
-
-            probes = &sourceProbes;
+            pointIndex = nextPoint++;
         }
 
-        source->reflectionState.validSimulationData = sEnableProbeCachingForMissingProbes ? probes->hasValidProbes() : true;
+        auto& probes = mBakedReflectionsProbes[pointIndex];
+
+        // If the probes needed here are still being streamed in, keep using the results of the previous lookup.
+        if (!probes.hasValidProbes() && mProbeManager->streamer().isLoading(mBakedReflectionsLookupPoints[pointIndex]))
+            continue;
+
+        source->reflectionState.validSimulationData = sEnableProbeCachingForMissingProbes ? probes.hasValidProbes() : true;
         if (!source->reflectionState.validSimulationData)
             continue;
 
-        BakedReflectionSimulator::findUniqueProbeBatches(*probes, mProbeBatchesForLookup);
+        BakedReflectionSimulator::findUniqueProbeBatches(probes, mProbeBatchesForLookup);
 
         if (mIndirectType != IndirectEffectType::Parametric)
         {
-            BakedReflectionSimulator::lookupEnergyField(source->reflectionInputs.bakedDataIdentifier, *probes, mProbeBatchesForLookup, *source->reflectionState.accumEnergyField);
+            BakedReflectionSimulator::lookupEnergyField(source->reflectionInputs.bakedDataIdentifier, probes, mProbeBatchesForLookup, *source->reflectionState.accumEnergyField);
         }
 
         if (mIndirectType == IndirectEffectType::Parametric || mIndirectType == IndirectEffectType::Hybrid)
         {
-            BakedReflectionSimulator::lookupReverb(source->reflectionInputs.bakedDataIdentifier, *probes, mProbeBatchesForLookup, source->reflectionOutputs.reverb);
+            BakedReflectionSimulator::lookupReverb(source->reflectionInputs.bakedDataIdentifier, probes, mProbeBatchesForLookup, source->reflectionOutputs.reverb);
         }
     }
 }
@@ -387,7 +584,7 @@ void SimulationManager::lookupBakedReflections()
 void SimulationManager::copyEnergyFieldsFromDeviceToHost()
 {
 #if defined(IPL_USES_OPENCL)
-    for (auto& source : mSourceData[0])
+    for (auto source : mReflectionTargets)
     {
         if (!source->reflectionInputs.enabled)
             continue;
@@ -406,7 +603,7 @@ void SimulationManager::generateDistanceCorrectionCurves(int numSamples)
 
     mDistanceAttenuationCorrectionCurves.clear();
 
-    for (auto& source : mSourceData[0])
+    for (auto source : mReflectionTargets)
     {
         if (!source->reflectionInputs.enabled)
             continue;
@@ -421,6 +618,7 @@ void SimulationManager::generateDistanceCorrectionCurves(int numSamples)
 
             source->reflectionInputs.distanceAttenuationModel.dirty = false;
             source->reflectionState.prevDistanceAttenuationModel = source->reflectionInputs.distanceAttenuationModel;
+            source->reflectionState.accumEnergyField->markAllBinsDirty();
 
             // From here on out, we will always apply a distance attenuation correction curve for this source.
             source->reflectionState.applyDistanceAttenuationCorrectionCurve = true;
@@ -443,12 +641,15 @@ void SimulationManager::reconstructImpulseResponses()
 {
     PROFILE_FUNCTION();
 
+    Timer timer;
+    timer.start();
+
     mEnergyFieldsForReconstruction.clear();
     mEnergyFieldsForCPUReconstruction.clear();
     mAirAbsorptionModels.clear();
     mImpulseResponses.clear();
 
-    for (auto& source : mSourceData[0])
+    for (auto source : mReflectionTargets)
     {
         if (!source->reflectionInputs.enabled)
             continue;
@@ -466,11 +667,16 @@ void SimulationManager::reconstructImpulseResponses()
 
         mAirAbsorptionModels.push_back(source->reflectionInputs.airAbsorptionModel);
         mImpulseResponses.push_back(source->reflectionState.impulseResponse.get());
+
+        // Reconstruction may happen on the GPU, so mark the entire impulse response as needing to be partitioned.
+        source->reflectionState.impulseResponse->markModified(0, source->reflectionState.impulseResponse->numSamples());
     }
 
     if (mEnergyFieldsForReconstruction.empty() && mEnergyFieldsForCPUReconstruction.empty())
         return;
 
+    auto& reconstructor = *mReconstructors[0];
+
     if (mSceneType == SceneType::RadeonRays &&
         mIndirectType == IndirectEffectType::TrueAudioNext &&
         mEnergyFieldsForCPUReconstruction.size() > 0)
@@ -483,37 +689,94 @@ void SimulationManager::reconstructImpulseResponses()
 
     if (mEnergyFieldsForReconstruction.size() > 0)
     {
-        mReconstructor->reconstruct(static_cast<int>(mImpulseResponses.size()), mEnergyFieldsForReconstruction.data(),
+        reconstructor.reconstruct(static_cast<int>(mImpulseResponses.size()), mEnergyFieldsForReconstruction.data(),
                                     mDistanceAttenuationCorrectionCurves.data(), mAirAbsorptionModels.data(),
                                     mImpulseResponses.data(), mSharedData->reflection.reconstructionType,
                                     mSharedData->reflection.duration, mSharedData->reflection.order);
     }
+
+    mIndirectTimings.reconstruct = timer.elapsedMilliseconds();
+}
+
+void SimulationManager::reconstructImpulseResponse(SimulationData& source,
+                                                   int threadId)
+{
+    if (!source.reflectionInputs.enabled)
+        return;
+
+    auto& accumEnergyField = *source.reflectionState.accumEnergyField;
+
+    if (source.reflectionInputs.airAbsorptionModel != source.reflectionState.prevAirAbsorptionModel)
+    {
+        source.reflectionState.prevAirAbsorptionModel = source.reflectionInputs.airAbsorptionModel;
+        accumEnergyField.markAllBinsDirty();
+    }
+
+    const EnergyField* energyField = &accumEnergyField;
+    ImpulseResponse* impulseResponse = source.reflectionState.impulseResponse.get();
+
+    // This matches the correction curves chosen by generateDistanceCorrectionCurves.
+    const float* distanceAttenuationCorrectionCurve = nullptr;
+    if (source.reflectionState.applyDistanceAttenuationCorrectionCurve && source.reflectionState.validSimulationData)
+    {
+        distanceAttenuationCorrectionCurve = source.reflectionState.distanceAttenuationCorrectionCurve.data();
+    }
+
+    // Hybrid reverb estimation modifies the impulse response after reconstruction, so only convolution reverb can
+    // update the parts of the impulse response affected by changes to the energy field. The parts that are updated
+    // are marked as modified in the impulse response, and only those are partitioned again.
+    if (mIndirectType == IndirectEffectType::Convolution)
+    {
+        mReconstructors[threadId]->reconstructDirtyBins(1, &energyField, &distanceAttenuationCorrectionCurve,
+                                                        &source.reflectionInputs.airAbsorptionModel, &impulseResponse,
+                                                        mSharedData->reflection.reconstructionType, mSharedData->reflection.duration,
+                                                        mSharedData->reflection.order);
+    }
+    else
+    {
+        mReconstructors[threadId]->reconstruct(1, &energyField, &distanceAttenuationCorrectionCurve,
+                                               &source.reflectionInputs.airAbsorptionModel, &impulseResponse,
+                                               mSharedData->reflection.reconstructionType, mSharedData->reflection.duration,
+                                               mSharedData->reflection.order);
+    }
+
+    accumEnergyField.clearDirtyBins();
 }
 
 void SimulationManager::estimateReverb()
 {
     PROFILE_FUNCTION();
 
-    for (auto& source : mSourceData[0])
+    Timer timer;
+    timer.start();
+
+    for (auto source : mReflectionTargets)
     {
-        if (!source->reflectionInputs.enabled)
-            continue;
+        estimateReverb(*source);
+    }
 
-        if (!source->reflectionInputs.baked)
-        {
-            ReverbEstimator::estimate(*source->reflectionState.accumEnergyField, source->reflectionInputs.airAbsorptionModel, source->reflectionOutputs.reverb);
-        }
+    mIndirectTimings.estimateReverb = timer.elapsedMilliseconds();
+}
 
-        if (source->reflectionState.validSimulationData && (source->reflectionInputs.reverbScale[0] != 1.0f ||
-                                                            source->reflectionInputs.reverbScale[1] != 1.0f ||
-                                                            source->reflectionInputs.reverbScale[2] != 1.0f))
-        {
-            ReverbEstimator::applyReverbScale(source->reflectionInputs.reverbScale, *source->reflectionState.accumEnergyField);
+void SimulationManager::estimateReverb(SimulationData& source)
+{
+    if (!source.reflectionInputs.enabled)
+        return;
 
-            source->reflectionOutputs.reverb.reverbTimes[0] *= source->reflectionInputs.reverbScale[0];
-            source->reflectionOutputs.reverb.reverbTimes[1] *= source->reflectionInputs.reverbScale[1];
-            source->reflectionOutputs.reverb.reverbTimes[2] *= source->reflectionInputs.reverbScale[2];
-        }
+    if (!source.reflectionInputs.baked)
+    {
+        ReverbEstimator::estimate(*source.reflectionState.accumEnergyField, source.reflectionInputs.airAbsorptionModel, source.reflectionOutputs.reverb);
+    }
+
+    if (source.reflectionState.validSimulationData && (source.reflectionInputs.reverbScale[0] != 1.0f ||
+                                                       source.reflectionInputs.reverbScale[1] != 1.0f ||
+                                                       source.reflectionInputs.reverbScale[2] != 1.0f))
+    {
+        ReverbEstimator::applyReverbScale(source.reflectionInputs.reverbScale, *source.reflectionState.accumEnergyField);
+
+        source.reflectionOutputs.reverb.reverbTimes[0] *= source.reflectionInputs.reverbScale[0];
+        source.reflectionOutputs.reverb.reverbTimes[1] *= source.reflectionInputs.reverbScale[1];
+        source.reflectionOutputs.reverb.reverbTimes[2] *= source.reflectionInputs.reverbScale[2];
     }
 }
 
@@ -521,24 +784,35 @@ void SimulationManager::estimateHybridReverb()
 {
     PROFILE_FUNCTION();
 
-    for (auto& source : mSourceData[0])
+    Timer timer;
+    timer.start();
+
+    for (auto source : mReflectionTargets)
     {
-        if (!source->reflectionInputs.enabled)
-            continue;
+        estimateHybridReverb(*source, 0);
+    }
 
-        if (!source->reflectionState.validSimulationData)
-            continue;
+    mIndirectTimings.estimateHybridReverb = timer.elapsedMilliseconds();
+}
 
-        mHybridReverbEstimator->estimate(source->reflectionState.accumEnergyField.get(), source->reflectionOutputs.reverb, *source->reflectionState.impulseResponse,
-                                         source->reflectionInputs.transitionTime, source->reflectionInputs.overlapFraction,
-                                         mSharedData->reflection.order, source->reflectionOutputs.hybridEQ, source->reflectionOutputs.hybridDelay);
-    }
+void SimulationManager::estimateHybridReverb(SimulationData& source,
+                                             int threadId)
+{
+    if (!source.reflectionInputs.enabled)
+        return;
+
+    if (!source.reflectionState.validSimulationData)
+        return;
+
+    mHybridReverbEstimators[threadId]->estimate(source.reflectionState.accumEnergyField.get(), source.reflectionOutputs.reverb, *source.reflectionState.impulseResponse,
+                                                source.reflectionInputs.transitionTime, source.reflectionInputs.overlapFraction,
+                                                mSharedData->reflection.order, source.reflectionOutputs.hybridEQ, source.reflectionOutputs.hybridDelay);
 }
 
 void SimulationManager::copyImpulseResponsesFromHostToDevice()
 {
 #if defined(IPL_USES_OPENCL)
-    for (auto& source : mSourceData[0])
+    for (auto source : mReflectionTargets)
     {
         if (!source->reflectionInputs.enabled)
             continue;
@@ -555,86 +829,361 @@ void SimulationManager::partitionImpulseResponses(int numChannels, int numSample
 {
     PROFILE_FUNCTION();
 
-    for (auto& source : mSourceData[0])
+    Timer timer;
+    timer.start();
+
+    for (auto source : mReflectionTargets)
+    {
+        partitionImpulseResponse(*source, numChannels, numSamples, 0);
+    }
+
+#if defined(IPL_USES_TRUEAUDIONEXT)
+    if (mIndirectType == IndirectEffectType::TrueAudioNext)
+    {
+        mTAN->updateIRs();
+    }
+#endif
+
+    mIndirectTimings.partition = timer.elapsedMilliseconds();
+}
+
+void SimulationManager::partitionImpulseResponse(SimulationData& source,
+                                                 int numChannels,
+                                                 int numSamples,
+                                                 int threadId)
+{
+    if (!source.reflectionInputs.enabled)
+        return;
+
+    if (!source.reflectionState.validSimulationData)
+        return;
+
+    if (mIndirectType == IndirectEffectType::TrueAudioNext)
+    {
+#if defined(IPL_USES_TRUEAUDIONEXT)
+        if (source.reflectionOutputs.tanSlot >= 0)
+        {
+            mTAN->setIR(source.reflectionOutputs.tanSlot, static_cast<OpenCLImpulseResponse*>(source.reflectionState.impulseResponse.get())->channelBuffers());
+        }
+#endif
+    }
+    else if (mIndirectType != IndirectEffectType::Parametric)
+    {
+        auto& fftIR = *source.reflectionState.fftIR;
+
+        // The early part of the IR changes the most, and is partitioned whenever it changes. The rest of the IR is
+        // only partitioned every few simulation frames; changes to it remain marked as modified until then.
+        auto numBlocksToUpdate = std::min(mNumHeadBlocks, fftIR.numBlocks());
+        if (++source.reflectionState.numFramesSinceTailUpdate >= kTailUpdateInterval)
+        {
+            numBlocksToUpdate = fftIR.numBlocks();
+            source.reflectionState.numFramesSinceTailUpdate = 0;
+        }
+
+        auto numBlocksUpdated = mPartitioners[threadId]->partitionModified(*source.reflectionState.impulseResponse,
+                                                                           numChannels, numSamples, numBlocksToUpdate, fftIR);
+
+        if (numBlocksUpdated == 0 && !source.reflectionState.partitionCommitPending)
+            return;
+
+        // The write buffer may hold an older version of the FIR, depending on how buffers have been exchanged with the
+        // audio thread, so bring it up to date before committing it.
+        source.reflectionOutputs.overlapSaveFIR.writeBuffer->copyChangedBlocks(fftIR);
+
+        source.reflectionState.partitionCommitPending = !source.reflectionOutputs.overlapSaveFIR.commitWriteBuffer();
+        source.reflectionOutputs.numChannels = numChannels;
+        source.reflectionOutputs.numSamples = numSamples;
+    }
+}
+
+void SimulationManager::updateImpulseResponseCopies()
+{
+    for (auto source : mReflectionTargets)
+    {
+        updateImpulseResponseCopy(*source);
+    }
+}
+
+void SimulationManager::updateImpulseResponseCopy(SimulationData& source)
+{
+    if (!source.reflectionInputs.enabled)
+        return;
+
+    if (!source.reflectionState.validSimulationData)
+        return;
+
+    if (source.reflectionState.impulseResponseUpdated)
+        return;
+
+    if (mIndirectType == IndirectEffectType::Convolution || mIndirectType == IndirectEffectType::Hybrid)
+    {
+        memcpy(source.reflectionState.impulseResponseCopy->data(),
+               source.reflectionState.impulseResponse->data(),
+               source.reflectionState.impulseResponse->numChannels() * source.reflectionState.impulseResponse->numSamples() * sizeof(float));
+    }
+
+    source.reflectionState.impulseResponseUpdated = true;
+}
+
+void SimulationManager::processSourcesInParallel(int numChannels,
+                                                 int numSamples)
+{
+    PROFILE_FUNCTION();
+
+    for (auto& timings : mThreadIndirectTimings)
+    {
+        timings = IndirectSimulationTimings{};
+    }
+
+    mPostTraceJobGraph.reset();
+
+    // Impulse responses reconstructed with different parameters can't be updated incrementally.
+    if (mSharedData->reflection.reconstructionType != mPrevReconstructionType ||
+        mSharedData->reflection.duration != mPrevDuration ||
+        mSharedData->reflection.order != mPrevOrder)
+    {
+        for (auto source : mReflectionTargets)
+        {
+            source->reflectionState.accumEnergyField->markAllBinsDirty();
+        }
+
+        mPrevReconstructionType = mSharedData->reflection.reconstructionType;
+        mPrevDuration = mSharedData->reflection.duration;
+        mPrevOrder = mSharedData->reflection.order;
+    }
+
+    for (auto source : mReflectionTargets)
     {
         if (!source->reflectionInputs.enabled)
             continue;
 
-        if (!source->reflectionState.validSimulationData)
-            continue;
+        auto simulationData = source;
 
-        if (mIndirectType == IndirectEffectType::TrueAudioNext)
+        auto reconstructJob = mPostTraceJobGraph.addJob([this, simulationData](int threadId, std::atomic<bool>& cancel)
         {
-#if defined(IPL_USES_TRUEAUDIONEXT)
-            if (source->reflectionOutputs.tanSlot >= 0)
+            auto& timings = mThreadIndirectTimings[threadId];
+            Timer timer;
+
+            timer.start();
+            accumulateEnergyField(*simulationData);
+            timings.accumulate += timer.elapsedMilliseconds();
+
+            if (mIndirectType != IndirectEffectType::Parametric)
             {
-                mTAN->setIR(source->reflectionOutputs.tanSlot, static_cast<OpenCLImpulseResponse*>(source->reflectionState.impulseResponse.get())->channelBuffers());
+                timer.start();
+                reconstructImpulseResponse(*simulationData, threadId);
+                timings.reconstruct += timer.elapsedMilliseconds();
             }
-#endif
-        }
-        else if (mIndirectType != IndirectEffectType::Parametric)
+        });
+
+        auto reverbJob = mPostTraceJobGraph.addJob([this, simulationData](int threadId, std::atomic<bool>& cancel)
         {
-            mPartitioner->partition(*source->reflectionState.impulseResponse, numChannels, numSamples, *source->reflectionOutputs.overlapSaveFIR.writeBuffer);
+            auto& timings = mThreadIndirectTimings[threadId];
+            Timer timer;
 
-            source->reflectionOutputs.overlapSaveFIR.commitWriteBuffer();
-            source->reflectionOutputs.numChannels = numChannels;
-            source->reflectionOutputs.numSamples = numSamples;
-        }
+            if (mIndirectType == IndirectEffectType::Parametric || mIndirectType == IndirectEffectType::Hybrid)
+            {
+                timer.start();
+                estimateReverb(*simulationData);
+                timings.estimateReverb += timer.elapsedMilliseconds();
+            }
+
+            if (mIndirectType == IndirectEffectType::Hybrid)
+            {
+                timer.start();
+                estimateHybridReverb(*simulationData, threadId);
+                timings.estimateHybridReverb += timer.elapsedMilliseconds();
+            }
+        });
+
+        auto partitionJob = mPostTraceJobGraph.addJob([this, simulationData, numChannels, numSamples](int threadId, std::atomic<bool>& cancel)
+        {
+            auto& timings = mThreadIndirectTimings[threadId];
+            Timer timer;
+
+            timer.start();
+            partitionImpulseResponse(*simulationData, numChannels, numSamples, threadId);
+            updateImpulseResponseCopy(*simulationData);
+            timings.partition += timer.elapsedMilliseconds();
+        });
+
+        mPostTraceJobGraph.addDependency(reverbJob, reconstructJob);
+        mPostTraceJobGraph.addDependency(partitionJob, reverbJob);
     }
 
-#if defined(IPL_USES_TRUEAUDIONEXT)
-    if (mIndirectType == IndirectEffectType::TrueAudioNext)
+    mThreadPool->process(mPostTraceJobGraph);
+
+    for (const auto& timings : mThreadIndirectTimings)
     {
-        mTAN->updateIRs();
+        mIndirectTimings.accumulate += timings.accumulate;
+        mIndirectTimings.reconstruct += timings.reconstruct;
+        mIndirectTimings.estimateReverb += timings.estimateReverb;
+        mIndirectTimings.estimateHybridReverb += timings.estimateHybridReverb;
+        mIndirectTimings.partition += timings.partition;
     }
-#endif
 }
 
 void SimulationManager::simulatePathing()
 {
     PROFILE_FUNCTION();
 
-    ProbeNeighborhood sourceProbes;
-    ProbeNeighborhood listenerProbes;
-    ProbeBatch* prevListenerProbeBatch = nullptr;
+    Timer totalTimer;
+    totalTimer.start();
 
-    sourceProbes.resize(ProbeNeighborhood::kMaxProbesPerBatch);
-    listenerProbes.resize(ProbeNeighborhood::kMaxProbesPerBatch);
+    mPathingTimings = PathingSimulationTimings{};
+
+    for (auto& timings : mThreadPathingTimings)
+    {
+        timings = PathingSimulationTimings{};
+    }
+
+    // Find the probes that influence the listener and all sources in a single batched query for each probe batch. The
+    // first point in each query is the listener, followed by each source that uses that probe batch.
+    mPathingSources.clear();
+    mPathingSourceSimulators.clear();
+    mPathingSourceProbes.clear();
+    mPathingSourceListenerProbes.clear();
+    mPathingSourceQueries.clear();
+    mPathingProbeBatches.clear();
+    mPathingProbeBatchIndices.clear();
+
+    Timer timer;
+    timer.start();
 
     for (auto& source : mSourceData[0])
     {
-        if (source->pathingInputs.enabled)
+        if (!source->pathingInputs.enabled)
+            continue;
+
+        auto probeBatch = source->pathingInputs.probes.get();
+
+        auto queryIndex = 0;
+        auto queryIter = mPathingProbeBatchIndices.find(probeBatch);
+        if (queryIter != mPathingProbeBatchIndices.end())
+        {
+            queryIndex = queryIter->second;
+        }
+        else
         {
-            auto probeBatch = source->pathingInputs.probes.get();
-            auto& simulator = *mPathSimulators[0][source->pathingInputs.probes.get()];
+            queryIndex = static_cast<int>(mPathingProbeBatches.size());
+            mPathingProbeBatchIndices[probeBatch] = queryIndex;
+            mPathingProbeBatches.push_back(probeBatch);
 
-            sourceProbes.reset();
-            probeBatch->getInfluencingProbes(source->pathingInputs.source.origin, sourceProbes);
-            sourceProbes.checkOcclusion(*mScene, source->pathingInputs.source.origin);
-            sourceProbes.calcWeights(source->pathingInputs.source.origin);
+            if (queryIndex >= static_cast<int>(mPathingProbes.size()))
+            {
+                mPathingProbes.push_back(make_unique<ProbeNeighborhoodBatch>());
+                mPathingProbePoints.emplace_back();
+            }
+
+            mPathingProbePoints[queryIndex].clear();
+            mPathingProbePoints[queryIndex].push_back(mSharedData->pathing.listener.origin);
+        }
+
+        mPathingSourceQueries.push_back(std::make_pair(queryIndex, static_cast<int>(mPathingProbePoints[queryIndex].size())));
+        mPathingProbePoints[queryIndex].push_back(source->pathingInputs.source.origin);
+
+        mPathingSources.push_back(source.get());
+        mPathingSourceSimulators.push_back(mPathSimulators[0][probeBatch].get());
+    }
 
-            if (prevListenerProbeBatch != probeBatch)
+    for (auto i = 0; i < static_cast<int>(mPathingProbeBatches.size()); ++i)
+    {
+        const auto& points = mPathingProbePoints[i];
+        auto& neighborhoods = *mPathingProbes[i];
+
+        neighborhoods.resize(static_cast<int>(points.size()), ProbeNeighborhood::kMaxProbesPerBatch);
+        mPathingProbeBatches[i]->getInfluencingProbes(points.data(), neighborhoods);
+        neighborhoods.checkOcclusion(*mScene, points.data());
+        neighborhoods.calcWeights(points.data());
+    }
+
+    for (const auto& query : mPathingSourceQueries)
+    {
+        const auto& neighborhoods = *mPathingProbes[query.first];
+        mPathingSourceProbes.push_back(&neighborhoods[query.second]);
+        mPathingSourceListenerProbes.push_back(&neighborhoods[0]);
+    }
+
+    mPathingTimings.listenerProbes = timer.elapsedMilliseconds();
+
+    auto simulateSource = [this](int index,
+                                 int threadId)
+    {
+        auto& source = *mPathingSources[index];
+        auto& simulator = *mPathingSourceSimulators[index];
+        const auto& sourceProbes = *mPathingSourceProbes[index];
+        const auto& listenerProbes = *mPathingSourceListenerProbes[index];
+        auto probeBatch = source.pathingInputs.probes.get();
+
+        auto& timings = source.pathingState.timings;
+        timings = PathingSimulationTimings{};
+
+        Timer sourceTimer;
+        sourceTimer.start();
+
+        Timer findPathsTimer;
+        findPathsTimer.start();
+
+        simulator.findPaths(source.pathingInputs.source.origin, mSharedData->pathing.listener.origin, *mScene, *probeBatch, sourceProbes,
+                            listenerProbes, source.pathingInputs.visRadius, source.pathingInputs.visThreshold, source.pathingInputs.visRange,
+                            source.pathingInputs.order, source.pathingInputs.enableValidation, source.pathingInputs.findAlternatePaths,
+                            source.pathingInputs.simplifyPaths, source.pathingInputs.realTimeVis,
+                            source.pathingState.eq, source.pathingState.sh.data(), &source.pathingState.direction, &source.pathingState.distanceRatio,
+                            mSharedData->pathing.visCallback, mSharedData->pathing.userData, false, threadId);
+
+        timings.findPaths = findPathsTimer.elapsedMilliseconds();
+
+        memcpy(source.pathingOutputs.eq, source.pathingState.eq, Bands::kNumBands * sizeof(float));
+        memcpy(source.pathingOutputs.sh.data(), source.pathingState.sh.data(), source.pathingOutputs.sh.totalSize() * sizeof(float));
+        source.pathingOutputs.direction = source.pathingState.direction;
+        source.pathingOutputs.distanceRatio = source.pathingState.distanceRatio;
+
+        timings.total = sourceTimer.elapsedMilliseconds();
+    };
+
+    auto numSources = static_cast<int>(mPathingSources.size());
+
+    // The validation ray visualization callback is application code, and is only called from the calling thread.
+    //
+    // Pathing jobs share worker threads with direct simulation, rather than getting threads of their own out of the
+    // same thread budget. If direct simulation is run while pathing jobs are queued, its jobs are pushed to the back
+    // of the workers' queues, and each worker takes jobs from the back of its own queue first. So direct simulation
+    // only waits for the pathing jobs that are already running, one per worker, and not for the rest of the pathing
+    // job graph.
+    if (mDirectPathingThreadPool && !mSharedData->pathing.visCallback && numSources > 1)
+    {
+        mPathingJobGraph.reset();
+
+        for (auto i = 0; i < numSources; ++i)
+        {
+            mPathingJobGraph.addJob([this, &simulateSource, i](int threadId, std::atomic<bool>& cancel)
             {
-                prevListenerProbeBatch = probeBatch;
+                simulateSource(i, threadId);
 
-                listenerProbes.reset();
-                probeBatch->getInfluencingProbes(mSharedData->pathing.listener.origin, listenerProbes);
-                listenerProbes.checkOcclusion(*mScene, mSharedData->pathing.listener.origin);
-                listenerProbes.calcWeights(mSharedData->pathing.listener.origin);
-            }
+                const auto& sourceTimings = mPathingSources[i]->pathingState.timings;
+                auto& timings = mThreadPathingTimings[threadId];
+                timings.findPaths += sourceTimings.findPaths;
+            });
+        }
 
-            simulator.findPaths(source->pathingInputs.source.origin, mSharedData->pathing.listener.origin, *mScene, *probeBatch, sourceProbes,
-                                listenerProbes, source->pathingInputs.visRadius, source->pathingInputs.visThreshold, source->pathingInputs.visRange,
-                                source->pathingInputs.order, source->pathingInputs.enableValidation, source->pathingInputs.findAlternatePaths,
-                                source->pathingInputs.simplifyPaths, source->pathingInputs.realTimeVis,
-                                source->pathingState.eq, source->pathingState.sh.data(), &source->pathingState.direction, &source->pathingState.distanceRatio, mSharedData->pathing.visCallback, mSharedData->pathing.userData);
+        mDirectPathingThreadPool->process(mPathingJobGraph);
 
-            memcpy(source->pathingOutputs.eq, source->pathingState.eq, Bands::kNumBands * sizeof(float));
-            memcpy(source->pathingOutputs.sh.data(), source->pathingState.sh.data(), source->pathingOutputs.sh.totalSize() * sizeof(float));
-            source->pathingOutputs.direction = source->pathingState.direction;
-            source->pathingOutputs.distanceRatio = source->pathingState.distanceRatio;
+        for (const auto& timings : mThreadPathingTimings)
+        {
+            mPathingTimings.findPaths += timings.findPaths;
         }
     }
+    else
+    {
+        for (auto i = 0; i < numSources; ++i)
+        {
+            simulateSource(i, 0);
+
+            mPathingTimings.findPaths += mPathingSources[i]->pathingState.timings.findPaths;
+        }
+    }
+
+    mPathingTimings.total = totalTimer.elapsedMilliseconds();
 }
 
 void SimulationManager::simulatePathing(SimulationData& source)
@@ -735,9 +1284,20 @@ void SimulationManager::simulatePathing(SimulationData& source, ProbeNeighborhoo
     }
 }
 
-bool SimulationManager::hasListenerChanged() const
+int SimulationManager::numListeners() const
+{
+    auto numListeners = static_cast<int>(mSharedData->reflection.additionalListeners.size()) + 1;
+    return std::min(numListeners, mMaxNumListeners);
+}
+
+const CoordinateSpace3f& SimulationManager::listener(int listenerIndex) const
+{
+    return (listenerIndex == 0) ? mSharedData->reflection.listener : mSharedData->reflection.additionalListeners[listenerIndex - 1];
+}
+
+bool SimulationManager::hasListenerChanged(int listenerIndex) const
 {
-    auto changed = ((mSharedData->reflection.listener.origin - mPrevListener.origin).length() > 1e-4f);
+    auto changed = ((listener(listenerIndex).origin - mPrevListeners[listenerIndex].origin).length() > 1e-4f);
     return changed;
 }
 
@@ -46,12 +46,23 @@ struct SharedDirectSimulationInputs
 struct SharedReflectionSimulationInputs
 {
     CoordinateSpace3f listener;
+    // Further listeners for which reflections are simulated in the same frame, at most maxNumListeners - 1. Each
+    // source's outputs for listener i are in SimulationData::listenerData(i), where listener 0 is the one above.
+    vector<CoordinateSpace3f> additionalListeners;
     int numRays;
     int numBounces;
     float duration;
     int order;
     float irradianceMinDistance;
     ReconstructionType reconstructionType;
+    bool clusterSources = false; // See IReflectionSimulator::setSourceClustering.
+    float maxClusteringError = 0.05f;
+    bool russianRoulette = false; // See IReflectionSimulator::setRussianRoulette.
+    float survivalThreshold = 0.1f;
+    bool rotateDiffuseSamples = false; // See IReflectionSimulator::setDiffuseSampleRotation.
+    bool cachePaths = false; // See IReflectionSimulator::setPathCaching.
+    int pathHistoryLength = 4;
+    bool shareListenerPaths = false; // See IReflectionSimulator::setListenerPathSharing.
 };
 
 struct SharedPathingSimulationInputs
@@ -61,6 +72,35 @@ struct SharedPathingSimulationInputs
     void* userData = nullptr;
 };
 
+// Time spent in each stage of the most recent call to SimulationManager::simulateIndirect(), in milliseconds. When the
+// per-source stages run in parallel, the time reported for each of them is the total across all threads, and
+// postTrace is the elapsed time for all of them together.
+struct IndirectSimulationTimings
+{
+    double trace = 0.0;
+    double lookupBaked = 0.0;
+    double accumulate = 0.0;
+    double reconstruct = 0.0;
+    double estimateReverb = 0.0;
+    double estimateHybridReverb = 0.0;
+    double partition = 0.0;
+    double postTrace = 0.0;
+};
+
+// Time spent in each stage of the most recent call to SimulationManager::simulatePathing(), in milliseconds. The
+// probes that influence the listener and all sources are found together, using one batched query per probe batch, and
+// the time taken is reported as listenerProbes; sourceProbes is always zero. The same structure is used for the
+// timings of individual sources, in which case only findPaths and total are non-zero. When sources are simulated in
+// parallel, the time reported for each per-source stage is the total across all threads, and total is the elapsed
+// time.
+struct PathingSimulationTimings
+{
+    double listenerProbes = 0.0;
+    double sourceProbes = 0.0;
+    double findPaths = 0.0;
+    double total = 0.0;
+};
+
 struct SharedSimulationData
 {
     SharedDirectSimulationInputs direct;
@@ -131,6 +171,11 @@ public:
         return mMaxOrder;
     }
 
+    int maxNumListeners() const
+    {
+        return mMaxNumListeners;
+    }
+
     int samplingRate() const
     {
         return mSamplingRate;
@@ -170,6 +215,15 @@ public:
 
     void removeProbeBatch(shared_ptr<ProbeBatch> probeBatch);
 
+    // Adds a probe batch whose baked reflections data is streamed in and out of memory in tiles, based on the
+    // positions of the listener and sources. Remove it using removeProbeBatch.
+    void addStreamedProbeBatch(shared_ptr<ProbeBatch> probeBatch,
+                               float tileSize);
+
+    void setProbeStreamingSettings(const ProbeStreamingSettings& settings);
+
+    ProbeStreamingStats probeStreamingStats() const;
+
     void addSource(shared_ptr<SimulationData> source);
 
     void removeSource(shared_ptr<SimulationData> source);
@@ -190,7 +244,27 @@ public:
 
     void simulatePathing(SimulationData& source, ProbeNeighborhood& sourceProbeNeighborhood, ProbeNeighborhood& listenerProbeNeighborhood);
 
+    const IndirectSimulationTimings& indirectTimings() const
+    {
+        return mIndirectTimings;
+    }
+
+    const PathingSimulationTimings& pathingTimings() const
+    {
+        return mPathingTimings;
+    }
+
 private:
+    // Relative change in an accumulated energy field bin, since an impulse response was last reconstructed from it,
+    // beyond which the corresponding part of the impulse response is reconstructed again.
+    static const float kEnergyFieldChangeThreshold;
+
+    // Duration of the early part of each IR that is partitioned as soon as it changes.
+    static const float kHeadDuration;
+
+    // Number of simulation frames between updates to the partitions of the rest of each IR.
+    static const int kTailUpdateInterval;
+
     bool mEnableDirect;
     bool mEnableIndirect;
     bool mEnablePathing;
@@ -199,6 +273,7 @@ private:
     int mMaxNumOcclusionSamples;
     float mMaxDuration;
     int mMaxOrder;
+    int mMaxNumListeners;
     int mNumVisSamples;
     bool mAsymmetricVisRange;
     Vector3f mDown;
@@ -208,21 +283,28 @@ private:
     unique_ptr<ProbeManager> mProbeManager;
     unique_ptr<DirectSimulator> mDirectSimulator;
     unique_ptr<IReflectionSimulator> mReflectionSimulator;
-    unique_ptr<IReconstructor> mReconstructor;
+    vector<unique_ptr<IReconstructor>> mReconstructors; // One per thread if mParallelPostTrace is true, else one.
     unique_ptr<IReconstructor> mCPUReconstructor;
-    unique_ptr<HybridReverbEstimator> mHybridReverbEstimator;
-    unique_ptr<OverlapSavePartitioner> mPartitioner;
+    vector<unique_ptr<HybridReverbEstimator>> mHybridReverbEstimators; // One per thread if mParallelPostTrace is true, else one.
+    vector<unique_ptr<OverlapSavePartitioner>> mPartitioners; // One per thread if mParallelPostTrace is true, else one.
     shared_ptr<OpenCLDevice> mOpenCL;
     shared_ptr<TANDevice> mTAN;
     map<const ProbeBatch*, shared_ptr<PathSimulator>> mPathSimulators[2];
     JobGraph mJobGraph;
+    JobGraph mPostTraceJobGraph;
     unique_ptr<ThreadPool> mThreadPool;
+    unique_ptr<ThreadPool> mDirectPathingThreadPool;
     unique_ptr<SharedSimulationData> mSharedData;
-    CoordinateSpace3f mPrevListener;
+    vector<CoordinateSpace3f> mPrevListeners;
     list<shared_ptr<SimulationData>> mSourceData[2];
+    vector<const DirectSimulationInputs*> mDirectInputs;
+    vector<DirectSimulationState*> mDirectStates;
+    vector<DirectSoundPath*> mDirectSoundPaths;
     vector<CoordinateSpace3f> mRealTimeSources;
     vector<Directivity> mRealTimeDirectivities;
     vector<EnergyField*> mRealTimeEnergyFields;
+    vector<CoordinateSpace3f> mRealTimeListeners;
+    vector<SimulationData*> mReflectionTargets; // Each source for the first listener, then for each further listener.
     vector<EnergyField*> mAccumEnergyFields;
     vector<EnergyField*> mEnergyFieldsForReconstruction;
     vector<EnergyField*> mEnergyFieldsForCPUReconstruction;
@@ -230,13 +312,49 @@ private:
     vector<AirAbsorptionModel> mAirAbsorptionModels;
     vector<ImpulseResponse*> mImpulseResponses;
     ProbeNeighborhood mTempSourcePathingProbes;
+    int mNumPathingThreads;
+    vector<ProbeBatch*> mPathingProbeBatches; // Probe batches used in the current call.
+    unordered_map<const ProbeBatch*, int> mPathingProbeBatchIndices;
+    vector<vector<Vector3f>> mPathingProbePoints; // For each probe batch, the listener followed by its sources.
+    vector<unique_ptr<ProbeNeighborhoodBatch>> mPathingProbes; // For each probe batch, probes influencing each point.
+    vector<std::pair<int, int>> mPathingSourceQueries; // Indices into mPathingProbes for each source.
+    vector<SimulationData*> mPathingSources;
+    vector<PathSimulator*> mPathingSourceSimulators;
+    vector<const ProbeNeighborhood*> mPathingSourceProbes;
+    vector<const ProbeNeighborhood*> mPathingSourceListenerProbes;
+    JobGraph mPathingJobGraph;
     ProbeNeighborhood mTempListenerPathingProbes;
     unordered_set<const ProbeBatch*> mProbeBatchesForLookup;
+    vector<Vector3f> mBakedReflectionsLookupPoints; // The listener, followed by sources using static listener data.
+    ProbeNeighborhoodBatch mBakedReflectionsProbes; // Probes influencing each of mBakedReflectionsLookupPoints.
 
     // Version number of the scene when simulateIndirect() was last called.
     uint32_t mSceneVersion;
 
-    bool hasListenerChanged() const;
+    // If true, the stages of simulateIndirect() that follow ray tracing run as per-source jobs on the thread pool.
+    // This is the case whenever reconstruction and partitioning run on the CPU.
+    bool mParallelPostTrace;
+
+    // Reconstruction parameters used by the previous call to processSourcesInParallel().
+    ReconstructionType mPrevReconstructionType;
+    float mPrevDuration;
+    int mPrevOrder;
+
+    // Number of overlap-save blocks covered by kHeadDuration.
+    int mNumHeadBlocks;
+
+    IndirectSimulationTimings mIndirectTimings;
+    vector<IndirectSimulationTimings> mThreadIndirectTimings; // Per-thread timings for the per-source jobs.
+
+    PathingSimulationTimings mPathingTimings;
+    vector<PathingSimulationTimings> mThreadPathingTimings; // Per-thread timings for the per-source pathing jobs.
+
+    // Number of listeners for which reflections are simulated in the current frame.
+    int numListeners() const;
+
+    const CoordinateSpace3f& listener(int listenerIndex) const;
+
+    bool hasListenerChanged(int listenerIndex) const;
 
     // Returns true if the scene has changed since the last call to simulateIndirect().
     bool hasSceneChanged();
@@ -244,8 +362,10 @@ private:
     // Records that we have used the latest version of the scene.
     void resetSceneChanged();
 
+    void gatherReflectionTargets();
     void simulateRealTimeReflections();
     void accumulateEnergyFields();
+    void accumulateEnergyField(SimulationData& source);
     void lookupBakedReflections();
     void copyEnergyFieldsFromDeviceToHost();
     void generateDistanceCorrectionCurves(int numSamples);
@@ -254,6 +374,19 @@ private:
     void estimateHybridReverb();
     void copyImpulseResponsesFromHostToDevice();
     void partitionImpulseResponses(int numChannels, int numSamples);
+    void updateImpulseResponseCopies();
+
+    // Per-source versions of the above, which use the per-thread objects with the given index.
+    void reconstructImpulseResponse(SimulationData& source, int threadId);
+    void estimateReverb(SimulationData& source);
+    void estimateHybridReverb(SimulationData& source, int threadId);
+    void partitionImpulseResponse(SimulationData& source, int numChannels, int numSamples, int threadId);
+    void updateImpulseResponseCopy(SimulationData& source);
+
+    // Runs accumulation, reconstruction, reverb estimation, and partitioning for each source as a chain of jobs on
+    // the thread pool. Chains for different sources are independent, so different stages for different sources can
+    // run at the same time.
+    void processSourcesInParallel(int numChannels, int numSamples);
 };
 
 }
@@ -0,0 +1,148 @@
+//
+// Copyright 2017-2023 Valve Corporation.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "source_cluster_tree.h"
+
+#include <algorithm>
+
+#include "box.h"
+#include "profiler.h"
+#include "stack.h"
+
+namespace ipl {
+
+// --------------------------------------------------------------------------------------------------------------------
+// SourceClusterTree
+// --------------------------------------------------------------------------------------------------------------------
+
+const int SourceClusterTree::kMaxDepth;
+
+SourceClusterTree::SourceClusterTree(int maxNumSources)
+    : mNumNodes(0)
+    , mNodes(std::max(2 * maxNumSources - 1, 1))
+    , mSourceIndices(std::max(maxNumSources, 1))
+{}
+
+void SourceClusterTree::build(int numSources,
+                              const CoordinateSpace3f* sources)
+{
+    PROFILE_FUNCTION();
+
+    assert(numSources <= static_cast<int>(mSourceIndices.size(0)));
+
+    mNumNodes = 0;
+
+    if (numSources <= 0)
+        return;
+
+    for (auto i = 0; i < numSources; ++i)
+    {
+        mSourceIndices[i] = i;
+    }
+
+    buildNode(0, numSources, sources);
+}
+
+int SourceClusterTree::buildNode(int start,
+                                 int count,
+                                 const CoordinateSpace3f* sources)
+{
+    auto index = mNumNodes++;
+
+    auto& node = mNodes[index];
+    node.start = start;
+    node.count = count;
+    node.children[0] = -1;
+    node.children[1] = -1;
+
+    if (count == 1)
+    {
+        node.bounds = Sphere(sources[mSourceIndices[start]].origin, 0.0f);
+        return index;
+    }
+
+    Box box;
+    for (auto i = start; i < start + count; ++i)
+    {
+        box.minCoordinates = Vector3f::min(box.minCoordinates, sources[mSourceIndices[i]].origin);
+        box.maxCoordinates = Vector3f::max(box.maxCoordinates, sources[mSourceIndices[i]].origin);
+    }
+
+    auto axis = box.extents().indexOfMaxComponent();
+    auto half = count / 2;
+
+    std::nth_element(&mSourceIndices[start], &mSourceIndices[start + half], &mSourceIndices[start + count],
+                     [sources, axis](int lhs, int rhs)
+    {
+        return sources[lhs].origin[axis] < sources[rhs].origin[axis];
+    });
+
+    auto left = buildNode(start, half, sources);
+    auto right = buildNode(start + half, count - half, sources);
+
+    node.children[0] = left;
+    node.children[1] = right;
+    node.bounds = computeBoundingSphere(mNodes[left].bounds, mNodes[right].bounds);
+
+    return index;
+}
+
+bool SourceClusterTree::anyHit(const Ray& ray,
+                               float maxDistance,
+                               float radius,
+                               const Vector3f& excludedPoint,
+                               const CoordinateSpace3f* sources) const
+{
+    if (mNumNodes == 0)
+        return false;
+
+    Stack<int, kMaxDepth> stack;
+    stack.push(0);
+
+    while (!stack.isEmpty())
+    {
+        const auto& node = mNodes[stack.pop()];
+
+        // Conservatively reject nodes whose bounding sphere, grown by the radius (and a small margin for rounding
+        // error), does not touch the ray anywhere before maxDistance.
+        auto originToCenter = Vector3f(node.bounds.center - ray.origin);
+        auto distanceAlongRay = std::min(std::max(Vector3f::dot(originToCenter, ray.direction), 0.0f), maxDistance);
+        auto offset = Vector3f(originToCenter - (ray.direction * distanceAlongRay));
+        auto nodeRadius = (node.bounds.radius + radius) * 1.01f;
+        if (offset.lengthSquared() > nodeRadius * nodeRadius)
+            continue;
+
+        if (node.isLeaf())
+        {
+            const auto& source = sources[mSourceIndices[node.start]];
+            if ((excludedPoint - source.origin).length() > radius)
+            {
+                auto sourceHitDistance = ray.intersect(Sphere(source.origin, radius));
+                if (0.0f <= sourceHitDistance && sourceHitDistance < maxDistance)
+                    return true;
+            }
+        }
+        else
+        {
+            stack.push(node.children[1]);
+            stack.push(node.children[0]);
+        }
+    }
+
+    return false;
+}
+
+}
@@ -0,0 +1,94 @@
+//
+// Copyright 2017-2023 Valve Corporation.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include "array.h"
+#include "coordinate_space.h"
+#include "ray.h"
+#include "sphere.h"
+
+namespace ipl {
+
+// --------------------------------------------------------------------------------------------------------------------
+// SourceClusterTree
+// --------------------------------------------------------------------------------------------------------------------
+
+// A node of a SourceClusterTree. Each node contains a contiguous range of the tree's source indices, and a sphere that
+// bounds the positions of all those sources.
+struct SourceClusterNode
+{
+    Sphere bounds;
+    int start; // Index of the first source of this node in the tree's list of source indices.
+    int count; // Number of sources in this node.
+    int children[2]; // Indices of the child nodes, or -1 for leaves.
+
+    bool isLeaf() const
+    {
+        return (children[0] < 0);
+    }
+};
+
+// A binary hierarchy of clusters of sources, used to avoid evaluating every source individually when shading or
+// tracing rays in scenes with many sources. Each leaf contains a single source. Nodes are stored in depth-first order,
+// so every node appears before its children.
+class SourceClusterTree
+{
+public:
+    static const int kMaxDepth = 64;
+
+    SourceClusterTree(int maxNumSources);
+
+    int numNodes() const
+    {
+        return mNumNodes;
+    }
+
+    const SourceClusterNode& node(int index) const
+    {
+        return mNodes[index];
+    }
+
+    // Returns the index of the source stored at the given position in the tree's list of source indices.
+    int sourceIndex(int index) const
+    {
+        return mSourceIndices[index];
+    }
+
+    // Rebuilds the tree for the given source positions, by recursively splitting at the median along the axis of
+    // greatest extent.
+    void build(int numSources,
+               const CoordinateSpace3f* sources);
+
+    // Returns true if the ray hits a sphere of the given radius around any source, at a distance less than
+    // maxDistance. Sources within the given radius of excludedPoint are ignored.
+    bool anyHit(const Ray& ray,
+                float maxDistance,
+                float radius,
+                const Vector3f& excludedPoint,
+                const CoordinateSpace3f* sources) const;
+
+private:
+    int mNumNodes;
+    Array<SourceClusterNode> mNodes;
+    Array<int> mSourceIndices;
+
+    int buildNode(int start,
+                  int count,
+                  const CoordinateSpace3f* sources);
+};
+
+}
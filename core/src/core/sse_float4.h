@@ -16,6 +16,9 @@
 
 #pragma once
 
+#include <cstdint>
+#include <cstring>
+
 #include <emmintrin.h>
 #include <xmmintrin.h>
 
@@ -183,6 +186,17 @@ namespace float4
         return _mm_load1_ps(p);
     }
 
+    // Load 4 unsigned bytes (with no alignment requirement), converting each to a float.
+    inline float4_t loadu8(const uint8_t* p)
+    {
+        int32_t bytes;
+        memcpy(&bytes, p, sizeof(bytes));
+
+        auto zero = _mm_setzero_si128();
+        auto x = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+        return _mm_cvtepi32_ps(x);
+    }
+
     // Aligned store.
     inline void store(float* p,
                       float4_t x)
@@ -230,6 +244,12 @@ namespace float4
     {
         return _mm_cvtss_f32(in);
     }
+
+    // Returns a 4-bit integer whose i-th bit is the sign bit of lane i. Typically used to test comparison masks.
+    inline int movemask(float4_t in)
+    {
+        return _mm_movemask_ps(in);
+    }
 }
 
 }
\ No newline at end of file
@@ -22,26 +22,34 @@ namespace ipl {
 // StaticMesh
 // --------------------------------------------------------------------------------------------------------------------
 
+const float StaticMesh::kMaxRefitCostRatio = 1.5f;
+
 StaticMesh::StaticMesh(int numVertices,
                        int numTriangles,
                        int numMaterials,
                        const Vector3f* vertices,
                        const Triangle* triangles,
                        const int* materialIndices,
-                       const Material* materials)
-    : mMesh(numVertices, numTriangles, vertices, triangles)
-    , mBVH(mMesh)
+                       const Material* materials,
+                       shared_ptr<JobScheduler> scheduler)
+    : mScheduler(scheduler)
+    , mMesh(numVertices, numTriangles, vertices, triangles)
+    , mBVH(mMesh, nullptr, nullptr, mScheduler.get())
     , mMaterialIndices(numTriangles)
     , mMaterials(numMaterials)
+    , mHasChanged(false)
 {
     memcpy(mMaterialIndices.data(), materialIndices, numTriangles * sizeof(int));
     memcpy(mMaterials.data(), materials, numMaterials * sizeof(Material));
 }
 
-StaticMesh::StaticMesh(const Serialized::StaticMesh* serializedObject)
-    : mMesh(serializedObject->mesh())
-    , mBVH(mMesh)
+StaticMesh::StaticMesh(const Serialized::StaticMesh* serializedObject,
+                       shared_ptr<JobScheduler> scheduler)
+    : mScheduler(scheduler)
+    , mMesh(serializedObject->mesh())
+    , mBVH(mMesh, nullptr, nullptr, mScheduler.get())
     , mMaterialIndices(mMesh.numTriangles())
+    , mHasChanged(false)
 {
     assert(serializedObject);
     assert(serializedObject->mesh());
@@ -56,8 +64,9 @@ StaticMesh::StaticMesh(const Serialized::StaticMesh* serializedObject)
     memcpy(mMaterials.data(), serializedObject->materials()->data(), numMaterials * sizeof(Material));
 }
 
-StaticMesh::StaticMesh(SerializedObject& serializedObject)
-    : StaticMesh(Serialized::GetStaticMesh(serializedObject.data()))
+StaticMesh::StaticMesh(SerializedObject& serializedObject,
+                       shared_ptr<JobScheduler> scheduler)
+    : StaticMesh(Serialized::GetStaticMesh(serializedObject.data()), scheduler)
 {}
 
 flatbuffers::Offset<Serialized::StaticMesh> StaticMesh::serialize(SerializedObject& serializedObject) const
@@ -79,6 +88,43 @@ void StaticMesh::serializeAsRoot(SerializedObject& serializedObject) const
     serializedObject.commit();
 }
 
+void StaticMesh::updateVertices(const Vector3f* vertices)
+{
+    // Vertices are staged rather than written to the mesh immediately, since
+    // the mesh may be in use by ray tracing queries until the scene is
+    // committed.
+    if (mPendingVertices.size(0) == 0)
+    {
+        mPendingVertices.resize(mMesh.numVertices());
+    }
+
+    memcpy(mPendingVertices.data(), vertices, mMesh.numVertices() * sizeof(Vector3f));
+    mHasChanged = true;
+}
+
+void StaticMesh::commit(SceneCommitFlags flags)
+{
+    if (!mHasChanged)
+        return;
+
+    mMesh.updateVertices(mPendingVertices.data());
+
+    if (flags & ForceRebuild)
+    {
+        mBVH.rebuild(mMesh, mScheduler.get());
+    }
+    else
+    {
+        auto costRatio = mBVH.refit(mMesh);
+        if (costRatio > kMaxRefitCostRatio && !(flags & RefitOnly))
+        {
+            mBVH.rebuild(mMesh, mScheduler.get());
+        }
+    }
+
+    mHasChanged = false;
+}
+
 Hit StaticMesh::closestHit(const Ray& ray,
                            float minDistance,
                            float maxDistance) const
@@ -102,6 +148,34 @@ bool StaticMesh::anyHit(const Ray& ray,
     return mBVH.isOccluded(ray, mMesh, minDistance, maxDistance);
 }
 
+void StaticMesh::closestHits(int numRays,
+                             const Ray* rays,
+                             const float* minDistances,
+                             const float* maxDistances,
+                             Hit* hits) const
+{
+    auto hitMask = mBVH.intersect(numRays, rays, minDistances, maxDistances, mMesh, hits);
+
+    for (auto i = 0; i < numRays; ++i)
+    {
+        if (hitMask & (1 << i))
+        {
+            hits[i].normal = mMesh.normal(hits[i].triangleIndex);
+            hits[i].materialIndex = mMaterialIndices[hits[i].triangleIndex];
+            hits[i].material = &mMaterials[hits[i].materialIndex];
+        }
+    }
+}
+
+void StaticMesh::anyHits(int numRays,
+                         const Ray* rays,
+                         const float* minDistances,
+                         const float* maxDistances,
+                         bool* occluded) const
+{
+    mBVH.isOccluded(numRays, rays, minDistances, maxDistances, mMesh, occluded);
+}
+
 bool StaticMesh::intersectsBox(const Box& box) const
 {
     return mBVH.intersect(box, mMesh);
@@ -17,11 +17,25 @@
 #pragma once
 
 #include "bvh.h"
+#include "job_scheduler.h"
 
 #include "static_mesh.fbs.h"
 
 namespace ipl {
 
+// --------------------------------------------------------------------------------------------------------------------
+// SceneCommitFlags
+// --------------------------------------------------------------------------------------------------------------------
+
+// Flags that control how changes to the geometry of static meshes are applied when a scene is committed. By default,
+// the BVH of a deformed mesh is refitted, and rebuilt only if refitting has degraded its quality too much.
+enum SceneCommitFlags
+{
+    RefitOnly = 1 << 0,
+    ForceRebuild = 1 << 1
+};
+
+
 // --------------------------------------------------------------------------------------------------------------------
 // IStaticMesh
 // --------------------------------------------------------------------------------------------------------------------
@@ -39,6 +53,12 @@ public:
     virtual int numTriangles() const = 0;
 
     virtual int numMaterials() const = 0;
+
+    // Updates the positions of all vertices of the mesh. The triangles and materials are left unchanged. The change
+    // takes effect the next time the scene containing the mesh is committed. The default implementation does nothing,
+    // for ray tracer backends that do not support deforming meshes.
+    virtual void updateVertices(const Vector3f* vertices)
+    {}
 };
 
 
@@ -50,17 +70,22 @@ public:
 class StaticMesh : public IStaticMesh
 {
 public:
+    // If a scheduler is given, the BVH of a large mesh is built in parallel on its threads, both here and whenever it
+    // is rebuilt by commit(). Otherwise, the BVH is built serially.
     StaticMesh(int numVertices,
                int numTriangles,
                int numMaterials,
                const Vector3f* vertices,
                const Triangle* triangles,
                const int* materialIndices,
-               const Material* materials);
+               const Material* materials,
+               shared_ptr<JobScheduler> scheduler = nullptr);
 
-    StaticMesh(const Serialized::StaticMesh* serializedObject);
+    StaticMesh(const Serialized::StaticMesh* serializedObject,
+               shared_ptr<JobScheduler> scheduler = nullptr);
 
-    StaticMesh(SerializedObject& serializedObject);
+    StaticMesh(SerializedObject& serializedObject,
+               shared_ptr<JobScheduler> scheduler = nullptr);
 
     virtual int numVertices() const override
     {
@@ -77,6 +102,19 @@ public:
         return static_cast<int>(mMaterials.size(0));
     }
 
+    virtual void updateVertices(const Vector3f* vertices) override;
+
+    // Returns true if the vertices have been updated since the last call to commit().
+    bool hasChanged() const
+    {
+        return mHasChanged;
+    }
+
+    // Applies any pending vertex updates. The BVH is refitted, unless the flags request a full rebuild, or refitting
+    // increases the cost of traversing the BVH by more than kMaxRefitCostRatio and the flags do not prohibit a
+    // rebuild.
+    void commit(SceneCommitFlags flags);
+
     Mesh& mesh()
     {
         return mMesh;
@@ -115,6 +153,22 @@ public:
                 float minDistance,
                 float maxDistance) const;
 
+    // Updates the closest hits for a packet of up to BVH::kPacketSize rays. A hit is only overwritten if a closer
+    // intersection with this mesh is found.
+    void closestHits(int numRays,
+                     const Ray* rays,
+                     const float* minDistances,
+                     const float* maxDistances,
+                     Hit* hits) const;
+
+    // Updates the occlusion status for a packet of up to BVH::kPacketSize rays. Rays already marked as occluded are
+    // not traced.
+    void anyHits(int numRays,
+                 const Ray* rays,
+                 const float* minDistances,
+                 const float* maxDistances,
+                 bool* occluded) const;
+
     bool intersectsBox(const Box& box) const;
 
     flatbuffers::Offset<Serialized::StaticMesh> serialize(SerializedObject& serializedObject) const;
@@ -122,10 +176,15 @@ public:
     void serializeAsRoot(SerializedObject& serializedObject) const;
 
 private:
+    static const float kMaxRefitCostRatio; // Maximum increase in BVH traversal cost tolerated before rebuilding.
+
+    shared_ptr<JobScheduler> mScheduler; // Used to build the BVH in parallel. May be nullptr.
     Mesh mMesh;
     BVH mBVH;
     Array<int> mMaterialIndices;
     Array<Material> mMaterials;
+    Array<Vector3f> mPendingVertices; // Vertices passed to the most recent call to updateVertices().
+    bool mHasChanged; // Flag indicating whether the vertices have been updated since the last call to commit().
 };
 
 }
@@ -23,71 +23,35 @@ namespace ipl {
 // --------------------------------------------------------------------------------------------------------------------
 
 ThreadPool::ThreadPool(int numThreads)
-    : mThreads(numThreads)
+    : mScheduler(numThreads)
     , mCancel(false)
-    , mReady(0)
-    , mCompleted(0)
-    , mQuit(false)
     , mJobGraph(nullptr)
-{
-    for (auto i = 0; i < numThreads; ++i)
-    {
-        mThreads[i] = std::move(std::thread(&ThreadPool::threadFunc, this, i));
-    }
-}
+{}
 
-ThreadPool::~ThreadPool()
+void ThreadPool::process(JobGraph& jobGraph)
 {
     std::unique_lock<std::mutex> lock(mMutex);
-    mQuit = true;
-    mReady = static_cast<int>(mThreads.size(0));
-    mCondVarReady.notify_all();
-    lock.unlock();
-    for (auto i = 0u; i < mThreads.size(0); ++i)
+    if (mCancel)
     {
-        mThreads[i].join();
+        jobGraph.cancel();
     }
-}
-
-void ThreadPool::process(JobGraph& jobGraph)
-{
     mJobGraph = &jobGraph;
-    std::unique_lock<std::mutex> lock(mMutex);
-    mReady = static_cast<int>(mThreads.size(0));
-    mCompleted = 0;
-    mCondVarReady.notify_all();
-    mCondVarComplete.wait(lock, [this]() { return (mCompleted == mThreads.size(0)); });
+    lock.unlock();
+
+    mScheduler.submit(jobGraph);
+    mScheduler.wait(jobGraph);
+
+    lock.lock();
+    mJobGraph = nullptr;
 }
 
 void ThreadPool::cancel()
 {
+    std::lock_guard<std::mutex> lock(mMutex);
     mCancel = true;
-}
-
-void ThreadPool::threadFunc(int threadId)
-{
-    while (true)
+    if (mJobGraph)
     {
-        std::unique_lock<std::mutex> lock(mMutex);
-        mCondVarReady.wait(lock, [this]() { return (mReady > 0 || mCancel || mQuit); });
-        --mReady;
-
-        if (mQuit)
-        {
-            mCondVarComplete.notify_one();
-            break;
-        }
-
-        lock.unlock();
-        while (mJobGraph->processNextJob(threadId, mCancel))
-        {
-            if (mCancel)
-                break;
-        }
-
-        lock.lock();
-        ++mCompleted;
-        mCondVarComplete.notify_one();
+        mJobGraph->cancel();
     }
 }
 
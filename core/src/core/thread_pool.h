@@ -16,7 +16,7 @@
 
 #pragma once
 
-#include "job_graph.h"
+#include "job_scheduler.h"
 
 namespace ipl {
 
@@ -24,29 +24,31 @@ namespace ipl {
 // ThreadPool
 // --------------------------------------------------------------------------------------------------------------------
 
+// Runs job graphs to completion using a JobScheduler. This provides the blocking interface used by older code; new
+// code that needs to overlap multiple job graphs, or to submit work without blocking, should use the JobScheduler
+// directly.
 class ThreadPool
 {
 public:
     ThreadPool(int numThreads);
 
-    ~ThreadPool();
+    JobScheduler& scheduler()
+    {
+        return mScheduler;
+    }
 
+    // Runs all jobs in a job graph, and blocks until they have completed.
     void process(JobGraph& jobGraph);
 
+    // Cancels the job graph currently being processed, if any, along with all job graphs processed subsequently.
+    // This may be called from any thread.
     void cancel();
 
 private:
-    Array<std::thread> mThreads;
-    std::atomic<bool> mCancel;
-    std::atomic<int> mReady;
-    std::atomic<int> mCompleted;
-    std::atomic<bool> mQuit;
-    std::mutex mMutex;
-    std::condition_variable mCondVarReady;
-    std::condition_variable mCondVarComplete;
-    JobGraph* mJobGraph;
-
-    void threadFunc(int threadId);
+    JobScheduler mScheduler;
+    bool mCancel;
+    JobGraph* mJobGraph; // The job graph currently being processed.
+    std::mutex mMutex; // Guards mCancel and mJobGraph.
 };
 
 }
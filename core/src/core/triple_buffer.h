@@ -44,13 +44,17 @@ public:
         readBuffer  = ipl::make_unique<T>(std::forward<Args>(args)...);
     }
 
-    void commitWriteBuffer()
+    // Returns false if the previously committed data has not been read yet, in which case nothing is committed.
+    bool commitWriteBuffer()
     {
         if (!mNewDataWritten)
         {
             shareBuffer.swap(writeBuffer);
             mNewDataWritten = true;
+            return true;
         }
+
+        return false;
     }
 
     bool updateReadBuffer()
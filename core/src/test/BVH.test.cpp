@@ -14,9 +14,12 @@
 // limitations under the License.
 //
 
+#include <random>
+
 #include <catch.hpp>
 
 #include <bvh.h>
+#include <job_scheduler.h>
 
 TEST_CASE("BvhNode", "[BvhNode]")
 {
@@ -95,4 +98,190 @@ TEST_CASE("TraversalTask", "[TraversalTask]")
 
 TEST_CASE("Bvh", "[Bvh]")
 {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+    std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+
+    const auto kNumTriangles = 300;
+    std::vector<ipl::Vector3f> vertices;
+    std::vector<ipl::Triangle> triangles;
+
+    for (auto i = 0; i < kNumTriangles; ++i)
+    {
+        ipl::Vector3f center(position(rng), position(rng), position(rng));
+        for (auto j = 0; j < 3; ++j)
+        {
+            vertices.push_back(center + ipl::Vector3f(offset(rng), offset(rng), offset(rng)));
+        }
+
+        triangles.push_back(ipl::Triangle{ { 3 * i, 3 * i + 1, 3 * i + 2 } });
+    }
+
+    ipl::Mesh mesh(static_cast<int>(vertices.size()), kNumTriangles, vertices.data(), triangles.data());
+    ipl::BVH bvh(mesh);
+
+    SECTION("Wide nodes contain all triangles")
+    {
+        std::vector<bool> found(kNumTriangles, false);
+
+        for (auto i = 0; i < bvh.numWideNodes(); ++i)
+        {
+            const auto& node = bvh.wideNode(i);
+            for (auto j = 0; j < ipl::WideBVHNode::kWidth && !node.isEmpty(j); ++j)
+            {
+                if (!node.isLeaf(j))
+                    continue;
+
+                auto triangleIndex = node.triangleIndex(j);
+                found[triangleIndex] = true;
+
+                auto box = node.childBoundingBox(j);
+                for (auto k = 0; k < 3; ++k)
+                {
+                    REQUIRE(box.contains(mesh.triangleVertex(triangleIndex, k)));
+                }
+            }
+        }
+
+        REQUIRE(std::count(found.begin(), found.end(), true) == kNumTriangles);
+    }
+
+    SECTION("Traversal matches brute force intersection")
+    {
+        for (auto i = 0; i < 500; ++i)
+        {
+            ipl::Ray ray;
+            ray.origin = ipl::Vector3f(position(rng), position(rng), position(rng));
+            ray.direction = ipl::Vector3f::unitVector(ipl::Vector3f(offset(rng), offset(rng), offset(rng)));
+
+            auto closest = std::numeric_limits<float>::infinity();
+            for (auto j = 0; j < kNumTriangles; ++j)
+            {
+                auto t = ray.intersect(mesh, j);
+                if (0.0f <= t && t < closest)
+                {
+                    closest = t;
+                }
+            }
+
+            auto hit = bvh.intersect(ray, mesh, 0.0f, std::numeric_limits<float>::infinity());
+            REQUIRE(hit.distance == Approx(closest));
+            REQUIRE(bvh.isOccluded(ray, mesh, 0.0f, 5.0f) == (closest < 5.0f));
+        }
+    }
+
+    SECTION("Refitting after moving vertices matches brute force intersection")
+    {
+        for (auto i = 0; i < kNumTriangles; ++i)
+        {
+            ipl::Vector3f displacement(offset(rng), offset(rng), offset(rng));
+            for (auto j = 0; j < 3; ++j)
+            {
+                vertices[3 * i + j] += 3.0f * displacement;
+            }
+        }
+
+        mesh.updateVertices(vertices.data());
+        auto costRatio = bvh.refit(mesh);
+        REQUIRE(costRatio > 0.0f);
+
+        for (auto i = 0; i < bvh.numWideNodes(); ++i)
+        {
+            const auto& node = bvh.wideNode(i);
+            for (auto j = 0; j < ipl::WideBVHNode::kWidth && !node.isEmpty(j); ++j)
+            {
+                if (!node.isLeaf(j))
+                    continue;
+
+                auto box = node.childBoundingBox(j);
+                for (auto k = 0; k < 3; ++k)
+                {
+                    REQUIRE(box.contains(mesh.triangleVertex(node.triangleIndex(j), k)));
+                }
+            }
+        }
+
+        ipl::BVH rebuiltBVH(mesh);
+
+        for (auto i = 0; i < 500; ++i)
+        {
+            ipl::Ray ray;
+            ray.origin = ipl::Vector3f(position(rng), position(rng), position(rng));
+            ray.direction = ipl::Vector3f::unitVector(ipl::Vector3f(offset(rng), offset(rng), offset(rng)));
+
+            auto closest = std::numeric_limits<float>::infinity();
+            for (auto j = 0; j < kNumTriangles; ++j)
+            {
+                auto t = ray.intersect(mesh, j);
+                if (0.0f <= t && t < closest)
+                {
+                    closest = t;
+                }
+            }
+
+            auto hit = bvh.intersect(ray, mesh, 0.0f, std::numeric_limits<float>::infinity());
+            REQUIRE(hit.distance == Approx(closest));
+            REQUIRE(bvh.isOccluded(ray, mesh, 0.0f, 5.0f) == (closest < 5.0f));
+
+            auto rebuiltHit = rebuiltBVH.intersect(ray, mesh, 0.0f, std::numeric_limits<float>::infinity());
+            REQUIRE(rebuiltHit.distance == Approx(closest));
+        }
+
+        bvh.rebuild(mesh);
+        REQUIRE(bvh.refit(mesh) == Approx(1.0f));
+    }
+
+    SECTION("Parallel construction produces the same BVH as serial construction")
+    {
+        const auto kNumLargeTriangles = 20000;
+        std::vector<ipl::Vector3f> largeVertices;
+        std::vector<ipl::Triangle> largeTriangles;
+
+        for (auto i = 0; i < kNumLargeTriangles; ++i)
+        {
+            ipl::Vector3f center(position(rng), position(rng), position(rng));
+            for (auto j = 0; j < 3; ++j)
+            {
+                largeVertices.push_back(center + 0.1f * ipl::Vector3f(offset(rng), offset(rng), offset(rng)));
+            }
+
+            largeTriangles.push_back(ipl::Triangle{ { 3 * i, 3 * i + 1, 3 * i + 2 } });
+        }
+
+        ipl::Mesh largeMesh(static_cast<int>(largeVertices.size()), kNumLargeTriangles, largeVertices.data(), largeTriangles.data());
+        ipl::JobScheduler scheduler(4);
+
+        ipl::BVH serialBVH(largeMesh);
+        ipl::BVH parallelBVH(largeMesh, nullptr, nullptr, &scheduler);
+
+        auto requireEqual = [&]()
+        {
+            REQUIRE(serialBVH.numNodes() == parallelBVH.numNodes());
+            for (auto i = 0; i < serialBVH.numNodes(); ++i)
+            {
+                const auto& serialNode = serialBVH.node(i);
+                const auto& parallelNode = parallelBVH.node(i);
+
+                REQUIRE(serialNode.isLeaf() == parallelNode.isLeaf());
+                REQUIRE(serialNode.getTriangleIndex() == parallelNode.getTriangleIndex());
+                REQUIRE(serialNode.boundingBox().maxCoordinates.x() == parallelNode.boundingBox().maxCoordinates.x());
+                REQUIRE(serialNode.boundingBox().maxCoordinates.y() == parallelNode.boundingBox().maxCoordinates.y());
+                REQUIRE(serialNode.boundingBox().maxCoordinates.z() == parallelNode.boundingBox().maxCoordinates.z());
+            }
+        };
+
+        requireEqual();
+
+        // Rebuilds reuse the same scheduler.
+        for (auto& vertex : largeVertices)
+        {
+            vertex += ipl::Vector3f(offset(rng), offset(rng), offset(rng));
+        }
+
+        ipl::Mesh movedMesh(static_cast<int>(largeVertices.size()), kNumLargeTriangles, largeVertices.data(), largeTriangles.data());
+        serialBVH.rebuild(movedMesh);
+        parallelBVH.rebuild(movedMesh, &scheduler);
+
+        requireEqual();
+    }
 }
@@ -0,0 +1,130 @@
+//
+// Copyright 2017-2023 Valve Corporation.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <catch.hpp>
+
+#include <background_job_queue.h>
+
+TEST_CASE("BackgroundJobQueue hands jobs to its worker", "[BackgroundJobQueue]")
+{
+    ipl::BackgroundJobQueue queue(4);
+
+    // Keeps the worker busy until released.
+    std::atomic<bool> started(false);
+    std::atomic<bool> release(false);
+    ipl::BackgroundJob slowJob([&]()
+    {
+        started = true;
+        while (!release)
+        {
+            std::this_thread::yield();
+        }
+    });
+
+    std::atomic<int> count(0);
+    ipl::BackgroundJob job([&]()
+    {
+        count++;
+    });
+
+    SECTION("Submitted jobs run on the worker")
+    {
+        for (auto i = 0; i < 100; ++i)
+        {
+            REQUIRE(queue.submit(job));
+            job.waitUntilIdle();
+
+            REQUIRE(count == i + 1);
+        }
+    }
+
+    SECTION("Jobs claimed before the worker gets to them are not run by the worker")
+    {
+        REQUIRE(queue.submit(slowJob));
+        while (!started)
+        {
+            std::this_thread::yield();
+        }
+
+        REQUIRE(queue.submit(job));
+        REQUIRE(job.claimOrWait());
+
+        // The job stays in the queue until the worker discards it, so can't be submitted again until then.
+        REQUIRE(!job.isIdle());
+        REQUIRE(!queue.submit(job));
+
+        release = true;
+        job.waitUntilIdle();
+        slowJob.waitUntilIdle();
+
+        REQUIRE(count == 0);
+    }
+
+    SECTION("Jobs started by the worker are waited for")
+    {
+        REQUIRE(queue.submit(slowJob));
+        while (!started)
+        {
+            std::this_thread::yield();
+        }
+
+        std::thread releaser([&]()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            release = true;
+        });
+
+        REQUIRE(!slowJob.claimOrWait());
+        REQUIRE(release);
+        REQUIRE(slowJob.isIdle());
+
+        releaser.join();
+    }
+
+    SECTION("Submitting to a full queue fails")
+    {
+        REQUIRE(queue.submit(slowJob));
+        while (!started)
+        {
+            std::this_thread::yield();
+        }
+
+        std::vector<std::unique_ptr<ipl::BackgroundJob>> jobs;
+        for (auto i = 0; i < queue.capacity() + 1; ++i)
+        {
+            jobs.push_back(std::unique_ptr<ipl::BackgroundJob>(new ipl::BackgroundJob([&]() { count++; })));
+        }
+
+        for (auto i = 0; i < queue.capacity(); ++i)
+        {
+            REQUIRE(queue.submit(*jobs[i]));
+        }
+
+        REQUIRE(!queue.submit(*jobs[queue.capacity()]));
+        REQUIRE(jobs[queue.capacity()]->isIdle());
+
+        release = true;
+        for (auto& queuedJob : jobs)
+        {
+            queuedJob->waitUntilIdle();
+        }
+
+        REQUIRE(count == queue.capacity());
+    }
+
+    release = true;
+    slowJob.waitUntilIdle();
+}
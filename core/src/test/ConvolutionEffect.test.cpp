@@ -14,12 +14,328 @@
 // limitations under the License.
 //
 
+#include <chrono>
+#include <random>
+#include <thread>
+
 #include <catch.hpp>
 
+#include <non_uniform_convolution_effect.h>
+#include <overlap_save_convolution_effect.h>
+
 TEST_CASE("ConvolutionMixer", "[ConvolutionMixer]")
 {
+    const auto kFrameSize = 64;
+    const auto kNumChannels = 2;
+
+    ipl::AudioSettings audioSettings{48000, kFrameSize};
+    ipl::OverlapSaveConvolutionMixer mixer(audioSettings, ipl::OverlapSaveConvolutionEffectSettings{kNumChannels, 4 * kFrameSize});
+
+    ipl::OverlapSaveConvolutionMixerParams mixerParams{};
+    mixerParams.numChannels = kNumChannels;
+
+    ipl::AudioBuffer wet(kNumChannels, kFrameSize);
+    ipl::AudioBuffer out(kNumChannels, kFrameSize);
+    for (auto i = 0; i < kNumChannels; ++i)
+    {
+        for (auto j = 0; j < kFrameSize; ++j)
+        {
+            wet[i][j] = static_cast<float>(i * kFrameSize + j);
+        }
+    }
+
+    // Time domain input is summed, and passed through without any delay or crossfading.
+    mixer.mixTimeDomain(wet.data());
+    mixer.mixTimeDomain(wet.data());
+    mixer.apply(mixerParams, out);
+
+    for (auto i = 0; i < kNumChannels; ++i)
+    {
+        for (auto j = 0; j < kFrameSize; ++j)
+        {
+            REQUIRE(out[i][j] == Approx(2.0f * wet[i][j]).margin(1e-4f));
+        }
+    }
+
+    // Mixed input is cleared after each frame.
+    mixer.apply(mixerParams, out);
+
+    for (auto i = 0; i < kNumChannels; ++i)
+    {
+        for (auto j = 0; j < kFrameSize; ++j)
+        {
+            REQUIRE(out[i][j] == Approx(0.0f).margin(1e-4f));
+        }
+    }
 }
 
 TEST_CASE("ConvolutionEffect", "[ConvolutionEffect]")
 {
 }
+
+TEST_CASE("OverlapSavePartitioner only updates modified blocks.", "[ConvolutionEffect]")
+{
+    const auto kFrameSize = 256;
+    const auto kSamplingRate = 48000;
+    const auto kDuration = 0.1f;
+    const auto kOrder = 1;
+
+    ipl::ImpulseResponse ir(kDuration, kOrder, kSamplingRate);
+    for (auto i = 0; i < ir.numChannels(); ++i)
+    {
+        for (auto j = 0; j < ir.numSamples(); ++j)
+        {
+            ir[i][j] = sinf(0.01f * (i + 1) * j) * expf(-1e-3f * j);
+        }
+    }
+
+    ipl::OverlapSavePartitioner partitioner(kFrameSize);
+    ipl::OverlapSaveFIR fullFFTIR(ir.numChannels(), ir.numSamples(), kFrameSize);
+    ipl::OverlapSaveFIR fftIR(ir.numChannels(), ir.numSamples(), kFrameSize);
+
+    auto numBlocks = fftIR.numBlocks();
+
+    // A newly created IR is entirely marked as modified.
+    REQUIRE(partitioner.partitionModified(ir, ir.numChannels(), ir.numSamples(), numBlocks, fftIR) == numBlocks);
+    REQUIRE(partitioner.partitionModified(ir, ir.numChannels(), ir.numSamples(), numBlocks, fftIR) == 0);
+
+    partitioner.partition(ir, ir.numChannels(), ir.numSamples(), fullFFTIR);
+
+    for (auto i = 0; i < ir.numChannels(); ++i)
+    {
+        for (auto j = 0; j < numBlocks; ++j)
+        {
+            REQUIRE(fftIR.blockVersion(j) != 0);
+            REQUIRE(fftIR.blockVersion(j) != fullFFTIR.blockVersion(j));
+
+            for (auto k = 0; k < fftIR.numSpectrumSamples(); ++k)
+            {
+                REQUIRE(fftIR[i][j][k].real() == Approx(fullFFTIR[i][j][k].real()).margin(1e-4f));
+                REQUIRE(fftIR[i][j][k].imag() == Approx(fullFFTIR[i][j][k].imag()).margin(1e-4f));
+            }
+        }
+    }
+
+    ipl::OverlapSaveFIR copiedFFTIR(ir.numChannels(), ir.numSamples(), kFrameSize);
+    copiedFFTIR.copyChangedBlocks(fftIR);
+
+    std::vector<uint64_t> versions(numBlocks);
+    for (auto j = 0; j < numBlocks; ++j)
+    {
+        versions[j] = fftIR.blockVersion(j);
+    }
+
+    const auto kModifiedBlock = 3;
+    ir[1][kModifiedBlock * kFrameSize + 10] += 1.0f;
+    ir.markModified(kModifiedBlock * kFrameSize + 10, kModifiedBlock * kFrameSize + 11);
+
+    // Blocks past the ones requested are left modified for later.
+    REQUIRE(partitioner.partitionModified(ir, ir.numChannels(), ir.numSamples(), kModifiedBlock, fftIR) == 0);
+    REQUIRE(partitioner.partitionModified(ir, ir.numChannels(), ir.numSamples(), numBlocks, fftIR) == 1);
+
+    for (auto j = 0; j < numBlocks; ++j)
+    {
+        REQUIRE((fftIR.blockVersion(j) != versions[j]) == (j == kModifiedBlock));
+    }
+
+    copiedFFTIR.copyChangedBlocks(fftIR);
+
+    for (auto i = 0; i < ir.numChannels(); ++i)
+    {
+        for (auto j = 0; j < numBlocks; ++j)
+        {
+            REQUIRE(copiedFFTIR.blockVersion(j) == fftIR.blockVersion(j));
+            REQUIRE(memcmp(copiedFFTIR[i][j], fftIR[i][j], fftIR.numSpectrumSamples() * sizeof(ipl::complex_t)) == 0);
+        }
+    }
+}
+
+TEST_CASE("NonUniformConvolutionEffect matches OverlapSaveConvolutionEffect.", "[NonUniformConvolutionEffect]")
+{
+    const auto kFrameSize = 64;
+    const auto kSamplingRate = 48000;
+    const auto kNumChannels = 4;
+    const auto kIRSize = 40 * kFrameSize;
+    const auto kDuration = static_cast<float>(kIRSize) / kSamplingRate;
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+    auto makeIR = [&](ipl::ImpulseResponse& ir)
+    {
+        for (auto i = 0; i < ir.numChannels(); ++i)
+        {
+            for (auto j = 0; j < ir.numSamples(); ++j)
+            {
+                ir[i][j] = distribution(rng) * expf(-2e-3f * j);
+            }
+        }
+    };
+
+    ipl::ImpulseResponse ir(kDuration, 1, kSamplingRate);
+    ipl::ImpulseResponse updatedIR(kDuration, 1, kSamplingRate);
+    makeIR(ir);
+    makeIR(updatedIR);
+
+    REQUIRE(ir.numSamples() == kIRSize);
+
+    ipl::OverlapSavePartitioner partitioner(kFrameSize);
+
+    ipl::TripleBuffer<ipl::OverlapSaveFIR> fftIR;
+    ipl::TripleBuffer<ipl::OverlapSaveFIR> nonUniformFFTIR;
+    fftIR.initBuffers(kNumChannels, kIRSize, kFrameSize);
+    nonUniformFFTIR.initBuffers(kNumChannels, kIRSize, kFrameSize);
+
+    auto commitIR = [&](const ipl::ImpulseResponse& impulseResponse)
+    {
+        partitioner.partition(impulseResponse, kNumChannels, kIRSize, *fftIR.writeBuffer);
+        nonUniformFFTIR.writeBuffer->copyChangedBlocks(*fftIR.writeBuffer);
+        fftIR.commitWriteBuffer();
+        nonUniformFFTIR.commitWriteBuffer();
+    };
+
+    // With a slow worker, the worker is kept busy by another job for much longer than a frame, so most tail jobs miss
+    // their deadline and are run on the calling thread, while others are still running on the worker at their deadline.
+    for (auto withJobQueue : {false, true})
+    for (auto slowWorker : {false, true})
+    for (auto withMixer : {false, true})
+    {
+        if (slowWorker && !withJobQueue)
+            continue;
+
+        ipl::AudioSettings audioSettings{kSamplingRate, kFrameSize};
+
+        ipl::NonUniformConvolutionEffectSettings nonUniformSettings{};
+        nonUniformSettings.numChannels = kNumChannels;
+        nonUniformSettings.irSize = kIRSize;
+        if (withJobQueue)
+        {
+            nonUniformSettings.jobQueue = ipl::make_shared<ipl::BackgroundJobQueue>();
+        }
+
+        ipl::BackgroundJob slowJob([]()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        });
+
+        auto slowDown = [&]()
+        {
+            if (slowWorker)
+            {
+                nonUniformSettings.jobQueue->submit(slowJob);
+            }
+        };
+
+        ipl::OverlapSaveConvolutionEffect effect(audioSettings, ipl::OverlapSaveConvolutionEffectSettings{kNumChannels, kIRSize});
+        ipl::NonUniformConvolutionEffect nonUniformEffect(audioSettings, nonUniformSettings);
+
+        REQUIRE(nonUniformEffect.numPartitionGroups() > 1);
+
+        ipl::AudioBuffer in(1, kFrameSize);
+        ipl::AudioBuffer out(kNumChannels, kFrameSize);
+        ipl::AudioBuffer nonUniformOut(kNumChannels, kFrameSize);
+
+        ipl::OverlapSaveConvolutionMixer mixer(audioSettings, ipl::OverlapSaveConvolutionEffectSettings{kNumChannels, kIRSize});
+        ipl::OverlapSaveConvolutionMixer nonUniformMixer(audioSettings, ipl::OverlapSaveConvolutionEffectSettings{kNumChannels, kIRSize});
+
+        ipl::OverlapSaveConvolutionMixerParams mixerParams{};
+        mixerParams.numChannels = kNumChannels;
+
+        ipl::OverlapSaveConvolutionEffectParams params{};
+        params.fftIR = &fftIR;
+        params.numChannels = kNumChannels;
+        params.numSamples = kIRSize;
+
+        ipl::OverlapSaveConvolutionEffectParams nonUniformParams = params;
+        nonUniformParams.fftIR = &nonUniformFFTIR;
+
+        auto maxDifference = [&](int numFrames)
+        {
+            auto result = 0.0f;
+
+            for (auto i = 0; i < numFrames; ++i)
+            {
+                slowDown();
+
+                for (auto j = 0; j < kFrameSize; ++j)
+                {
+                    in[0][j] = distribution(rng);
+                }
+
+                if (withMixer)
+                {
+                    effect.apply(params, in, mixer);
+                    nonUniformEffect.apply(nonUniformParams, in, nonUniformMixer);
+                    mixer.apply(mixerParams, out);
+                    nonUniformMixer.apply(mixerParams, nonUniformOut);
+                }
+                else
+                {
+                    effect.apply(params, in, out);
+                    nonUniformEffect.apply(nonUniformParams, in, nonUniformOut);
+                }
+
+                for (auto j = 0; j < kNumChannels; ++j)
+                {
+                    for (auto k = 0; k < kFrameSize; ++k)
+                    {
+                        result = std::max(result, fabsf(out[j][k] - nonUniformOut[j][k]));
+                    }
+                }
+            }
+
+            return result;
+        };
+
+        commitIR(ir);
+        REQUIRE(maxDifference(200) < 1e-4f);
+
+        // Changes to the tail are crossfaded in over longer periods of time, so only compare outputs once the effects of
+        // the update have settled.
+        commitIR(updatedIR);
+        maxDifference(3 * kIRSize / kFrameSize);
+        REQUIRE(maxDifference(50) < 1e-4f);
+
+        // The tail should match the output of the uniformly partitioned effect when given silent input.
+        in.makeSilent();
+
+        auto numTailFrames = 0;
+        auto maxTailDifference = 0.0f;
+        while (true)
+        {
+            slowDown();
+
+            ipl::AudioEffectState state;
+            if (withMixer)
+            {
+                effect.apply(params, in, mixer);
+                state = nonUniformEffect.tail(nonUniformMixer);
+                mixer.apply(mixerParams, out);
+                nonUniformMixer.apply(mixerParams, nonUniformOut);
+            }
+            else
+            {
+                effect.apply(params, in, out);
+                state = nonUniformEffect.tail(nonUniformOut);
+            }
+
+            for (auto j = 0; j < kNumChannels; ++j)
+            {
+                for (auto k = 0; k < kFrameSize; ++k)
+                {
+                    maxTailDifference = std::max(maxTailDifference, fabsf(out[j][k] - nonUniformOut[j][k]));
+                }
+            }
+
+            if (state != ipl::AudioEffectState::TailRemaining)
+                break;
+
+            ++numTailFrames;
+        }
+
+        REQUIRE(numTailFrames == kIRSize / kFrameSize - 2);
+        REQUIRE(maxTailDifference < 1e-4f);
+
+        slowJob.waitUntilIdle();
+    }
+}
@@ -14,10 +14,102 @@
 // limitations under the License.
 //
 
+#include <random>
+
 #include <catch.hpp>
 
 #include <direct_simulator.h>
 
+#include "test_scenes.h"
+
+namespace {
+
+const auto kNumSources = 100;
+const auto kMaxNumOcclusionSamples = 32;
+
+// Creates a scene containing randomly placed triangles, all with the same partially transmissive material.
+ipl::shared_ptr<ipl::Scene> createTransmissiveScene(std::mt19937& rng)
+{
+    ipl::Material material{};
+    material.transmission[0] = 0.5f;
+    material.transmission[1] = 0.25f;
+    material.transmission[2] = 0.125f;
+
+    return createRandomScene(rng, material);
+}
+
+std::vector<ipl::DirectSimulationInputs> createRandomInputs(std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+
+    std::vector<ipl::DirectSimulationInputs> inputs(kNumSources);
+    for (auto i = 0; i < kNumSources; ++i)
+    {
+        auto flags = ipl::CalcDistanceAttenuation | ipl::CalcAirAbsorption | ipl::CalcDelay | ipl::CalcOcclusion;
+        if (i % 4 != 0)
+        {
+            flags |= ipl::CalcTransmission;
+        }
+
+        inputs[i].flags = static_cast<ipl::DirectSimulationFlags>(flags);
+        inputs[i].source = ipl::CoordinateSpace3f(ipl::Vector3f(position(rng), position(rng), position(rng)));
+        inputs[i].occlusionType = (i % 2 == 0) ? ipl::OcclusionType::Raycast : ipl::OcclusionType::Volumetric;
+        inputs[i].occlusionRadius = 1.0f;
+        inputs[i].numOcclusionSamples = (i % 3 == 0) ? kMaxNumOcclusionSamples : 16;
+        inputs[i].numTransmissionRays = 1 + (i % 5);
+        inputs[i].temporalOcclusion = false;
+    }
+
+    return inputs;
+}
+
+// Simulates each source individually.
+std::vector<ipl::DirectSoundPath> simulateEachSource(ipl::DirectSimulator& directSimulator,
+                                                     const ipl::IScene* scene,
+                                                     const std::vector<ipl::DirectSimulationInputs>& inputs,
+                                                     const ipl::CoordinateSpace3f& listener)
+{
+    std::vector<ipl::DirectSoundPath> directSoundPaths(inputs.size());
+
+    for (auto i = 0u; i < inputs.size(); ++i)
+    {
+        directSimulator.simulate(scene, inputs[i].flags, inputs[i].source, listener,
+                                 inputs[i].distanceAttenuationModel, inputs[i].airAbsorptionModel,
+                                 inputs[i].directivity, inputs[i].occlusionType, inputs[i].occlusionRadius,
+                                 inputs[i].numOcclusionSamples, inputs[i].numTransmissionRays, directSoundPaths[i]);
+    }
+
+    return directSoundPaths;
+}
+
+// Simulates all sources with a single call.
+std::vector<ipl::DirectSoundPath> simulateAllSources(ipl::DirectSimulator& directSimulator,
+                                                     const ipl::IScene* scene,
+                                                     const std::vector<ipl::DirectSimulationInputs>& inputs,
+                                                     std::vector<ipl::DirectSimulationState>* states,
+                                                     const ipl::CoordinateSpace3f& listener,
+                                                     ipl::JobScheduler* scheduler)
+{
+    std::vector<ipl::DirectSoundPath> directSoundPaths(inputs.size());
+    std::vector<const ipl::DirectSimulationInputs*> inputPointers(inputs.size());
+    std::vector<ipl::DirectSimulationState*> statePointers(inputs.size());
+    std::vector<ipl::DirectSoundPath*> directSoundPathPointers(inputs.size());
+
+    for (auto i = 0u; i < inputs.size(); ++i)
+    {
+        inputPointers[i] = &inputs[i];
+        statePointers[i] = (states) ? &(*states)[i] : nullptr;
+        directSoundPathPointers[i] = &directSoundPaths[i];
+    }
+
+    directSimulator.simulate(scene, static_cast<int>(inputs.size()), inputPointers.data(), statePointers.data(),
+                             listener, directSoundPathPointers.data(), scheduler);
+
+    return directSoundPaths;
+}
+
+}
+
 TEST_CASE("DirectSoundPath", "[DirectSoundPath]")
 {
 }
@@ -25,3 +117,105 @@ TEST_CASE("DirectSoundPath", "[DirectSoundPath]")
 TEST_CASE("DirectSimulator", "[DirectSimulator]")
 {
 }
+
+TEST_CASE("Batched direct simulation matches per-source simulation.", "[DirectSimulator]")
+{
+    std::mt19937 rng(42);
+    auto scene = createTransmissiveScene(rng);
+    auto inputs = createRandomInputs(rng);
+
+    ipl::CoordinateSpace3f listener(ipl::Vector3f(0.0f, 0.0f, 0.0f));
+
+    ipl::DirectSimulator directSimulator(kMaxNumOcclusionSamples);
+    auto expected = simulateEachSource(directSimulator, scene.get(), inputs, listener);
+
+    for (auto numThreads : {0, 4})
+    {
+        ipl::unique_ptr<ipl::JobScheduler> scheduler;
+        if (numThreads > 0)
+        {
+            scheduler = ipl::make_unique<ipl::JobScheduler>(numThreads);
+        }
+
+        auto directSoundPaths = simulateAllSources(directSimulator, scene.get(), inputs, nullptr, listener, scheduler.get());
+
+        for (auto i = 0; i < kNumSources; ++i)
+        {
+            REQUIRE(directSoundPaths[i].distanceAttenuation == expected[i].distanceAttenuation);
+            REQUIRE(directSoundPaths[i].delay == expected[i].delay);
+            REQUIRE(directSoundPaths[i].occlusion == Approx(expected[i].occlusion));
+
+            for (auto j = 0; j < ipl::Bands::kNumBands; ++j)
+            {
+                REQUIRE(directSoundPaths[i].airAbsorption[j] == expected[i].airAbsorption[j]);
+                REQUIRE(directSoundPaths[i].transmission[j] == Approx(expected[i].transmission[j]));
+            }
+        }
+    }
+}
+
+TEST_CASE("Temporally amortized volumetric occlusion converges.", "[DirectSimulator]")
+{
+    std::mt19937 rng(42);
+    auto scene = createTransmissiveScene(rng);
+    auto inputs = createRandomInputs(rng);
+
+    // Some sample counts are not a multiple of the maximum update interval.
+    for (auto i = 0; i < kNumSources; ++i)
+    {
+        inputs[i].occlusionType = ipl::OcclusionType::Volumetric;
+        inputs[i].temporalOcclusion = true;
+
+        if (i % 3 == 1)
+        {
+            inputs[i].numOcclusionSamples = 20;
+        }
+    }
+
+    ipl::CoordinateSpace3f listener(ipl::Vector3f(0.0f, 0.0f, 0.0f));
+
+    ipl::DirectSimulator directSimulator(kMaxNumOcclusionSamples);
+    std::vector<ipl::DirectSimulationState> states(kNumSources);
+
+    auto requireConverged = [&](const std::vector<ipl::DirectSoundPath>& directSoundPaths)
+    {
+        auto expected = simulateEachSource(directSimulator, scene.get(), inputs, listener);
+
+        for (auto i = 0; i < kNumSources; ++i)
+        {
+            REQUIRE(states[i].numStaleSamples == 0);
+            REQUIRE(directSoundPaths[i].occlusion == Approx(expected[i].occlusion));
+        }
+    };
+
+    // All samples are traced the first time.
+    requireConverged(simulateAllSources(directSimulator, scene.get(), inputs, &states, listener, nullptr));
+
+    // After a small movement, only some samples are traced per simulation run, but all of them are traced within
+    // kTemporalOcclusionMaxUpdateInterval (8) simulation runs.
+    listener.origin += ipl::Vector3f(0.1f, 0.0f, 0.0f);
+    for (auto& sourceInputs : inputs)
+    {
+        sourceInputs.source.origin += ipl::Vector3f(0.0f, 0.2f, 0.0f);
+    }
+
+    auto directSoundPaths = simulateAllSources(directSimulator, scene.get(), inputs, &states, listener, nullptr);
+
+    auto numPartialUpdates = 0;
+    for (const auto& state : states)
+    {
+        if (state.numStaleSamples > 0)
+        {
+            ++numPartialUpdates;
+        }
+    }
+
+    REQUIRE(numPartialUpdates > 0);
+
+    for (auto i = 1; i < 8; ++i)
+    {
+        directSoundPaths = simulateAllSources(directSimulator, scene.get(), inputs, &states, listener, nullptr);
+    }
+
+    requireConverged(directSoundPaths);
+}
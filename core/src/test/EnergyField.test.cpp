@@ -16,6 +16,12 @@
 
 #include <catch.hpp>
 
+#include <baked_reflection_data.h>
+#include <compressed_energy_field.h>
+#include <energy_field.h>
+#include <impulse_response.h>
+#include <reconstructor.h>
+
 TEST_CASE("Histogram", "[Histogram]")
 {
 }
@@ -28,6 +34,243 @@ TEST_CASE("EnergyField", "[EnergyField]")
 {
 }
 
+TEST_CASE("CompressedEnergyField", "[EnergyField]")
+{
+    const auto kDuration = 1.0f;
+    const auto kOrder = 2;
+
+    ipl::EnergyField energyField(kDuration, kOrder);
+    for (auto i = 0; i < energyField.numChannels(); ++i)
+    {
+        for (auto j = 0; j < ipl::Bands::kNumBands; ++j)
+        {
+            for (auto k = 0; k < energyField.numBins(); ++k)
+            {
+                energyField[i][j][k] = ((i == 0) ? 1.0f : 0.3f * sinf(1.0f + i + k)) * expf(-(0.05f + 0.02f * j) * k);
+            }
+        }
+    }
+
+    auto maxRelativeError = [&](const ipl::EnergyField& decoded,
+                                float dynamicRange)
+    {
+        auto result = 0.0f;
+
+        for (auto i = 0; i < energyField.numChannels(); ++i)
+        {
+            for (auto j = 0; j < ipl::Bands::kNumBands; ++j)
+            {
+                auto scale = 0.0f;
+                for (auto k = 0; k < energyField.numBins(); ++k)
+                {
+                    scale = std::max(scale, fabsf(energyField[i][j][k]));
+                }
+
+                for (auto k = 0; k < energyField.numBins(); ++k)
+                {
+                    auto value = energyField[i][j][k];
+                    if (fabsf(value) < scale * exp2f(-dynamicRange))
+                    {
+                        REQUIRE(fabsf(decoded[i][j][k]) <= scale * exp2f(-dynamicRange) * 1.5f);
+                    }
+                    else
+                    {
+                        result = std::max(result, fabsf(decoded[i][j][k] - value) / fabsf(value));
+                    }
+                }
+            }
+        }
+
+        return result;
+    };
+
+    SECTION("Decoded values are within the quantization error.")
+    {
+        ipl::CompressedEnergyField compressed8(energyField, ipl::EnergyFieldCompression::LogQuantized8);
+        ipl::CompressedEnergyField compressed16(energyField, ipl::EnergyFieldCompression::LogQuantized16);
+        ipl::EnergyField decoded(kDuration, kOrder);
+
+        REQUIRE(compressed8.serializedSize() < energyField.serializedSize() / 3);
+        REQUIRE(compressed16.serializedSize() < energyField.serializedSize() / 1.9f);
+
+        compressed8.decode(decoded);
+        REQUIRE(maxRelativeError(decoded, 27.0f) < 0.08f);
+
+        compressed16.decode(decoded);
+        REQUIRE(maxRelativeError(decoded, 47.0f) < 1e-3f);
+    }
+
+    SECTION("Baked data looks up compressed energy fields without expanding them.")
+    {
+        ipl::BakedDataIdentifier identifier{};
+        identifier.type = ipl::BakedDataType::Reflections;
+        identifier.variation = ipl::BakedDataVariation::Reverb;
+
+        ipl::ProbeBatch probeBatch;
+        probeBatch.addProbe(ipl::Sphere(ipl::Vector3f::kZero, 1.0f));
+        probeBatch.commit();
+
+        ipl::BakedReflectionsData bakedData(identifier, 1, true, false);
+        bakedData.setEnergyFieldCompression(ipl::EnergyFieldCompression::LogQuantized16);
+
+        auto probeEnergyField = ipl::make_unique<ipl::EnergyField>(kDuration, kOrder);
+        probeEnergyField->copyFrom(energyField);
+        bakedData.set(0, std::move(probeEnergyField));
+
+        REQUIRE(bakedData.lookupEnergyField(0) == nullptr);
+        REQUIRE(bakedData.lookupCompressedEnergyField(0) != nullptr);
+
+        ipl::ProbeNeighborhood neighborhood;
+        neighborhood.resize(1);
+        neighborhood.batches[0] = &probeBatch;
+        neighborhood.probeIndices[0] = 0;
+        neighborhood.weights[0] = 0.5f;
+
+        ipl::EnergyField result(kDuration, kOrder);
+        result.reset();
+        bakedData.evaluateEnergyField(neighborhood, result);
+
+        for (auto i = 0; i < energyField.numChannels(); ++i)
+        {
+            for (auto j = 0; j < ipl::Bands::kNumBands; ++j)
+            {
+                for (auto k = 0; k < energyField.numBins(); ++k)
+                {
+                    REQUIRE(result[i][j][k] == Approx(0.5f * energyField[i][j][k]).epsilon(1e-3f).margin(1e-12f));
+                }
+            }
+        }
+    }
+}
+
 TEST_CASE("EnergyFieldReconstructor", "[EnergyFieldReconstructor]")
 {
+    const auto kDuration = 0.5f;
+    const auto kOrder = 1;
+    const auto kSamplingRate = 48000;
+    const auto kBin = 10;
+
+    ipl::EnergyField energyField(kDuration, kOrder);
+    ipl::ImpulseResponse impulseResponse(kDuration, kOrder, kSamplingRate);
+    ipl::Reconstructor reconstructor(kDuration, kOrder, kSamplingRate);
+
+    const ipl::EnergyField* energyFields[] = { &energyField };
+    const float* distanceAttenuationCorrectionCurves[] = { nullptr };
+    ipl::AirAbsorptionModel airAbsorptionModels[] = { ipl::AirAbsorptionModel{} };
+    ipl::ImpulseResponse* impulseResponses[] = { &impulseResponse };
+
+    auto numSamplesPerBin = static_cast<int>(ceilf(ipl::EnergyField::kBinDuration * kSamplingRate));
+
+    SECTION("Zero energy field gives a silent impulse response.")
+    {
+        energyField.reset();
+
+        for (auto type : { ipl::ReconstructionType::Gaussian, ipl::ReconstructionType::Linear })
+        {
+            reconstructor.reconstruct(1, energyFields, distanceAttenuationCorrectionCurves, airAbsorptionModels,
+                                      impulseResponses, type, kDuration, kOrder);
+
+            for (auto i = 0; i < impulseResponse.numChannels(); ++i)
+            {
+                for (auto j = 0; j < impulseResponse.numSamples(); ++j)
+                {
+                    REQUIRE(fabsf(impulseResponse[i][j]) < 1e-6f);
+                }
+            }
+        }
+    }
+
+    SECTION("Gaussian reconstruction is localized in time and linear across channels.")
+    {
+        energyField.reset();
+        for (auto i = 0; i < ipl::Bands::kNumBands; ++i)
+        {
+            energyField[0][i][kBin] = 1.0f;
+            energyField[1][i][kBin] = -0.5f;
+        }
+
+        reconstructor.reconstruct(1, energyFields, distanceAttenuationCorrectionCurves, airAbsorptionModels,
+                                  impulseResponses, ipl::ReconstructionType::Gaussian, kDuration, kOrder);
+
+        auto totalEnergy = 0.0f;
+        auto binEnergy = 0.0f;
+        for (auto i = 0; i < impulseResponse.numSamples(); ++i)
+        {
+            auto energy = impulseResponse[0][i] * impulseResponse[0][i];
+            totalEnergy += energy;
+
+            if ((kBin - 1) * numSamplesPerBin <= i && i < (kBin + 3) * numSamplesPerBin)
+            {
+                binEnergy += energy;
+            }
+
+            REQUIRE(impulseResponse[1][i] == Approx(-0.5f * impulseResponse[0][i]).margin(1e-6f));
+            REQUIRE(fabsf(impulseResponse[2][i]) < 1e-6f);
+        }
+
+        REQUIRE(totalEnergy > 0.0f);
+        REQUIRE(binEnergy / totalEnergy > 0.99f);
+    }
+
+    SECTION("Reconstructing dirty bins matches a full reconstruction.")
+    {
+        auto initEnergyField = [](ipl::EnergyField& energyField)
+        {
+            for (auto i = 0; i < energyField.numChannels(); ++i)
+            {
+                for (auto j = 0; j < ipl::Bands::kNumBands; ++j)
+                {
+                    for (auto k = 0; k < energyField.numBins(); ++k)
+                    {
+                        energyField[i][j][k] = ((i == 0) ? 1.0f : 0.25f) * expf(-0.1f * k);
+                    }
+                }
+            }
+        };
+
+        ipl::EnergyField changedEnergyField(kDuration, kOrder);
+        initEnergyField(changedEnergyField);
+        for (auto i = 0; i < energyField.numChannels(); ++i)
+        {
+            for (auto j = 0; j < ipl::Bands::kNumBands; ++j)
+            {
+                changedEnergyField[i][j][kBin] *= 2.0f;
+                changedEnergyField[i][j][kBin + 1] *= 0.5f;
+                changedEnergyField[i][j][3 * kBin] *= 1.5f;
+            }
+        }
+
+        ipl::ImpulseResponse fullImpulseResponse(kDuration, kOrder, kSamplingRate);
+        ipl::ImpulseResponse* fullImpulseResponses[] = { &fullImpulseResponse };
+        const ipl::EnergyField* changedEnergyFields[] = { &changedEnergyField };
+
+        for (auto type : { ipl::ReconstructionType::Gaussian, ipl::ReconstructionType::Linear })
+        {
+            initEnergyField(energyField);
+
+            reconstructor.reconstruct(1, energyFields, distanceAttenuationCorrectionCurves, airAbsorptionModels,
+                                      impulseResponses, type, kDuration, kOrder);
+            energyField.clearDirtyBins();
+
+            ipl::EnergyField::accumulate(changedEnergyField, 0, 1e-3f, energyField);
+
+            for (auto k = 0; k < energyField.numBins(); ++k)
+            {
+                REQUIRE(energyField.isBinDirty(k) == (k == kBin || k == kBin + 1 || k == 3 * kBin));
+            }
+
+            reconstructor.reconstructDirtyBins(1, energyFields, distanceAttenuationCorrectionCurves, airAbsorptionModels,
+                                               impulseResponses, type, kDuration, kOrder);
+            reconstructor.reconstruct(1, changedEnergyFields, distanceAttenuationCorrectionCurves, airAbsorptionModels,
+                                      fullImpulseResponses, type, kDuration, kOrder);
+
+            for (auto i = 0; i < impulseResponse.numChannels(); ++i)
+            {
+                for (auto j = 0; j < impulseResponse.numSamples(); ++j)
+                {
+                    REQUIRE(impulseResponse[i][j] == Approx(fullImpulseResponse[i][j]).margin(1e-5f));
+                }
+            }
+        }
+    }
 }
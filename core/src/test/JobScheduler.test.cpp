@@ -0,0 +1,194 @@
+//
+// Copyright 2017-2023 Valve Corporation.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <catch.hpp>
+
+#include <thread_pool.h>
+
+TEST_CASE("JobScheduler runs all jobs in dependency order", "[JobScheduler]")
+{
+    const auto kNumThreads = 4;
+    ipl::JobScheduler scheduler(kNumThreads);
+
+    SECTION("Independent jobs all run once")
+    {
+        const auto kNumJobs = 1000;
+        std::vector<std::atomic<int>> counts(kNumJobs);
+        std::atomic<bool> validThreadIds(true);
+
+        ipl::JobGraph jobGraph;
+        for (auto i = 0; i < kNumJobs; ++i)
+        {
+            counts[i] = 0;
+            jobGraph.addJob([&counts, &validThreadIds, i](int threadId, std::atomic<bool>& cancel)
+            {
+                if (threadId < 0 || threadId >= kNumThreads)
+                    validThreadIds = false;
+
+                counts[i]++;
+            });
+        }
+
+        scheduler.submit(jobGraph);
+        scheduler.wait(jobGraph);
+
+        REQUIRE(jobGraph.isComplete());
+        REQUIRE(validThreadIds);
+        for (auto i = 0; i < kNumJobs; ++i)
+        {
+            REQUIRE(counts[i] == 1);
+        }
+    }
+
+    SECTION("Dependent jobs run after their dependencies")
+    {
+        // Builds a diamond-shaped graph repeatedly: one job fans out to many
+        // jobs, which all fan back in to a single job.
+        const auto kNumLevels = 20;
+        const auto kWidth = 16;
+
+        std::atomic<int> completed(0);
+        std::atomic<bool> ordered(true);
+
+        ipl::JobGraph jobGraph;
+        auto previous = -1;
+        for (auto level = 0; level < kNumLevels; ++level)
+        {
+            auto expected = level * (kWidth + 1);
+
+            auto fanOut = jobGraph.addJob([&, expected](int threadId, std::atomic<bool>& cancel)
+            {
+                if (completed != expected)
+                    ordered = false;
+
+                completed++;
+            });
+
+            if (previous >= 0)
+            {
+                jobGraph.addDependency(fanOut, previous);
+            }
+
+            auto fanIn = -1;
+            int middle[kWidth];
+            for (auto i = 0; i < kWidth; ++i)
+            {
+                middle[i] = jobGraph.addJob([&, expected](int threadId, std::atomic<bool>& cancel)
+                {
+                    if (completed < expected + 1)
+                        ordered = false;
+
+                    completed++;
+                });
+
+                jobGraph.addDependency(middle[i], fanOut);
+            }
+
+            fanIn = jobGraph.addJob([&, expected](int threadId, std::atomic<bool>& cancel)
+            {
+                if (completed != expected + kWidth + 1)
+                    ordered = false;
+            });
+
+            for (auto i = 0; i < kWidth; ++i)
+            {
+                jobGraph.addDependency(fanIn, middle[i]);
+            }
+
+            previous = fanIn;
+        }
+
+        scheduler.submit(jobGraph);
+        scheduler.wait(jobGraph);
+
+        REQUIRE(ordered);
+        REQUIRE(completed == kNumLevels * (kWidth + 1));
+    }
+
+    SECTION("Multiple job graphs can be in flight at once")
+    {
+        std::atomic<int> sum(0);
+
+        ipl::JobGraph jobGraphs[3];
+        for (auto i = 0; i < 3; ++i)
+        {
+            for (auto j = 0; j < 100; ++j)
+            {
+                jobGraphs[i].addJob([&sum, i](int threadId, std::atomic<bool>& cancel)
+                {
+                    sum += i + 1;
+                });
+            }
+        }
+
+        for (auto i = 0; i < 3; ++i)
+        {
+            scheduler.submit(jobGraphs[i]);
+        }
+
+        for (auto i = 0; i < 3; ++i)
+        {
+            scheduler.wait(jobGraphs[i]);
+        }
+
+        REQUIRE(sum == 600);
+    }
+
+    SECTION("Cancelled jobs are skipped")
+    {
+        std::atomic<int> count(0);
+
+        ipl::JobGraph jobGraph;
+        for (auto i = 0; i < 100; ++i)
+        {
+            jobGraph.addJob([&count](int threadId, std::atomic<bool>& cancel)
+            {
+                count++;
+            });
+        }
+
+        jobGraph.cancel();
+        scheduler.submit(jobGraph);
+        scheduler.wait(jobGraph);
+
+        REQUIRE(jobGraph.isComplete());
+        REQUIRE(count == 0);
+    }
+}
+
+TEST_CASE("ThreadPool processes job graphs to completion", "[ThreadPool]")
+{
+    ipl::ThreadPool threadPool(2);
+    ipl::JobGraph jobGraph;
+
+    for (auto iteration = 0; iteration < 10; ++iteration)
+    {
+        std::atomic<int> count(0);
+
+        jobGraph.reset();
+        for (auto i = 0; i < 50; ++i)
+        {
+            jobGraph.addJob([&count](int threadId, std::atomic<bool>& cancel)
+            {
+                count++;
+            });
+        }
+
+        threadPool.process(jobGraph);
+
+        REQUIRE(count == 50);
+    }
+}
@@ -0,0 +1,433 @@
+//
+// Copyright 2017-2023 Valve Corporation.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <random>
+#include <set>
+
+#include <catch.hpp>
+
+#include <path_data.h>
+#include <scene.h>
+
+// A wall that paths between probes on either side of it have to go around.
+ipl::shared_ptr<ipl::Scene> createWallScene()
+{
+    ipl::Vector3f vertices[] = {
+        ipl::Vector3f(3.5f, -10.0f, -1.0f),
+        ipl::Vector3f(3.5f, 10.0f, -1.0f),
+        ipl::Vector3f(3.5f, 10.0f, 5.5f),
+        ipl::Vector3f(3.5f, -10.0f, 5.5f)
+    };
+
+    ipl::Triangle triangles[] = {
+        ipl::Triangle{ { 0, 1, 2 } },
+        ipl::Triangle{ { 0, 2, 3 } }
+    };
+
+    int materialIndices[] = { 0, 0 };
+    ipl::Material material{};
+
+    auto scene = ipl::make_shared<ipl::Scene>();
+    auto staticMesh = scene->createStaticMesh(4, 2, 1, vertices, triangles, materialIndices, &material);
+    scene->addStaticMesh(staticMesh);
+    scene->commit();
+
+    return scene;
+}
+
+// A square grid of probes, spaced 1 unit apart, with some of them on either side of the wall.
+void createProbeGrid(int gridSize,
+                     ipl::ProbeBatch& probes)
+{
+    for (auto i = 0; i < gridSize; ++i)
+    {
+        for (auto j = 0; j < gridSize; ++j)
+        {
+            probes.addProbe(ipl::Sphere(ipl::Vector3f(static_cast<float>(i), 0.0f, static_cast<float>(j)), 1.5f));
+        }
+    }
+    probes.commit();
+}
+
+// Checks that looking up any pair of probes returns the same path from both sets of baked data.
+void requireSameLookups(const ipl::BakedPathData& lhs,
+                        const ipl::BakedPathData& rhs,
+                        const ipl::ProbeBatch& probes)
+{
+    REQUIRE(lhs.numValidPaths() == rhs.numValidPaths());
+    REQUIRE(lhs.numUniquePaths() == rhs.numUniquePaths());
+
+    for (auto i = 0; i < probes.numProbes(); ++i)
+    {
+        for (auto j = 0; j < probes.numProbes(); ++j)
+        {
+            auto lhsPath = lhs.lookupShortestPath(i, j, nullptr);
+            auto rhsPath = rhs.lookupShortestPath(i, j, nullptr);
+
+            REQUIRE(lhsPath.isValid() == rhsPath.isValid());
+            REQUIRE(lhsPath.direct == rhsPath.direct);
+            REQUIRE(lhsPath.firstProbe == rhsPath.firstProbe);
+            REQUIRE(lhsPath.lastProbe == rhsPath.lastProbe);
+            REQUIRE(lhsPath.probeAfterFirst == rhsPath.probeAfterFirst);
+            REQUIRE(lhsPath.probeBeforeLast == rhsPath.probeBeforeLast);
+            REQUIRE(lhsPath.distanceInternal == rhsPath.distanceInternal);
+            REQUIRE(lhsPath.deviationInternal == rhsPath.deviationInternal);
+        }
+    }
+}
+
+TEST_CASE("BakedPathData only stores valid paths, and matches path finding.", "[BakedPathData]")
+{
+    const auto kGridSize = 8;
+    const auto kPathRange = 6.0f;
+
+    auto scene = createWallScene();
+
+    ipl::ProbeBatch probes;
+    createProbeGrid(kGridSize, probes);
+
+    auto numProbes = probes.numProbes();
+
+    ipl::ThreadPool threadPool(2);
+    std::atomic<bool> cancel(false);
+    ipl::BakedPathData bakedPathData(*scene, probes, 1, 0.0f, 0.99f, INFINITY, INFINITY, kPathRange, true,
+                                     -ipl::Vector3f::kYAxis, false, 2, threadPool, cancel);
+
+    ipl::PathFinder pathFinder(probes, 1);
+    std::vector<ipl::ProbePath> paths(numProbes);
+
+    auto numValidPaths = 0;
+    auto numIndirectPaths = 0;
+
+    for (auto i = 0; i < numProbes; ++i)
+    {
+        for (auto& path : paths)
+        {
+            path.reset();
+        }
+
+        pathFinder.findAllShortestPaths(*scene, probes, bakedPathData.visGraph(), i, 0.0f, 0.99f, kPathRange, 0,
+                                        paths.data());
+
+        // Only paths to probes with lower or equal indices are stored, the rest are looked up in reverse.
+        for (auto j = 0; j <= i; ++j)
+        {
+            ipl::ProbePath probePath;
+            auto soundPath = bakedPathData.lookupShortestPath(i, j, &probePath);
+            auto reverseSoundPath = bakedPathData.lookupShortestPath(j, i, nullptr);
+
+            REQUIRE(soundPath.isValid() == paths[j].valid);
+            REQUIRE(reverseSoundPath.isValid() == paths[j].valid);
+            REQUIRE(probePath.valid == paths[j].valid);
+
+            if (!paths[j].valid)
+                continue;
+
+            auto distance = ipl::SoundPath(paths[j], probes).distance(probes, i, j);
+            REQUIRE(soundPath.distance(probes, i, j) == Approx(distance));
+            REQUIRE(reverseSoundPath.distance(probes, j, i) == Approx(distance));
+
+            ++numValidPaths;
+
+            if (!soundPath.direct)
+            {
+                ++numIndirectPaths;
+            }
+        }
+    }
+
+    REQUIRE(numIndirectPaths > 0);
+    REQUIRE(bakedPathData.numValidPaths() == numValidPaths);
+    REQUIRE(bakedPathData.numValidPaths() < numProbes * (numProbes + 1) / 2);
+    REQUIRE(bakedPathData.numUniquePaths() <= numValidPaths + 1);
+}
+
+TEST_CASE("PathFinder::findShortestPath finds connected paths exactly when baked paths exist.", "[BakedPathData]")
+{
+    const auto kGridSize = 8;
+
+    auto scene = createWallScene();
+
+    ipl::ProbeBatch probes;
+    createProbeGrid(kGridSize, probes);
+
+    auto numProbes = probes.numProbes();
+
+    ipl::ProbeVisibilityTester visTester(1, false, -ipl::Vector3f::kYAxis);
+    std::atomic<bool> cancel(false);
+    ipl::ProbeVisibilityGraph visGraph(*scene, probes, visTester, 0.0f, 0.99f, 2.0f, 1, cancel);
+
+    ipl::PathFinder pathFinder(probes, 1);
+    std::vector<ipl::ProbePath> paths(numProbes);
+
+    for (auto i = 0; i < numProbes; ++i)
+    {
+        pathFinder.findAllShortestPaths(*scene, probes, visGraph, i, 0.0f, 0.99f, INFINITY, 0, paths.data());
+
+        for (auto j = 0; j < numProbes; ++j)
+        {
+            auto path = pathFinder.findShortestPath(*scene, probes, visGraph, visTester, i, j, 0.0f, 0.99f, 2.0f,
+                                                    INFINITY, false, false);
+
+            REQUIRE(path.valid == paths[j].valid);
+
+            if (!path.valid)
+                continue;
+
+            // The path starts at the start probe, and every consecutive pair of probes is connected.
+            REQUIRE(path.nodes.size() > 0);
+            REQUIRE(path.nodes.front() == i);
+
+            for (auto k = 0u; k + 1 < path.nodes.size(); ++k)
+            {
+                REQUIRE(visGraph.hasEdge(path.nodes[k], path.nodes[k + 1]));
+            }
+
+            REQUIRE(visGraph.hasEdge(path.nodes.back(), j));
+
+            // The path is as short as the one found by Dijkstra's algorithm over the whole graph.
+            auto distance = ipl::SoundPath(path, probes).distance(probes, i, j);
+            auto shortestDistance = ipl::SoundPath(paths[j], probes).distance(probes, i, j);
+            REQUIRE(distance == Approx(shortestDistance));
+        }
+    }
+}
+
+TEST_CASE("Path finding only uses probes within the path range of both ends of the path.", "[BakedPathData]")
+{
+    const auto kPathRange = 4.2f;
+
+    // The shortest path from the start probe (0) to the end probe (1) goes through probe 2, which is out of range of
+    // both. A longer path, which zigzags through probes 3, 4, 5, and 6, stays within range.
+    ipl::Vector3f positions[] = {
+        ipl::Vector3f(0.0f, 0.0f, 0.0f),
+        ipl::Vector3f(4.0f, 0.0f, 0.0f),
+        ipl::Vector3f(2.0f, 0.0f, 4.0f),
+        ipl::Vector3f(1.0f, 0.0f, 2.0f),
+        ipl::Vector3f(1.0f, 0.0f, -2.0f),
+        ipl::Vector3f(3.0f, 0.0f, 2.0f),
+        ipl::Vector3f(3.0f, 0.0f, -2.0f)
+    };
+
+    std::pair<int, int> edges[] = { {0, 2}, {2, 1}, {0, 3}, {3, 4}, {4, 5}, {5, 6}, {6, 1} };
+
+    auto scene = createWallScene();
+
+    ipl::ProbeBatch probes;
+    for (const auto& position : positions)
+    {
+        probes.addProbe(ipl::Sphere(position, 1.0f));
+    }
+    probes.commit();
+
+    // No probes are close enough to be connected automatically, so the graph only contains the edges above.
+    ipl::ProbeVisibilityTester visTester(1, false, -ipl::Vector3f::kYAxis);
+    std::atomic<bool> cancel(false);
+    ipl::ProbeVisibilityGraph visGraph(*scene, probes, visTester, 0.0f, 0.99f, 0.0f, 1, cancel);
+
+    for (const auto& edge : edges)
+    {
+        visGraph.mAdjacent[edge.first].push_back(edge.second);
+        visGraph.mAdjacent[edge.second].push_back(edge.first);
+    }
+
+    ipl::PathFinder pathFinder(probes, 1);
+    std::vector<ipl::ProbePath> paths(probes.numProbes());
+
+    const ipl::vector<int> kShortestNodes = { 2 };
+    const ipl::vector<int> kInRangeNodes = { 3, 4, 5, 6 };
+
+    // Without a path range, the shortest path is found.
+    pathFinder.findAllShortestPaths(*scene, probes, visGraph, 0, 0.0f, 0.99f, INFINITY, 0, paths.data());
+    REQUIRE(paths[1].valid);
+    REQUIRE(paths[1].nodes == kShortestNodes);
+
+    auto path = pathFinder.findShortestPath(*scene, probes, visGraph, visTester, 0, 1, 0.0f, 0.99f, 0.0f, INFINITY,
+                                            false, false);
+    REQUIRE(path.valid);
+    REQUIRE(path.nodes == ipl::vector<int>{ 0, 2 });
+
+    // With a path range, baking used to find the same shortest path, and then discard it because probe 2 is out of
+    // range. Now, the shortest path that stays within range is kept instead.
+    pathFinder.findAllShortestPaths(*scene, probes, visGraph, 0, 0.0f, 0.99f, kPathRange, 0, paths.data());
+    REQUIRE(paths[1].valid);
+    REQUIRE(paths[1].nodes == kInRangeNodes);
+    REQUIRE(!paths[2].valid);
+
+    path = pathFinder.findShortestPath(*scene, probes, visGraph, visTester, 0, 1, 0.0f, 0.99f, 0.0f, kPathRange,
+                                       false, false);
+    REQUIRE(path.valid);
+    REQUIRE(path.nodes == ipl::vector<int>{ 0, 3, 4, 5, 6 });
+
+    // If the end probe itself is out of range, there is no path.
+    path = pathFinder.findShortestPath(*scene, probes, visGraph, visTester, 0, 2, 0.0f, 0.99f, 0.0f, kPathRange,
+                                       false, false);
+    REQUIRE(!path.valid);
+}
+
+TEST_CASE("RadixHeap pops nodes in order of increasing cost.", "[BakedPathData]")
+{
+    const auto kNumNodes = 1000;
+
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> distribution(0.0f, 10.0f);
+
+    ipl::RadixHeap heap;
+
+    // Run the heap twice, to check that it can be reused after being cleared.
+    for (auto run = 0; run < 2; ++run)
+    {
+        heap.clear();
+        REQUIRE(heap.empty());
+
+        // As in Dijkstra's algorithm, every cost pushed is at least the cost most recently popped.
+        std::vector<float> costs(kNumNodes);
+        std::multiset<float> pendingCosts;
+        auto lastCost = 0.0f;
+
+        auto popAndCheck = [&]()
+        {
+            auto entry = heap.top();
+            heap.pop();
+
+            REQUIRE(entry.cost == costs[entry.nodeIndex]);
+            REQUIRE(entry.cost == *pendingCosts.begin());
+
+            pendingCosts.erase(pendingCosts.begin());
+            lastCost = entry.cost;
+        };
+
+        for (auto i = 0; i < kNumNodes; ++i)
+        {
+            // Some nodes have the same cost as the most recently popped node.
+            costs[i] = (i % 5 == 0) ? lastCost : lastCost + distribution(rng);
+            heap.push(i, costs[i]);
+            pendingCosts.insert(costs[i]);
+
+            // Pop every other node, so pushes and pops are interleaved.
+            if (i % 2 == 1)
+            {
+                popAndCheck();
+            }
+        }
+
+        REQUIRE(heap.size() == kNumNodes / 2);
+
+        while (!heap.empty())
+        {
+            popAndCheck();
+        }
+
+        REQUIRE(pendingCosts.empty());
+    }
+}
+
+TEST_CASE("BakedPathData can be serialized and loaded back.", "[BakedPathData]")
+{
+    const auto kGridSize = 8;
+    const auto kPathRange = 6.0f;
+
+    auto scene = createWallScene();
+
+    ipl::ProbeBatch probes;
+    createProbeGrid(kGridSize, probes);
+
+    auto numProbes = probes.numProbes();
+
+    ipl::ThreadPool threadPool(2);
+    std::atomic<bool> cancel(false);
+    ipl::BakedPathData bakedPathData(*scene, probes, 1, 0.0f, 0.99f, INFINITY, INFINITY, kPathRange, true,
+                                     -ipl::Vector3f::kYAxis, false, 2, threadPool, cancel);
+
+    ipl::SerializedObject serializedObject;
+    serializedObject.fbb().Finish(bakedPathData.serialize(serializedObject));
+    serializedObject.commit();
+
+    auto serializedData = flatbuffers::GetRoot<ipl::Serialized::BakedPathingData>(serializedObject.data());
+
+    SECTION("Sparse data round-trips without changing any lookups.")
+    {
+        REQUIRE(serializedData->format() == ipl::Serialized::BakedPathingDataFormat::SPARSE);
+        REQUIRE(serializedData->path_indices() == nullptr);
+        REQUIRE(serializedData->path_offsets()->Length() == static_cast<uint32_t>(numProbes + 1));
+        REQUIRE(serializedData->path_end_deltas()->Length() == static_cast<uint32_t>(bakedPathData.numValidPaths()));
+
+        ipl::BakedPathData loadedBakedPathData(serializedData);
+
+        requireSameLookups(bakedPathData, loadedBakedPathData, probes);
+        REQUIRE(loadedBakedPathData.pathRange() == kPathRange);
+    }
+
+    SECTION("Dense data written by older versions loads with the same lookups.")
+    {
+        // Older versions store, for each valid path, its index into a (# probes)x(# probes) table, instead of
+        // offsets and end deltas.
+        std::vector<int32_t> pathIndices;
+        for (auto i = 0; i < numProbes; ++i)
+        {
+            auto end = 0;
+            for (auto j = serializedData->path_offsets()->Get(i); j < serializedData->path_offsets()->Get(i + 1); ++j)
+            {
+                end += serializedData->path_end_deltas()->Get(j);
+                pathIndices.push_back(i * numProbes + end);
+            }
+        }
+
+        REQUIRE(pathIndices.size() == static_cast<size_t>(bakedPathData.numValidPaths()));
+
+        ipl::SerializedObject denseSerializedObject;
+        auto& fbb = denseSerializedObject.fbb();
+
+        auto visGraphOffset = bakedPathData.visGraph().serialize(denseSerializedObject);
+
+        std::vector<flatbuffers::Offset<ipl::Serialized::SoundPath>> soundPathOffsets;
+        for (auto i = 0u; i < serializedData->unique_paths()->Length(); ++i)
+        {
+            auto soundPath = serializedData->unique_paths()->Get(i);
+            soundPathOffsets.push_back(ipl::Serialized::CreateSoundPath(fbb, soundPath->first_probe(),
+                                                                        soundPath->last_probe(),
+                                                                        soundPath->probe_after_first(),
+                                                                        soundPath->probe_before_last(),
+                                                                        soundPath->direct(),
+                                                                        soundPath->distance_internal(),
+                                                                        soundPath->deviation_internal()));
+        }
+
+        std::vector<int32_t> paths(serializedData->paths()->begin(), serializedData->paths()->end());
+
+        auto soundPathsOffset = fbb.CreateVector(soundPathOffsets.data(), soundPathOffsets.size());
+        auto pathIndicesOffset = fbb.CreateVector(pathIndices.data(), pathIndices.size());
+        auto pathsOffset = fbb.CreateVector(paths.data(), paths.size());
+
+        ipl::Serialized::BakedPathingDataBuilder builder(fbb);
+        builder.add_vis_graph(visGraphOffset);
+        builder.add_unique_paths(soundPathsOffset);
+        builder.add_path_indices(pathIndicesOffset);
+        builder.add_paths(pathsOffset);
+        fbb.Finish(builder.Finish());
+        denseSerializedObject.commit();
+
+        auto denseSerializedData = flatbuffers::GetRoot<ipl::Serialized::BakedPathingData>(denseSerializedObject.data());
+        REQUIRE(denseSerializedData->format() == ipl::Serialized::BakedPathingDataFormat::DENSE);
+
+        ipl::BakedPathData loadedBakedPathData(denseSerializedData);
+
+        requireSameLookups(bakedPathData, loadedBakedPathData, probes);
+
+        // Older versions don't record the path range, so paths found at run-time are not bounded by it.
+        REQUIRE(std::isinf(loadedBakedPathData.pathRange()));
+    }
+}
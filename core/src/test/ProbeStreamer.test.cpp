@@ -0,0 +1,178 @@
+//
+// Copyright 2017-2023 Valve Corporation.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <catch.hpp>
+
+#include <baked_reflection_data.h>
+#include <probe_manager.h>
+
+// A row of probes along the x axis, whose baked reverb time is the index of the probe.
+ipl::shared_ptr<ipl::ProbeBatch> createRowOfProbes(const ipl::BakedDataIdentifier& identifier,
+                                                   int numProbes,
+                                                   float probeSpacing)
+{
+    auto probeBatch = ipl::make_shared<ipl::ProbeBatch>();
+    for (auto i = 0; i < numProbes; ++i)
+    {
+        probeBatch->addProbe(ipl::Sphere(ipl::Vector3f(i * probeSpacing, 0.0f, 0.0f), 1.5f));
+    }
+    probeBatch->commit();
+
+    auto bakedData = ipl::make_unique<ipl::BakedReflectionsData>(identifier, numProbes, true, true);
+    for (auto i = 0; i < numProbes; ++i)
+    {
+        auto energyField = ipl::make_unique<ipl::EnergyField>(0.1f, 0);
+        energyField->reset();
+        bakedData->set(i, std::move(energyField));
+
+        ipl::Reverb reverb{};
+        reverb.reverbTimes[0] = static_cast<float>(i);
+        bakedData->set(i, reverb);
+    }
+    probeBatch->addData(identifier, std::move(bakedData));
+
+    return probeBatch;
+}
+
+TEST_CASE("ProbeStreamer streams tiles of probe batches within a memory budget.", "[ProbeStreamer]")
+{
+    const auto kNumProbes = 50;
+    const auto kProbeSpacing = 2.0f;
+    const auto kTileSize = 10.0f;
+
+    ipl::BakedDataIdentifier identifier{};
+    identifier.type = ipl::BakedDataType::Reflections;
+    identifier.variation = ipl::BakedDataVariation::Reverb;
+
+    // A row of probes along the x axis, with tiles containing 5 probes each.
+    auto probeBatch = createRowOfProbes(identifier, kNumProbes, kProbeSpacing);
+
+    ipl::ProbeManager probeManager;
+    auto& streamer = probeManager.streamer();
+    streamer.setSettings(ipl::ProbeStreamingSettings{std::numeric_limits<uint64_t>::max(), 3.0f});
+
+    probeManager.addStreamedProbeBatch(probeBatch, kTileSize);
+    probeManager.commit();
+
+    REQUIRE(streamer.stats().numTiles == kNumProbes * kProbeSpacing / kTileSize);
+
+    auto updateUntilResident = [&](const ipl::Vector3f& point)
+    {
+        probeManager.updateStreaming(1, &point);
+        streamer.waitUntilIdle();
+        probeManager.updateStreaming(1, &point);
+    };
+
+    auto lookupReverbTime = [&](const ipl::Vector3f& point)
+    {
+        ipl::ProbeNeighborhood neighborhood;
+        probeManager.getInfluencingProbes(point, neighborhood);
+        neighborhood.calcWeights(point);
+
+        auto reverbTime = 0.0f;
+        for (auto i = 0; i < neighborhood.numProbes(); ++i)
+        {
+            if (!neighborhood.batches[i] || neighborhood.probeIndices[i] < 0)
+                continue;
+
+            auto& data = static_cast<ipl::BakedReflectionsData&>((*neighborhood.batches[i])[identifier]);
+            reverbTime += neighborhood.weights[i] * data.lookupReverb(neighborhood.probeIndices[i])->reverbTimes[0];
+        }
+
+        return reverbTime;
+    };
+
+    const auto kPoint = ipl::Vector3f(4.0f, 0.0f, 0.0f);
+
+    // Nothing is resident until a tile has been requested and loaded.
+    ipl::ProbeNeighborhood neighborhood;
+    probeManager.getInfluencingProbes(kPoint, neighborhood);
+    REQUIRE(!neighborhood.hasValidProbes());
+
+    probeManager.updateStreaming(1, &kPoint);
+    REQUIRE(streamer.isLoading(kPoint));
+
+    streamer.waitUntilIdle();
+    probeManager.updateStreaming(1, &kPoint);
+
+    REQUIRE(!streamer.isLoading(kPoint));
+    REQUIRE(streamer.stats().numResidentTiles == 1);
+    REQUIRE(streamer.stats().numLoads == 1);
+    REQUIRE(streamer.residentProbeBatches()[0]->numProbes() == 5);
+    REQUIRE(lookupReverbTime(kPoint) == Approx(2.0f));
+
+    // With a budget of a single tile, moving away evicts the tile that is no longer needed.
+    auto tileSize = streamer.stats().residentBytes;
+    REQUIRE(tileSize > 0);
+
+    streamer.setSettings(ipl::ProbeStreamingSettings{tileSize, 3.0f});
+
+    const auto kFarPoint = ipl::Vector3f(54.0f, 0.0f, 0.0f);
+    updateUntilResident(kFarPoint);
+
+    REQUIRE(streamer.stats().numResidentTiles == 1);
+    REQUIRE(streamer.stats().numLoads == 2);
+    REQUIRE(streamer.stats().numEvictions == 1);
+    REQUIRE(streamer.stats().residentBytes <= tileSize);
+    REQUIRE(lookupReverbTime(kFarPoint) == Approx(27.0f));
+
+    probeManager.getInfluencingProbes(kPoint, neighborhood);
+    REQUIRE(!neighborhood.hasValidProbes());
+
+    probeManager.removeProbeBatch(probeBatch);
+    probeManager.commit();
+
+    REQUIRE(streamer.stats().numTiles == 0);
+    REQUIRE(streamer.stats().residentBytes == 0);
+    REQUIRE(streamer.residentProbeBatches().empty());
+}
+
+TEST_CASE("ProbeStreamer respects the memory budget before any tile has been loaded.", "[ProbeStreamer]")
+{
+    const auto kNumProbes = 50;
+    const auto kProbeSpacing = 2.0f;
+    const auto kTileSize = 10.0f;
+
+    ipl::BakedDataIdentifier identifier{};
+    identifier.type = ipl::BakedDataType::Reflections;
+    identifier.variation = ipl::BakedDataVariation::Reverb;
+
+    auto probeBatch = createRowOfProbes(identifier, kNumProbes, kProbeSpacing);
+
+    // Every tile has 5 probes with the same amount of baked data, so this budget fits only one and a half tiles.
+    auto bytesPerTile = (*probeBatch)[identifier].serializedSize() * 5 / kNumProbes;
+
+    ipl::ProbeManager probeManager;
+    auto& streamer = probeManager.streamer();
+    streamer.setSettings(ipl::ProbeStreamingSettings{bytesPerTile + bytesPerTile / 2, 25.0f});
+
+    probeManager.addStreamedProbeBatch(probeBatch, kTileSize);
+    probeManager.commit();
+
+    // The prefetch radius covers three tiles, but only the nearest one fits in the budget.
+    const auto kPoint = ipl::Vector3f(4.0f, 0.0f, 0.0f);
+    probeManager.updateStreaming(1, &kPoint);
+
+    REQUIRE(streamer.stats().numLoadingTiles == 1);
+
+    streamer.waitUntilIdle();
+    probeManager.updateStreaming(1, &kPoint);
+    streamer.waitUntilIdle();
+    probeManager.updateStreaming(1, &kPoint);
+
+    REQUIRE(streamer.stats().numLoads == 1);
+    REQUIRE(streamer.stats().numResidentTiles == 1);
+}
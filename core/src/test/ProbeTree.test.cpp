@@ -19,6 +19,7 @@
 #include <random>
 
 #include <probe_manager.h>
+#include <scene.h>
 using namespace ipl;
 
 TEST_CASE("Weight function sums to 1", "[Probe]")
@@ -65,7 +66,7 @@ TEST_CASE("ProbeTree::getSamplesThatInfluence returns correct number of probes",
         probeIndices[i] = -1;
     }
 
-    tree.getInfluencingProbes(Vector3f(-7, -7, -7), probes.data(), static_cast<int>(probes.size()), probeIndices.data());
+    tree.getInfluencingProbes(Vector3f(-7, -7, -7), static_cast<int>(probes.size()), probeIndices.data());
 
     auto numValidProbes = 0;
     for (auto i = 0u; i < probes.size(); ++i)
@@ -78,3 +79,203 @@ TEST_CASE("ProbeTree::getSamplesThatInfluence returns correct number of probes",
 
     REQUIRE(numValidProbes == 2);
 }
+
+TEST_CASE("Batched probe neighborhood queries match single-point queries", "[ProbeTree]")
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(0.0f, 20.0f);
+    std::uniform_real_distribution<float> height(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> offset(-0.5f, 0.5f);
+
+    // A single layer of probes, spaced so no point is influenced by more than kMaxProbesPerBatch probes.
+    auto probeBatch = make_shared<ProbeBatch>();
+    for (auto i = 0; i < 10; ++i)
+    {
+        for (auto j = 0; j < 10; ++j)
+        {
+            probeBatch->addProbe(Sphere(Vector3f(2.0f * i, 2.0f * j, 0.0f), 2.2f));
+        }
+    }
+    probeBatch->commit();
+
+    ProbeManager probeManager;
+    probeManager.addProbeBatch(probeBatch);
+    probeManager.commit();
+
+    const auto kNumTriangles = 200;
+    vector<Vector3f> vertices;
+    vector<Triangle> triangles;
+    vector<int> materialIndices(kNumTriangles, 0);
+    Material material{};
+
+    for (auto i = 0; i < kNumTriangles; ++i)
+    {
+        Vector3f center(position(rng), position(rng), height(rng));
+        for (auto j = 0; j < 3; ++j)
+        {
+            vertices.push_back(center + Vector3f(offset(rng), offset(rng), offset(rng)));
+        }
+
+        triangles.push_back(Triangle{ { 3 * i, 3 * i + 1, 3 * i + 2 } });
+    }
+
+    Scene scene;
+    auto staticMesh = scene.createStaticMesh(static_cast<int>(vertices.size()), kNumTriangles, 1, vertices.data(),
+                                             triangles.data(), materialIndices.data(), &material);
+    scene.addStaticMesh(staticMesh);
+    scene.commit();
+
+    // More points than fit in one packet, so several packets are traversed.
+    const auto kNumPoints = 100;
+    vector<Vector3f> points(kNumPoints);
+    for (auto i = 0; i < kNumPoints; ++i)
+    {
+        points[i] = Vector3f(position(rng), position(rng), height(rng));
+    }
+
+    ProbeNeighborhoodBatch neighborhoods;
+    probeManager.getInfluencingProbes(kNumPoints, points.data(), neighborhoods);
+    neighborhoods.checkOcclusion(scene, points.data());
+    neighborhoods.calcWeights(points.data());
+
+    REQUIRE(neighborhoods.numNeighborhoods() == kNumPoints);
+
+    for (auto i = 0; i < kNumPoints; ++i)
+    {
+        ProbeNeighborhood neighborhood;
+        probeManager.getInfluencingProbes(points[i], neighborhood);
+        neighborhood.checkOcclusion(scene, points[i]);
+        neighborhood.calcWeights(points[i]);
+
+        // Probes may be found in a different order, so compare weights by probe index.
+        map<int, float> expectedWeights;
+        for (auto j = 0; j < neighborhood.numProbes(); ++j)
+        {
+            if (neighborhood.batches[j] && neighborhood.probeIndices[j] >= 0)
+            {
+                expectedWeights[neighborhood.probeIndices[j]] = neighborhood.weights[j];
+            }
+        }
+
+        REQUIRE(expectedWeights.size() < ProbeNeighborhood::kMaxProbesPerBatch);
+
+        map<int, float> weights;
+        const auto& batchedNeighborhood = neighborhoods[i];
+        for (auto j = 0; j < batchedNeighborhood.numProbes(); ++j)
+        {
+            if (batchedNeighborhood.batches[j] && batchedNeighborhood.probeIndices[j] >= 0)
+            {
+                weights[batchedNeighborhood.probeIndices[j]] = batchedNeighborhood.weights[j];
+            }
+        }
+
+        REQUIRE(weights.size() == expectedWeights.size());
+        for (const auto& weight : expectedWeights)
+        {
+            REQUIRE(weights.find(weight.first) != weights.end());
+            REQUIRE(weights[weight.first] == Approx(weight.second));
+        }
+    }
+}
+
+TEST_CASE("ProbeTree::kNearest finds the nearest probes in order", "[ProbeTree]")
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(0.0f, 50.0f);
+
+    vector<Probe> probes(500);
+    for (auto& probe : probes)
+    {
+        probe.influence = Sphere(Vector3f(position(rng), position(rng), position(rng)), 2.0f);
+    }
+
+    ProbeTree tree(static_cast<int>(probes.size()), probes.data());
+
+    const auto kNumNearest = 8;
+
+    for (auto i = 0; i < 50; ++i)
+    {
+        Vector3f point(position(rng), position(rng), position(rng));
+
+        vector<float> expectedDistances;
+        for (const auto& probe : probes)
+        {
+            expectedDistances.push_back((probe.influence.center - point).length());
+        }
+        std::sort(expectedDistances.begin(), expectedDistances.end());
+
+        int probeIndices[kNumNearest];
+        float distances[kNumNearest];
+        auto numFound = tree.kNearest(point, kNumNearest, probeIndices, distances);
+
+        REQUIRE(numFound == kNumNearest);
+        for (auto j = 0; j < kNumNearest; ++j)
+        {
+            REQUIRE(distances[j] == Approx(expectedDistances[j]));
+            REQUIRE((probes[probeIndices[j]].influence.center - point).length() == Approx(distances[j]));
+        }
+    }
+}
+
+TEST_CASE("ProbeTree incremental updates match a rebuilt tree", "[ProbeTree]")
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(0.0f, 20.0f);
+    std::uniform_real_distribution<float> radius(1.0f, 4.0f);
+
+    vector<Probe> probes(100);
+    for (auto& probe : probes)
+    {
+        probe.influence = Sphere(Vector3f(position(rng), position(rng), position(rng)), radius(rng));
+    }
+
+    ProbeTree tree(static_cast<int>(probes.size()), probes.data());
+
+    // Add, remove, and move probes in the same way a ProbeBatch would.
+    for (auto i = 0; i < 300; ++i)
+    {
+        auto operation = i % 3;
+        if (operation == 0)
+        {
+            Probe probe{ Sphere(Vector3f(position(rng), position(rng), position(rng)), radius(rng)) };
+            probes.push_back(probe);
+            tree.insertProbe(probe.influence);
+        }
+        else if (operation == 1)
+        {
+            auto index = static_cast<int>(rng() % probes.size());
+            probes.erase(probes.begin() + index);
+            tree.removeProbe(index);
+        }
+        else
+        {
+            auto index = static_cast<int>(rng() % probes.size());
+            probes[index].influence = Sphere(Vector3f(position(rng), position(rng), position(rng)), radius(rng));
+            tree.updateProbe(index, probes[index].influence);
+        }
+    }
+
+    REQUIRE(tree.numProbes() == static_cast<int>(probes.size()));
+
+    ProbeTree rebuiltTree(static_cast<int>(probes.size()), probes.data());
+
+    const auto kMaxInfluencingProbes = 64;
+
+    for (auto i = 0; i < 100; ++i)
+    {
+        Vector3f point(position(rng), position(rng), position(rng));
+
+        int probeIndices[kMaxInfluencingProbes];
+        int expectedProbeIndices[kMaxInfluencingProbes];
+        tree.getInfluencingProbes(point, kMaxInfluencingProbes, probeIndices);
+        rebuiltTree.getInfluencingProbes(point, kMaxInfluencingProbes, expectedProbeIndices);
+
+        std::sort(probeIndices, probeIndices + kMaxInfluencingProbes);
+        std::sort(expectedProbeIndices, expectedProbeIndices + kMaxInfluencingProbes);
+
+        for (auto j = 0; j < kMaxInfluencingProbes; ++j)
+        {
+            REQUIRE(probeIndices[j] == expectedProbeIndices[j]);
+        }
+    }
+}
@@ -14,10 +14,372 @@
 // limitations under the License.
 //
 
+#include <random>
+
 #include <catch.hpp>
 
+#include <reflection_simulator.h>
+#include <thread_pool.h>
+
+#include "test_scenes.h"
+
+namespace {
+
+const auto kNumSources = 8;
+const auto kNumRays = 1024;
+const auto kNumBounces = 4;
+const auto kDuration = 1.0f;
+const auto kOrder = 2;
+
+// Creates a scene containing randomly placed triangles, all with the same partially absorptive material.
+ipl::shared_ptr<ipl::Scene> createAbsorptiveScene(std::mt19937& rng,
+                                                  float scattering)
+{
+    ipl::Material material{};
+    material.absorption[0] = 0.1f;
+    material.absorption[1] = 0.2f;
+    material.absorption[2] = 0.3f;
+    material.scattering = scattering;
+
+    return createRandomScene(rng, material);
+}
+
+// Runs the reflection simulation, and returns the energy fields from the last run, for all sources and listeners.
+// Running more than once checks that no state leaks from one simulation into the next. If pathHistoryLength is
+// non-zero, paths are cached across runs. If shareListenerPaths is true, paths are shared between listeners.
+std::vector<ipl::unique_ptr<ipl::EnergyField>> simulate(const ipl::IScene& scene,
+                                                        const ipl::CoordinateSpace3f* sources,
+                                                        int numListeners,
+                                                        const ipl::CoordinateSpace3f* listeners,
+                                                        int numRuns,
+                                                        ipl::EnergyFieldReduction reduction,
+                                                        bool clusterSources,
+                                                        float maxClusteringError,
+                                                        int pathHistoryLength = 0,
+                                                        int numThreads = 1,
+                                                        bool shareListenerPaths = false)
+{
+    ipl::Directivity directivities[kNumSources];
+
+    auto numEnergyFields = numListeners * kNumSources;
+
+    std::vector<ipl::unique_ptr<ipl::EnergyField>> energyFields(numEnergyFields);
+    std::vector<ipl::EnergyField*> energyFieldPtrs(numEnergyFields);
+    for (auto i = 0; i < numEnergyFields; ++i)
+    {
+        energyFields[i] = ipl::make_unique<ipl::EnergyField>(kDuration, kOrder);
+        energyFieldPtrs[i] = energyFields[i].get();
+    }
+
+    ipl::ReflectionSimulator simulator(kNumRays, 64, kDuration, kOrder, kNumSources, numListeners, numThreads,
+                                       reduction);
+    simulator.setSourceClustering(clusterSources, maxClusteringError);
+    simulator.setPathCaching(pathHistoryLength > 0, pathHistoryLength);
+    simulator.setListenerPathSharing(shareListenerPaths);
+
+    ipl::ThreadPool threadPool(numThreads);
+
+    for (auto run = 0; run < numRuns; ++run)
+    {
+        ipl::JobGraph jobGraph;
+        simulator.simulate(scene, kNumSources, sources, numListeners, listeners, directivities, kNumRays, kNumBounces,
+                           kDuration, kOrder, 1.0f, energyFieldPtrs.data(), jobGraph);
+        threadPool.process(jobGraph);
+    }
+
+    return energyFields;
+}
+
+// Checks that the energy fields for all sources in lhs match those in rhs, starting at the given offset into rhs. Values
+// within the given margin of each other are also considered equal.
+void requireEqual(const std::vector<ipl::unique_ptr<ipl::EnergyField>>& lhs,
+                  const std::vector<ipl::unique_ptr<ipl::EnergyField>>& rhs,
+                  int rhsOffset = 0,
+                  float margin = 0.0f)
+{
+    for (auto i = 0; i < kNumSources; ++i)
+    {
+        for (auto channel = 0; channel < lhs[i]->numChannels(); ++channel)
+        {
+            for (auto band = 0; band < ipl::Bands::kNumBands; ++band)
+            {
+                for (auto bin = 0; bin < lhs[i]->numBins(); ++bin)
+                {
+                    REQUIRE((*rhs[rhsOffset + i])[channel][band][bin] == Approx((*lhs[i])[channel][band][bin]).margin(margin));
+                }
+            }
+        }
+    }
+}
+
+// Returns the total energy in each band received from all sources, averaged over several simulations with many rays.
+// The simulations are run at each of the given listener positions in turn, and only those at the last position are
+// averaged. If pathHistoryLength is non-zero, paths are cached across simulations. If rotateDiffuseSamples is true,
+// diffuse samples are randomly rotated.
+void simulateTotalEnergy(const ipl::Scene& scene,
+                         const ipl::CoordinateSpace3f* sources,
+                         int numListenerPositions,
+                         const ipl::CoordinateSpace3f* listenerPositions,
+                         bool russianRoulette,
+                         float survivalThreshold,
+                         int pathHistoryLength,
+                         bool rotateDiffuseSamples,
+                         float* totalEnergy)
+{
+    const auto kNumTotalEnergyRays = 16384;
+    const auto kNumTotalEnergyBounces = 32;
+    const auto kNumRuns = 4;
+
+    ipl::Directivity directivities[kNumSources];
+
+    std::vector<ipl::unique_ptr<ipl::EnergyField>> energyFields(kNumSources);
+    std::vector<ipl::EnergyField*> energyFieldPtrs(kNumSources);
+    for (auto i = 0; i < kNumSources; ++i)
+    {
+        energyFields[i] = ipl::make_unique<ipl::EnergyField>(kDuration, 0);
+        energyFieldPtrs[i] = energyFields[i].get();
+    }
+
+    ipl::ReflectionSimulator simulator(kNumTotalEnergyRays, 64, kDuration, 0, kNumSources, 1, 1);
+    simulator.setRussianRoulette(russianRoulette, survivalThreshold);
+    simulator.setDiffuseSampleRotation(rotateDiffuseSamples);
+    simulator.setPathCaching(pathHistoryLength > 0, pathHistoryLength);
+
+    ipl::ThreadPool threadPool(1);
+
+    for (auto band = 0; band < ipl::Bands::kNumBands; ++band)
+    {
+        totalEnergy[band] = 0.0f;
+    }
+
+    for (auto run = 0; run < numListenerPositions * kNumRuns; ++run)
+    {
+        const auto& listener = listenerPositions[run / kNumRuns];
+
+        ipl::JobGraph jobGraph;
+        simulator.simulate(scene, kNumSources, sources, 1, &listener, directivities, kNumTotalEnergyRays,
+                           kNumTotalEnergyBounces, kDuration, 0, 1.0f, energyFieldPtrs.data(), jobGraph);
+        threadPool.process(jobGraph);
+
+        if (run / kNumRuns < numListenerPositions - 1)
+            continue;
+
+        for (auto i = 0; i < kNumSources; ++i)
+        {
+            for (auto band = 0; band < ipl::Bands::kNumBands; ++band)
+            {
+                for (auto bin = 0; bin < energyFields[i]->numBins(); ++bin)
+                {
+                    totalEnergy[band] += (*energyFields[i])[0][band][bin] / kNumRuns;
+                }
+            }
+        }
+    }
+}
+
+}
+
 TEST_CASE("ReflectionSimulator", "[ReflectionSimulator]")
 {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(-5.0f, 5.0f);
+
+    auto scene = createAbsorptiveScene(rng, 0.5f);
+
+    // With purely specular reflections, no random numbers are used, so simulations can be compared exactly.
+    auto specularScene = createAbsorptiveScene(rng, 0.0f);
+
+    ipl::CoordinateSpace3f sources[kNumSources];
+    for (auto i = 0; i < kNumSources; ++i)
+    {
+        sources[i] = ipl::CoordinateSpace3f(ipl::Vector3f(position(rng), position(rng), position(rng)));
+    }
+
+    ipl::CoordinateSpace3f listeners[2] = {
+        ipl::CoordinateSpace3f(-ipl::Vector3f::kZAxis, ipl::Vector3f::kYAxis, ipl::Vector3f::kZero),
+        ipl::CoordinateSpace3f(-ipl::Vector3f::kZAxis, ipl::Vector3f::kYAxis, ipl::Vector3f(1.0f, 0.5f, -1.0f))
+    };
+
+    SECTION("Parallel energy field reduction matches serial reduction")
+    {
+        auto serial = simulate(*specularScene, sources, 1, listeners, 2, ipl::EnergyFieldReduction::Serial, false, 0.0f);
+        auto parallel = simulate(*specularScene, sources, 1, listeners, 2, ipl::EnergyFieldReduction::Parallel, false, 0.0f);
+
+        requireEqual(serial, parallel);
+    }
+
+    SECTION("Parallel energy field reduction with several threads matches serial reduction")
+    {
+        const auto kNumThreads = 4;
+
+        // Rays are split between threads differently from one run to the next, so energy is summed in a different
+        // order, and only matches up to rounding error.
+        auto serial = simulate(*specularScene, sources, 1, listeners, 2, ipl::EnergyFieldReduction::Serial, false, 0.0f);
+        auto serialThreaded = simulate(*specularScene, sources, 1, listeners, 2, ipl::EnergyFieldReduction::Serial, false, 0.0f, 0, kNumThreads);
+        auto parallelThreaded = simulate(*specularScene, sources, 1, listeners, 2, ipl::EnergyFieldReduction::Parallel, false, 0.0f, 0, kNumThreads);
+
+        requireEqual(serial, serialThreaded, 0, 1e-6f);
+        requireEqual(serial, parallelThreaded, 0, 1e-6f);
+    }
+
+    SECTION("Source clustering with zero error matches shading sources individually")
+    {
+        auto individual = simulate(*specularScene, sources, 1, listeners, 2, ipl::EnergyFieldReduction::Parallel, false, 0.0f);
+        auto clustered = simulate(*specularScene, sources, 1, listeners, 2, ipl::EnergyFieldReduction::Parallel, true, 0.0f);
+
+        requireEqual(individual, clustered);
+    }
+
+    SECTION("Source clustering with nonzero error stays close to shading sources individually, with fewer shadow rays")
+    {
+        const auto kMaxClusteringError = 0.1f;
+
+        OcclusionRayCountingScene countingScene(specularScene);
+
+        auto individual = simulate(countingScene, sources, 1, listeners, 1, ipl::EnergyFieldReduction::Parallel, false, 0.0f);
+        auto numIndividualShadowRays = countingScene.numOcclusionRays();
+
+        countingScene.resetNumOcclusionRays();
+
+        auto clustered = simulate(countingScene, sources, 1, listeners, 1, ipl::EnergyFieldReduction::Parallel, true, kMaxClusteringError);
+        auto numClusteredShadowRays = countingScene.numOcclusionRays();
+
+        REQUIRE(numClusteredShadowRays < numIndividualShadowRays);
+
+        // The error allowed at each hit point is relative to the energy received from all sources, so individual
+        // sources may be off by more than this, but the total energy should not be.
+        for (auto band = 0; band < ipl::Bands::kNumBands; ++band)
+        {
+            auto individualEnergy = 0.0f;
+            auto clusteredEnergy = 0.0f;
+
+            for (auto i = 0; i < kNumSources; ++i)
+            {
+                for (auto bin = 0; bin < individual[i]->numBins(); ++bin)
+                {
+                    individualEnergy += (*individual[i])[0][band][bin];
+                    clusteredEnergy += (*clustered[i])[0][band][bin];
+                }
+            }
+
+            REQUIRE(individualEnergy > 0.0f);
+            REQUIRE(clusteredEnergy == Approx(individualEnergy).epsilon(kMaxClusteringError));
+        }
+    }
+
+    SECTION("Multi-listener simulation matches separate simulations for each listener")
+    {
+        auto multi = simulate(*specularScene, sources, 2, listeners, 2, ipl::EnergyFieldReduction::Parallel, false, 0.0f);
+
+        for (auto i = 0; i < 2; ++i)
+        {
+            auto single = simulate(*specularScene, sources, 1, &listeners[i], 2, ipl::EnergyFieldReduction::Parallel, false, 0.0f);
+
+            requireEqual(single, multi, i * kNumSources);
+        }
+    }
+
+    SECTION("Sharing paths between nearby listeners stays close to separate simulations, with fewer shadow rays")
+    {
+        ipl::CoordinateSpace3f nearbyListeners[2] = {
+            listeners[0],
+            ipl::CoordinateSpace3f(-ipl::Vector3f::kZAxis, ipl::Vector3f::kYAxis, ipl::Vector3f(0.1f, 0.0f, 0.0f))
+        };
+
+        OcclusionRayCountingScene countingScene(specularScene);
+
+        auto separate = simulate(countingScene, sources, 2, nearbyListeners, 1, ipl::EnergyFieldReduction::Parallel, false, 0.0f);
+        auto numSeparateShadowRays = countingScene.numOcclusionRays();
+
+        countingScene.resetNumOcclusionRays();
+
+        auto shared = simulate(countingScene, sources, 2, nearbyListeners, 1, ipl::EnergyFieldReduction::Parallel, false, 0.0f, 0, 1, true);
+        auto numSharedShadowRays = countingScene.numOcclusionRays();
+
+        REQUIRE(numSharedShadowRays < numSeparateShadowRays);
+
+        // Paths are traced from the first listener, so its results are unchanged.
+        requireEqual(separate, shared);
+
+        // Reused paths only approximate the paths that the second listener would have traced itself.
+        for (auto band = 0; band < ipl::Bands::kNumBands; ++band)
+        {
+            auto separateEnergy = 0.0f;
+            auto sharedEnergy = 0.0f;
+
+            for (auto i = kNumSources; i < 2 * kNumSources; ++i)
+            {
+                for (auto bin = 0; bin < separate[i]->numBins(); ++bin)
+                {
+                    separateEnergy += (*separate[i])[0][band][bin];
+                    sharedEnergy += (*shared[i])[0][band][bin];
+                }
+            }
+
+            REQUIRE(separateEnergy > 0.0f);
+            REQUIRE(sharedEnergy == Approx(separateEnergy).epsilon(0.1));
+        }
+    }
+
+    SECTION("Russian roulette does not change the expected energy")
+    {
+        float fixedEnergy[ipl::Bands::kNumBands];
+        float russianRouletteEnergy[ipl::Bands::kNumBands];
+        simulateTotalEnergy(*scene, sources, 1, listeners, false, 0.0f, 0, false, fixedEnergy);
+        simulateTotalEnergy(*scene, sources, 1, listeners, true, 0.5f, 0, false, russianRouletteEnergy);
+
+        for (auto band = 0; band < ipl::Bands::kNumBands; ++band)
+        {
+            REQUIRE(fixedEnergy[band] > 0.0f);
+            REQUIRE(russianRouletteEnergy[band] == Approx(fixedEnergy[band]).epsilon(0.1));
+        }
+    }
+
+    SECTION("Rotating diffuse samples does not change the expected energy")
+    {
+        float fixedEnergy[ipl::Bands::kNumBands];
+        float rotatedEnergy[ipl::Bands::kNumBands];
+        simulateTotalEnergy(*scene, sources, 1, listeners, false, 0.0f, 0, false, fixedEnergy);
+        simulateTotalEnergy(*scene, sources, 1, listeners, false, 0.0f, 0, true, rotatedEnergy);
+
+        for (auto band = 0; band < ipl::Bands::kNumBands; ++band)
+        {
+            REQUIRE(fixedEnergy[band] > 0.0f);
+            REQUIRE(rotatedEnergy[band] == Approx(fixedEnergy[band]).epsilon(0.1));
+        }
+    }
+
+    SECTION("Path caching with static listeners matches simulation without caching")
+    {
+        auto cached = simulate(*specularScene, sources, 2, listeners, 3, ipl::EnergyFieldReduction::Parallel, false, 0.0f, 4);
+
+        // Each path is shaded once per history slot, so values that cancel out can differ by rounding error.
+        for (auto i = 0; i < 2; ++i)
+        {
+            auto uncached = simulate(*specularScene, sources, 1, &listeners[i], 3, ipl::EnergyFieldReduction::Parallel, false, 0.0f);
+
+            requireEqual(uncached, cached, i * kNumSources, 1e-6f);
+        }
+    }
+
+    SECTION("Path caching with a moving listener does not change the expected energy")
+    {
+        ipl::CoordinateSpace3f movingListener[2] = {
+            listeners[0],
+            ipl::CoordinateSpace3f(-ipl::Vector3f::kZAxis, ipl::Vector3f::kYAxis, ipl::Vector3f(0.1f, 0.0f, 0.0f))
+        };
+
+        float uncachedEnergy[ipl::Bands::kNumBands];
+        float cachedEnergy[ipl::Bands::kNumBands];
+        simulateTotalEnergy(*scene, sources, 1, &movingListener[1], false, 0.0f, 0, false, uncachedEnergy);
+        simulateTotalEnergy(*scene, sources, 2, movingListener, false, 0.0f, 4, false, cachedEnergy);
+
+        for (auto band = 0; band < ipl::Bands::kNumBands; ++band)
+        {
+            REQUIRE(uncachedEnergy[band] > 0.0f);
+            REQUIRE(cachedEnergy[band] == Approx(uncachedEnergy[band]).epsilon(0.1));
+        }
+    }
 }
 
 TEST_CASE("DecoupledReflectionSimulator", "[DecoupledReflectionSimulator]")
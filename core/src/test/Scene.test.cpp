@@ -14,6 +14,8 @@
 // limitations under the License.
 //
 
+#include <random>
+
 #include <catch.hpp>
 
 #include <scene.h>
@@ -24,4 +26,88 @@ TEST_CASE("IScene", "[IScene]")
 
 TEST_CASE("Scene", "[Scene]")
 {
+    SECTION("Batched queries match single-ray queries")
+    {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+        std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+
+        const auto kNumTriangles = 500;
+        std::vector<ipl::Vector3f> vertices;
+        std::vector<ipl::Triangle> triangles;
+        std::vector<int> materialIndices(kNumTriangles, 0);
+        ipl::Material material{};
+
+        for (auto i = 0; i < kNumTriangles; ++i)
+        {
+            ipl::Vector3f center(position(rng), position(rng), position(rng));
+            for (auto j = 0; j < 3; ++j)
+            {
+                vertices.push_back(center + ipl::Vector3f(offset(rng), offset(rng), offset(rng)));
+            }
+
+            triangles.push_back(ipl::Triangle{ { 3 * i, 3 * i + 1, 3 * i + 2 } });
+        }
+
+        auto scene = ipl::make_shared<ipl::Scene>();
+        auto staticMesh = scene->createStaticMesh(static_cast<int>(vertices.size()), kNumTriangles, 1, vertices.data(),
+                                                  triangles.data(), materialIndices.data(), &material);
+        scene->addStaticMesh(staticMesh);
+
+        auto subScene = ipl::make_shared<ipl::Scene>();
+        auto subStaticMesh = subScene->createStaticMesh(static_cast<int>(vertices.size()), kNumTriangles, 1,
+                                                        vertices.data(), triangles.data(), materialIndices.data(),
+                                                        &material);
+        subScene->addStaticMesh(subStaticMesh);
+        subScene->commit();
+
+        auto transform = ipl::Matrix4x4f::identityMatrix();
+        transform(0, 3) = 3.0f;
+        transform(1, 3) = -2.0f;
+        auto instancedMesh = scene->createInstancedMesh(subScene, transform);
+        scene->addInstancedMesh(instancedMesh);
+
+        scene->commit();
+
+        const auto kNumRays = 1000;
+        std::vector<ipl::Ray> rays(kNumRays);
+        std::vector<float> minDistances(kNumRays);
+        std::vector<float> maxDistances(kNumRays);
+
+        for (auto i = 0; i < kNumRays; ++i)
+        {
+            rays[i].origin = ipl::Vector3f(position(rng), position(rng), position(rng));
+            rays[i].direction = ipl::Vector3f::unitVector(ipl::Vector3f(offset(rng), offset(rng), offset(rng)));
+            minDistances[i] = 0.0f;
+            maxDistances[i] = (i % 3 == 0) ? std::numeric_limits<float>::infinity() : (i % 7 == 0) ? -1.0f : 5.0f;
+        }
+
+        std::vector<ipl::Hit> hits(kNumRays);
+        scene->closestHits(kNumRays, rays.data(), minDistances.data(), maxDistances.data(), hits.data());
+
+        std::vector<char> occluded(kNumRays);
+        scene->anyHits(kNumRays, rays.data(), minDistances.data(), maxDistances.data(), reinterpret_cast<bool*>(occluded.data()));
+
+        for (auto i = 0; i < kNumRays; ++i)
+        {
+            if (maxDistances[i] < 0.0f)
+            {
+                REQUIRE(occluded[i]);
+                continue;
+            }
+
+            auto hit = scene->closestHit(rays[i], minDistances[i], maxDistances[i]);
+            if (hit.distance < maxDistances[i])
+            {
+                REQUIRE(hits[i].distance == Approx(hit.distance).margin(1e-4f));
+                REQUIRE(hits[i].materialIndex == hit.materialIndex);
+            }
+            else
+            {
+                REQUIRE(hits[i].distance >= maxDistances[i]);
+            }
+
+            REQUIRE(static_cast<bool>(occluded[i]) == scene->anyHit(rays[i], minDistances[i], maxDistances[i]));
+        }
+    }
 }
@@ -0,0 +1,56 @@
+//
+// Copyright 2017-2023 Valve Corporation.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <stdio.h>
+
+#include <catch.hpp>
+
+#include <error.h>
+#include <serialized_object.h>
+
+TEST_CASE("SerializedObject can be backed by a memory-mapped file.", "[SerializedObject]")
+{
+    const auto kFileName = "serialized_object_test.bin";
+    const auto kSize = 4096 + 17;
+
+    std::vector<ipl::byte_t> contents(kSize);
+    for (auto i = 0; i < kSize; ++i)
+    {
+        contents[i] = static_cast<ipl::byte_t>((i * 31) & 0xff);
+    }
+
+    auto file = fopen(kFileName, "wb");
+    REQUIRE(file != nullptr);
+    fwrite(contents.data(), 1, contents.size(), file);
+    fclose(file);
+
+    {
+        auto mappedFile = ipl::make_shared<ipl::MappedFile>(kFileName);
+        ipl::SerializedObject serializedObject(mappedFile);
+
+        REQUIRE(serializedObject.mappedFile() == mappedFile);
+        REQUIRE(serializedObject.size() == contents.size());
+        REQUIRE(serializedObject.data() == mappedFile->data());
+        REQUIRE(memcmp(serializedObject.data(), contents.data(), contents.size()) == 0);
+    }
+
+    remove(kFileName);
+
+    REQUIRE_THROWS_AS(ipl::MappedFile(kFileName), ipl::Exception);
+
+    ipl::SerializedObject inMemorySerializedObject(contents.size(), contents.data());
+    REQUIRE(inMemorySerializedObject.mappedFile() == nullptr);
+}
@@ -0,0 +1,48 @@
+//
+// Copyright 2017-2023 Valve Corporation.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "test_scenes.h"
+
+ipl::shared_ptr<ipl::Scene> createRandomScene(std::mt19937& rng,
+                                              const ipl::Material& material)
+{
+    std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+    std::uniform_real_distribution<float> offset(-3.0f, 3.0f);
+
+    const auto kNumTriangles = 500;
+    std::vector<ipl::Vector3f> vertices;
+    std::vector<ipl::Triangle> triangles;
+    std::vector<int> materialIndices(kNumTriangles, 0);
+
+    for (auto i = 0; i < kNumTriangles; ++i)
+    {
+        ipl::Vector3f center(position(rng), position(rng), position(rng));
+        for (auto j = 0; j < 3; ++j)
+        {
+            vertices.push_back(center + ipl::Vector3f(offset(rng), offset(rng), offset(rng)));
+        }
+
+        triangles.push_back(ipl::Triangle{ { 3 * i, 3 * i + 1, 3 * i + 2 } });
+    }
+
+    auto scene = ipl::make_shared<ipl::Scene>();
+    auto staticMesh = scene->createStaticMesh(static_cast<int>(vertices.size()), kNumTriangles, 1, vertices.data(),
+                                              triangles.data(), materialIndices.data(), &material);
+    scene->addStaticMesh(staticMesh);
+    scene->commit();
+
+    return scene;
+}
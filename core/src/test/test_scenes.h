@@ -0,0 +1,158 @@
+//
+// Copyright 2017-2023 Valve Corporation.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include <atomic>
+#include <random>
+
+#include <scene.h>
+
+// Creates a scene containing 500 randomly placed triangles within a 20m cube centered at the origin, all with the
+// given material.
+ipl::shared_ptr<ipl::Scene> createRandomScene(std::mt19937& rng,
+                                              const ipl::Material& material);
+
+// Wraps a scene, and counts the number of occlusion rays traced against it. All other calls are forwarded unchanged.
+class OcclusionRayCountingScene : public ipl::IScene
+{
+public:
+    OcclusionRayCountingScene(ipl::shared_ptr<ipl::IScene> scene)
+        : mScene(scene)
+        , mNumOcclusionRays(0)
+    {}
+
+    int64_t numOcclusionRays() const
+    {
+        return mNumOcclusionRays;
+    }
+
+    void resetNumOcclusionRays()
+    {
+        mNumOcclusionRays = 0;
+    }
+
+    virtual int numStaticMeshes() const override
+    {
+        return mScene->numStaticMeshes();
+    }
+
+    virtual int numInstancedMeshes() const override
+    {
+        return mScene->numInstancedMeshes();
+    }
+
+    virtual ipl::shared_ptr<ipl::IStaticMesh> createStaticMesh(int numVertices,
+                                                               int numTriangles,
+                                                               int numMaterials,
+                                                               const ipl::Vector3f* vertices,
+                                                               const ipl::Triangle* triangles,
+                                                               const int* materialIndices,
+                                                               const ipl::Material* materials) override
+    {
+        return mScene->createStaticMesh(numVertices, numTriangles, numMaterials, vertices, triangles, materialIndices,
+                                        materials);
+    }
+
+    virtual ipl::shared_ptr<ipl::IStaticMesh> createStaticMesh(ipl::SerializedObject& serializedObject) override
+    {
+        return mScene->createStaticMesh(serializedObject);
+    }
+
+    virtual ipl::shared_ptr<ipl::IInstancedMesh> createInstancedMesh(ipl::shared_ptr<ipl::IScene> subScene,
+                                                                     const ipl::Matrix4x4f& transform) override
+    {
+        return mScene->createInstancedMesh(subScene, transform);
+    }
+
+    virtual void addStaticMesh(ipl::shared_ptr<ipl::IStaticMesh> staticMesh) override
+    {
+        mScene->addStaticMesh(staticMesh);
+    }
+
+    virtual void removeStaticMesh(ipl::shared_ptr<ipl::IStaticMesh> staticMesh) override
+    {
+        mScene->removeStaticMesh(staticMesh);
+    }
+
+    virtual void addInstancedMesh(ipl::shared_ptr<ipl::IInstancedMesh> instancedMesh) override
+    {
+        mScene->addInstancedMesh(instancedMesh);
+    }
+
+    virtual void removeInstancedMesh(ipl::shared_ptr<ipl::IInstancedMesh> instancedMesh) override
+    {
+        mScene->removeInstancedMesh(instancedMesh);
+    }
+
+    virtual void commit() override
+    {
+        mScene->commit();
+    }
+
+    virtual void commit(ipl::SceneCommitFlags flags) override
+    {
+        mScene->commit(flags);
+    }
+
+    virtual uint32_t version() const override
+    {
+        return mScene->version();
+    }
+
+    virtual ipl::Hit closestHit(const ipl::Ray& ray,
+                                float minDistance,
+                                float maxDistance) const override
+    {
+        return mScene->closestHit(ray, minDistance, maxDistance);
+    }
+
+    virtual bool anyHit(const ipl::Ray& ray,
+                        float minDistance,
+                        float maxDistance) const override
+    {
+        ++mNumOcclusionRays;
+        return mScene->anyHit(ray, minDistance, maxDistance);
+    }
+
+    virtual void closestHits(int numRays,
+                             const ipl::Ray* rays,
+                             const float* minDistances,
+                             const float* maxDistances,
+                             ipl::Hit* hits) const override
+    {
+        mScene->closestHits(numRays, rays, minDistances, maxDistances, hits);
+    }
+
+    virtual void anyHits(int numRays,
+                         const ipl::Ray* rays,
+                         const float* minDistances,
+                         const float* maxDistances,
+                         bool* occluded) const override
+    {
+        mNumOcclusionRays += numRays;
+        mScene->anyHits(numRays, rays, minDistances, maxDistances, occluded);
+    }
+
+    virtual void dumpObj(const ipl::string& fileName) const override
+    {
+        mScene->dumpObj(fileName);
+    }
+
+private:
+    ipl::shared_ptr<ipl::IScene> mScene;
+    mutable std::atomic<int64_t> mNumOcclusionRays;
+};